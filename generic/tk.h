@@ -1049,6 +1049,8 @@ typedef void	(Tk_ItemInsertProc)(Tk_Canvas canvas, Tk_Item *itemPtr,
 #endif /* USE_OLD_CANVAS */
 typedef void	(Tk_ItemDCharsProc)(Tk_Canvas canvas, Tk_Item *itemPtr,
 		    int first, int last);
+typedef int	(Tk_ItemCoordArrayProc)(Tcl_Interp *interp, Tk_Canvas canvas,
+		    Tk_Item *itemPtr, int numCoords, double *coordPtr);
 
 #ifndef __NO_OLD_CONFIG
 
@@ -1103,7 +1105,11 @@ typedef struct Tk_ItemType {
 				/* Procedure to delete characters from an
 				 * item. */
     struct Tk_ItemType *nextPtr;/* Used to link types together into a list. */
-    char *reserved1;		/* Reserved for future extension. */
+    Tk_ItemCoordArrayProc *coordArrayProc;
+				/* Procedure to get and set the item's
+				 * coordinates as an array of doubles, or
+				 * NULL if the item only supports
+				 * coordProc. */
     int reserved2;		/* Carefully compatible with */
     char *reserved3;		/* Jan Nijtmans dash patch */
     char *reserved4;
@@ -47,11 +47,35 @@ static const char *const atomNameArray[] = {
     NULL
 };
 
+/*
+ * The following are the other atoms Tk itself uses on X11. They are all
+ * interned with a single request when a display is opened (see
+ * TkPrefetchAtoms), rather than one round trip at a time on first use.
+ */
+
+static const char *const tkAtomNameArray[] = {
+    "CLIPBOARD",	"COMPOUND_TEXT",	"INCR",
+    "MULTIPLE",		"TARGETS",		"TEXT",
+    "TIMESTAMP",	"TK_APPLICATION",	"TK_WINDOW",
+    "UTF8_STRING",	"Comm",			"InterpRegistry",
+    "TK_SEND_SOCKET",
+    "WM_PROTOCOLS",	"WM_DELETE_WINDOW",	"__WM_ROOT",
+    "__SWM_ROOT",	"_NET_WM_PID",		"_NET_WM_PING",
+    "_NET_WM_NAME",	"_NET_WM_ICON_NAME",	"_NET_WM_ICON",
+    "_NET_WM_STATE",	"_NET_WM_STATE_ABOVE",	"_NET_WM_STATE_FULLSCREEN",
+    "_NET_WM_STATE_MAXIMIZED_HORZ",		"_NET_WM_STATE_MAXIMIZED_VERT",
+    "_NET_WM_WINDOW_TYPE",			"_NET_WM_WINDOW_OPACITY",
+    NULL
+};
+
 /*
  * Forward references to functions defined in this file:
  */
 
 static void	AtomInit(TkDisplay *dispPtr);
+static void	InternAtoms(TkDisplay *dispPtr, int count,
+		    const char *const *names, Atom *atoms);
+static void	SetAtom(TkDisplay *dispPtr, Tcl_HashEntry *hPtr, Atom atom);
 
 /*
  *--------------------------------------------------------------
@@ -89,16 +113,69 @@ Tk_InternAtom(
 
     hPtr = Tcl_CreateHashEntry(&dispPtr->nameTable, name, &isNew);
     if (isNew) {
-	Tcl_HashEntry *hPtr2;
-	Atom atom;
-
-	atom = XInternAtom(dispPtr->display, name, False);
-	Tcl_SetHashValue(hPtr, INT2PTR(atom));
-	hPtr2 = Tcl_CreateHashEntry(&dispPtr->atomTable, INT2PTR(atom), &isNew);
-	Tcl_SetHashValue(hPtr2, Tcl_GetHashKey(&dispPtr->nameTable, hPtr));
+	SetAtom(dispPtr, hPtr, XInternAtom(dispPtr->display, name, False));
     }
     return (Atom)PTR2INT(Tcl_GetHashValue(hPtr));
 }
+
+/*
+ *--------------------------------------------------------------
+ *
+ * Tk_InternAtoms --
+ *
+ *	Like Tk_InternAtom, but for several names at once: all the names not
+ *	in the local cache yet are sent to the server in a single request.
+ *	Extensions can call this once when they are loaded, for all the atoms
+ *	they use.
+ *
+ * Results:
+ *	If atoms isn't NULL, atoms[i] is set to the Atom for names[i].
+ *
+ * Side effects:
+ *	New entries may be added to the local atom cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+Tk_InternAtoms(
+    Tk_Window tkwin,		/* Window token; map names to atoms for this
+				 * window's display. */
+    int count,			/* Number of names. */
+    const char *const *names,	/* Names to turn into atoms. */
+    Atom *atoms)		/* Where to store the atoms, or NULL. */
+{
+    InternAtoms(((TkWindow *) tkwin)->dispPtr, count, names, atoms);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPrefetchAtoms --
+ *
+ *	Called when a display is opened, to intern all the atoms Tk is known
+ *	to use on it with a single request.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The atoms are added to the local atom cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPrefetchAtoms(
+    TkDisplay *dispPtr)		/* Display just opened. */
+{
+    int count = 0;
+
+    while (tkAtomNameArray[count] != NULL) {
+	count++;
+    }
+    InternAtoms(dispPtr, count, tkAtomNameArray, NULL);
+}
 
 /*
  *--------------------------------------------------------------
@@ -206,6 +283,110 @@ AtomInit(
     }
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * InternAtoms --
+ *
+ *	The guts of Tk_InternAtoms and TkPrefetchAtoms.
+ *
+ * Results:
+ *	If atoms isn't NULL, atoms[i] is set to the Atom for names[i].
+ *
+ * Side effects:
+ *	New entries may be added to the local atom cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+InternAtoms(
+    TkDisplay *dispPtr,		/* Display to intern the atoms on. */
+    int count,			/* Number of names. */
+    const char *const *names,	/* Names to turn into atoms. */
+    Atom *atoms)		/* Where to store the atoms, or NULL. */
+{
+    Tcl_HashEntry *hPtr, **newPtrs;
+    char **newNames;
+    Atom *newAtoms;
+    int i, isNew, numNew = 0;
+
+    if (count <= 0) {
+	return;
+    }
+    if (!dispPtr->atomInit) {
+	AtomInit(dispPtr);
+    }
+
+    newPtrs = ckalloc(count * sizeof(Tcl_HashEntry *));
+    newNames = ckalloc(count * sizeof(char *));
+    newAtoms = ckalloc(count * sizeof(Atom));
+    for (i = 0; i < count; i++) {
+	hPtr = Tcl_CreateHashEntry(&dispPtr->nameTable, names[i], &isNew);
+	if (isNew) {
+	    newPtrs[numNew] = hPtr;
+	    newNames[numNew] = Tcl_GetHashKey(&dispPtr->nameTable, hPtr);
+	    numNew++;
+	}
+    }
+
+    if (numNew > 0) {
+#if !defined(_WIN32) && !defined(MAC_OSX_TK)
+	if (!XInternAtoms(dispPtr->display, newNames, numNew, False,
+		newAtoms))
+#endif
+	{
+	    for (i = 0; i < numNew; i++) {
+		newAtoms[i] = XInternAtom(dispPtr->display, newNames[i],
+			False);
+	    }
+	}
+	for (i = 0; i < numNew; i++) {
+	    SetAtom(dispPtr, newPtrs[i], newAtoms[i]);
+	}
+    }
+
+    if (atoms != NULL) {
+	for (i = 0; i < count; i++) {
+	    hPtr = Tcl_FindHashEntry(&dispPtr->nameTable, names[i]);
+	    atoms[i] = (Atom) PTR2INT(Tcl_GetHashValue(hPtr));
+	}
+    }
+    ckfree(newPtrs);
+    ckfree(newNames);
+    ckfree(newAtoms);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * SetAtom --
+ *
+ *	Records a newly interned atom in both directions of the local cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The name entry hPtr gets its value, and a reverse entry is made.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+SetAtom(
+    TkDisplay *dispPtr,		/* Display the atom belongs to. */
+    Tcl_HashEntry *hPtr,	/* New entry in dispPtr->nameTable. */
+    Atom atom)			/* Atom for its name. */
+{
+    Tcl_HashEntry *hPtr2;
+    int isNew;
+
+    Tcl_SetHashValue(hPtr, INT2PTR(atom));
+    hPtr2 = Tcl_CreateHashEntry(&dispPtr->atomTable, INT2PTR(atom), &isNew);
+    Tcl_SetHashValue(hPtr2, Tcl_GetHashKey(&dispPtr->nameTable, hPtr));
+}
+
 /*
  * Local Variables:
  * mode: c
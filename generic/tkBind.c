@@ -2234,6 +2234,13 @@ ExpandPercents(
 
 	    tkwin = Tk_IdToWindow(eventPtr->xany.display,
 		    eventPtr->xany.window);
+	    if ((tkwin == NULL) && (eventPtr->xany.window == None)) {
+		/*
+		 * Event synthesized for a windowless window.
+		 */
+
+		tkwin = (Tk_Window) winPtr;
+	    }
 	    if (tkwin != NULL) {
 		string = Tk_PathName(tkwin);
 	    } else {
@@ -147,6 +147,8 @@ static const Tk_OptionSpec labelOptionSpecs[] = {
 	DEF_BUTTON_UNDERLINE, -1, Tk_Offset(TkButton, underline), 0, 0, 0},
     {TK_OPTION_STRING, "-width", "width", "Width",
 	DEF_BUTTON_WIDTH, Tk_Offset(TkButton, widthPtr), -1, 0, 0, 0},
+    {TK_OPTION_BOOLEAN, "-windowless", "windowless", "Windowless",
+	DEF_LABEL_WINDOWLESS, -1, Tk_Offset(TkButton, windowless), 0, 0, 0},
     {TK_OPTION_PIXELS, "-wraplength", "wrapLength", "WrapLength",
 	DEF_BUTTON_WRAP_LENGTH, Tk_Offset(TkButton, wrapLengthPtr),
 	Tk_Offset(TkButton, wrapLength), 0, 0, 0},
@@ -743,6 +745,7 @@ ButtonCreate(
     butPtr->cursor = None;
     butPtr->takeFocusPtr = NULL;
     butPtr->commandPtr = NULL;
+    butPtr->windowless = 0;
     butPtr->flags = 0;
 
     Tk_CreateEventHandler(butPtr->tkwin,
@@ -758,6 +761,9 @@ ButtonCreate(
 	Tk_DestroyWindow(butPtr->tkwin);
 	return TCL_ERROR;
     }
+    if (butPtr->windowless) {
+	TkSetWindowless(butPtr->tkwin);
+    }
 
     Tcl_SetObjResult(interp, TkNewWindowObj(butPtr->tkwin));
     return TCL_OK;
@@ -828,6 +834,26 @@ ButtonWidgetObjCmd(
 	    }
 	    Tcl_SetObjResult(interp, objPtr);
 	} else {
+	    int i, length;
+
+	    /*
+	     * Whether a label has a window of its own is decided when it is
+	     * created. Only the option names are looked at, not their values.
+	     */
+
+	    for (i = 2; (butPtr->type == TYPE_LABEL) && (i < objc); i += 2) {
+		const char *arg = Tcl_GetStringFromObj(objv[i], &length);
+
+		if ((length >= 4)
+			&& (strncmp(arg, "-windowless", (unsigned) length) == 0)) {
+		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			    "can't modify -windowless option after widget is "
+			    "created", -1));
+		    Tcl_SetErrorCode(interp, "TK", "LABEL", "CREATE_ONLY",
+			    NULL);
+		    goto error;
+		}
+	    }
 	    result = ConfigureButton(interp, butPtr, objc-2, objv+2);
 	}
 	break;
@@ -1483,6 +1509,16 @@ ButtonEventProc(
     return;
 
   redraw:
+    if ((butPtr->tkwin != NULL) && (Tk_WindowId(butPtr->tkwin) == None)
+	    && (butPtr->flags & REDRAW_PENDING)) {
+	/*
+	 * A windowless label must be drawn after its parent, so move the
+	 * pending redraw behind the parent's.
+	 */
+
+	Tcl_CancelIdleCall(TkpDisplayButton, butPtr);
+	butPtr->flags &= ~REDRAW_PENDING;
+    }
     if ((butPtr->tkwin != NULL) && !(butPtr->flags & REDRAW_PENDING)) {
 	Tcl_DoWhenIdle(TkpDisplayButton, butPtr);
 	butPtr->flags |= REDRAW_PENDING;
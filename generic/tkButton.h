@@ -253,6 +253,10 @@ typedef struct {
     int repeatInterval;		/* Value of -repeatinterval option; specifies
 				 * the number of ms between auto-repeat
 				 * invocataions of the button command. */
+    int windowless;		/* Value of -windowless option; non-zero means
+				 * the label is drawn into its parent's window
+				 * rather than having one of its own. Used
+				 * only by labels. */
     int flags;			/* Various flags; see below for
 				 * definitions. */
 } TkButton;
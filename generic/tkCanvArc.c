@@ -220,7 +220,7 @@ Tk_ItemType tkArcType = {
     ArcCoords,			/* coordProc */
     DeleteArc,			/* deleteProc */
     DisplayArc,			/* displayProc */
-    TK_CONFIG_OBJS,		/* flags */
+    TK_CONFIG_OBJS | TK_CACHE_POSTSCRIPT,	/* flags */
     ArcToPoint,			/* pointProc */
     ArcToArea,			/* areaProc */
     ArcToPostscript,		/* postscriptProc */
@@ -635,6 +635,11 @@ ComputeArcBbox(
     double width;
     Tk_State state = arcPtr->header.state;
 
+    if (TkCanvDeferBbox(canvas, &arcPtr->header,
+	    (TkCanvBboxProc *) ComputeArcBbox)) {
+	return;
+    }
+
     if (state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
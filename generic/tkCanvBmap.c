@@ -125,7 +125,7 @@ Tk_ItemType tkBitmapType = {
     BitmapCoords,		/* coordProc */
     DeleteBitmap,		/* deleteProc */
     DisplayBitmap,		/* displayProc */
-    TK_CONFIG_OBJS,		/* flags */
+    TK_CONFIG_OBJS | TK_CACHE_POSTSCRIPT,	/* flags */
     BitmapToPoint,		/* pointProc */
     BitmapToArea,		/* areaProc */
     BitmapToPostscript,		/* postscriptProc */
@@ -480,6 +480,11 @@ ComputeBitmapBbox(
     Pixmap bitmap;
     Tk_State state = bmapPtr->header.state;
 
+    if (TkCanvDeferBbox(canvas, &bmapPtr->header,
+	    (TkCanvBboxProc *) ComputeBitmapBbox)) {
+	return;
+    }
+
     if (state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
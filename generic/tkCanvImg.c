@@ -432,6 +432,11 @@ ComputeImageBbox(
     Tk_Image image;
     Tk_State state = imgPtr->header.state;
 
+    if (TkCanvDeferBbox(canvas, &imgPtr->header,
+	    (TkCanvBboxProc *) ComputeImageBbox)) {
+	return;
+    }
+
     if(state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
@@ -61,6 +61,25 @@ typedef struct LineItem {
     const Tk_SmoothMethod *smooth; /* Non-zero means draw line smoothed (i.e.
 				 * with Bezier splines). */
     int splineSteps;		/* Number of steps in each spline segment. */
+    double *smoothPtr;		/* Malloc-ed array holding the flattened
+				 * spline for smoothed lines, in canvas
+				 * coordinates (same layout as coordPtr).
+				 * NULL means it hasn't been generated since
+				 * the line's geometry last changed. */
+    int numSmoothPoints;	/* Number of points in *smoothPtr. */
+    int decimate;		/* Non-zero means that, for display, the line
+				 * is reduced to a few points per pixel
+				 * column first. */
+    double *decimPtr;		/* Malloc-ed array holding the decimated
+				 * display points, or NULL if they haven't
+				 * been computed since the geometry last
+				 * changed. */
+    int numDecimPoints;		/* Number of points in *decimPtr. */
+    int decimMonotonic;		/* Non-zero means the pixel columns of the
+				 * points in *decimPtr never decrease, so the
+				 * visible part can be found by bisection. */
+    TkCanvPathCache pathCache;	/* Screen coordinates of the displayed
+				 * points, kept between redraws. */
 } LineItem;
 
 /*
@@ -92,9 +111,16 @@ static void		DisplayLine(Tk_Canvas canvas,
 static int		GetLineIndex(Tcl_Interp *interp,
 			    Tk_Canvas canvas, Tk_Item *itemPtr,
 			    Tcl_Obj *obj, int *indexPtr);
+static double *		GetLineDecimatedPoints(Tk_Canvas canvas,
+			    LineItem *linePtr, int *numPointsPtr);
+static double *		GetLineSmoothPoints(Tk_Canvas canvas,
+			    LineItem *linePtr, int *numPointsPtr);
 static int		LineCoords(Tcl_Interp *interp,
 			    Tk_Canvas canvas, Tk_Item *itemPtr,
 			    int objc, Tcl_Obj *const objv[]);
+static int		LineCoordArray(Tcl_Interp *interp,
+			    Tk_Canvas canvas, Tk_Item *itemPtr,
+			    int numCoords, double *coordPtr);
 static void		LineDeleteCoords(Tk_Canvas canvas,
 			    Tk_Item *itemPtr, int first, int last);
 static void		LineInsert(Tk_Canvas canvas,
@@ -181,6 +207,8 @@ static const Tk_ConfigSpec configSpecs[] = {
 	TK_CONFIG_NULL_OK, &dashOption},
     {TK_CONFIG_PIXELS, "-dashoffset", NULL, NULL,
 	"0", Tk_Offset(LineItem, outline.offset), TK_CONFIG_DONT_SET_DEFAULT, NULL},
+    {TK_CONFIG_BOOLEAN, "-decimate", NULL, NULL,
+	"0", Tk_Offset(LineItem, decimate), TK_CONFIG_DONT_SET_DEFAULT, NULL},
     {TK_CONFIG_CUSTOM, "-disableddash", NULL, NULL,
 	NULL, Tk_Offset(LineItem, outline.disabledDash),
 	TK_CONFIG_NULL_OK, &dashOption},
@@ -227,7 +255,8 @@ Tk_ItemType tkLineType = {
     LineCoords,				/* coordProc */
     DeleteLine,				/* deleteProc */
     DisplayLine,			/* displayProc */
-    TK_CONFIG_OBJS | TK_MOVABLE_POINTS,	/* flags */
+    TK_CONFIG_OBJS | TK_MOVABLE_POINTS | TK_CACHE_POSTSCRIPT,
+				/* flags */
     LineToPoint,			/* pointProc */
     LineToArea,				/* areaProc */
     LineToPostscript,			/* postscriptProc */
@@ -239,7 +268,8 @@ Tk_ItemType tkLineType = {
     LineInsert,				/* insertProc */
     LineDeleteCoords,			/* dTextProc */
     NULL,				/* nextPtr */
-    NULL, 0, NULL, NULL
+    LineCoordArray,			/* coordArrayProc */
+    0, NULL, NULL
 };
 
 /*
@@ -305,6 +335,14 @@ CreateLine(
     linePtr->lastArrowPtr = NULL;
     linePtr->smooth = NULL;
     linePtr->splineSteps = 12;
+    linePtr->smoothPtr = NULL;
+    linePtr->numSmoothPoints = 0;
+    linePtr->decimate = 0;
+    linePtr->decimPtr = NULL;
+    linePtr->numDecimPoints = 0;
+    linePtr->decimMonotonic = 0;
+    linePtr->pathCache.pointPtr = NULL;
+    linePtr->pathCache.numPoints = 0;
 
     /*
      * Count the number of points and then parse them into a point array.
@@ -440,6 +478,99 @@ LineCoords(
     return TCL_OK;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * LineCoordArray --
+ *
+ *	This function is invoked to get or set the coordinates of a line as a
+ *	packed array of doubles, which is much cheaper than going through a
+ *	list of Tcl_Objs when the line has many points.
+ *
+ * Results:
+ *	If numCoords is negative, the line's coordinates are stored at
+ *	coordPtr (unless it is NULL) and the number of coordinates is
+ *	returned. Otherwise the line's coordinates are replaced by the
+ *	numCoords values at coordPtr and a standard Tcl result is returned; on
+ *	error, a message is left in the interp's result.
+ *
+ * Side effects:
+ *	The coordinates for the given item may be changed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+LineCoordArray(
+    Tcl_Interp *interp,		/* Used for error reporting. */
+    Tk_Canvas canvas,		/* Canvas containing item. */
+    Tk_Item *itemPtr,		/* Item whose coordinates are to be read or
+				 * modified. */
+    int numCoords,		/* Number of coordinates at coordPtr, or -1
+				 * to read the coordinates. */
+    double *coordPtr)		/* Array of coordinates: x1, y1, x2, y2, ... */
+{
+    LineItem *linePtr = (LineItem *) itemPtr;
+    int numPoints;
+
+    if (numCoords < 0) {
+	numCoords = 2*linePtr->numPoints;
+	if (coordPtr != NULL && numCoords > 0) {
+	    memcpy(coordPtr, linePtr->coordPtr, numCoords * sizeof(double));
+	    if (linePtr->firstArrowPtr != NULL) {
+		coordPtr[0] = linePtr->firstArrowPtr[0];
+		coordPtr[1] = linePtr->firstArrowPtr[1];
+	    }
+	    if (linePtr->lastArrowPtr != NULL) {
+		coordPtr[numCoords-2] = linePtr->lastArrowPtr[0];
+		coordPtr[numCoords-1] = linePtr->lastArrowPtr[1];
+	    }
+	}
+	return numCoords;
+    }
+    if (numCoords & 1) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"wrong # coordinates: expected an even number, got %d",
+		numCoords));
+	Tcl_SetErrorCode(interp, "TK", "CANVAS", "COORDS", "LINE", NULL);
+	return TCL_ERROR;
+    } else if (numCoords < 4) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"wrong # coordinates: expected at least 4, got %d", numCoords));
+	Tcl_SetErrorCode(interp, "TK", "CANVAS", "COORDS", "LINE", NULL);
+	return TCL_ERROR;
+    }
+
+    numPoints = numCoords/2;
+    if (linePtr->numPoints != numPoints) {
+	if (linePtr->coordPtr != NULL) {
+	    ckfree(linePtr->coordPtr);
+	}
+	linePtr->coordPtr = ckalloc(sizeof(double) * numCoords);
+	linePtr->numPoints = numPoints;
+    }
+    memcpy(linePtr->coordPtr, coordPtr, numCoords * sizeof(double));
+
+    /*
+     * Update arrowheads by throwing away any existing arrow-head information
+     * and calling ConfigureArrows to recompute it.
+     */
+
+    if (linePtr->firstArrowPtr != NULL) {
+	ckfree(linePtr->firstArrowPtr);
+	linePtr->firstArrowPtr = NULL;
+    }
+    if (linePtr->lastArrowPtr != NULL) {
+	ckfree(linePtr->lastArrowPtr);
+	linePtr->lastArrowPtr = NULL;
+    }
+    if (linePtr->arrow != ARROWS_NONE) {
+	ConfigureArrows(canvas, linePtr);
+    }
+    ComputeLineBbox(canvas, linePtr);
+    return TCL_OK;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -620,6 +751,13 @@ DeleteLine(
     if (linePtr->lastArrowPtr != NULL) {
 	ckfree(linePtr->lastArrowPtr);
     }
+    if (linePtr->smoothPtr != NULL) {
+	ckfree(linePtr->smoothPtr);
+    }
+    if (linePtr->decimPtr != NULL) {
+	ckfree(linePtr->decimPtr);
+    }
+    TkCanvFreePathCache(&linePtr->pathCache);
 }
 
 /*
@@ -635,6 +773,8 @@ DeleteLine(
  *
  * Side effects:
  *	The fields x1, y1, x2, and y2 are updated in the header for itemPtr.
+ *	Since this is called whenever the line's geometry changes, any cached
+ *	spline, decimated or screen points are discarded too.
  *
  *--------------------------------------------------------------
  */
@@ -650,6 +790,23 @@ ComputeLineBbox(
     Tk_State state = linePtr->header.state;
     Tk_TSOffset *tsoffset;
 
+    if (linePtr->smoothPtr != NULL) {
+	ckfree(linePtr->smoothPtr);
+	linePtr->smoothPtr = NULL;
+	linePtr->numSmoothPoints = 0;
+    }
+    if (linePtr->decimPtr != NULL) {
+	ckfree(linePtr->decimPtr);
+	linePtr->decimPtr = NULL;
+	linePtr->numDecimPoints = 0;
+    }
+    TkCanvFreePathCache(&linePtr->pathCache);
+
+    if (TkCanvDeferBbox(canvas, &linePtr->header,
+	    (TkCanvBboxProc *) ComputeLineBbox)) {
+	return;
+    }
+
     if (state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
@@ -806,6 +963,92 @@ ComputeLineBbox(
     linePtr->header.y2 += 1;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * GetLineSmoothPoints --
+ *
+ *	Returns the points of a smoothed line's spline, flattened into a
+ *	polyline in canvas coordinates. The points are generated on first use
+ *	and cached in the item until its geometry changes, so that redisplay,
+ *	hit testing and Postscript generation don't each have to expand the
+ *	spline again.
+ *
+ * Results:
+ *	A pointer to the flattened points (owned by the item; callers must not
+ *	free it). The number of points is stored at *numPointsPtr.
+ *
+ * Side effects:
+ *	Memory may be allocated for the cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double *
+GetLineSmoothPoints(
+    Tk_Canvas canvas,		/* Canvas that contains item. */
+    LineItem *linePtr,		/* Smoothed line with more than 2 points. */
+    int *numPointsPtr)		/* Where to store number of points. */
+{
+    if (linePtr->smoothPtr == NULL) {
+	int numPoints = linePtr->smooth->coordProc(canvas, NULL,
+		linePtr->numPoints, linePtr->splineSteps, NULL, NULL);
+
+	linePtr->smoothPtr = ckalloc(2 * numPoints * sizeof(double));
+	linePtr->numSmoothPoints = linePtr->smooth->coordProc(canvas,
+		linePtr->coordPtr, linePtr->numPoints, linePtr->splineSteps,
+		NULL, linePtr->smoothPtr);
+    }
+    *numPointsPtr = linePtr->numSmoothPoints;
+    return linePtr->smoothPtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetLineDecimatedPoints --
+ *
+ *	Returns the points used to display a line whose -decimate option is
+ *	set: the line's points (or its flattened spline, if it is smoothed)
+ *	reduced by Tk_CanvasDecimatePath to at most four per pixel column. The
+ *	result is cached in the item until its geometry changes, so redisplay
+ *	costs depend on the width of the line on screen rather than on the
+ *	number of points.
+ *
+ * Results:
+ *	A pointer to the decimated points (owned by the item; callers must not
+ *	free it). The number of points is stored at *numPointsPtr.
+ *
+ * Side effects:
+ *	Memory may be allocated for the cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double *
+GetLineDecimatedPoints(
+    Tk_Canvas canvas,		/* Canvas that contains item. */
+    LineItem *linePtr,		/* Line with -decimate set. */
+    int *numPointsPtr)		/* Where to store number of points. */
+{
+    if (linePtr->decimPtr == NULL) {
+	double *linePoints;
+	int numPoints;
+
+	if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
+	    linePoints = GetLineSmoothPoints(canvas, linePtr, &numPoints);
+	} else {
+	    linePoints = linePtr->coordPtr;
+	    numPoints = linePtr->numPoints;
+	}
+	linePtr->decimPtr = ckalloc(2 * numPoints * sizeof(double));
+	linePtr->numDecimPoints = Tk_CanvasDecimatePath(numPoints, linePoints,
+		linePtr->decimPtr, &linePtr->decimMonotonic);
+    }
+    *numPointsPtr = linePtr->numDecimPoints;
+    return linePtr->decimPtr;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -831,13 +1074,14 @@ DisplayLine(
     Drawable drawable,		/* Pixmap or window in which to draw item. */
     int x, int y, int width, int height)
 				/* Describes region of canvas that must be
-				 * redisplayed (not used). */
+				 * redisplayed (only used for decimated
+				 * lines). */
 {
     LineItem *linePtr = (LineItem *) itemPtr;
     XPoint staticPoints[MAX_STATIC_POINTS*3];
     XPoint *pointPtr;
-    double linewidth;
-    int numPoints;
+    double linewidth, *linePoints;
+    int numPoints, first, count, batch;
     Tk_State state = itemPtr->state;
 
     if ((!linePtr->numPoints) || (linePtr->outline.gc == None)) {
@@ -860,29 +1104,81 @@ DisplayLine(
     /*
      * Build up an array of points in screen coordinates. Use a static array
      * unless the line has an enormous number of points; in this case,
-     * dynamically allocate an array. For smoothed lines, generate the curve
-     * points on each redisplay.
+     * dynamically allocate an array. For smoothed lines, use the cached
+     * curve points.
      */
 
-    if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
-	numPoints = linePtr->smooth->coordProc(canvas, NULL,
-		linePtr->numPoints, linePtr->splineSteps, NULL, NULL);
+    if (linePtr->decimate && (linePtr->numPoints > 2)) {
+	linePoints = GetLineDecimatedPoints(canvas, linePtr, &numPoints);
+	first = 0;
+	count = numPoints;
+
+	/*
+	 * If the decimated points are sorted by column, only the part of the
+	 * line that crosses the area being redrawn (plus a margin for caps
+	 * and joins) needs to go to the server. Dashed lines are always drawn
+	 * in full, since cutting them would shift the dash pattern.
+	 */
+
+	if (linePtr->decimMonotonic && (linePtr->outline.dash.number == 0)
+		&& (linePtr->outline.activeDash.number == 0)
+		&& (linePtr->outline.disabledDash.number == 0)) {
+	    double left = x - linewidth - 2.0;
+	    double right = x + width + linewidth + 2.0;
+	    int lo, hi, mid, last;
+
+	    for (lo = 0, hi = numPoints; lo < hi; ) {
+		mid = (lo + hi) / 2;
+		if (linePoints[2*mid] < left) {
+		    lo = mid + 1;
+		} else {
+		    hi = mid;
+		}
+	    }
+	    first = (lo > 0) ? lo - 1 : 0;
+	    for (hi = numPoints; lo < hi; ) {
+		mid = (lo + hi) / 2;
+		if (linePoints[2*mid] <= right) {
+		    lo = mid + 1;
+		} else {
+		    hi = mid;
+		}
+	    }
+	    last = (lo < numPoints) ? lo : numPoints - 1;
+	    count = (last > first) ? last - first + 1 : 0;
+	}
     } else {
-	numPoints = linePtr->numPoints;
+	if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
+	    linePoints = GetLineSmoothPoints(canvas, linePtr, &numPoints);
+	} else {
+	    linePoints = linePtr->coordPtr;
+	    numPoints = linePtr->numPoints;
+	}
+	first = 0;
+	count = numPoints;
     }
 
-    if (numPoints <= MAX_STATIC_POINTS) {
+    /*
+     * The screen coordinates of the whole line are kept between redraws, so
+     * normally they only need shifting to the drawable's origin. Lines that
+     * need clipping at the current scroll position are translated afresh.
+     */
+
+    if (count <= MAX_STATIC_POINTS) {
 	pointPtr = staticPoints;
     } else {
-	pointPtr = ckalloc(numPoints * 3 * sizeof(XPoint));
+	pointPtr = ckalloc(count * 3 * sizeof(XPoint));
     }
-
-    if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
-	numPoints = linePtr->smooth->coordProc(canvas, linePtr->coordPtr,
-		linePtr->numPoints, linePtr->splineSteps, pointPtr, NULL);
+    if (count > 0) {
+	numPoints = TkCanvTranslateCachedPath((TkCanvas *) canvas,
+		&linePtr->pathCache, numPoints, linePoints, first, count,
+		pointPtr);
+	if (numPoints < 0) {
+	    numPoints = TkCanvTranslatePath((TkCanvas *) canvas, count,
+		    linePoints + 2*first, 0, pointPtr, NULL);
+	}
     } else {
-	numPoints = TkCanvTranslatePath((TkCanvas *) canvas, numPoints,
-		linePtr->coordPtr, 0, pointPtr);
+	numPoints = 0;
     }
 
     /*
@@ -892,14 +1188,35 @@ DisplayLine(
      * read-only.
      */
 
+    /*
+     * A single segment with neither arrows, dashes nor stipples leaves the
+     * GC as it is, and is added to the canvas's batch of segments (see
+     * TkCanvDrawSegment). Items with the same look share their GCs
+     * (Tk_GetGC), so a run of such lines goes out in one XDrawSegments
+     * call. Anything else is drawn at once, after the waiting segments.
+     */
+
+    batch = (numPoints == 2) && (linePtr->arrow == ARROWS_NONE)
+	    && (linePtr->outline.dash.number == 0)
+	    && (linePtr->outline.activeDash.number == 0)
+	    && (linePtr->outline.disabledDash.number == 0)
+	    && (linePtr->outline.stipple == None)
+	    && (linePtr->outline.activeStipple == None)
+	    && (linePtr->outline.disabledStipple == None);
+    if (!batch) {
+	TkCanvFlushSegments((TkCanvas *) canvas);
+    }
     if (Tk_ChangeOutlineGC(canvas, itemPtr, &linePtr->outline)) {
 	Tk_CanvasSetOffset(canvas, linePtr->arrowGC,
 		&linePtr->outline.tsoffset);
     }
-    if (numPoints > 1) {
+    if (batch) {
+	TkCanvDrawSegment((TkCanvas *) canvas, drawable,
+		linePtr->outline.gc, pointPtr);
+    } else if (numPoints > 1) {
 	XDrawLines(display, drawable, linePtr->outline.gc, pointPtr, numPoints,
 		CoordModeOrigin);
-    } else {
+    } else if (numPoints == 1) {
 	int intwidth = (int) (linewidth + 0.5);
 
 	if (intwidth < 1) {
@@ -1328,7 +1645,6 @@ LineToPoint(
     Tk_State state = itemPtr->state;
     LineItem *linePtr = (LineItem *) itemPtr;
     double *coordPtr, *linePoints;
-    double staticSpace[2*MAX_STATIC_POINTS];
     double poly[10];
     double bestDist, dist, width;
     int numPoints, count;
@@ -1359,15 +1675,7 @@ LineToPoint(
     }
 
     if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
-	numPoints = linePtr->smooth->coordProc(canvas, NULL,
-		linePtr->numPoints, linePtr->splineSteps, NULL, NULL);
-	if (numPoints <= MAX_STATIC_POINTS) {
-	    linePoints = staticSpace;
-	} else {
-	    linePoints = ckalloc(2 * numPoints * sizeof(double));
-	}
-	numPoints = linePtr->smooth->coordProc(canvas, linePtr->coordPtr,
-		linePtr->numPoints, linePtr->splineSteps, NULL, linePoints);
+	linePoints = GetLineSmoothPoints(canvas, linePtr, &numPoints);
     } else {
 	numPoints = linePtr->numPoints;
 	linePoints = linePtr->coordPtr;
@@ -1522,9 +1830,6 @@ LineToPoint(
     }
 
   done:
-    if ((linePoints != staticSpace) && (linePoints != linePtr->coordPtr)) {
-	ckfree(linePoints);
-    }
     return bestDist;
 }
 
@@ -1554,7 +1859,6 @@ LineToArea(
     double *rectPtr)
 {
     LineItem *linePtr = (LineItem *) itemPtr;
-    double staticSpace[2*MAX_STATIC_POINTS];
     double *linePoints;
     int numPoints, result;
     double radius, width;
@@ -1594,15 +1898,7 @@ LineToArea(
      */
 
     if ((linePtr->smooth) && (linePtr->numPoints > 2)) {
-	numPoints = linePtr->smooth->coordProc(canvas, NULL,
-		linePtr->numPoints, linePtr->splineSteps, NULL, NULL);
-	if (numPoints <= MAX_STATIC_POINTS) {
-	    linePoints = staticSpace;
-	} else {
-	    linePoints = ckalloc(2 * numPoints * sizeof(double));
-	}
-	numPoints = linePtr->smooth->coordProc(canvas, linePtr->coordPtr,
-		linePtr->numPoints, linePtr->splineSteps, NULL, linePoints);
+	linePoints = GetLineSmoothPoints(canvas, linePtr, &numPoints);
     } else {
 	numPoints = linePtr->numPoints;
 	linePoints = linePtr->coordPtr;
@@ -1644,9 +1940,6 @@ LineToArea(
     }
 
   done:
-    if ((linePoints != staticSpace) && (linePoints != linePtr->coordPtr)) {
-	ckfree(linePoints);
-    }
     return result;
 }
 
@@ -2357,22 +2650,11 @@ LineToPostscript(
 	 * output them into the Postscript file with "lineto"s instead.
 	 */
 
-	double staticPoints[2*MAX_STATIC_POINTS];
 	double *pointPtr;
 	int numPoints;
 
-	numPoints = linePtr->smooth->coordProc(canvas, NULL,
-		linePtr->numPoints, linePtr->splineSteps, NULL, NULL);
-	pointPtr = staticPoints;
-	if (numPoints > MAX_STATIC_POINTS) {
-	    pointPtr = ckalloc(numPoints * 2 * sizeof(double));
-	}
-	numPoints = linePtr->smooth->coordProc(canvas, linePtr->coordPtr,
-		linePtr->numPoints, linePtr->splineSteps, NULL, pointPtr);
+	pointPtr = GetLineSmoothPoints(canvas, linePtr, &numPoints);
 	Tk_CanvasPsPath(interp, canvas, pointPtr, numPoints);
-	if (pointPtr != staticPoints) {
-	    ckfree(pointPtr);
-	}
     }
     Tcl_AppendObjToObj(psObj, Tcl_GetObjResult(interp));
 
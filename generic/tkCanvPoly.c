@@ -48,6 +48,14 @@ typedef struct PolygonItem  {
     int splineSteps;		/* Number of steps in each spline segment. */
     int autoClosed;		/* Zero means the given polygon was closed,
 				   one means that we auto closed it. */
+    double *smoothPtr;		/* Malloc-ed array holding the flattened
+				 * spline for smoothed polygons, in canvas
+				 * coordinates. NULL means it hasn't been
+				 * generated since the geometry last
+				 * changed. */
+    int numSmoothPoints;	/* Number of points in *smoothPtr. */
+    TkCanvPathCache pathCache;	/* Screen coordinates of the displayed
+				 * points, kept between redraws. */
 } PolygonItem;
 
 /*
@@ -163,9 +171,14 @@ static void		DisplayPolygon(Tk_Canvas canvas,
 static int		GetPolygonIndex(Tcl_Interp *interp,
 			    Tk_Canvas canvas, Tk_Item *itemPtr,
 			    Tcl_Obj *obj, int *indexPtr);
+static double *		GetPolygonSmoothPoints(Tk_Canvas canvas,
+			    PolygonItem *polyPtr, int *numPointsPtr);
 static int		PolygonCoords(Tcl_Interp *interp,
 			    Tk_Canvas canvas, Tk_Item *itemPtr,
 			    int objc, Tcl_Obj *const objv[]);
+static int		PolygonCoordArray(Tcl_Interp *interp,
+			    Tk_Canvas canvas, Tk_Item *itemPtr,
+			    int numCoords, double *coordPtr);
 static void		PolygonDeleteCoords(Tk_Canvas canvas,
 			    Tk_Item *itemPtr, int first, int last);
 static void		PolygonInsert(Tk_Canvas canvas,
@@ -196,7 +209,8 @@ Tk_ItemType tkPolygonType = {
     PolygonCoords,			/* coordProc */
     DeletePolygon,			/* deleteProc */
     DisplayPolygon,			/* displayProc */
-    TK_CONFIG_OBJS | TK_MOVABLE_POINTS,	/* flags */
+    TK_CONFIG_OBJS | TK_MOVABLE_POINTS | TK_CACHE_POSTSCRIPT,
+				/* flags */
     PolygonToPoint,			/* pointProc */
     PolygonToArea,			/* areaProc */
     PolygonToPostscript,		/* postscriptProc */
@@ -208,7 +222,8 @@ Tk_ItemType tkPolygonType = {
     PolygonInsert,		/* insertProc */
     PolygonDeleteCoords,		/* dTextProc */
     NULL,				/* nextPtr */
-    NULL, 0, NULL, NULL
+    PolygonCoordArray,			/* coordArrayProc */
+    0, NULL, NULL
 };
 
 /*
@@ -277,6 +292,10 @@ CreatePolygon(
     polyPtr->smooth = NULL;
     polyPtr->splineSteps = 12;
     polyPtr->autoClosed = 0;
+    polyPtr->smoothPtr = NULL;
+    polyPtr->numSmoothPoints = 0;
+    polyPtr->pathCache.pointPtr = NULL;
+    polyPtr->pathCache.numPoints = 0;
 
     /*
      * Count the number of points and then parse them into a point array.
@@ -402,6 +421,94 @@ PolygonCoords(
     return TCL_OK;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * PolygonCoordArray --
+ *
+ *	This function is invoked to get or set the coordinates of a polygon as
+ *	a packed array of doubles, which is much cheaper than going through a
+ *	list of Tcl_Objs when the polygon has many points.
+ *
+ * Results:
+ *	If numCoords is negative, the polygon's coordinates (without the
+ *	point added to close it, if any) are stored at coordPtr (unless it is
+ *	NULL) and the number of coordinates is returned. Otherwise the
+ *	polygon's coordinates are replaced by the numCoords values at coordPtr
+ *	and a standard Tcl result is returned; on error, a message is left in
+ *	the interp's result.
+ *
+ * Side effects:
+ *	The coordinates for the given item may be changed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+PolygonCoordArray(
+    Tcl_Interp *interp,		/* Used for error reporting. */
+    Tk_Canvas canvas,		/* Canvas containing item. */
+    Tk_Item *itemPtr,		/* Item whose coordinates are to be read or
+				 * modified. */
+    int numCoords,		/* Number of coordinates at coordPtr, or -1
+				 * to read the coordinates. */
+    double *coordPtr)		/* Array of coordinates: x1, y1, x2, y2, ... */
+{
+    PolygonItem *polyPtr = (PolygonItem *) itemPtr;
+    int numPoints;
+
+    if (numCoords < 0) {
+	numCoords = 2*(polyPtr->numPoints - polyPtr->autoClosed);
+	if (coordPtr != NULL && numCoords > 0) {
+	    memcpy(coordPtr, polyPtr->coordPtr, numCoords * sizeof(double));
+	}
+	return numCoords;
+    }
+    if (numCoords & 1) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"wrong # coordinates: expected an even number, got %d",
+		numCoords));
+	Tcl_SetErrorCode(interp, "TK", "CANVAS", "COORDS", "POLYGON", NULL);
+	return TCL_ERROR;
+    }
+
+    numPoints = numCoords/2;
+    if (polyPtr->pointsAllocated <= numPoints) {
+	if (polyPtr->coordPtr != NULL) {
+	    ckfree(polyPtr->coordPtr);
+	}
+
+	/*
+	 * One extra point gets allocated here, because we always add
+	 * another point to close the polygon.
+	 */
+
+	polyPtr->coordPtr = ckalloc(sizeof(double) * (numCoords+2));
+	polyPtr->pointsAllocated = numPoints+1;
+    }
+    if (numCoords > 0) {
+	memcpy(polyPtr->coordPtr, coordPtr, numCoords * sizeof(double));
+    }
+    polyPtr->numPoints = numPoints;
+    polyPtr->autoClosed = 0;
+
+    /*
+     * Close the polygon if it isn't already closed.
+     */
+
+    if (numCoords > 2
+	    && ((polyPtr->coordPtr[numCoords-2] != polyPtr->coordPtr[0])
+	    || (polyPtr->coordPtr[numCoords-1] != polyPtr->coordPtr[1]))) {
+	polyPtr->autoClosed = 1;
+	polyPtr->numPoints++;
+	polyPtr->coordPtr[numCoords] = polyPtr->coordPtr[0];
+	polyPtr->coordPtr[numCoords+1] = polyPtr->coordPtr[1];
+    }
+
+    ComputePolygonBbox(canvas, polyPtr);
+    return TCL_OK;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -593,6 +700,10 @@ DeletePolygon(
     if (polyPtr->fillGC != None) {
 	Tk_FreeGC(display, polyPtr->fillGC);
     }
+    if (polyPtr->smoothPtr != NULL) {
+	ckfree(polyPtr->smoothPtr);
+    }
+    TkCanvFreePathCache(&polyPtr->pathCache);
 }
 
 /*
@@ -608,6 +719,8 @@ DeletePolygon(
  *
  * Side effects:
  *	The fields x1, y1, x2, and y2 are updated in the header for itemPtr.
+ *	Since this is called whenever the polygon's geometry changes, any
+ *	cached spline or screen points are discarded too.
  *
  *--------------------------------------------------------------
  */
@@ -623,6 +736,18 @@ ComputePolygonBbox(
     Tk_State state = polyPtr->header.state;
     Tk_TSOffset *tsoffset;
 
+    if (polyPtr->smoothPtr != NULL) {
+	ckfree(polyPtr->smoothPtr);
+	polyPtr->smoothPtr = NULL;
+	polyPtr->numSmoothPoints = 0;
+    }
+    TkCanvFreePathCache(&polyPtr->pathCache);
+
+    if (TkCanvDeferBbox(canvas, &polyPtr->header,
+	    (TkCanvBboxProc *) ComputePolygonBbox)) {
+	return;
+    }
+
     if (state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
@@ -776,6 +901,44 @@ ComputePolygonBbox(
     polyPtr->header.y2 += 1;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * GetPolygonSmoothPoints --
+ *
+ *	Returns the points of a smoothed polygon's spline, flattened into a
+ *	closed polyline in canvas coordinates. The points are generated on
+ *	first use and kept until the polygon's geometry changes.
+ *
+ * Results:
+ *	A pointer to the flattened points (owned by the item; callers must not
+ *	free it). The number of points is stored at *numPointsPtr.
+ *
+ * Side effects:
+ *	Memory may be allocated for the cache.
+ *
+ *--------------------------------------------------------------
+ */
+
+static double *
+GetPolygonSmoothPoints(
+    Tk_Canvas canvas,		/* Canvas that contains item. */
+    PolygonItem *polyPtr,	/* Smoothed polygon. */
+    int *numPointsPtr)		/* Where to store number of points. */
+{
+    if (polyPtr->smoothPtr == NULL) {
+	int numPoints = polyPtr->smooth->coordProc(canvas, NULL,
+		polyPtr->numPoints, polyPtr->splineSteps, NULL, NULL);
+
+	polyPtr->smoothPtr = ckalloc(2 * numPoints * sizeof(double));
+	polyPtr->numSmoothPoints = polyPtr->smooth->coordProc(canvas,
+		polyPtr->coordPtr, polyPtr->numPoints, polyPtr->splineSteps,
+		NULL, polyPtr->smoothPtr);
+    }
+    *numPointsPtr = polyPtr->numSmoothPoints;
+    return polyPtr->smoothPtr;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -951,35 +1114,43 @@ DisplayPolygon(
 		x - intLineWidth/2, y - intLineWidth/2,
 		(unsigned) intLineWidth+1, (unsigned) intLineWidth+1,
 		0, 64*360);
-    } else if (!polyPtr->smooth || polyPtr->numPoints < 4) {
-	TkFillPolygon(canvas, polyPtr->coordPtr, polyPtr->numPoints,
-		    display, drawable, polyPtr->fillGC, polyPtr->outline.gc);
     } else {
-	int numPoints;
 	XPoint staticPoints[MAX_STATIC_POINTS];
 	XPoint *pointPtr;
+	double *polyPoints;
+	int numPoints;
 
 	/*
-	 * This is a smoothed polygon. Display using a set of generated spline
-	 * points rather than the original points.
+	 * Smoothed polygons are displayed using the cached spline points
+	 * rather than the original points. The screen coordinates are cached
+	 * as well; if the polygon needs clipping at the current scroll
+	 * position, fall back to translating it afresh.
 	 */
 
-	numPoints = polyPtr->smooth->coordProc(canvas, NULL,
-		polyPtr->numPoints, polyPtr->splineSteps, NULL, NULL);
+	if (!polyPtr->smooth || polyPtr->numPoints < 4) {
+	    polyPoints = polyPtr->coordPtr;
+	    numPoints = polyPtr->numPoints;
+	} else {
+	    polyPoints = GetPolygonSmoothPoints(canvas, polyPtr, &numPoints);
+	}
 	if (numPoints <= MAX_STATIC_POINTS) {
 	    pointPtr = staticPoints;
 	} else {
 	    pointPtr = ckalloc(numPoints * sizeof(XPoint));
 	}
-	numPoints = polyPtr->smooth->coordProc(canvas, polyPtr->coordPtr,
-		polyPtr->numPoints, polyPtr->splineSteps, pointPtr, NULL);
-	if (polyPtr->fillGC != None) {
-	    XFillPolygon(display, drawable, polyPtr->fillGC, pointPtr,
-		    numPoints, Complex, CoordModeOrigin);
-	}
-	if (polyPtr->outline.gc != None) {
-	    XDrawLines(display, drawable, polyPtr->outline.gc, pointPtr,
-		    numPoints, CoordModeOrigin);
+	if (TkCanvTranslateCachedPath((TkCanvas *) canvas, &polyPtr->pathCache,
+		numPoints, polyPoints, 0, numPoints, pointPtr) < 0) {
+	    TkFillPolygon(canvas, polyPoints, numPoints, display, drawable,
+		    polyPtr->fillGC, polyPtr->outline.gc);
+	} else {
+	    if (polyPtr->fillGC != None && numPoints > 3) {
+		XFillPolygon(display, drawable, polyPtr->fillGC, pointPtr,
+			numPoints, Complex, CoordModeOrigin);
+	    }
+	    if (polyPtr->outline.gc != None) {
+		XDrawLines(display, drawable, polyPtr->outline.gc, pointPtr,
+			numPoints, CoordModeOrigin);
+	    }
 	}
 	if (pointPtr != staticPoints) {
 	    ckfree(pointPtr);
@@ -1247,7 +1418,6 @@ PolygonToPoint(
 {
     PolygonItem *polyPtr = (PolygonItem *) itemPtr;
     double *coordPtr, *polyPoints;
-    double staticSpace[2*MAX_STATIC_POINTS];
     double poly[10];
     double radius;
     double bestDist, dist;
@@ -1281,15 +1451,7 @@ PolygonToPoint(
      */
 
     if ((polyPtr->smooth) && (polyPtr->numPoints > 2)) {
-	numPoints = polyPtr->smooth->coordProc(canvas, NULL,
-		polyPtr->numPoints, polyPtr->splineSteps, NULL, NULL);
-	if (numPoints <= MAX_STATIC_POINTS) {
-	    polyPoints = staticSpace;
-	} else {
-	    polyPoints = ckalloc(2 * numPoints * sizeof(double));
-	}
-	numPoints = polyPtr->smooth->coordProc(canvas, polyPtr->coordPtr,
-		polyPtr->numPoints, polyPtr->splineSteps, NULL, polyPoints);
+	polyPoints = GetPolygonSmoothPoints(canvas, polyPtr, &numPoints);
     } else {
 	numPoints = polyPtr->numPoints;
 	polyPoints = polyPtr->coordPtr;
@@ -1403,9 +1565,6 @@ PolygonToPoint(
     }
 
   donepoint:
-    if (polyPoints != staticSpace && polyPoints != polyPtr->coordPtr) {
-	ckfree(polyPoints);
-    }
     return bestDist;
 }
 
@@ -1439,7 +1598,6 @@ PolygonToArea(
 {
     PolygonItem *polyPtr = (PolygonItem *) itemPtr;
     double *coordPtr;
-    double staticSpace[2*MAX_STATIC_POINTS];
     double *polyPoints, poly[10];
     double radius;
     int numPoints, count;
@@ -1490,15 +1648,7 @@ PolygonToArea(
      */
 
     if (polyPtr->smooth) {
-	numPoints = polyPtr->smooth->coordProc(canvas, NULL,
-		polyPtr->numPoints, polyPtr->splineSteps, NULL, NULL);
-	if (numPoints <= MAX_STATIC_POINTS) {
-	    polyPoints = staticSpace;
-	} else {
-	    polyPoints = ckalloc(2 * numPoints * sizeof(double));
-	}
-	numPoints = polyPtr->smooth->coordProc(canvas, polyPtr->coordPtr,
-		polyPtr->numPoints, polyPtr->splineSteps, NULL, polyPoints);
+	polyPoints = GetPolygonSmoothPoints(canvas, polyPtr, &numPoints);
     } else {
 	numPoints = polyPtr->numPoints;
 	polyPoints = polyPtr->coordPtr;
@@ -1597,9 +1747,6 @@ PolygonToArea(
     }
 
   donearea:
-    if ((polyPoints != staticSpace) && (polyPoints != polyPtr->coordPtr)) {
-	ckfree(polyPoints);
-    }
     return inside;
 }
 
@@ -85,8 +85,56 @@ typedef struct TkPostscriptInfo {
 				 * ::tk::ps_preamable [sic]. */
     Tk_Window tkwin;		/* Window to get font pixel/point transform
 				 * from. */
+    char *imageEncodingString;	/* Value of the -imageencoding option, or
+				 * NULL. Malloc'ed. */
+    int imageEncoding;		/* How image data is written; one of the
+				 * PS_ENCODE_* values below. */
+    Tcl_Obj *itemFontsObj;	/* If not NULL, the names of the Postscript
+				 * fonts used by the item being output are
+				 * appended to this list, for the cache. */
+    Tcl_Obj *itemMapsObj;	/* If not NULL, the color and font map
+				 * entries looked up by the item being output
+				 * are appended to this list, for the cache
+				 * (see RecordMapLookup). */
 } TkPostscriptInfo;
 
+/*
+ * Values for the imageEncoding field of TkPostscriptInfo:
+ *
+ * PS_ENCODE_HEX -		ASCIIHex, as all printers understand.
+ * PS_ENCODE_ASCII85 -		ASCII85; needs a Level 2 interpreter.
+ * PS_ENCODE_RUNLENGTH -	RunLength compression, then ASCII85 (Level 2).
+ * PS_ENCODE_FLATE -		Flate (zlib) compression, then ASCII85; needs a
+ *				Level 3 interpreter.
+ */
+
+#define PS_ENCODE_HEX		0
+#define PS_ENCODE_ASCII85	1
+#define PS_ENCODE_RUNLENGTH	2
+#define PS_ENCODE_FLATE		3
+
+/*
+ * One of the following structures is kept in the psCache table of a canvas
+ * for each item whose Postscript may be reused (see TK_CACHE_POSTSCRIPT in
+ * tkCanvas.h). Entries are removed whenever their item changes or one of
+ * the color or font map entries they used has changed; the whole table is
+ * emptied when the canvas is reconfigured or a postscript command uses
+ * different settings (color mode, map variables, area height). No new
+ * entries are made once the Postscript held by the table reaches
+ * PS_CACHE_MAX_SIZE bytes.
+ */
+
+typedef struct PsCacheEntry {
+    Tcl_Obj *psObj;		/* Postscript generated for the item, without
+				 * the surrounding gsave/grestore. */
+    Tcl_Obj *fontsObj;		/* List of the Postscript fonts it uses. */
+    Tcl_Obj *mapsObj;		/* Map entries it looked up; see
+				 * RecordMapLookup. */
+    int size;			/* Number of bytes in psObj. */
+} PsCacheEntry;
+
+#define PS_CACHE_MAX_SIZE	(4 * 1024 * 1024)
+
 /*
  * The table below provides a template that's used to process arguments to the
  * canvas "postscript" command and fill in TkPostscriptInfo structures.
@@ -105,6 +153,8 @@ static const Tk_ConfigSpec configSpecs[] = {
 	"", Tk_Offset(TkPostscriptInfo, fontVar), 0, NULL},
     {TK_CONFIG_PIXELS, "-height", NULL, NULL,
 	"", Tk_Offset(TkPostscriptInfo, height), 0, NULL},
+    {TK_CONFIG_STRING, "-imageencoding", NULL, NULL,
+	"", Tk_Offset(TkPostscriptInfo, imageEncodingString), 0, NULL},
     {TK_CONFIG_ANCHOR, "-pageanchor", NULL, NULL,
 	"", Tk_Offset(TkPostscriptInfo, pageAnchor), 0, NULL},
     {TK_CONFIG_STRING, "-pageheight", NULL, NULL,
@@ -138,6 +188,22 @@ static void		PostscriptBitmap(Tk_Window tkwin, Pixmap bitmap,
 			    int startX, int startY, int width, int height,
 			    Tcl_Obj *psObj);
 static inline Tcl_Obj *	GetPostscriptBuffer(Tcl_Interp *interp);
+static const char *	ImageDataFilter(TkPostscriptInfo *psInfoPtr);
+static void		EncodeHex(Tcl_Obj *psObj, const unsigned char *data,
+			    int length);
+static void		EncodeAscii85(Tcl_Obj *psObj,
+			    const unsigned char *data, int length);
+static int		PostscriptImageData(Tcl_Interp *interp,
+			    TkPostscriptInfo *psInfoPtr, Tcl_Obj *psObj,
+			    const unsigned char *data, int length);
+static void		CheckPsCache(TkCanvas *canvasPtr,
+			    TkPostscriptInfo *psInfoPtr);
+static PsCacheEntry *	GetCachedPostscript(Tcl_Interp *interp,
+			    TkCanvas *canvasPtr, TkPostscriptInfo *psInfoPtr,
+			    Tk_Item *itemPtr);
+static void		RecordMapLookup(TkPostscriptInfo *psInfoPtr,
+			    const char *varName, const char *name,
+			    Tcl_Obj *valueObj);
 
 /*
  *--------------------------------------------------------------
@@ -180,7 +246,8 @@ TkCanvPostscriptCmd(
     Tcl_HashEntry *hPtr;
     Tcl_DString buffer;
     Tcl_Obj *preambleObj;
-    Tcl_Obj *psObj;
+    Tcl_Obj *psObj, *itemObj;
+    PsCacheEntry *cachePtr;
     int deltaX = 0, deltaY = 0;	/* Offset of lower-left corner of area to be
 				 * marked up, measured in canvas units from
 				 * the positioning point on the page (reflects
@@ -236,6 +303,10 @@ TkCanvPostscriptCmd(
     psInfo.prepass = 0;
     psInfo.prolog = 1;
     psInfo.tkwin = tkwin;
+    psInfo.imageEncodingString = NULL;
+    psInfo.imageEncoding = PS_ENCODE_HEX;
+    psInfo.itemFontsObj = NULL;
+    psInfo.itemMapsObj = NULL;
     Tcl_InitHashTable(&psInfo.fontTable, TCL_STRING_KEYS);
     result = Tk_ConfigureWidget(interp, tkwin, configSpecs, argc-2, argv+2,
 	    (char *) &psInfo, TK_CONFIG_ARGV_ONLY);
@@ -335,6 +406,26 @@ TkCanvPostscriptCmd(
 	}
     }
 
+    if (psInfo.imageEncodingString != NULL) {
+	static const char *const encodings[] = {
+	    "hex", "ascii85", "runlength", "flate", NULL
+	};
+
+	/*
+	 * The values of the table must match the PS_ENCODE_* definitions.
+	 */
+
+	Tcl_Obj *encodingObj =
+		Tcl_NewStringObj(psInfo.imageEncodingString, -1);
+
+	result = Tcl_GetIndexFromObj(interp, encodingObj, encodings,
+		"image encoding", 0, &psInfo.imageEncoding);
+	Tcl_DecrRefCount(encodingObj);
+	if (result != TCL_OK) {
+	    goto cleanup;
+	}
+    }
+
     if (psInfo.fileName != NULL) {
 	/*
 	 * Check that -file and -channel are not both specified.
@@ -403,6 +494,7 @@ TkCanvPostscriptCmd(
      * Conventions.
      */
 
+    CheckPsCache(canvasPtr, &psInfo);
     psInfo.prepass = 1;
     for (itemPtr = canvasPtr->firstItemPtr; itemPtr != NULL;
 	    itemPtr = itemPtr->nextPtr) {
@@ -413,6 +505,9 @@ TkCanvPostscriptCmd(
 	if (itemPtr->typePtr->postscriptProc == NULL) {
 	    continue;
 	}
+	if (GetCachedPostscript(interp, canvasPtr, &psInfo, itemPtr) != NULL) {
+	    continue;
+	}
 	result = itemPtr->typePtr->postscriptProc(interp,
 		(Tk_Canvas) canvasPtr, itemPtr, 1);
 	Tcl_ResetResult(interp);
@@ -437,6 +532,10 @@ TkCanvPostscriptCmd(
 	Tcl_AppendToObj(psObj,
 		"%!PS-Adobe-3.0 EPSF-3.0\n"
 		"%%Creator: Tk Canvas Widget\n", -1);
+	if (psInfo.imageEncoding != PS_ENCODE_HEX) {
+	    Tcl_AppendPrintfToObj(psObj, "%%%%LanguageLevel: %d\n",
+		    (psInfo.imageEncoding == PS_ENCODE_FLATE) ? 3 : 2);
+	}
 
 #ifdef HAVE_PW_GECOS
 	if (!Tcl_IsSafe(interp)) {
@@ -572,26 +671,61 @@ TkCanvPostscriptCmd(
 	    continue;
 	}
 
-	Tcl_ResetResult(interp);
-	result = itemPtr->typePtr->postscriptProc(interp,
-		(Tk_Canvas) canvasPtr, itemPtr, 0);
-	if (result != TCL_OK) {
-	    Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
-		    "\n    (generating Postscript for item %d)",
-		    itemPtr->id));
-	    goto cleanup;
+	cachePtr = GetCachedPostscript(interp, canvasPtr, &psInfo, itemPtr);
+	if (cachePtr != NULL) {
+	    itemObj = cachePtr->psObj;
+	} else {
+	    Tcl_ResetResult(interp);
+	    if ((itemPtr->typePtr->alwaysRedraw & TK_CACHE_POSTSCRIPT)
+		    && (canvasPtr->psCacheSize < PS_CACHE_MAX_SIZE)) {
+		psInfo.itemFontsObj = Tcl_NewObj();
+		Tcl_IncrRefCount(psInfo.itemFontsObj);
+		psInfo.itemMapsObj = Tcl_NewObj();
+		Tcl_IncrRefCount(psInfo.itemMapsObj);
+	    }
+	    result = itemPtr->typePtr->postscriptProc(interp,
+		    (Tk_Canvas) canvasPtr, itemPtr, 0);
+	    if (result != TCL_OK) {
+		Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+			"\n    (generating Postscript for item %d)",
+			itemPtr->id));
+		goto cleanup;
+	    }
+	    itemObj = Tcl_GetObjResult(interp);
+	    if (psInfo.itemFontsObj != NULL) {
+		Tcl_HashEntry *hPtr;
+		int isNew;
+
+		cachePtr = ckalloc(sizeof(PsCacheEntry));
+		cachePtr->psObj = itemObj;
+		Tcl_IncrRefCount(itemObj);
+		(void) Tcl_GetStringFromObj(itemObj, &cachePtr->size);
+		cachePtr->fontsObj = psInfo.itemFontsObj;
+		psInfo.itemFontsObj = NULL;
+		cachePtr->mapsObj = psInfo.itemMapsObj;
+		psInfo.itemMapsObj = NULL;
+		hPtr = Tcl_CreateHashEntry(&canvasPtr->psCache,
+			(char *) itemPtr, &isNew);
+		Tcl_SetHashValue(hPtr, cachePtr);
+		canvasPtr->psCacheSize += cachePtr->size;
+	    }
 	}
 
-	Tcl_AppendToObj(psObj, "gsave\n", -1);
-	Tcl_AppendObjToObj(psObj, Tcl_GetObjResult(interp));
-	Tcl_AppendToObj(psObj, "grestore\n", -1);
+	/*
+	 * When writing to a channel, the item's Postscript goes straight
+	 * out rather than being collected first.
+	 */
 
 	if (psInfo.chan != NULL) {
-	    if (Tcl_WriteObj(psInfo.chan, psObj) == -1) {
+	    if ((Tcl_WriteChars(psInfo.chan, "gsave\n", -1) == -1)
+		    || (Tcl_WriteObj(psInfo.chan, itemObj) == -1)
+		    || (Tcl_WriteChars(psInfo.chan, "grestore\n", -1) == -1)) {
 		goto channelWriteFailed;
 	    }
-	    Tcl_DecrRefCount(psObj);
-	    psObj = Tcl_NewObj();
+	} else {
+	    Tcl_AppendToObj(psObj, "gsave\n", -1);
+	    Tcl_AppendObjToObj(psObj, itemObj);
+	    Tcl_AppendToObj(psObj, "grestore\n", -1);
 	}
     }
 
@@ -645,6 +779,9 @@ TkCanvPostscriptCmd(
     if (psInfo.colorMode != NULL) {
 	ckfree(psInfo.colorMode);
     }
+    if (psInfo.imageEncodingString != NULL) {
+	ckfree(psInfo.imageEncodingString);
+    }
     if (psInfo.fileName != NULL) {
 	ckfree(psInfo.fileName);
     }
@@ -654,6 +791,12 @@ TkCanvPostscriptCmd(
     if (psInfo.channelName != NULL) {
 	ckfree(psInfo.channelName);
     }
+    if (psInfo.itemFontsObj != NULL) {
+	Tcl_DecrRefCount(psInfo.itemFontsObj);
+    }
+    if (psInfo.itemMapsObj != NULL) {
+	Tcl_DecrRefCount(psInfo.itemMapsObj);
+    }
     Tcl_DeleteHashTable(&psInfo.fontTable);
     canvasPtr->psInfo = (Tk_PostscriptInfo) oldInfoPtr;
     Tcl_DecrRefCount(preambleObj);
@@ -673,7 +816,210 @@ GetPostscriptBuffer(
     }
     return psObj;
 }
-
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CheckPsCache --
+ *
+ *	This function is called at the start of a postscript command to
+ *	make sure that the Postscript cached for the items of the canvas was
+ *	generated with the same settings as the command's. The settings that
+ *	matter to all items are the color mode, the image encoding, the names
+ *	of the color and font map variables, and the bottom of the area
+ *	(Postscript y coordinates are measured from it). The map entries
+ *	themselves are checked item by item, in GetCachedPostscript.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	If the settings differ, the cache is emptied and remembers the new
+ *	ones.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+CheckPsCache(
+    TkCanvas *canvasPtr,	/* Canvas being output. */
+    TkPostscriptInfo *psInfoPtr)/* Settings of the postscript command. */
+{
+    Tcl_Obj *keyObj;
+
+    keyObj = Tcl_ObjPrintf("%d %d %d", psInfoPtr->colorLevel,
+	    psInfoPtr->imageEncoding, psInfoPtr->y2);
+    Tcl_IncrRefCount(keyObj);
+    Tcl_ListObjAppendElement(NULL, keyObj, Tcl_NewStringObj(
+	    (psInfoPtr->colorVar != NULL) ? psInfoPtr->colorVar : "", -1));
+    Tcl_ListObjAppendElement(NULL, keyObj, Tcl_NewStringObj(
+	    (psInfoPtr->fontVar != NULL) ? psInfoPtr->fontVar : "", -1));
+
+    if ((canvasPtr->psCacheKey == NULL) || strcmp(Tcl_GetString(keyObj),
+	    Tcl_GetString(canvasPtr->psCacheKey)) != 0) {
+	TkCanvPsFreeCache(canvasPtr);
+	canvasPtr->psCacheKey = keyObj;
+    } else {
+	Tcl_DecrRefCount(keyObj);
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * RecordMapLookup --
+ *
+ *	Called when the color or font map is consulted while the Postscript
+ *	of an item is being generated for the cache. The lookup is recorded
+ *	as three list elements: the name of the map variable, the element
+ *	name, and a list holding the value found (empty if there was none).
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Elements are appended to psInfoPtr->itemMapsObj.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+RecordMapLookup(
+    TkPostscriptInfo *psInfoPtr,/* Postscript being generated. */
+    const char *varName,	/* Map variable that was looked at. */
+    const char *name,		/* Element of it that was looked up. */
+    Tcl_Obj *valueObj)		/* Value found, or NULL. */
+{
+    Tcl_Obj *mapsObj = psInfoPtr->itemMapsObj;
+
+    if (mapsObj == NULL) {
+	return;
+    }
+    Tcl_ListObjAppendElement(NULL, mapsObj, Tcl_NewStringObj(varName, -1));
+    Tcl_ListObjAppendElement(NULL, mapsObj, Tcl_NewStringObj(name, -1));
+    Tcl_ListObjAppendElement(NULL, mapsObj,
+	    Tcl_NewListObj((valueObj != NULL), &valueObj));
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetCachedPostscript --
+ *
+ *	This function looks up the cached Postscript of an item, and checks
+ *	that the color and font map entries it was generated with are
+ *	unchanged.
+ *
+ * Results:
+ *	The cache entry, or NULL if the item has none (or it is stale).
+ *
+ * Side effects:
+ *	The fonts used by the item are entered into psInfoPtr->fontTable, as
+ *	generating its Postscript would have done. Stale entries are removed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static PsCacheEntry *
+GetCachedPostscript(
+    Tcl_Interp *interp,		/* Interpreter the map variables live in. */
+    TkCanvas *canvasPtr,	/* Canvas containing the item. */
+    TkPostscriptInfo *psInfoPtr,/* Postscript being generated. */
+    Tk_Item *itemPtr)		/* Item to look up. */
+{
+    Tcl_HashEntry *hPtr;
+    PsCacheEntry *cachePtr;
+    Tcl_Obj **objv, **valuev, *valueObj;
+    int objc, valuec, i, isNew;
+
+    hPtr = Tcl_FindHashEntry(&canvasPtr->psCache, (char *) itemPtr);
+    if (hPtr == NULL) {
+	return NULL;
+    }
+    cachePtr = Tcl_GetHashValue(hPtr);
+    Tcl_ListObjGetElements(NULL, cachePtr->mapsObj, &objc, &objv);
+    for (i = 0; i + 2 < objc; i += 3) {
+	valueObj = Tcl_GetVar2Ex(interp, Tcl_GetString(objv[i]),
+		Tcl_GetString(objv[i+1]), 0);
+	Tcl_ListObjGetElements(NULL, objv[i+2], &valuec, &valuev);
+	if ((valueObj == NULL) ? (valuec != 0) : ((valuec == 0)
+		|| strcmp(Tcl_GetString(valueObj),
+		Tcl_GetString(valuev[0])) != 0)) {
+	    TkCanvPsForgetItem(canvasPtr, itemPtr);
+	    return NULL;
+	}
+    }
+    Tcl_ListObjGetElements(NULL, cachePtr->fontsObj, &objc, &objv);
+    for (i = 0; i < objc; i++) {
+	Tcl_CreateHashEntry(&psInfoPtr->fontTable, Tcl_GetString(objv[i]),
+		&isNew);
+    }
+    return cachePtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkCanvPsForgetItem, TkCanvPsFreeCache --
+ *
+ *	These functions discard the cached Postscript of one item or of all
+ *	the items of a canvas. TkCanvPsForgetItem must be called whenever an
+ *	item changes or is deleted; TkCanvPsFreeCache when the canvas is
+ *	reconfigured or destroyed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkCanvPsForgetItem(
+    TkCanvas *canvasPtr,	/* Canvas containing the item. */
+    Tk_Item *itemPtr)		/* Item that changed. */
+{
+    Tcl_HashEntry *hPtr;
+    PsCacheEntry *cachePtr;
+
+    hPtr = Tcl_FindHashEntry(&canvasPtr->psCache, (char *) itemPtr);
+    if (hPtr != NULL) {
+	cachePtr = Tcl_GetHashValue(hPtr);
+	canvasPtr->psCacheSize -= cachePtr->size;
+	Tcl_DecrRefCount(cachePtr->psObj);
+	Tcl_DecrRefCount(cachePtr->fontsObj);
+	Tcl_DecrRefCount(cachePtr->mapsObj);
+	ckfree(cachePtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+}
+
+void
+TkCanvPsFreeCache(
+    TkCanvas *canvasPtr)	/* Canvas whose cache is to be emptied. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    PsCacheEntry *cachePtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&canvasPtr->psCache, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cachePtr = Tcl_GetHashValue(hPtr);
+	Tcl_DecrRefCount(cachePtr->psObj);
+	Tcl_DecrRefCount(cachePtr->fontsObj);
+	Tcl_DecrRefCount(cachePtr->mapsObj);
+	ckfree(cachePtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    canvasPtr->psCacheSize = 0;
+    if (canvasPtr->psCacheKey != NULL) {
+	Tcl_DecrRefCount(canvasPtr->psCacheKey);
+	canvasPtr->psCacheKey = NULL;
+    }
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -714,12 +1060,13 @@ Tk_PostscriptColor(
      */
 
     if (psInfoPtr->colorVar != NULL) {
-	const char *cmdString = Tcl_GetVar2(interp, psInfoPtr->colorVar,
-		Tk_NameOfColor(colorPtr), 0);
+	const char *name = Tk_NameOfColor(colorPtr);
+	Tcl_Obj *cmdObj = Tcl_GetVar2Ex(interp, psInfoPtr->colorVar, name, 0);
 
-	if (cmdString != NULL) {
+	RecordMapLookup(psInfoPtr, psInfoPtr->colorVar, name, cmdObj);
+	if (cmdObj != NULL) {
 	    Tcl_AppendPrintfToObj(GetPostscriptBuffer(interp),
-		    "%s\n", cmdString);
+		    "%s\n", Tcl_GetString(cmdObj));
 	    return TCL_OK;
 	}
     }
@@ -792,6 +1139,7 @@ Tk_PostscriptFont(
 	double size;
 	Tcl_Obj *list = Tcl_GetVar2Ex(interp, psInfoPtr->fontVar, name, 0);
 
+	RecordMapLookup(psInfoPtr, psInfoPtr->fontVar, name, list);
 	if (list != NULL) {
 	    if (Tcl_ListObjGetElements(interp, list, &objc, &objv) != TCL_OK
 		    || objc != 2
@@ -812,6 +1160,10 @@ Tk_PostscriptFont(
 		    fontname, (int) size,
 		    strncasecmp(fontname, "Symbol", 7) ? " ISOEncode" : "");
 	    Tcl_CreateHashEntry(&psInfoPtr->fontTable, fontname, &i);
+	    if (psInfoPtr->itemFontsObj != NULL) {
+		Tcl_ListObjAppendElement(NULL, psInfoPtr->itemFontsObj,
+			Tcl_NewStringObj(fontname, -1));
+	    }
 	    return TCL_OK;
 	}
     }
@@ -828,6 +1180,10 @@ Tk_PostscriptFont(
 	    fontname, TkFontGetPoints(psInfoPtr->tkwin, points),
 	    strncasecmp(fontname, "Symbol", 7) ? " ISOEncode" : "");
     Tcl_CreateHashEntry(&psInfoPtr->fontTable, Tcl_DStringValue(&ds), &i);
+    if (psInfoPtr->itemFontsObj != NULL) {
+	Tcl_ListObjAppendElement(NULL, psInfoPtr->itemFontsObj,
+		Tcl_NewStringObj(Tcl_DStringValue(&ds), -1));
+    }
     Tcl_DStringFree(&ds);
 
     return TCL_OK;
@@ -1222,6 +1578,253 @@ TkImageGetColor(
 }
 #endif /* _WIN32 || MAC_OSX_TK */
 
+/*
+ *--------------------------------------------------------------
+ *
+ * ImageDataFilter --
+ *
+ *	This function returns the Postscript code that sets up the file from
+ *	which image data written by PostscriptImageData is read. Except in hex
+ *	mode, the underlying ASCII85 filter is also stored under the name
+ *	TkImageSource, so that whatever is left of it after the image has been
+ *	drawn can be skipped with "TkImageSource flushfile".
+ *
+ * Results:
+ *	A static string.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static const char *
+ImageDataFilter(
+    TkPostscriptInfo *psInfoPtr)/* Postscript being generated. */
+{
+    switch (psInfoPtr->imageEncoding) {
+    case PS_ENCODE_HEX:
+	return "currentfile /ASCIIHexDecode filter";
+    case PS_ENCODE_ASCII85:
+	return "currentfile /ASCII85Decode filter dup /TkImageSource exch def";
+    case PS_ENCODE_RUNLENGTH:
+	return "currentfile /ASCII85Decode filter dup /TkImageSource exch def"
+		" /RunLengthDecode filter";
+    default:
+	return "currentfile /ASCII85Decode filter dup /TkImageSource exch def"
+		" /FlateDecode filter";
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * EncodeHex, EncodeAscii85 --
+ *
+ *	These functions append binary image data to a Postscript buffer in
+ *	ASCIIHex or ASCII85 form. The encoded text is written straight into
+ *	space reserved at the end of the buffer, so no intermediate strings
+ *	are created. EncodeAscii85 also writes the "~>" end-of-data marker;
+ *	callers of EncodeHex write the ">" themselves.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The encoded data is appended to psObj.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+EncodeHex(
+    Tcl_Obj *psObj,		/* Buffer to append to. */
+    const unsigned char *data,	/* Bytes to encode. */
+    int length)			/* Number of bytes at data. */
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    int oldLength, i;
+    char *start, *p;
+
+    (void) Tcl_GetStringFromObj(psObj, &oldLength);
+    Tcl_SetObjLength(psObj, oldLength + 2*length + length/30 + 1);
+    start = p = Tcl_GetString(psObj) + oldLength;
+    for (i = 0; i < length; i++) {
+	*p++ = hexDigits[data[i] >> 4];
+	*p++ = hexDigits[data[i] & 0xF];
+	if (i % 30 == 29) {
+	    *p++ = '\n';
+	}
+    }
+    Tcl_SetObjLength(psObj, oldLength + (p - start));
+}
+
+static void
+EncodeAscii85(
+    Tcl_Obj *psObj,		/* Buffer to append to. */
+    const unsigned char *data,	/* Bytes to encode. */
+    int length)			/* Number of bytes at data. */
+{
+    int oldLength, groups, i, k, n, lineLen = 0;
+    unsigned int word;
+    char *start, *p, digits[5];
+
+    groups = (length + 3) / 4;
+    (void) Tcl_GetStringFromObj(psObj, &oldLength);
+    Tcl_SetObjLength(psObj, oldLength + groups*6 + 8);
+    start = p = Tcl_GetString(psObj) + oldLength;
+    for (i = 0; i < length; i += 4) {
+	n = length - i;
+	if (n >= 4) {
+	    n = 4;
+	    word = ((unsigned) data[i] << 24) | (data[i+1] << 16)
+		    | (data[i+2] << 8) | data[i+3];
+	} else {
+	    word = (unsigned) data[i] << 24;
+	    if (n > 1) {
+		word |= data[i+1] << 16;
+	    }
+	    if (n > 2) {
+		word |= data[i+2] << 8;
+	    }
+	}
+	if (lineLen >= 72) {
+	    *p++ = '\n';
+	    lineLen = 0;
+	}
+	if (word == 0 && n == 4) {
+	    *p++ = 'z';
+	    lineLen++;
+	    continue;
+	}
+	for (k = 4; k >= 0; k--) {
+	    digits[k] = (char) ('!' + word % 85);
+	    word /= 85;
+	}
+
+	/*
+	 * Keep lines from starting with '%', which document managers could
+	 * take for a comment. The decoder skips white space.
+	 */
+
+	if (lineLen == 0 && digits[0] == '%') {
+	    *p++ = ' ';
+	    lineLen++;
+	}
+	for (k = 0; k <= n; k++) {
+	    *p++ = digits[k];
+	}
+	lineLen += n + 1;
+    }
+    memcpy(p, "~>\n", 3);
+    p += 3;
+    Tcl_SetObjLength(psObj, oldLength + (p - start));
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PostscriptImageData --
+ *
+ *	This function appends the pixel data of an image to a Postscript
+ *	buffer, compressed and encoded as selected by the -imageencoding
+ *	option. The data must be read through the filter returned by
+ *	ImageDataFilter.
+ *
+ * Results:
+ *	Returns a standard Tcl result; an error is only possible if the data
+ *	can't be compressed.
+ *
+ * Side effects:
+ *	The encoded data is appended to psObj. In hex mode the ">" marker
+ *	is left to the caller.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+PostscriptImageData(
+    Tcl_Interp *interp,		/* For error reporting. */
+    TkPostscriptInfo *psInfoPtr,/* Postscript being generated. */
+    Tcl_Obj *psObj,		/* Buffer to append to. */
+    const unsigned char *data,	/* Image samples. */
+    int length)			/* Number of bytes at data. */
+{
+    Tcl_Obj *compressedObj;
+    unsigned char *out, *litPtr;
+    int i, run, literal;
+    Tcl_ZlibStream stream;
+
+    switch (psInfoPtr->imageEncoding) {
+    case PS_ENCODE_HEX:
+	EncodeHex(psObj, data, length);
+	return TCL_OK;
+    case PS_ENCODE_ASCII85:
+	EncodeAscii85(psObj, data, length);
+	return TCL_OK;
+    case PS_ENCODE_RUNLENGTH:
+	/*
+	 * Runs of three or more equal bytes (two at the start of a literal)
+	 * become repeat records; everything else is copied in literal records
+	 * of up to 128 bytes.
+	 */
+
+	compressedObj = Tcl_NewObj();
+	out = Tcl_SetByteArrayLength(compressedObj,
+		length + length/128 + 2);
+	litPtr = NULL;
+	literal = 0;
+	for (i = 0; i < length; i += run) {
+	    for (run = 1; (i + run < length) && (run < 128)
+		    && (data[i + run] == data[i]); run++) {
+		/* Empty loop body. */
+	    }
+	    if (run >= 3 || (run == 2 && literal == 0)) {
+		*out++ = (unsigned char) (257 - run);
+		*out++ = data[i];
+		literal = 0;
+		continue;
+	    }
+	    run = 1;
+	    if (literal == 0) {
+		litPtr = out++;
+	    }
+	    *out++ = data[i];
+	    *litPtr = (unsigned char) literal;
+	    if (++literal == 128) {
+		literal = 0;
+	    }
+	}
+	*out++ = 128;
+	Tcl_SetByteArrayLength(compressedObj,
+		out - Tcl_GetByteArrayFromObj(compressedObj, NULL));
+	break;
+    default:
+	if (Tcl_ZlibStreamInit(NULL, TCL_ZLIB_STREAM_DEFLATE,
+		TCL_ZLIB_FORMAT_ZLIB, TCL_ZLIB_COMPRESS_DEFAULT, NULL,
+		&stream) != TCL_OK) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "zlib initialization failed", -1));
+	    Tcl_SetErrorCode(interp, "TK", "CANVAS", "PS", "ZLIB_INIT", NULL);
+	    return TCL_ERROR;
+	}
+	compressedObj = Tcl_NewByteArrayObj(data, length);
+	Tcl_IncrRefCount(compressedObj);
+	Tcl_ZlibStreamPut(stream, compressedObj, TCL_ZLIB_FINALIZE);
+	Tcl_DecrRefCount(compressedObj);
+	compressedObj = Tcl_NewObj();
+	Tcl_ZlibStreamGet(stream, compressedObj, -1);
+	Tcl_ZlibStreamClose(stream);
+	break;
+    }
+
+    Tcl_IncrRefCount(compressedObj);
+    out = Tcl_GetByteArrayFromObj(compressedObj, &length);
+    EncodeAscii85(psObj, out, length);
+    Tcl_DecrRefCount(compressedObj);
+    return TCL_OK;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -1258,10 +1861,11 @@ TkPostscriptImage(
     int bytesPerLine = 0, maxWidth = 0;
     int level = psInfoPtr->colorLevel;
     Colormap cmap;
-    int i, ncolors;
+    int i, ncolors, result = TCL_OK;
     Visual *visual;
     TkColormapData cdata;
     Tcl_Obj *psObj;
+    unsigned char *data, *dataPtr;
 
     if (psInfoPtr->prepass) {
 	return TCL_OK;
@@ -1336,7 +1940,8 @@ TkPostscriptImage(
     /*
      * Check that at least one row of the image can be represented with a
      * string less than 64 KB long (this is a limit in the Postscript
-     * interpreter).
+     * interpreter). Data read through a filter has no such limit, so the
+     * whole image then goes in a single band.
      */
 
     switch (level) {
@@ -1345,7 +1950,9 @@ TkPostscriptImage(
     default: bytesPerLine = 3 * width;	     maxWidth = 20000;  break;
     }
 
-    if (bytesPerLine > 60000) {
+    if (psInfoPtr->imageEncoding != PS_ENCODE_HEX) {
+	maxRows = (height > 0) ? height : 1;
+    } else if (bytesPerLine > 60000) {
 	Tcl_ResetResult(interp);
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"can't generate Postscript for images more than %d pixels wide",
@@ -1353,26 +1960,16 @@ TkPostscriptImage(
 	Tcl_SetErrorCode(interp, "TK", "CANVAS", "PS", "MEMLIMIT", NULL);
 	ckfree(cdata.colors);
 	return TCL_ERROR;
+    } else {
+	maxRows = 60000 / bytesPerLine;
     }
-
-    maxRows = 60000 / bytesPerLine;
     psObj = GetPostscriptBuffer(interp);
+    data = ckalloc(maxRows * bytesPerLine + 1);
 
     for (band = height-1; band >= 0; band -= maxRows) {
 	int rows = (band >= maxRows) ? maxRows : band + 1;
-	int lineLen = 0;
 
-	switch (level) {
-	case 0:
-	    Tcl_AppendPrintfToObj(psObj, "%d %d 1 matrix {\n<", width, rows);
-	    break;
-	case 1:
-	    Tcl_AppendPrintfToObj(psObj, "%d %d 8 matrix {\n<", width, rows);
-	    break;
-	default:
-	    Tcl_AppendPrintfToObj(psObj, "%d %d 8 matrix {\n<", width, rows);
-	    break;
-	}
+	dataPtr = data;
 	for (yy = band; yy > band - rows; yy--) {
 	    switch (level) {
 	    case 0: {
@@ -1382,30 +1979,23 @@ TkPostscriptImage(
 		 */
 
 		unsigned char mask = 0x80;
-		unsigned char data = 0x00;
+		unsigned char bits = 0x00;
 
 		for (xx = x; xx< x+width; xx++) {
 		    TkImageGetColor(&cdata, XGetPixel(ximage, xx, yy),
 			    &red, &green, &blue);
 		    if (0.30 * red + 0.59 * green + 0.11 * blue > 0.5) {
-			data |= mask;
+			bits |= mask;
 		    }
 		    mask >>= 1;
 		    if (mask == 0) {
-			Tcl_AppendPrintfToObj(psObj, "%02X", data);
-			lineLen += 2;
-			if (lineLen > 60) {
-			    lineLen = 0;
-			    Tcl_AppendToObj(psObj, "\n", -1);
-			}
+			*dataPtr++ = bits;
 			mask = 0x80;
-			data = 0x00;
+			bits = 0x00;
 		    }
 		}
 		if ((width % 8) != 0) {
-		    Tcl_AppendPrintfToObj(psObj, "%02X", data);
-		    mask = 0x80;
-		    data = 0x00;
+		    *dataPtr++ = bits;
 		}
 		break;
 	    }
@@ -1418,14 +2008,8 @@ TkPostscriptImage(
 		for (xx = x; xx < x+width; xx ++) {
 		    TkImageGetColor(&cdata, XGetPixel(ximage, xx, yy),
 			    &red, &green, &blue);
-		    Tcl_AppendPrintfToObj(psObj, "%02X",
-			    (int) floor(0.5 + 255.0 *
-			    (0.30 * red + 0.59 * green + 0.11 * blue)));
-		    lineLen += 2;
-		    if (lineLen > 60) {
-			lineLen = 0;
-			Tcl_AppendToObj(psObj, "\n", -1);
-		    }
+		    *dataPtr++ = (unsigned char) floor(0.5 + 255.0 *
+			    (0.30 * red + 0.59 * green + 0.11 * blue));
 		}
 		break;
 	    default:
@@ -1437,31 +2021,38 @@ TkPostscriptImage(
 		for (xx = x; xx < x+width; xx++) {
 		    TkImageGetColor(&cdata, XGetPixel(ximage, xx, yy),
 			    &red, &green, &blue);
-		    Tcl_AppendPrintfToObj(psObj, "%02X%02X%02X",
-			    (int) floor(0.5 + 255.0 * red),
-			    (int) floor(0.5 + 255.0 * green),
-			    (int) floor(0.5 + 255.0 * blue));
-		    lineLen += 6;
-		    if (lineLen > 60) {
-			lineLen = 0;
-			Tcl_AppendToObj(psObj, "\n", -1);
-		    }
+		    *dataPtr++ = (unsigned char) floor(0.5 + 255.0 * red);
+		    *dataPtr++ = (unsigned char) floor(0.5 + 255.0 * green);
+		    *dataPtr++ = (unsigned char) floor(0.5 + 255.0 * blue);
 		}
 		break;
 	    }
 	}
-	switch (level) {
-	case 0: case 1:
-	    Tcl_AppendToObj(psObj, ">\n} image\n", -1); break;
-	default:
-	    Tcl_AppendToObj(psObj, ">\n} false 3 colorimage\n", -1); break;
+
+	if (psInfoPtr->imageEncoding == PS_ENCODE_HEX) {
+	    Tcl_AppendPrintfToObj(psObj, "%d %d %d matrix {\n<", width, rows,
+		    (level == 0) ? 1 : 8);
+	    EncodeHex(psObj, data, dataPtr - data);
+	    Tcl_AppendToObj(psObj, (level < 2) ? ">\n} image\n"
+		    : ">\n} false 3 colorimage\n", -1);
+	} else {
+	    Tcl_AppendPrintfToObj(psObj, "{%d %d %d matrix %s\n%s"
+		    " TkImageSource flushfile} exec\n", width, rows,
+		    (level == 0) ? 1 : 8, ImageDataFilter(psInfoPtr),
+		    (level < 2) ? "image" : "false 3 colorimage");
+	    result = PostscriptImageData(interp, psInfoPtr, psObj, data,
+		    dataPtr - data);
+	    if (result != TCL_OK) {
+		break;
+	    }
 	}
 	Tcl_AppendPrintfToObj(psObj, "0 %d translate\n", rows);
     }
+    ckfree(data);
     ckfree(cdata.colors);
-    return TCL_OK;
+    return result;
 }
-
+
 /*
  *--------------------------------------------------------------
  *
@@ -1494,13 +2085,14 @@ Tk_PostscriptPhoto(
     int colorLevel = psInfoPtr->colorLevel;
     const char *displayOperation, *decode;
     unsigned char *pixelPtr;
-    int bpc, xx, yy, lineLen, alpha;
+    int bpc, xx, yy, alpha, result;
     float red, green, blue;
     int bytesPerLine = 0, maxWidth = 0;
     unsigned char opaque = 255;
     unsigned char *alphaPtr;
     int alphaOffset, alphaPitch, alphaIncr;
     Tcl_Obj *psObj;
+    unsigned char *data, *dataPtr;
 
     if (psInfoPtr->prepass) {
 	return TCL_OK;
@@ -1566,10 +2158,19 @@ Tk_PostscriptPhoto(
     Tcl_AppendPrintfToObj(psObj,
 	    "<<\n  /ImageType 1\n"
 	    "  /Width %d\n  /Height %d\n  /BitsPerComponent %d\n"
-	    "  /DataSource currentfile\n  /ASCIIHexDecode filter\n"
-	    "  /ImageMatrix [1 0 0 -1 0 %d]\n  /Decode [%s]\n>>\n"
-	    "1 %s\n",
-	    width, height, bpc, height, decode, displayOperation);
+	    "  /DataSource %s\n"
+	    "  /ImageMatrix [1 0 0 -1 0 %d]\n  /Decode [%s]\n>>\n",
+	    width, height, bpc, ImageDataFilter(psInfoPtr), height, decode);
+    if (psInfoPtr->imageEncoding == PS_ENCODE_HEX) {
+	Tcl_AppendPrintfToObj(psObj, "1 %s\n", displayOperation);
+    } else {
+	/*
+	 * Make sure the whole encoded stream is consumed, up to its "~>".
+	 */
+
+	Tcl_AppendPrintfToObj(psObj,
+		"1 {%s TkImageSource flushfile} exec\n", displayOperation);
+    }
 
     /*
      * Check the PhotoImageBlock information. We assume that:
@@ -1595,7 +2196,16 @@ Tk_PostscriptPhoto(
 	alphaOffset = blockPtr->offset[3];
     }
 
-    for (yy = 0, lineLen=0; yy < height; yy++) {
+    /*
+     * Collect the samples of the whole image; each row holds the
+     * transparency data followed by the pixels (or, in monochrome, the black
+     * pixels followed by the white ones).
+     */
+
+    data = ckalloc((colorLevel == 0 ? 2*bytesPerLine
+	    : width + bytesPerLine) * height + 1);
+    dataPtr = data;
+    for (yy = 0; yy < height; yy++) {
 	switch (colorLevel) {
 	case 0: {
 	    /*
@@ -1606,7 +2216,8 @@ Tk_PostscriptPhoto(
 	     */
 
 	    unsigned char mask = 0x80;
-	    unsigned char data = 0x00;
+	    unsigned char black = 0x00, white = 0x00;
+	    unsigned char *whitePtr = dataPtr + bytesPerLine;
 
 	    for (xx = 0; xx< width; xx ++) {
 		pixelPtr = blockPtr->pixelPtr + (yy * blockPtr->pitch)
@@ -1620,72 +2231,33 @@ Tk_PostscriptPhoto(
 			+ (xx * alphaIncr) + alphaOffset);
 
 		/*
-		 * If pixel is less than threshold, then it is black.
+		 * If pixel is less than threshold, then it is black, otherwise
+		 * it is white.
 		 */
 
-		if ((alpha != 0) &&
-			(0.3086*red + 0.6094*green + 0.082*blue < 128)) {
-		    data |= mask;
-		}
-		mask >>= 1;
-		if (mask == 0) {
-		    Tcl_AppendPrintfToObj(psObj, "%02X", data);
-		    lineLen += 2;
-		    if (lineLen >= 60) {
-			lineLen = 0;
-			Tcl_AppendToObj(psObj, "\n", -1);
+		if (alpha != 0) {
+		    if (0.3086*red + 0.6094*green + 0.082*blue < 128) {
+			black |= mask;
+		    } else {
+			white |= mask;
 		    }
-		    mask = 0x80;
-		    data = 0x00;
-		}
-	    }
-	    if ((width % 8) != 0) {
-		Tcl_AppendPrintfToObj(psObj, "%02X", data);
-		mask = 0x80;
-		data = 0x00;
-	    }
-
-	    mask = 0x80;
-	    data = 0x00;
-	    for (xx=0 ; xx<width ; xx++) {
-		pixelPtr = blockPtr->pixelPtr + (yy * blockPtr->pitch)
-			+ (xx *blockPtr->pixelSize);
-
-		red = pixelPtr[blockPtr->offset[0]];
-		green = pixelPtr[blockPtr->offset[1]];
-		blue = pixelPtr[blockPtr->offset[2]];
-
-		alpha = *(alphaPtr + (yy * alphaPitch)
-			+ (xx * alphaIncr) + alphaOffset);
-
-		/*
-		 * If pixel is greater than threshold, then it is white.
-		 */
-
-		if ((alpha != 0) &&
-			(0.3086*red + 0.6094*green + 0.082*blue >= 128)) {
-		    data |= mask;
 		}
 		mask >>= 1;
 		if (mask == 0) {
-		    Tcl_AppendPrintfToObj(psObj, "%02X", data);
-		    lineLen += 2;
-		    if (lineLen >= 60) {
-			lineLen = 0;
-			Tcl_AppendToObj(psObj, "\n", -1);
-		    }
+		    *dataPtr++ = black;
+		    *whitePtr++ = white;
 		    mask = 0x80;
-		    data = 0x00;
+		    black = white = 0x00;
 		}
 	    }
 	    if ((width % 8) != 0) {
-		Tcl_AppendPrintfToObj(psObj, "%02X", data);
-		mask = 0x80;
-		data = 0x00;
+		*dataPtr++ = black;
+		*whitePtr++ = white;
 	    }
+	    dataPtr = whitePtr;
 	    break;
 	}
-	case 1: {
+	case 1:
 	    /*
 	     * Generate transparency data. We must prevent a transparent value
 	     * of 0 because of a bug in some HP printers.
@@ -1694,12 +2266,7 @@ Tk_PostscriptPhoto(
 	    for (xx = 0; xx < width; xx ++) {
 		alpha = *(alphaPtr + (yy * alphaPitch)
 			+ (xx * alphaIncr) + alphaOffset);
-		Tcl_AppendPrintfToObj(psObj, "%02X", alpha | 0x01);
-		lineLen += 2;
-		if (lineLen >= 60) {
-		    lineLen = 0;
-		    Tcl_AppendToObj(psObj, "\n", -1);
-		}
+		*dataPtr++ = alpha | 0x01;
 	    }
 
 	    /*
@@ -1715,16 +2282,10 @@ Tk_PostscriptPhoto(
 		green = pixelPtr[blockPtr->offset[1]];
 		blue = pixelPtr[blockPtr->offset[2]];
 
-		Tcl_AppendPrintfToObj(psObj, "%02X", (int) floor(0.5 +
-			( 0.3086 * red + 0.6094 * green + 0.0820 * blue)));
-		lineLen += 2;
-		if (lineLen >= 60) {
-		    lineLen = 0;
-		    Tcl_AppendToObj(psObj, "\n", -1);
-		}
+		*dataPtr++ = (unsigned char) floor(0.5 +
+			( 0.3086 * red + 0.6094 * green + 0.0820 * blue));
 	    }
 	    break;
-	}
 	default:
 	    /*
 	     * Generate transparency data. We must prevent a transparent value
@@ -1734,12 +2295,7 @@ Tk_PostscriptPhoto(
 	    for (xx = 0; xx < width; xx ++) {
 		alpha = *(alphaPtr + (yy * alphaPitch)
 			+ (xx * alphaIncr) + alphaOffset);
-		Tcl_AppendPrintfToObj(psObj, "%02X", alpha | 0x01);
-		lineLen += 2;
-		if (lineLen >= 60) {
-		    lineLen = 0;
-		    Tcl_AppendToObj(psObj, "\n", -1);
-		}
+		*dataPtr++ = alpha | 0x01;
 	    }
 
 	    /*
@@ -1751,28 +2307,28 @@ Tk_PostscriptPhoto(
 		pixelPtr = blockPtr->pixelPtr + (yy * blockPtr->pitch)
 			+ (xx * blockPtr->pixelSize);
 
-		Tcl_AppendPrintfToObj(psObj, "%02X%02X%02X",
-			pixelPtr[blockPtr->offset[0]],
-			pixelPtr[blockPtr->offset[1]],
-			pixelPtr[blockPtr->offset[2]]);
-		lineLen += 6;
-		if (lineLen >= 60) {
-		    lineLen = 0;
-		    Tcl_AppendToObj(psObj, "\n", -1);
-		}
+		*dataPtr++ = pixelPtr[blockPtr->offset[0]];
+		*dataPtr++ = pixelPtr[blockPtr->offset[1]];
+		*dataPtr++ = pixelPtr[blockPtr->offset[2]];
 	    }
 	    break;
 	}
     }
 
+    result = PostscriptImageData(interp, psInfoPtr, psObj, data,
+	    dataPtr - data);
+    ckfree(data);
+
     /*
      * The end-of-data marker.
      */
 
-    Tcl_AppendToObj(psObj, ">\n", -1);
-    return TCL_OK;
+    if (result == TCL_OK && psInfoPtr->imageEncoding == PS_ENCODE_HEX) {
+	Tcl_AppendToObj(psObj, ">\n", -1);
+    }
+    return result;
 }
-
+
 /*
  * Local Variables:
  * mode: c
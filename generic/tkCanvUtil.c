@@ -1635,7 +1635,8 @@ TranslateAndAppendCoords(
  *	Clipped and translated path vertices are written into outArr[]. There
  *	might be as many as twice the vertices in outArr[] as there are in
  *	coordPtr[]. The return value is the number of vertices actually
- *	written into outArr[].
+ *	written into outArr[]. If clippedPtr is not NULL, *clippedPtr is set
+ *	to 1 if the path had to be clipped and 0 otherwise.
  *
  * Side effects:
  *	None
@@ -1650,7 +1651,9 @@ TkCanvTranslatePath(
 				 * coordArr[] */
     double *coordArr,		/* X and Y coordinates for each vertex */
     int closedPath,		/* True if this is a closed polygon */
-    XPoint *outArr)		/* Write results here, if not NULL */
+    XPoint *outArr,		/* Write results here, if not NULL */
+    int *clippedPtr)		/* If not NULL, report whether clipping was
+				 * needed here */
 {
     int numOutput = 0;		/* Number of output coordinates */
     double lft, rgh;		/* Left and right sides of the bounding box */
@@ -1707,8 +1710,14 @@ TkCanvTranslatePath(
     }
     if (i == numVertex){
 	assert(numOutput == numVertex);
+	if (clippedPtr != NULL) {
+	    *clippedPtr = 0;
+	}
 	return numOutput;
     }
+    if (clippedPtr != NULL) {
+	*clippedPtr = 1;
+    }
 
     /*
      * If we reach this point, it means that some clipping is required. Begin
@@ -1864,6 +1873,266 @@ TkCanvTranslatePath(
     return numOutput;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * Tk_CanvasDecimatePath --
+ *
+ *	Reduce a path with many more vertices than there are pixel columns to
+ *	something that draws the same on screen. Each run of consecutive
+ *	vertices whose x coordinates round to the same pixel column is
+ *	replaced by at most four vertices: the first and last of the run and
+ *	the ones with the smallest and largest y coordinates, kept in path
+ *	order. Since the canvas origin is always an integer number of pixels,
+ *	the result does not depend on how the canvas is scrolled, so it only
+ *	needs to be recomputed when the coordinates change.
+ *
+ *	outArr must have room for 2*numVertex doubles; it may not overlap
+ *	coordArr.
+ *
+ * Results:
+ *	The decimated vertices are written into outArr[] and their number is
+ *	returned. If monotonicPtr is not NULL, *monotonicPtr is set to 1 if
+ *	the pixel columns of the result never decrease (so that callers can
+ *	binary search for the visible part of the path) and 0 otherwise.
+ *
+ * Side effects:
+ *	None
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+Tk_CanvasDecimatePath(
+    int numVertex,		/* Number of vertices specified by
+				 * coordArr[] */
+    const double *coordArr,	/* X and Y coordinates for each vertex */
+    double *outArr,		/* Write results here */
+    int *monotonicPtr)		/* If not NULL, report whether the result is
+				 * sorted by x coordinate */
+{
+    int i, j, k, numOutput = 0, monotonic = 1;
+    int idx[4];
+    double prevColumn = 0.0;
+
+    for (i = 0; i < numVertex; i = j) {
+	double column = floor(coordArr[2*i] + 0.5);
+	int minIdx = i, maxIdx = i;
+
+	for (j = i+1; j < numVertex
+		&& floor(coordArr[2*j] + 0.5) == column; j++) {
+	    if (coordArr[2*j+1] < coordArr[2*minIdx+1]) {
+		minIdx = j;
+	    } else if (coordArr[2*j+1] > coordArr[2*maxIdx+1]) {
+		maxIdx = j;
+	    }
+	}
+	if (i > 0 && column < prevColumn) {
+	    monotonic = 0;
+	}
+	prevColumn = column;
+
+	/*
+	 * Emit first, min/max (in path order) and last of the run, dropping
+	 * any that coincide.
+	 */
+
+	idx[0] = i;
+	idx[1] = (minIdx < maxIdx) ? minIdx : maxIdx;
+	idx[2] = (minIdx < maxIdx) ? maxIdx : minIdx;
+	idx[3] = j - 1;
+	for (k = 0; k < 4; k++) {
+	    if (k > 0 && idx[k] == idx[k-1]) {
+		continue;
+	    }
+	    outArr[2*numOutput] = coordArr[2*idx[k]];
+	    outArr[2*numOutput+1] = coordArr[2*idx[k]+1];
+	    numOutput++;
+	}
+    }
+    if (monotonicPtr != NULL) {
+	*monotonicPtr = monotonic;
+    }
+    return numOutput;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkCanvTranslateCachedPath --
+ *
+ *	Like TkCanvTranslatePath, but keeps the translated form of the whole
+ *	path in *cachePtr so that redisplaying an unchanged item only has to
+ *	shift the cached points to the current drawable origin. Points are
+ *	cached relative to the canvas origin, so the cache survives redraws
+ *	of any part of the window and is rebuilt only after scrolling.
+ *
+ *	The numVertex points at coordArr are the complete path of the item;
+ *	only the count vertices starting at index first are written to
+ *	outArr, which must have room for count points.
+ *
+ * Results:
+ *	The return value is the number of vertices written into outArr[], or
+ *	-1 if the path needs clipping at the current origin. In that case
+ *	nothing is written and the caller must fall back to
+ *	TkCanvTranslatePath.
+ *
+ * Side effects:
+ *	The cache may be (re)filled.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+TkCanvTranslateCachedPath(
+    TkCanvas *canvPtr,		/* The canvas */
+    TkCanvPathCache *cachePtr,	/* Cache belonging to the item. */
+    int numVertex,		/* Number of vertices in the whole path. */
+    double *coordArr,		/* X and Y coordinates for each vertex */
+    int first,			/* Index of first vertex to output. */
+    int count,			/* Number of vertices to output. */
+    XPoint *outArr)		/* Write results here */
+{
+    XPoint *srcPtr;
+    int i, dx, dy;
+
+    if ((cachePtr->numPoints != 0)
+	    && ((cachePtr->xOrigin != canvPtr->xOrigin)
+	    || (cachePtr->yOrigin != canvPtr->yOrigin))) {
+	TkCanvFreePathCache(cachePtr);
+    }
+    if (cachePtr->numPoints > 0) {
+	canvPtr->pathCacheHits++;
+    } else if (cachePtr->numPoints == 0) {
+	int saveX = canvPtr->drawableXOrigin;
+	int saveY = canvPtr->drawableYOrigin;
+	XPoint *pointPtr = ckalloc(3 * numVertex * sizeof(XPoint));
+	int clipped;
+
+	canvPtr->drawableXOrigin = canvPtr->xOrigin;
+	canvPtr->drawableYOrigin = canvPtr->yOrigin;
+	TkCanvTranslatePath(canvPtr, numVertex, coordArr, 0, pointPtr,
+		&clipped);
+	canvPtr->drawableXOrigin = saveX;
+	canvPtr->drawableYOrigin = saveY;
+
+	cachePtr->xOrigin = canvPtr->xOrigin;
+	cachePtr->yOrigin = canvPtr->yOrigin;
+	if (clipped) {
+	    ckfree(pointPtr);
+	    cachePtr->numPoints = -1;
+	} else {
+	    cachePtr->pointPtr = ckrealloc(pointPtr,
+		    numVertex * sizeof(XPoint));
+	    cachePtr->numPoints = numVertex;
+	    canvPtr->pathCacheFills++;
+	}
+    }
+    if (cachePtr->numPoints < 0) {
+	return -1;
+    }
+
+    dx = canvPtr->xOrigin - canvPtr->drawableXOrigin;
+    dy = canvPtr->yOrigin - canvPtr->drawableYOrigin;
+    srcPtr = cachePtr->pointPtr + first;
+    for (i = 0; i < count; i++) {
+	outArr[i].x = (short) (srcPtr[i].x + dx);
+	outArr[i].y = (short) (srcPtr[i].y + dy);
+    }
+    return count;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkCanvFreePathCache --
+ *
+ *	Discards the points held in a path cache. Items call this whenever
+ *	their coordinates change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkCanvFreePathCache(
+    TkCanvPathCache *cachePtr)	/* Cache to empty. */
+{
+    if (cachePtr->pointPtr != NULL) {
+	ckfree(cachePtr->pointPtr);
+	cachePtr->pointPtr = NULL;
+    }
+    cachePtr->numPoints = 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkCanvDrawSegment, TkCanvFlushSegments --
+ *
+ *	TkCanvDrawSegment draws a single line segment as part of a batch:
+ *	consecutive segments drawn into the same drawable with the same GC go
+ *	out in one XDrawSegments call when TkCanvFlushSegments is called, or
+ *	when the next segment doesn't fit the batch. The caller must not
+ *	change the GC while segments are waiting. Items that draw anything
+ *	other than segments flush the batch first, so that the stacking order
+ *	is kept.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Segments are drawn, now or later.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkCanvDrawSegment(
+    TkCanvas *canvPtr,		/* The canvas */
+    Drawable drawable,		/* Where to draw. */
+    GC gc,			/* GC to draw with. */
+    XPoint *pointPtr)		/* The two ends of the segment. */
+{
+    XSegment *segPtr;
+
+    if ((canvPtr->numSegments > 0) && ((gc != canvPtr->segmentGC)
+	    || (drawable != canvPtr->segmentDrawable))) {
+	TkCanvFlushSegments(canvPtr);
+    }
+    if (canvPtr->numSegments == canvPtr->segmentSpace) {
+	canvPtr->segmentSpace = 2*canvPtr->segmentSpace + 16;
+	canvPtr->segments = ckrealloc(canvPtr->segments,
+		canvPtr->segmentSpace * sizeof(XSegment));
+    }
+    canvPtr->segmentGC = gc;
+    canvPtr->segmentDrawable = drawable;
+    segPtr = &canvPtr->segments[canvPtr->numSegments++];
+    segPtr->x1 = pointPtr[0].x;
+    segPtr->y1 = pointPtr[0].y;
+    segPtr->x2 = pointPtr[1].x;
+    segPtr->y2 = pointPtr[1].y;
+}
+
+void
+TkCanvFlushSegments(
+    TkCanvas *canvPtr)		/* The canvas */
+{
+    if (canvPtr->numSegments == 0) {
+	return;
+    }
+    XDrawSegments(canvPtr->display, canvPtr->segmentDrawable,
+	    canvPtr->segmentGC, canvPtr->segments, canvPtr->numSegments);
+    canvPtr->segmentsDrawn += canvPtr->numSegments;
+    canvPtr->segmentBatches++;
+    canvPtr->numSegments = 0;
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -238,13 +238,35 @@ static Tcl_ThreadDataKey dataKey;
 static SearchUids *	GetStaticUids(void);
 #endif /* USE_OLD_TAG_SEARCH */
 
+/*
+ * The subcommands of the canvas widget command:
+ */
+
+static const char *const canvasOptionStrings[] = {
+	"addtag",	"batch",	"bbox",		"bind",
+	"canvasx",
+	"canvasy",	"cget",		"configure",	"coords",
+	"create",	"dchars",	"delete",	"dtag",
+	"find",		"focus",	"gettags",	"icursor",
+	"imove",	"index",	"insert",	"itemcget",
+	"itemconfigure",
+	"lower",	"move",		"moveto",	"postscript",
+	"raise",	"rchars",	"scale",	"scan",
+	"select",	"type",		"xview",	"yview",
+	NULL
+};
+
 /*
  * Prototypes for functions defined later in this file:
  */
 
+static int		CanvasBatch(TkCanvas *canvasPtr, Tcl_Interp *interp,
+			    Tcl_Obj *cmdObj, Tcl_Obj *opListObj);
+static void		CanvasBatchFlush(TkCanvas *canvasPtr);
 static void		CanvasBindProc(ClientData clientData,
 			    XEvent *eventPtr);
 static void		CanvasBlinkProc(ClientData clientData);
+static void		CanvasBlitScroll(TkCanvas *canvasPtr);
 static void		CanvasCmdDeletedProc(ClientData clientData);
 static void		CanvasDoEvent(TkCanvas *canvasPtr, XEvent *eventPtr);
 static void		CanvasEventProc(ClientData clientData,
@@ -288,6 +310,8 @@ static int		FindArea(Tcl_Interp *interp, TkCanvas *canvasPtr,
 static double		GridAlign(double coord, double spacing);
 static const char**	TkGetStringsFromObjs(int argc, Tcl_Obj *const *objv);
 static void		InitCanvas(void);
+static int		ItemCoordsBinary(TkCanvas *canvasPtr,
+			    Tk_Item *itemPtr, int isFloat, Tcl_Obj *dataObj);
 #ifdef USE_OLD_TAG_SEARCH
 static Tk_Item *	NextItem(TagSearch *searchPtr);
 #endif /* USE_OLD_TAG_SEARCH */
@@ -377,6 +401,16 @@ AlwaysRedraw(
     return itemPtr->typePtr->alwaysRedraw & 1;
 }
 
+static inline void
+ItemChanged(
+    TkCanvas *canvasPtr,
+    Tk_Item *itemPtr)
+{
+    if (canvasPtr->psCache.numEntries > 0) {
+	TkCanvPsForgetItem(canvasPtr, itemPtr);
+    }
+}
+
 static inline int
 ItemConfigure(
     TkCanvas *canvasPtr,
@@ -387,6 +421,7 @@ ItemConfigure(
     Tcl_Interp *interp = canvasPtr->interp;
     int result;
 
+    ItemChanged(canvasPtr, itemPtr);
     if (itemPtr->typePtr->alwaysRedraw & TK_CONFIG_OBJS) {
 	result = itemPtr->typePtr->configProc(interp, (Tk_Canvas) canvasPtr,
 		itemPtr, objc, objv, TK_CONFIG_ARGV_ONLY);
@@ -434,6 +469,7 @@ ItemCoords(
     Tcl_Interp *interp = canvasPtr->interp;
     int result;
 
+    ItemChanged(canvasPtr, itemPtr);
     if (itemPtr->typePtr->coordProc == NULL) {
 	result = TCL_OK;
     } else if (itemPtr->typePtr->alwaysRedraw & TK_CONFIG_OBJS) {
@@ -493,6 +529,7 @@ ItemDelChars(
     int first,
     int last)
 {
+    ItemChanged(canvasPtr, itemPtr);
     itemPtr->typePtr->dCharsProc((Tk_Canvas) canvasPtr, itemPtr, first, last);
 }
 
@@ -501,6 +538,10 @@ ItemDelete(
     TkCanvas *canvasPtr,
     Tk_Item *itemPtr)
 {
+    ItemChanged(canvasPtr, itemPtr);
+    if (AlwaysRedraw(itemPtr)) {
+	canvasPtr->numAlwaysRedraw--;
+    }
     itemPtr->typePtr->deleteProc((Tk_Canvas) canvasPtr, itemPtr,
 	    canvasPtr->display);
 }
@@ -513,6 +554,14 @@ ItemDisplay(
     int screenX1, int screenY1,
     int width, int height)
 {
+    /*
+     * Line items add to the batch of segments themselves; anything else
+     * must not be drawn before the segments below it.
+     */
+
+    if (itemPtr->typePtr != &tkLineType) {
+	TkCanvFlushSegments(canvasPtr);
+    }
     itemPtr->typePtr->displayProc((Tk_Canvas) canvasPtr, itemPtr,
 	    canvasPtr->display, pixmap, screenX1, screenY1, width, height);
 }
@@ -544,6 +593,7 @@ ItemInsert(
     int beforeThis,
     Tcl_Obj *toInsert)
 {
+    ItemChanged(canvasPtr, itemPtr);
     if (itemPtr->typePtr->alwaysRedraw & TK_CONFIG_OBJS) {
 	itemPtr->typePtr->insertProc((Tk_Canvas) canvasPtr, itemPtr,
 		beforeThis, toInsert);
@@ -583,6 +633,7 @@ ItemScale(
     double xOrigin, double yOrigin,
     double xScale, double yScale)
 {
+    ItemChanged(canvasPtr, itemPtr);
     itemPtr->typePtr->scaleProc((Tk_Canvas) canvasPtr, itemPtr,
 	    xOrigin, yOrigin, xScale, yScale);
 }
@@ -610,6 +661,7 @@ ItemTranslate(
     double xDelta,
     double yDelta)
 {
+    ItemChanged(canvasPtr, itemPtr);
     itemPtr->typePtr->translateProc((Tk_Canvas) canvasPtr, itemPtr,
 	    xDelta, yDelta);
 }
@@ -641,6 +693,7 @@ Tk_CanvasObjCmd(
     Tk_Window tkwin = clientData;
     TkCanvas *canvasPtr;
     Tk_Window newWin;
+    int i;
 
     if (typeList == NULL) {
 	InitCanvas();
@@ -679,6 +732,9 @@ Tk_CanvasObjCmd(
     canvasPtr->highlightColorPtr = NULL;
     canvasPtr->inset = 0;
     canvasPtr->pixmapGC = None;
+    canvasPtr->scrollGC = None;
+    canvasPtr->blitXOrigin = canvasPtr->blitYOrigin = 0;
+    canvasPtr->numAlwaysRedraw = 0;
     canvasPtr->width = None;
     canvasPtr->height = None;
     canvasPtr->confine = 0;
@@ -739,6 +795,23 @@ Tk_CanvasObjCmd(
     canvasPtr->bindTagExprs = NULL;
 #endif
     Tcl_InitHashTable(&canvasPtr->idTable, TCL_ONE_WORD_KEYS);
+    Tcl_InitHashTable(&canvasPtr->psCache, TCL_ONE_WORD_KEYS);
+    canvasPtr->psCacheKey = NULL;
+    canvasPtr->psCacheSize = 0;
+    canvasPtr->batchDepth = 0;
+    canvasPtr->pathCacheFills = 0;
+    canvasPtr->pathCacheHits = 0;
+    canvasPtr->segments = NULL;
+    canvasPtr->numSegments = 0;
+    canvasPtr->segmentSpace = 0;
+    canvasPtr->segmentGC = NULL;
+    canvasPtr->segmentDrawable = None;
+    canvasPtr->segmentsDrawn = 0;
+    canvasPtr->segmentBatches = 0;
+    for (i = 0; i < TK_CANV_BBOX_PROCS; i++) {
+	canvasPtr->bboxProcs[i].typePtr = NULL;
+	canvasPtr->bboxProcs[i].proc = NULL;
+    }
 
     Tk_SetClass(canvasPtr->tkwin, "Canvas");
     Tk_SetClassProcs(canvasPtr->tkwin, &canvasClass, canvasPtr);
@@ -800,20 +873,9 @@ CanvasWidgetCmd(
 #endif /* USE_OLD_TAG_SEARCH */
 
     int index;
-    static const char *const optionStrings[] = {
-	"addtag",	"bbox",		"bind",		"canvasx",
-	"canvasy",	"cget",		"configure",	"coords",
-	"create",	"dchars",	"delete",	"dtag",
-	"find",		"focus",	"gettags",	"icursor",
-	"imove",	"index",	"insert",	"itemcget",
-	"itemconfigure",
-	"lower",	"move",		"moveto",	"postscript",
-	"raise",	"rchars",	"scale",	"scan",
-	"select",	"type",		"xview",	"yview",
-	NULL
-    };
     enum options {
-	CANV_ADDTAG,	CANV_BBOX,	CANV_BIND,	CANV_CANVASX,
+	CANV_ADDTAG,	CANV_BATCH,	CANV_BBOX,	CANV_BIND,
+	CANV_CANVASX,
 	CANV_CANVASY,	CANV_CGET,	CANV_CONFIGURE,	CANV_COORDS,
 	CANV_CREATE,	CANV_DCHARS,	CANV_DELETE,	CANV_DTAG,
 	CANV_FIND,	CANV_FOCUS,	CANV_GETTAGS,	CANV_ICURSOR,
@@ -828,12 +890,23 @@ CanvasWidgetCmd(
 	Tcl_WrongNumArgs(interp, 1, objv, "option ?arg ...?");
 	return TCL_ERROR;
     }
-    if (Tcl_GetIndexFromObj(interp, objv[1], optionStrings, "option", 0,
-	    &index) != TCL_OK) {
+    if (Tcl_GetIndexFromObj(interp, objv[1], canvasOptionStrings, "option",
+	    0, &index) != TCL_OK) {
 	return TCL_ERROR;
     }
     Tcl_Preserve(canvasPtr);
 
+    /*
+     * Subcommands that look at the bounding boxes of items need those of
+     * items changed in the current batch to be brought up to date first.
+     */
+
+    if ((canvasPtr->flags & BATCH_CHANGED) && ((index == CANV_ADDTAG)
+	    || (index == CANV_BBOX) || (index == CANV_FIND)
+	    || (index == CANV_MOVETO) || (index == CANV_POSTSCRIPT))) {
+	CanvasBatchFlush(canvasPtr);
+    }
+
     result = TCL_OK;
     switch ((enum options) index) {
     case CANV_ADDTAG:
@@ -845,6 +918,15 @@ CanvasWidgetCmd(
 	result = FIND_ITEMS(objv[2], 3);
 	break;
 
+    case CANV_BATCH:
+	if (objc != 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "operationList");
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	result = CanvasBatch(canvasPtr, interp, objv[0], objv[2]);
+	break;
+
     case CANV_BBOX: {
 	int i, gotAny;
 	int x1 = 0, y1 = 0, x2 = 0, y2 = 0;	/* Initializations needed only
@@ -1150,6 +1232,30 @@ CanvasWidgetCmd(
 	    goto done;
 	}
 	FIRST_CANVAS_ITEM_MATCHING(objv[2], &searchPtr, goto done);
+	if ((objc == 5 || objc == 6)
+		&& !strcmp(Tcl_GetString(objv[3]), "-binary")) {
+	    static const char *const binaryTypes[] = {
+		"double", "float", NULL
+	    };
+	    int isFloat;
+
+	    if (Tcl_GetIndexFromObj(interp, objv[4], binaryTypes,
+		    "binary type", 0, &isFloat) != TCL_OK) {
+		result = TCL_ERROR;
+		goto done;
+	    }
+	    if (itemPtr != NULL) {
+		if (objc == 6) {
+		    EventuallyRedrawItem(canvasPtr, itemPtr);
+		}
+		result = ItemCoordsBinary(canvasPtr, itemPtr, isFloat,
+			(objc == 6) ? objv[5] : NULL);
+		if (objc == 6) {
+		    EventuallyRedrawItem(canvasPtr, itemPtr);
+		}
+	    }
+	    break;
+	}
 	if (itemPtr != NULL) {
 	    if (objc != 3) {
 		EventuallyRedrawItem(canvasPtr, itemPtr);
@@ -1306,6 +1412,7 @@ CanvasWidgetCmd(
 	itemPtr->typePtr = typePtr;
 	itemPtr->state = TK_STATE_NULL;
 	itemPtr->redraw_flags = 0;
+	itemPtr->x1 = itemPtr->y1 = itemPtr->x2 = itemPtr->y2 = 0;
 
 	if (ItemCreate(canvasPtr, itemPtr, objc, objv) != TCL_OK) {
 	    ckfree(itemPtr);
@@ -1326,6 +1433,9 @@ CanvasWidgetCmd(
 	    canvasPtr->lastItemPtr->nextPtr = itemPtr;
 	}
 	canvasPtr->lastItemPtr = itemPtr;
+	if (AlwaysRedraw(itemPtr)) {
+	    canvasPtr->numAlwaysRedraw++;
+	}
 	itemPtr->redraw_flags |= FORCE_REDRAW;
 	EventuallyRedrawItem(canvasPtr, itemPtr);
 	canvasPtr->flags |= REPICK_NEEDED;
@@ -2136,6 +2246,428 @@ CanvasWidgetCmd(
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanvasBatch --
+ *
+ *	This function implements the "batch" widget command, which applies a
+ *	list of widget commands (each given as a list without the leading
+ *	pathName) to the canvas in one go. The operations are dispatched
+ *	straight to CanvasWidgetCmd, so there is no per-operation command
+ *	lookup or script evaluation. They run inside a batch (see
+ *	Tk_CanvasBeginBatch), so items touched several times have their
+ *	bounding boxes computed and their areas added to the damage region
+ *	only once, and the current item is re-picked once at the end.
+ *
+ * Results:
+ *	A standard Tcl result. On success, the interp's result is a list of
+ *	the results of the individual operations. All operations are checked
+ *	for a valid subcommand name before any is run. Processing stops at
+ *	the first operation that fails; the ones before it remain in effect.
+ *	They are not rolled back since item types have no way to save and
+ *	restore their state, and operations such as "create" or "configure"
+ *	may have side effects outside the canvas (images, embedded windows).
+ *
+ * Side effects:
+ *	Whatever the operations do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CanvasBatch(
+    TkCanvas *canvasPtr,	/* Canvas to operate on. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Obj *cmdObj,		/* Name of the canvas' widget command. */
+    Tcl_Obj *opListObj)		/* List of operations. */
+{
+    Tcl_Obj **opv, **argv, *resultObj;
+    Tcl_Obj *staticArgs[16], **args = staticArgs;
+    int i, opc, argc, index, argsSpace = 16, result = TCL_OK;
+
+    Tcl_IncrRefCount(opListObj);
+    if (Tcl_ListObjGetElements(interp, opListObj, &opc, &opv) != TCL_OK) {
+	Tcl_DecrRefCount(opListObj);
+	return TCL_ERROR;
+    }
+
+    /*
+     * Check every operation before applying any of them.
+     */
+
+    for (i = 0; i < opc; i++) {
+	if (Tcl_ListObjGetElements(interp, opv[i], &argc, &argv) != TCL_OK) {
+	    goto badOp;
+	}
+	if (argc == 0) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "empty canvas batch operation", -1));
+	    Tcl_SetErrorCode(interp, "TK", "CANVAS", "BATCH", NULL);
+	    goto badOp;
+	}
+	if (Tcl_GetIndexFromObj(interp, argv[0], canvasOptionStrings,
+		"option", 0, &index) != TCL_OK) {
+	    goto badOp;
+	}
+    }
+
+    resultObj = Tcl_NewObj();
+    Tcl_IncrRefCount(resultObj);
+    Tk_CanvasBeginBatch(interp, canvasPtr->tkwin);
+    for (i = 0; i < opc; i++) {
+	Tcl_ListObjGetElements(NULL, opv[i], &argc, &argv);
+	if (argc + 1 > argsSpace) {
+	    argsSpace = 2 * (argc + 1);
+	    if (args != staticArgs) {
+		ckfree(args);
+	    }
+	    args = ckalloc(argsSpace * sizeof(Tcl_Obj *));
+	}
+	args[0] = cmdObj;
+	memcpy(args + 1, argv, argc * sizeof(Tcl_Obj *));
+	Tcl_ResetResult(interp);
+	result = CanvasWidgetCmd(canvasPtr, interp, argc + 1, args);
+	if (result != TCL_OK) {
+	    break;
+	}
+	Tcl_ListObjAppendElement(NULL, resultObj, Tcl_GetObjResult(interp));
+    }
+    Tk_CanvasEndBatch((Tk_Canvas) canvasPtr);
+    if (result == TCL_OK) {
+	Tcl_SetObjResult(interp, resultObj);
+    } else {
+	Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+		"\n    (canvas batch operation %d)", i + 1));
+    }
+    Tcl_DecrRefCount(resultObj);
+    Tcl_DecrRefCount(opListObj);
+    if (args != staticArgs) {
+	ckfree(args);
+    }
+    return result;
+
+  badOp:
+    Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+	    "\n    (canvas batch operation %d)", i + 1));
+    Tcl_DecrRefCount(opListObj);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkCanvasFromWindow --
+ *
+ *	Finds the canvas widget record of a window.
+ *
+ * Results:
+ *	The canvas, or NULL if the window isn't a canvas widget.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tk_Canvas
+TkCanvasFromWindow(
+    Tk_Window tkwin)		/* Window that may be a canvas. */
+{
+    TkWindow *winPtr = (TkWindow *) tkwin;
+
+    if (winPtr->classProcsPtr != &canvasClass) {
+	return NULL;
+    }
+    return (Tk_Canvas) winPtr->instanceData;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tk_CanvasBeginBatch, Tk_CanvasEndBatch --
+ *
+ *	These functions bracket a series of changes to the items of a canvas.
+ *	Between them, an item's bounding box is only recomputed, and its area
+ *	only added to the region to redisplay, once however many times the
+ *	item is changed, and the current item is not re-picked. The deferred
+ *	work is done when the outermost batch ends, or earlier if something
+ *	needs up-to-date bounding boxes (such as the "bbox" or "find" widget
+ *	commands). Batches may be nested.
+ *
+ * Results:
+ *	Tk_CanvasBeginBatch returns the canvas, or NULL (with an error message
+ *	in interp) if tkwin isn't a canvas.
+ *
+ * Side effects:
+ *	The canvas is preserved for the duration of the batch; each
+ *	successful call to Tk_CanvasBeginBatch must be matched by a call to
+ *	Tk_CanvasEndBatch.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tk_Canvas
+Tk_CanvasBeginBatch(
+    Tcl_Interp *interp,		/* For error reporting; may be NULL. */
+    Tk_Window tkwin)		/* Canvas widget to start a batch on. */
+{
+    TkCanvas *canvasPtr = (TkCanvas *) TkCanvasFromWindow(tkwin);
+
+    if (canvasPtr == NULL) {
+	if (interp != NULL) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "window \"%s\" isn't a canvas", Tk_PathName(tkwin)));
+	    Tcl_SetErrorCode(interp, "TK", "CANVAS", "NOT_CANVAS", NULL);
+	}
+	return NULL;
+    }
+    Tcl_Preserve(canvasPtr);
+    canvasPtr->batchDepth++;
+    return (Tk_Canvas) canvasPtr;
+}
+
+void
+Tk_CanvasEndBatch(
+    Tk_Canvas canvas)		/* Canvas returned by Tk_CanvasBeginBatch. */
+{
+    TkCanvas *canvasPtr = (TkCanvas *) canvas;
+
+    if ((--canvasPtr->batchDepth == 0) && (canvasPtr->tkwin != NULL)) {
+	CanvasBatchFlush(canvasPtr);
+	if ((canvasPtr->flags & REPICK_NEEDED)
+		&& !(canvasPtr->flags & REDRAW_PENDING)) {
+	    Tcl_DoWhenIdle(DisplayCanvas, canvasPtr);
+	    canvasPtr->flags |= REDRAW_PENDING;
+	}
+    }
+    Tcl_Release(canvasPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkCanvDeferBbox --
+ *
+ *	Called by an item type's bounding box function before it does any
+ *	work. Inside a batch, the computation is put off until the batch is
+ *	flushed, when proc is called for the item.
+ *
+ * Results:
+ *	Returns 1 if the computation was deferred, in which case the caller
+ *	should return at once, or 0 if the caller should compute the bounding
+ *	box now.
+ *
+ * Side effects:
+ *	The item's current area is added to the region to redisplay if this
+ *	is its first change in the batch.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkCanvDeferBbox(
+    Tk_Canvas canvas,		/* Canvas containing the item. */
+    Tk_Item *itemPtr,		/* Item whose bounding box is out of date. */
+    TkCanvBboxProc *proc)	/* Function to compute it later. */
+{
+    TkCanvas *canvasPtr = (TkCanvas *) canvas;
+    int i;
+
+    if (canvasPtr->batchDepth == 0) {
+	return 0;
+    }
+    for (i = 0; i < TK_CANV_BBOX_PROCS; i++) {
+	if (canvasPtr->bboxProcs[i].typePtr == itemPtr->typePtr) {
+	    break;
+	}
+	if (canvasPtr->bboxProcs[i].typePtr == NULL) {
+	    canvasPtr->bboxProcs[i].typePtr = itemPtr->typePtr;
+	    canvasPtr->bboxProcs[i].proc = proc;
+	    break;
+	}
+    }
+    if (i == TK_CANV_BBOX_PROCS) {
+	return 0;
+    }
+    EventuallyRedrawItem(canvasPtr, itemPtr);
+    itemPtr->redraw_flags |= BATCH_DIRTY | BBOX_DEFERRED;
+    canvasPtr->flags |= BATCH_CHANGED;
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanvasBatchFlush --
+ *
+ *	Brings the items changed in the current batch up to date: computes
+ *	the bounding boxes that were deferred and adds the items' new areas to
+ *	the region to redisplay.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Item bounding boxes and the canvas' redraw region are updated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CanvasBatchFlush(
+    TkCanvas *canvasPtr)	/* Canvas whose batch is to be flushed. */
+{
+    Tk_Item *itemPtr;
+    int i, depth;
+
+    if (!(canvasPtr->flags & BATCH_CHANGED)) {
+	return;
+    }
+    canvasPtr->flags &= ~BATCH_CHANGED;
+    depth = canvasPtr->batchDepth;
+    canvasPtr->batchDepth = 0;
+    for (itemPtr = canvasPtr->firstItemPtr; itemPtr != NULL;
+	    itemPtr = itemPtr->nextPtr) {
+	if (!(itemPtr->redraw_flags & BATCH_DIRTY)) {
+	    continue;
+	}
+	if (itemPtr->redraw_flags & BBOX_DEFERRED) {
+	    for (i = 0; i < TK_CANV_BBOX_PROCS; i++) {
+		if (canvasPtr->bboxProcs[i].typePtr == itemPtr->typePtr) {
+		    canvasPtr->bboxProcs[i].proc((Tk_Canvas) canvasPtr,
+			    itemPtr);
+		    break;
+		}
+	    }
+	}
+	itemPtr->redraw_flags &= ~(BATCH_DIRTY | BBOX_DEFERRED);
+	EventuallyRedrawItem(canvasPtr, itemPtr);
+    }
+    canvasPtr->batchDepth = depth;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ItemCoordsBinary --
+ *
+ *	This function implements the "coords tagOrId -binary type ?data?"
+ *	form of the widget command, which reads or replaces an item's
+ *	coordinates as a byte array of native doubles or floats (as produced
+ *	by [binary format d* ...] or [binary format f* ...]). Item types that
+ *	provide a coordArrayProc have the coordinates copied straight to and
+ *	from their own storage; for other types, the data is converted to and
+ *	from the list form understood by coordProc.
+ *
+ * Results:
+ *	A standard Tcl result. When reading, the interp's result is set to the
+ *	byte array.
+ *
+ * Side effects:
+ *	The coordinates for the given item may be changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ItemCoordsBinary(
+    TkCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_Item *itemPtr,		/* Item whose coordinates are to be read or
+				 * modified. */
+    int isFloat,		/* Non-zero means the data holds floats, zero
+				 * means it holds doubles. */
+    Tcl_Obj *dataObj)		/* New coordinates, or NULL to read the
+				 * current ones. */
+{
+    Tcl_Interp *interp = canvasPtr->interp;
+    Tk_ItemType *typePtr = itemPtr->typePtr;
+    int i, length, numCoords, result = TCL_OK;
+    int size = isFloat ? sizeof(float) : sizeof(double);
+    double *coordPtr;
+    unsigned char *bytes;
+
+    if (dataObj == NULL) {
+	Tcl_Obj *resultObj, **objv;
+
+	if (typePtr->coordArrayProc != NULL) {
+	    numCoords = typePtr->coordArrayProc(interp, (Tk_Canvas) canvasPtr,
+		    itemPtr, -1, NULL);
+	    coordPtr = ckalloc((numCoords + 1) * sizeof(double));
+	    typePtr->coordArrayProc(interp, (Tk_Canvas) canvasPtr, itemPtr,
+		    -1, coordPtr);
+	} else {
+	    if (ItemCoords(canvasPtr, itemPtr, 0, NULL) != TCL_OK
+		    || Tcl_ListObjGetElements(interp, Tcl_GetObjResult(interp),
+			    &numCoords, &objv) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    coordPtr = ckalloc((numCoords + 1) * sizeof(double));
+	    for (i = 0; i < numCoords; i++) {
+		if (Tcl_GetDoubleFromObj(interp, objv[i],
+			&coordPtr[i]) != TCL_OK) {
+		    ckfree(coordPtr);
+		    return TCL_ERROR;
+		}
+	    }
+	}
+
+	resultObj = Tcl_NewObj();
+	bytes = Tcl_SetByteArrayLength(resultObj, numCoords * size);
+	if (isFloat) {
+	    for (i = 0; i < numCoords; i++) {
+		float value = (float) coordPtr[i];
+
+		memcpy(bytes + i*size, &value, size);
+	    }
+	} else {
+	    memcpy(bytes, coordPtr, numCoords * size);
+	}
+	ckfree(coordPtr);
+	Tcl_SetObjResult(interp, resultObj);
+	return TCL_OK;
+    }
+
+    bytes = Tcl_GetByteArrayFromObj(dataObj, &length);
+    if (length % size != 0) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"binary coordinate data must be a multiple of %d bytes, got %d",
+		size, length));
+	Tcl_SetErrorCode(interp, "TK", "CANVAS", "COORDS", "BINARY", NULL);
+	return TCL_ERROR;
+    }
+    numCoords = length / size;
+    coordPtr = ckalloc((numCoords + 1) * sizeof(double));
+    if (isFloat) {
+	for (i = 0; i < numCoords; i++) {
+	    float value;
+
+	    memcpy(&value, bytes + i*size, size);
+	    coordPtr[i] = value;
+	}
+    } else {
+	memcpy(coordPtr, bytes, length);
+    }
+
+    if (typePtr->coordArrayProc != NULL) {
+	ItemChanged(canvasPtr, itemPtr);
+	result = typePtr->coordArrayProc(interp, (Tk_Canvas) canvasPtr,
+		itemPtr, numCoords, coordPtr);
+    } else {
+	Tcl_Obj *listObj = Tcl_NewListObj(0, NULL);
+
+	for (i = 0; i < numCoords; i++) {
+	    Tcl_ListObjAppendElement(NULL, listObj,
+		    Tcl_NewDoubleObj(coordPtr[i]));
+	}
+	Tcl_IncrRefCount(listObj);
+	result = ItemCoords(canvasPtr, itemPtr, 1, &listObj);
+	Tcl_DecrRefCount(listObj);
+    }
+    ckfree(coordPtr);
+    return result;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2184,9 +2716,17 @@ DestroyCanvas(
      */
 
     Tcl_DeleteHashTable(&canvasPtr->idTable);
+    TkCanvPsFreeCache(canvasPtr);
+    Tcl_DeleteHashTable(&canvasPtr->psCache);
+    if (canvasPtr->segments != NULL) {
+	ckfree(canvasPtr->segments);
+    }
     if (canvasPtr->pixmapGC != None) {
 	Tk_FreeGC(canvasPtr->display, canvasPtr->pixmapGC);
     }
+    if (canvasPtr->scrollGC != None) {
+	Tk_FreeGC(canvasPtr->display, canvasPtr->scrollGC);
+    }
 #ifndef USE_OLD_TAG_SEARCH
     expr = canvasPtr->bindTagExprs;
     while (expr) {
@@ -2242,6 +2782,7 @@ ConfigureCanvas(
 	    flags|TK_CONFIG_OBJS) != TCL_OK) {
 	return TCL_ERROR;
     }
+    TkCanvPsFreeCache(canvasPtr);
 
     /*
      * A few options need special processing, such as setting the background
@@ -2264,6 +2805,13 @@ ConfigureCanvas(
 	Tk_FreeGC(canvasPtr->display, canvasPtr->pixmapGC);
     }
     canvasPtr->pixmapGC = newGC;
+    gcValues.graphics_exposures = True;
+    newGC = Tk_GetGC(canvasPtr->tkwin,
+	    GCFunction|GCGraphicsExposures|GCForeground, &gcValues);
+    if (canvasPtr->scrollGC != None) {
+	Tk_FreeGC(canvasPtr->display, canvasPtr->scrollGC);
+    }
+    canvasPtr->scrollGC = newGC;
 
     /*
      * Reconfigure items to reflect changed state disabled/normal.
@@ -2398,6 +2946,7 @@ CanvasWorldChanged(
     TkCanvas *canvasPtr = instanceData;
     Tk_Item *itemPtr;
 
+    TkCanvPsFreeCache(canvasPtr);
     itemPtr = canvasPtr->firstItemPtr;
     for ( ; itemPtr != NULL; itemPtr = itemPtr->nextPtr) {
 	if (ItemConfigure(canvasPtr, itemPtr, 0, NULL) != TCL_OK) {
@@ -2442,6 +2991,7 @@ DisplayCanvas(
     if (canvasPtr->tkwin == NULL) {
 	return;
     }
+    CanvasBatchFlush(canvasPtr);
 
     if (!Tk_IsMapped(tkwin)) {
 	goto done;
@@ -2462,10 +3012,12 @@ DisplayCanvas(
 
     /*
      * Choose a new current item if that is needed (this could cause event
-     * handlers to be invoked).
+     * handlers to be invoked). That waits for the end of any batch, which
+     * schedules another redisplay if it is still needed.
      */
 
-    while (canvasPtr->flags & REPICK_NEEDED) {
+    while ((canvasPtr->flags & REPICK_NEEDED)
+	    && (canvasPtr->batchDepth == 0)) {
 	Tcl_Preserve(canvasPtr);
 	canvasPtr->flags &= ~REPICK_NEEDED;
 	PickCurrentItem(canvasPtr, &canvasPtr->pickEvent);
@@ -2476,6 +3028,16 @@ DisplayCanvas(
 	}
     }
 
+    /*
+     * If the view was scrolled since the last redisplay, move the part of
+     * the window that is still valid; this registers the newly exposed areas
+     * for redrawing.
+     */
+
+    if (canvasPtr->flags & BLIT_PENDING) {
+	CanvasBlitScroll(canvasPtr);
+    }
+
     /*
      * Scan through the item list, registering the bounding box for all items
      * that didn't do that for the final coordinates yet. This can be
@@ -2604,6 +3166,7 @@ DisplayCanvas(
 	    ItemDisplay(canvasPtr, itemPtr, pixmap, screenX1, screenY1, width,
 		    height);
 	}
+	TkCanvFlushSegments(canvasPtr);
 
 #ifndef TK_NO_DOUBLE_BUFFERING
 	/*
@@ -2656,7 +3219,7 @@ DisplayCanvas(
     }
 
   done:
-    canvasPtr->flags &= ~(REDRAW_PENDING|BBOX_NOT_EMPTY);
+    canvasPtr->flags &= ~(REDRAW_PENDING|BBOX_NOT_EMPTY|BLIT_PENDING);
     canvasPtr->redrawX1 = canvasPtr->redrawX2 = 0;
     canvasPtr->redrawY1 = canvasPtr->redrawY2 = 0;
     if (canvasPtr->flags & UPDATE_SCROLLBARS) {
@@ -2692,8 +3255,19 @@ CanvasEventProc(
     if (eventPtr->type == Expose) {
 	int x, y;
 
-	x = eventPtr->xexpose.x + canvasPtr->xOrigin;
-	y = eventPtr->xexpose.y + canvasPtr->yOrigin;
+	/*
+	 * If a scroll is still waiting to be copied, the window shows the
+	 * canvas as seen from the old origin, and the damaged pixels will be
+	 * moved along with the rest.
+	 */
+
+	if (canvasPtr->flags & BLIT_PENDING) {
+	    x = eventPtr->xexpose.x + canvasPtr->blitXOrigin;
+	    y = eventPtr->xexpose.y + canvasPtr->blitYOrigin;
+	} else {
+	    x = eventPtr->xexpose.x + canvasPtr->xOrigin;
+	    y = eventPtr->xexpose.y + canvasPtr->yOrigin;
+	}
 	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr, x, y,
 		x + eventPtr->xexpose.width,
 		y + eventPtr->xexpose.height);
@@ -2724,6 +3298,7 @@ CanvasEventProc(
 	 */
 
 	CanvasSetOrigin(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin);
+	canvasPtr->flags &= ~BLIT_PENDING;
 	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr, canvasPtr->xOrigin,
 		canvasPtr->yOrigin,
 		canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
@@ -2887,6 +3462,20 @@ EventuallyRedrawItem(
     if (itemPtr == NULL) {
 	return;
     }
+    ItemChanged(canvasPtr, itemPtr);
+
+    /*
+     * Inside a batch, only the first change to an item registers its old
+     * area; the new area is added once by CanvasBatchFlush.
+     */
+
+    if (canvasPtr->batchDepth > 0) {
+	if (itemPtr->redraw_flags & BATCH_DIRTY) {
+	    return;
+	}
+	itemPtr->redraw_flags |= BATCH_DIRTY;
+	canvasPtr->flags |= BATCH_CHANGED;
+    }
     if ((itemPtr->x1 >= itemPtr->x2) || (itemPtr->y1 >= itemPtr->y2) ||
  	    (itemPtr->x2 < canvasPtr->xOrigin) ||
 	    (itemPtr->y2 < canvasPtr->yOrigin) ||
@@ -4932,6 +5521,7 @@ PickCurrentItem(
     coords[0] = canvasPtr->pickEvent.xcrossing.x + canvasPtr->xOrigin;
     coords[1] = canvasPtr->pickEvent.xcrossing.y + canvasPtr->yOrigin;
     if (canvasPtr->pickEvent.type != LeaveNotify) {
+	CanvasBatchFlush(canvasPtr);
 	canvasPtr->newCurrentPtr = CanvasFindClosest(canvasPtr, coords);
     } else {
 	canvasPtr->newCurrentPtr = NULL;
@@ -5727,6 +6317,32 @@ CanvasSetOrigin(
 	return;
     }
 
+#ifndef MAC_OSX_TK
+    /*
+     * If the window is on the screen and no item needs to hear about moving
+     * off-screen (see below), postpone the work to the next redisplay. It
+     * will copy the part of the window that stays visible and only redraw
+     * the strips that scrolled into view.
+     */
+
+    if (Tk_IsMapped(canvasPtr->tkwin) && (canvasPtr->scrollGC != None)
+	    && (canvasPtr->numAlwaysRedraw == 0)) {
+	if (!(canvasPtr->flags & BLIT_PENDING)) {
+	    canvasPtr->blitXOrigin = canvasPtr->xOrigin;
+	    canvasPtr->blitYOrigin = canvasPtr->yOrigin;
+	    canvasPtr->flags |= BLIT_PENDING;
+	}
+	canvasPtr->xOrigin = xOrigin;
+	canvasPtr->yOrigin = yOrigin;
+	canvasPtr->flags |= UPDATE_SCROLLBARS;
+	if (!(canvasPtr->flags & REDRAW_PENDING)) {
+	    Tcl_DoWhenIdle(DisplayCanvas, canvasPtr);
+	    canvasPtr->flags |= REDRAW_PENDING;
+	}
+	return;
+    }
+#endif /* MAC_OSX_TK */
+
     /*
      * Tricky point: must redisplay not only everything that's visible in the
      * window's final configuration, but also everything that was visible in
@@ -5735,6 +6351,7 @@ CanvasSetOrigin(
      * undisplay themselves.
      */
 
+    canvasPtr->flags &= ~BLIT_PENDING;
     Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr,
 	    canvasPtr->xOrigin, canvasPtr->yOrigin,
 	    canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
@@ -5747,6 +6364,96 @@ CanvasSetOrigin(
 	    canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
 	    canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanvasBlitScroll --
+ *
+ *	Called at the start of a redisplay after CanvasSetOrigin postponed a
+ *	change of origin. Moves the part of the window that is still valid to
+ *	its new position and arranges for the rest to be redrawn.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The window contents are copied and the redraw area is extended by the
+ *	strips that scrolled into view plus any parts of the source that
+ *	turned out to be obscured.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CanvasBlitScroll(
+    TkCanvas *canvasPtr)	/* Information about widget. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    int dx, dy, x, y, width, height, absDx, absDy;
+    TkRegion damageRgn;
+    XRectangle rect;
+
+    canvasPtr->flags &= ~BLIT_PENDING;
+    dx = canvasPtr->blitXOrigin - canvasPtr->xOrigin;
+    dy = canvasPtr->blitYOrigin - canvasPtr->yOrigin;
+    absDx = (dx < 0) ? -dx : dx;
+    absDy = (dy < 0) ? -dy : dy;
+    x = canvasPtr->inset;
+    y = canvasPtr->inset;
+    width = Tk_Width(tkwin) - 2*canvasPtr->inset;
+    height = Tk_Height(tkwin) - 2*canvasPtr->inset;
+
+    if ((dx == 0) && (dy == 0)) {
+	return;
+    }
+    if ((absDx >= width) || (absDy >= height)) {
+	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr,
+		canvasPtr->xOrigin, canvasPtr->yOrigin,
+		canvasPtr->xOrigin + Tk_Width(tkwin),
+		canvasPtr->yOrigin + Tk_Height(tkwin));
+	return;
+    }
+
+    /*
+     * Copy the part of the area inside the borders that remains visible.
+     * Areas of the source that were obscured come back as damage (in window
+     * coordinates).
+     */
+
+    damageRgn = TkCreateRegion();
+    if (TkScrollWindow(tkwin, canvasPtr->scrollGC, x + ((dx < 0) ? absDx : 0),
+	    y + ((dy < 0) ? absDy : 0), width - absDx, height - absDy, dx, dy,
+	    damageRgn)) {
+	TkClipBox(damageRgn, &rect);
+	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr,
+		canvasPtr->xOrigin + rect.x, canvasPtr->yOrigin + rect.y,
+		canvasPtr->xOrigin + rect.x + rect.width,
+		canvasPtr->yOrigin + rect.y + rect.height);
+    }
+    TkDestroyRegion(damageRgn);
+
+    /*
+     * Now the strips that scrolled into view.
+     */
+
+    if (dx != 0) {
+	int stripX = (dx > 0) ? x : x + width - absDx;
+
+	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr,
+		canvasPtr->xOrigin + stripX, canvasPtr->yOrigin + y,
+		canvasPtr->xOrigin + stripX + absDx,
+		canvasPtr->yOrigin + y + height);
+    }
+    if (dy != 0) {
+	int stripY = (dy > 0) ? y : y + height - absDy;
+
+	Tk_CanvasEventuallyRedraw((Tk_Canvas) canvasPtr,
+		canvasPtr->xOrigin + x, canvasPtr->yOrigin + stripY,
+		canvasPtr->xOrigin + x + width,
+		canvasPtr->yOrigin + stripY + absDy);
+    }
+}
 
 /*
  *----------------------------------------------------------------------
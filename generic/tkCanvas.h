@@ -35,6 +35,15 @@ struct TagSearchExpr_s {
 };
 #endif /* not USE_OLD_TAG_SEARCH */
 
+/*
+ * Type of the functions that item types pass to TkCanvDeferBbox, and the
+ * number of such functions a canvas can keep track of.
+ */
+
+typedef void (TkCanvBboxProc)(Tk_Canvas canvas, Tk_Item *itemPtr);
+
+#define TK_CANV_BBOX_PROCS	8
+
 /*
  * The record below describes a canvas widget. It is made available to the
  * item functions so they can access certain shared fields such as the overall
@@ -230,6 +239,76 @@ typedef struct TkCanvas {
     void *reserved2;
     void *reserved3;
     Tk_TSOffset tsoffset;
+
+    /*
+     * Information used to scroll by copying the window contents:
+     */
+
+    GC scrollGC;		/* Graphics context for copying the window
+				 * contents when scrolling; unlike pixmapGC
+				 * it generates GraphicsExpose events. */
+    int blitXOrigin, blitYOrigin;
+				/* If BLIT_PENDING is set, the canvas origin
+				 * that the contents of the window currently
+				 * correspond to. */
+    int numAlwaysRedraw;	/* Number of items whose type has
+				 * alwaysRedraw set; scrolling can't just
+				 * copy the window while there are any. */
+
+    /*
+     * Information used to avoid regenerating Postscript for items that
+     * haven't changed since the last "postscript" command:
+     */
+
+    Tcl_HashTable psCache;	/* Maps item pointers to the Postscript last
+				 * generated for them, for item types with
+				 * TK_CACHE_POSTSCRIPT set. */
+    Tcl_Obj *psCacheKey;	/* The output settings the entries of psCache
+				 * were generated with, or NULL. */
+    int psCacheSize;		/* Number of bytes of Postscript held by
+				 * psCache. */
+
+    /*
+     * Information used while a batch of changes is being made (see
+     * Tk_CanvasBeginBatch):
+     */
+
+    int batchDepth;		/* Number of Tk_CanvasBeginBatch calls that
+				 * haven't been matched by Tk_CanvasEndBatch
+				 * yet. While non-zero, bounding boxes and
+				 * redisplay of changed items are deferred
+				 * (see TkCanvDeferBbox). */
+    struct {
+	Tk_ItemType *typePtr;	/* Item type, or NULL for an unused slot. */
+	TkCanvBboxProc *proc;	/* Function that computes the bounding box of
+				 * items of that type. */
+    } bboxProcs[TK_CANV_BBOX_PROCS];
+				/* Bounding box functions of the item types
+				 * that have deferred bounding boxes. */
+
+    /*
+     * Statistics of the path cache used by line and polygon items (see
+     * TkCanvTranslateCachedPath), for the test suite:
+     */
+
+    int pathCacheFills;		/* Number of times the screen coordinates of
+				 * a path were computed and cached. */
+    int pathCacheHits;		/* Number of times a path was redrawn from
+				 * its cached screen coordinates. */
+
+    /*
+     * Single line segments waiting to be drawn with one XDrawSegments call
+     * (see TkCanvDrawSegment):
+     */
+
+    XSegment *segments;		/* Malloc'ed array of segments, or NULL. */
+    int numSegments;		/* Number of segments waiting. */
+    int segmentSpace;		/* Number of segments allocated. */
+    GC segmentGC;		/* GC to draw the waiting segments with. */
+    Drawable segmentDrawable;	/* Where to draw the waiting segments. */
+    int segmentsDrawn;		/* Number of segments drawn in batches, and */
+    int segmentBatches;		/* number of XDrawSegments calls used, for
+				 * the test suite. */
 #ifndef USE_OLD_TAG_SEARCH
     TagSearchExpr *bindTagExprs;/* Linked list of tag expressions used in
 				 * bindings. */
@@ -262,6 +341,12 @@ typedef struct TkCanvas {
  *				it should simply return immediately.
  * BBOX_NOT_EMPTY -		1 means that the bounding box of the area that
  *				should be redrawn is not empty.
+ * BLIT_PENDING -		1 means that the origin has changed since the
+ *				window was last drawn and the next redisplay
+ *				should copy the part of the window that is
+ *				still valid rather than redraw it.
+ * BATCH_CHANGED -		1 means that some items have been marked
+ *				BATCH_DIRTY since the batch was last flushed.
  */
 
 #define REDRAW_PENDING		1
@@ -273,6 +358,8 @@ typedef struct TkCanvas {
 #define LEFT_GRABBED_ITEM	0x40
 #define REPICK_IN_PROGRESS	0x100
 #define BBOX_NOT_EMPTY		0x200
+#define BLIT_PENDING		0x400
+#define BATCH_CHANGED		0x800
 
 /*
  * Flag bits for canvas items (redraw_flags):
@@ -281,20 +368,68 @@ typedef struct TkCanvas {
  *				are not yet registered using
  *				Tk_CanvasEventuallyRedraw(). It should still
  *				be done by the general canvas code.
+ * BATCH_DIRTY -		1 means that the item was changed during the
+ *				current batch; its old area has been
+ *				registered for redisplay, its new one will be
+ *				when the batch is flushed.
+ * BBOX_DEFERRED -		1 means that the item's bounding box is out of
+ *				date and will be recomputed when the batch is
+ *				flushed.
  */
 
 #define FORCE_REDRAW		8
+#define BATCH_DIRTY		0x10
+#define BBOX_DEFERRED		0x20
+
+/*
+ * Flag (used in the alwaysRedraw field of Tk_ItemType) to say that the
+ * Postscript for an item depends only on its configuration and coordinates
+ * (and on the settings of the postscript command), so it may be reused until
+ * the item changes. Only set by the standard item types.
+ */
+
+#define TK_CACHE_POSTSCRIPT	0x100
+
+/*
+ * The structure below holds the window-relative screen coordinates of a line
+ * or polygon path, so that redisplay does not have to translate (and
+ * possibly clip) every vertex again. The points are only valid for the
+ * canvas origin they were computed for; the item owning the cache must call
+ * TkCanvFreePathCache whenever its coordinates change.
+ */
+
+typedef struct TkCanvPathCache {
+    XPoint *pointPtr;		/* Malloc'ed translated points, or NULL. */
+    int numPoints;		/* Number of points in pointPtr, or -1 if the
+				 * path needs clipping at this origin and so
+				 * cannot be cached. */
+    int xOrigin, yOrigin;	/* Canvas origin the points were computed
+				 * for. */
+} TkCanvPathCache;
 
 /*
  * Canvas-related functions that are shared among Tk modules but not exported
  * to the outside world:
  */
 
+MODULE_SCOPE int	TkCanvDeferBbox(Tk_Canvas canvas, Tk_Item *itemPtr,
+			    TkCanvBboxProc *proc);
 MODULE_SCOPE int	TkCanvPostscriptCmd(TkCanvas *canvasPtr,
 			    Tcl_Interp *interp, int argc, const char **argv);
 MODULE_SCOPE int 	TkCanvTranslatePath(TkCanvas *canvPtr,
 			    int numVertex, double *coordPtr, int closed,
+			    XPoint *outPtr, int *clippedPtr);
+MODULE_SCOPE int	TkCanvTranslateCachedPath(TkCanvas *canvPtr,
+			    TkCanvPathCache *cachePtr, int numVertex,
+			    double *coordPtr, int first, int count,
 			    XPoint *outPtr);
+MODULE_SCOPE void	TkCanvFreePathCache(TkCanvPathCache *cachePtr);
+MODULE_SCOPE void	TkCanvDrawSegment(TkCanvas *canvPtr,
+			    Drawable drawable, GC gc, XPoint *pointPtr);
+MODULE_SCOPE void	TkCanvFlushSegments(TkCanvas *canvPtr);
+MODULE_SCOPE void	TkCanvPsForgetItem(TkCanvas *canvasPtr,
+			    Tk_Item *itemPtr);
+MODULE_SCOPE void	TkCanvPsFreeCache(TkCanvas *canvasPtr);
 /*
  * Standard item types provided by Tk:
  */
@@ -23,12 +23,75 @@ static int		ClipboardAppHandler(ClientData clientData,
 			    int offset, char *buffer, int maxBytes);
 static int		ClipboardHandler(ClientData clientData,
 			    int offset, char *buffer, int maxBytes);
+static void		ClipboardFreeEncoded(TkClipboardTarget *targetPtr);
+static int		ClipboardFindBuffer(TkClipboardTarget *targetPtr,
+			    long offset);
 static int		ClipboardWindowHandler(ClientData clientData,
 			    int offset, char *buffer, int maxBytes);
 static void		ClipboardLostSel(ClientData clientData);
 static int		ClipboardGetProc(ClientData clientData,
 			    Tcl_Interp *interp, const char *portion);
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClipboardFindBuffer --
+ *
+ *	Locate the buffer of a clipboard target that holds the byte at a
+ *	given offset. Retrievals fetch consecutive chunks, so the buffer in
+ *	which the previous retrieval ended and its successor are tried before
+ *	falling back to a binary search of the buffer index.
+ *
+ * Results:
+ *	The return value is the index in targetPtr->bufferIndex of the buffer
+ *	containing offset, or -1 if offset is past the end of the data.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClipboardFindBuffer(
+    TkClipboardTarget *targetPtr,
+				/* Target whose buffers are to be searched. */
+    long offset)		/* Offset of the desired byte. */
+{
+    TkClipboardBuffer **index = targetPtr->bufferIndex;
+    int i, low, high;
+
+    if ((offset < 0) || (offset >= targetPtr->length)) {
+	return -1;
+    }
+    for (i = targetPtr->lastIndex;
+	    (i < targetPtr->numBuffers) && (i <= targetPtr->lastIndex + 1);
+	    i++) {
+	if ((offset >= index[i]->offset)
+		&& (offset < index[i]->offset + index[i]->length)) {
+	    return i;
+	}
+    }
+
+    /*
+     * The offset is somewhere else; empty buffers share their offset with
+     * the next buffer, so look for the last buffer that starts at or before
+     * offset.
+     */
+
+    low = 0;
+    high = targetPtr->numBuffers - 1;
+    while (low < high) {
+	i = (low + high + 1) / 2;
+	if (index[i]->offset <= offset) {
+	    low = i;
+	} else {
+	    high = i - 1;
+	}
+    }
+    return low;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -43,7 +106,8 @@ static int		ClipboardGetProc(ClientData clientData,
  *	buffer.
  *
  * Side effects:
- *	None.
+ *	Remembers where the chunk ended, so that the next chunk can be found
+ *	without searching.
  *
  *----------------------------------------------------------------------
  */
@@ -58,53 +122,141 @@ ClipboardHandler(
 {
     TkClipboardTarget *targetPtr = clientData;
     TkClipboardBuffer *cbPtr;
-    char *srcPtr, *destPtr;
-    size_t count = 0;
-    int scanned = 0;
-    size_t length, freeCount;
+    char *destPtr;
+    long skip, length;
+    int i, count = 0;
 
     /*
      * Skip to buffer containing offset byte
      */
 
-    for (cbPtr = targetPtr->firstBufferPtr; ; cbPtr = cbPtr->nextPtr) {
-	if (cbPtr == NULL) {
-	    return 0;
-	}
-	if (scanned + cbPtr->length > offset) {
-	    break;
-	}
-	scanned += cbPtr->length;
+    i = ClipboardFindBuffer(targetPtr, offset);
+    if (i < 0) {
+	return 0;
     }
 
     /*
      * Copy up to maxBytes or end of list, switching buffers as needed.
      */
 
-    freeCount = maxBytes;
-    srcPtr = cbPtr->buffer + (offset - scanned);
     destPtr = buffer;
-    length = cbPtr->length - (offset - scanned);
-    while (1) {
-	if (length > freeCount) {
-	    strncpy(destPtr, srcPtr, freeCount);
-	    return maxBytes;
-	} else {
-	    strncpy(destPtr, srcPtr, length);
-	    destPtr += length;
-	    count += length;
-	    freeCount -= length;
+    skip = offset - targetPtr->bufferIndex[i]->offset;
+    for ( ; i < targetPtr->numBuffers; i++) {
+	cbPtr = targetPtr->bufferIndex[i];
+	length = cbPtr->length - skip;
+	if (length > maxBytes - count) {
+	    length = maxBytes - count;
 	}
-	cbPtr = cbPtr->nextPtr;
-	if (cbPtr == NULL) {
+	memcpy(destPtr, cbPtr->buffer + skip, (size_t) length);
+	destPtr += length;
+	count += length;
+	skip = 0;
+	targetPtr->lastIndex = i;
+	if (count == maxBytes) {
 	    break;
 	}
-	srcPtr = cbPtr->buffer;
-	length = cbPtr->length;
     }
-    return (int)count;
+    return count;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkClipboardGetEncoded --
+ *
+ *	Returns the entire contents of a clipboard target converted to a
+ *	given external encoding. The conversion is cached with the target, so
+ *	that serving the same target to several requestors, or in many
+ *	chunks, only encodes the data once.
+ *
+ * Results:
+ *	If selPtr is one of the clipboard's selection handlers, the return
+ *	value is a byte array object holding the converted data; the caller
+ *	must increment its reference count if it keeps it. Otherwise the
+ *	return value is NULL and the caller must convert the data itself.
+ *
+ * Side effects:
+ *	Any previously cached conversion of the target to a different
+ *	encoding is discarded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TkClipboardGetEncoded(
+    TkSelHandler *selPtr,	/* Selection handler that would supply the
+				 * data. */
+    const char *encodingName)	/* Name of the desired encoding. */
+{
+    TkClipboardTarget *targetPtr;
+    TkClipboardBuffer *cbPtr;
+    Tcl_Encoding encoding;
+    Tcl_DString utf, ds;
+
+    if (selPtr->proc != ClipboardHandler) {
+	return NULL;
+    }
+    targetPtr = selPtr->clientData;
+    encoding = Tcl_GetEncoding(NULL, encodingName);
+    if (encoding == NULL) {
+	return NULL;
+    }
+    if ((targetPtr->encodedObj != NULL) && (targetPtr->encoding == encoding)) {
+	Tcl_FreeEncoding(encoding);
+	return targetPtr->encodedObj;
+    }
+    ClipboardFreeEncoded(targetPtr);
+
+    Tcl_DStringInit(&utf);
+    Tcl_DStringSetLength(&utf, (int) targetPtr->length);
+    Tcl_DStringSetLength(&utf, 0);
+    for (cbPtr = targetPtr->firstBufferPtr; cbPtr != NULL;
+	    cbPtr = cbPtr->nextPtr) {
+	Tcl_DStringAppend(&utf, cbPtr->buffer, (int) cbPtr->length);
+    }
+    Tcl_UtfToExternalDString(encoding, Tcl_DStringValue(&utf),
+	    Tcl_DStringLength(&utf), &ds);
+    Tcl_DStringFree(&utf);
+
+    targetPtr->encoding = encoding;
+    targetPtr->encodedObj = Tcl_NewByteArrayObj(
+	    (unsigned char *) Tcl_DStringValue(&ds), Tcl_DStringLength(&ds));
+    Tcl_IncrRefCount(targetPtr->encodedObj);
+    Tcl_DStringFree(&ds);
+    return targetPtr->encodedObj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClipboardFreeEncoded --
+ *
+ *	Discards the cached conversion of a clipboard target, if any.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The cached object is released; transfers that are still using it keep
+ *	their own references.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ClipboardFreeEncoded(
+    TkClipboardTarget *targetPtr)
+{
+    if (targetPtr->encodedObj != NULL) {
+	Tcl_DecrRefCount(targetPtr->encodedObj);
+	targetPtr->encodedObj = NULL;
+    }
+    if (targetPtr->encoding != NULL) {
+	Tcl_FreeEncoding(targetPtr->encoding);
+	targetPtr->encoding = NULL;
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -269,6 +421,10 @@ Tk_ClipboardClear(
 	    nextCbPtr = cbPtr->nextPtr;
 	    ckfree(cbPtr);
 	}
+	if (targetPtr->bufferIndex != NULL) {
+	    ckfree(targetPtr->bufferIndex);
+	}
+	ClipboardFreeEncoded(targetPtr);
 	nextTargetPtr = targetPtr->nextPtr;
 	Tk_DeleteSelHandler(dispPtr->clipWindow, dispPtr->clipboardAtom,
 		targetPtr->type);
@@ -362,6 +518,12 @@ Tk_ClipboardAppend(
 	targetPtr->type = type;
 	targetPtr->format = format;
 	targetPtr->firstBufferPtr = targetPtr->lastBufferPtr = NULL;
+	targetPtr->bufferIndex = NULL;
+	targetPtr->numBuffers = targetPtr->indexSpace = 0;
+	targetPtr->lastIndex = 0;
+	targetPtr->length = 0;
+	targetPtr->encoding = NULL;
+	targetPtr->encodedObj = NULL;
 	targetPtr->nextPtr = dispPtr->clipTargetPtr;
 	dispPtr->clipTargetPtr = targetPtr;
 	Tk_CreateSelHandler(dispPtr->clipWindow, dispPtr->clipboardAtom,
@@ -377,7 +539,8 @@ Tk_ClipboardAppend(
     }
 
     /*
-     * Append a new buffer to the buffer chain.
+     * Append a new buffer to the buffer chain and to the index, and discard
+     * any conversion of the old contents.
      */
 
     cbPtr = ckalloc(sizeof(TkClipboardBuffer));
@@ -392,6 +555,16 @@ Tk_ClipboardAppend(
     cbPtr->length = strlen(buffer);
     cbPtr->buffer = ckalloc(cbPtr->length + 1);
     strcpy(cbPtr->buffer, buffer);
+    cbPtr->offset = targetPtr->length;
+    targetPtr->length += cbPtr->length;
+
+    if (targetPtr->numBuffers == targetPtr->indexSpace) {
+	targetPtr->indexSpace = 2 * targetPtr->indexSpace + 8;
+	targetPtr->bufferIndex = ckrealloc(targetPtr->bufferIndex,
+		targetPtr->indexSpace * sizeof(TkClipboardBuffer *));
+    }
+    targetPtr->bufferIndex[targetPtr->numBuffers++] = cbPtr;
+    ClipboardFreeEncoded(targetPtr);
 
     TkSelUpdateClipboard((TkWindow *) dispPtr->clipWindow, targetPtr);
 
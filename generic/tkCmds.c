@@ -38,10 +38,16 @@ static int		AppnameCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const *objv);
 static int		CaretCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const *objv);
+static int		ImagecacheCmd(ClientData dummy, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const *objv);
 static int		InactiveCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const *objv);
+static int		LayoutstatsCmd(ClientData dummy, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const *objv);
 static int		ScalingCmd(ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const *objv);
+static int		StartuptimesCmd(ClientData dummy, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const *objv);
 static int		UseinputmethodsCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv);
@@ -63,8 +69,11 @@ static const TkEnsemble tkCmdMap[] = {
     {"appname",		AppnameCmd, NULL },
     {"busy",		Tk_BusyObjCmd, NULL },
     {"caret",		CaretCmd, NULL },
+    {"imagecache",	ImagecacheCmd, NULL },
     {"inactive",	InactiveCmd, NULL },
+    {"layoutstats",	LayoutstatsCmd, NULL },
     {"scaling",		ScalingCmd, NULL },
+    {"startuptimes",	StartuptimesCmd, NULL },
     {"useinputmethods",	UseinputmethodsCmd, NULL },
     {"windowingsystem",	WindowingsystemCmd, NULL },
     {"fontchooser",	NULL, tkFontchooserEnsemble},
@@ -224,6 +233,23 @@ Tk_BindObjCmd(
 	if (mask == 0) {
 	    return TCL_ERROR;
 	}
+
+	/*
+	 * A windowless window gets its pointer events through its parent
+	 * (see TkWindowlessPointerEvent), but it needs an X window of its
+	 * own for a binding to keyboard or other events to fire.
+	 */
+
+	if ((string[0] == '.') && (winPtr->flags & TK_WINDOWLESS)
+		&& (mask & ~(ExposureMask|StructureNotifyMask
+			|VisibilityChangeMask|ButtonPressMask
+			|ButtonReleaseMask|EnterWindowMask|LeaveWindowMask
+			|PointerMotionMask|PointerMotionHintMask
+			|ButtonMotionMask|Button1MotionMask|Button2MotionMask
+			|Button3MotionMask|Button4MotionMask
+			|Button5MotionMask))) {
+	    Tk_MakeWindowExist((Tk_Window) winPtr);
+	}
     } else if (objc == 3) {
 	const char *command;
 
@@ -659,7 +685,8 @@ TkInitTkCmd(
  *----------------------------------------------------------------------
  *
  * AppnameCmd, CaretCmd, ScalingCmd, UseinputmethodsCmd,
- * WindowingsystemCmd, InactiveCmd --
+ * WindowingsystemCmd, InactiveCmd, ImagecacheCmd, LayoutstatsCmd,
+ * StartuptimesCmd --
  *
  *	These functions are invoked to process the "tk" ensemble subcommands.
  *	See the user documentation for details on what they do.
@@ -970,7 +997,81 @@ InactiveCmd(
     }
     return TCL_OK;
 }
+
+int
+ImagecacheCmd(
+    ClientData clientData,	/* Main window associated with interpreter. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tcl_WideInt limit = -1;
+
+    if (Tcl_IsSafe(interp)) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"imagecache not accessible in a safe interpreter", -1));
+	Tcl_SetErrorCode(interp, "TK", "SAFE", "IMAGE_CACHE", NULL);
+	return TCL_ERROR;
+    }
+    if (objc > 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?size|statistics?");
+	return TCL_ERROR;
+    }
+    if ((objc == 2) && !strcmp(Tcl_GetString(objv[1]), "statistics")) {
+	Tcl_SetObjResult(interp, TkPhotoCacheStatistics());
+	return TCL_OK;
+    }
+    if (objc == 2) {
+	if (Tcl_GetWideIntFromObj(interp, objv[1], &limit) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (limit < 0) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "bad cache size \"%s\": must be a non-negative integer",
+		    Tcl_GetString(objv[1])));
+	    Tcl_SetErrorCode(interp, "TK", "VALUE", "IMAGE_CACHE", NULL);
+	    return TCL_ERROR;
+	}
+	TkPhotoCacheLimit(limit);
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(TkPhotoCacheLimit(-1)));
+    return TCL_OK;
+}
+
+int
+LayoutstatsCmd(
+    ClientData clientData,	/* Main window associated with interpreter. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, TkGetLayoutStats());
+    return TCL_OK;
+}
 
+int
+StartuptimesCmd(
+    ClientData clientData,	/* Main window associated with interpreter. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    TkMainInfo *mainPtr = ((TkWindow *) clientData)->mainPtr;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    if (mainPtr->startupTimes != NULL) {
+	Tcl_SetObjResult(interp, mainPtr->startupTimes);
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
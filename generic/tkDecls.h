@@ -870,6 +870,18 @@ EXTERN void		Tk_CreateOldImageType(const Tk_ImageType *typePtr);
 /* 273 */
 EXTERN void		Tk_CreateOldPhotoImageFormat(
 				const Tk_PhotoImageFormat *formatPtr);
+/* 274 */
+EXTERN void		Tk_InternAtoms(Tk_Window tkwin, int count,
+				const char *const *names, Atom *atoms);
+/* 275 */
+EXTERN int		Tk_CanvasDecimatePath(int numVertex,
+				const double *coordArr, double *outArr,
+				int *monotonicPtr);
+/* 276 */
+EXTERN Tk_Canvas	Tk_CanvasBeginBatch(Tcl_Interp *interp,
+				Tk_Window tkwin);
+/* 277 */
+EXTERN void		Tk_CanvasEndBatch(Tk_Canvas canvas);
 
 typedef struct {
     const struct TkPlatStubs *tkPlatStubs;
@@ -1156,6 +1168,10 @@ typedef struct TkStubs {
     Tcl_Interp * (*tk_Interp) (Tk_Window tkwin); /* 271 */
     void (*tk_CreateOldImageType) (const Tk_ImageType *typePtr); /* 272 */
     void (*tk_CreateOldPhotoImageFormat) (const Tk_PhotoImageFormat *formatPtr); /* 273 */
+    void (*tk_InternAtoms) (Tk_Window tkwin, int count, const char *const *names, Atom *atoms); /* 274 */
+    int (*tk_CanvasDecimatePath) (int numVertex, const double *coordArr, double *outArr, int *monotonicPtr); /* 275 */
+    Tk_Canvas (*tk_CanvasBeginBatch) (Tcl_Interp *interp, Tk_Window tkwin); /* 276 */
+    void (*tk_CanvasEndBatch) (Tk_Canvas canvas); /* 277 */
 } TkStubs;
 
 extern const TkStubs *tkStubsPtr;
@@ -1716,6 +1732,14 @@ extern const TkStubs *tkStubsPtr;
 	(tkStubsPtr->tk_CreateOldImageType) /* 272 */
 #define Tk_CreateOldPhotoImageFormat \
 	(tkStubsPtr->tk_CreateOldPhotoImageFormat) /* 273 */
+#define Tk_InternAtoms \
+	(tkStubsPtr->tk_InternAtoms) /* 274 */
+#define Tk_CanvasDecimatePath \
+	(tkStubsPtr->tk_CanvasDecimatePath) /* 275 */
+#define Tk_CanvasBeginBatch \
+	(tkStubsPtr->tk_CanvasBeginBatch) /* 276 */
+#define Tk_CanvasEndBatch \
+	(tkStubsPtr->tk_CanvasEndBatch) /* 277 */
 
 #endif /* defined(USE_TK_STUBS) */
 
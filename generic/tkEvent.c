@@ -193,6 +193,7 @@ TCL_DECLARE_MUTEX(exitMutex)
 
 static void		CleanUpTkEvent(XEvent *eventPtr);
 static void		DelayedMotionProc(ClientData clientData);
+static void		DispatchEvent(XEvent *eventPtr, TkWindow *winPtr);
 static int		GetButtonMask(unsigned int Button);
 static unsigned long    GetEventMaskFromXEvent(XEvent *eventPtr);
 static TkWindow *	GetTkWindowFromXEvent(XEvent *eventPtr);
@@ -1136,11 +1137,15 @@ TkXErrorHandler(
  *
  * ParentXId --
  *
- *	Returns the parent of the given window, or "None" if the window
- *	doesn't exist.
+ *	Returns the parent of the given window. Root windows, whose property
+ *	changes are the most frequent reason for asking, are answered without
+ *	a round trip to the server. The answer is not cached: Tk gets no
+ *	events that would tell it when a foreign window is destroyed and its
+ *	id reused.
  *
  * Results:
- *	Returns an X window ID.
+ *	The parent window, or None if the window has no parent or does not
+ *	exist.
  *
  * Side effects:
  *	None.
@@ -1154,43 +1159,70 @@ ParentXId(
     Window w)
 {
     Tk_ErrorHandler handler;
-    int gotXError;
     Status status;
     Window parent;
     Window root;
     Window *childList;
     unsigned int nChildren;
+    int i, gotXError;
 
     /*
-     * Handle errors ourselves.
+     * Root windows have no parent; property changes on them are frequent
+     * and never worth a round trip.
      */
 
-    gotXError = 0;
-    handler = Tk_CreateErrorHandler(display, -1, -1, -1,
-	    TkXErrorHandler, &gotXError);
+    for (i = 0; i < ScreenCount(display); i++) {
+	if (w == RootWindow(display, i)) {
+	    return None;
+	}
+    }
 
     /*
-     * Get the parent window.
+     * Get the parent window, handling errors ourselves. XQueryTree waits for
+     * its reply, so any error has been reported by the time it returns and
+     * no XSync is needed before the handler goes.
      */
 
+    gotXError = 0;
+    handler = Tk_CreateErrorHandler(display, -1, -1, -1,
+	    TkXErrorHandler, &gotXError);
     status = XQueryTree(display, w, &root, &parent, &childList, &nChildren);
-
-    /*
-     * Do some cleanup; gotta return "None" if we got an error.
-     */
-
     Tk_DeleteErrorHandler(handler);
-    XSync(display, False);
     if (status != 0 && childList != NULL) {
 	XFree(childList);
     }
-    if (status == 0) {
-	parent = None;
+    if (status == 0 || gotXError) {
+	return None;
     }
-
     return parent;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkHandleWindowlessEvent --
+ *
+ *	Dispatches an event synthesized for a window that has no X window
+ *	(a windowless window, or one destroyed before it was ever made to
+ *	exist), which cannot be found from the (None) window in the event.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Same as Tk_HandleEvent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkHandleWindowlessEvent(
+    TkWindow *winPtr,		/* Window the event is for. */
+    XEvent *eventPtr)		/* Event to dispatch. */
+{
+    DispatchEvent(eventPtr, winPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1211,16 +1243,48 @@ ParentXId(
 void
 Tk_HandleEvent(
     XEvent *eventPtr)	/* Event to dispatch. */
+{
+    DispatchEvent(eventPtr, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DispatchEvent --
+ *
+ *	Does the work of Tk_HandleEvent and TkHandleWindowlessEvent.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Depends on the handlers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DispatchEvent(
+    XEvent *eventPtr,		/* Event to dispatch. */
+    TkWindow *winPtr)		/* Window the event is for, or NULL to find
+				 * it from the window in the event. */
 {
     register TkEventHandler *handlerPtr;
-    TkWindow *winPtr;
     unsigned long mask;
     InProgress ip;
     Tcl_Interp *interp = NULL;
+    int windowless = (winPtr != NULL);
     ThreadSpecificData *tsdPtr =
 	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
 
-    UpdateButtonEventState(eventPtr);
+    /*
+     * The pointer events of windowless windows have already been through
+     * this, and through the grab code below, as events for their parent.
+     */
+
+    if (!windowless) {
+	UpdateButtonEventState(eventPtr);
+    }
 
     /*
      * If the generic handler processed this event we are done and can return.
@@ -1239,7 +1303,9 @@ Tk_HandleEvent(
     }
 
     mask = GetEventMaskFromXEvent(eventPtr);
-    winPtr = GetTkWindowFromXEvent(eventPtr);
+    if (winPtr == NULL) {
+	winPtr = GetTkWindowFromXEvent(eventPtr);
+    }
 
     if (winPtr == NULL) {
 	goto releaseEventResources;
@@ -1274,11 +1340,19 @@ Tk_HandleEvent(
 	Tcl_Preserve(interp);
 
 	result = ((InvokeFocusHandlers(&winPtr, mask, eventPtr))
-		|| (InvokeMouseHandlers(winPtr, mask, eventPtr)));
+		|| (!windowless
+		    && InvokeMouseHandlers(winPtr, mask, eventPtr)));
 
 	if (result) {
 	    goto releaseInterpreter;
 	}
+
+	if ((winPtr->flags & TK_HAS_WINDOWLESS)
+		&& (mask & (ButtonPressMask|ButtonReleaseMask
+		    |PointerMotionMask|EnterWindowMask|LeaveWindowMask))
+		&& TkWindowlessPointerEvent(winPtr, eventPtr)) {
+	    goto releaseInterpreter;
+	}
     }
 
     /*
@@ -1297,7 +1371,8 @@ Tk_HandleEvent(
 	winPtr->inputContext = NULL;
     }
 
-    if ((winPtr->dispPtr->flags & TK_DISPLAY_USE_IM)) {
+    if ((winPtr->dispPtr->flags & TK_DISPLAY_USE_IM)
+	    && (winPtr->window != None)) {
 	if (!(winPtr->flags & (TK_CHECKED_IC|TK_ALREADY_DEAD))) {
 	    winPtr->flags |= TK_CHECKED_IC;
 	    if (winPtr->dispPtr->inputMethod != NULL) {
@@ -647,6 +647,9 @@ TkSetFocusWin(
 	 * we discard focus events that are triggered by the ChangeFocus.
 	 */
 
+	if (force) {
+	    TkFlushWindowChanges();
+	}
 	serial = TkpChangeFocus(TkpGetWrapperWindow(topLevelPtr), force);
 	if (serial != 0) {
 	    displayFocusPtr->focusSerial = serial;
@@ -676,6 +676,7 @@ CreateFrame(
      */
 
     Tk_SetClassProcs(newWin, &frameClass, framePtr);
+    TkAllowWindowless(newWin);
 
     mask = ExposureMask | StructureNotifyMask | FocusChangeMask;
     if (type == TYPE_TOPLEVEL) {
@@ -1611,6 +1612,12 @@ DisplayFrame(
 #endif /* TK_NO_DOUBLE_BUFFERING */
     }
 
+    /*
+     * Windowless children are drawn into the frame's window, so they have to
+     * be drawn again over the new background.
+     */
+
+    TkRedrawWindowless(tkwin);
 }
 
 /*
@@ -49,6 +49,112 @@ typedef struct MaintainMaster {
 				 * this master. */
 } MaintainMaster;
 
+/*
+ * Geometry managers don't lay out their masters directly from idle handlers
+ * of their own; they schedule them with TkScheduleLayout, and all the masters
+ * scheduled in a thread are laid out together by one idle handler, a layout
+ * pass. There is one of the following structures for each master waiting to
+ * be laid out:
+ */
+
+struct LayoutEntry;
+
+typedef struct LayoutList {
+    struct LayoutEntry *firstPtr, *lastPtr;
+				/* Ends of a list of entries, kept sorted
+				 * deepest first. */
+} LayoutList;
+
+typedef struct LayoutEntry {
+    Tcl_IdleProc *proc;		/* Manager procedure that lays out the
+				 * master. */
+    ClientData clientData;	/* Manager's record for the master; also the
+				 * key of this entry in the layout table. */
+    int depth;			/* Number of ancestors of the master window,
+				 * used to order the pass. */
+    LayoutList *arrangeListPtr;	/* List of masters being arranged by a pass
+				 * that holds the entry, or NULL if the entry
+				 * is waiting for a pass. Passes can nest (see
+				 * LayoutPassProc), each with its own list. */
+    struct LayoutEntry *prevPtr, *nextPtr;
+				/* Neighbours in the list holding the entry,
+				 * which is kept sorted deepest first. */
+} LayoutEntry;
+
+/*
+ * A layout pass has two phases. In the request phase, the waiting masters are
+ * visited deepest first and their managers only compute and propagate their
+ * requested sizes (see TkLayoutRequestOnly); parents whose requested size
+ * changes as a result join the pass. In the arrange phase, the masters are
+ * visited shallowest first and their slaves are placed, so each master is
+ * laid out once, after its own size has been settled by its parent.
+ */
+
+#define LAYOUT_IDLE		0
+#define LAYOUT_REQUEST		1
+#define LAYOUT_ARRANGE		2
+
+/*
+ * While a pass runs, the X requests that move, resize and map the slaves
+ * being placed are held back: the new geometry is recorded in the TkWindow
+ * and the usual ConfigureNotify and MapNotify events are synthesized at once,
+ * but the window is entered in a table of pending windows that is flushed
+ * when the pass ends. A slave that is moved several times during a pass is
+ * only moved once, and one that is mapped and unmapped again is left alone.
+ * There is one of the following structures for each pending window. Only the
+ * X11 port defers requests; the other ports emulate the X calls and keep
+ * their own state.
+ */
+
+#if !defined(_WIN32) && !defined(MAC_OSX_TK)
+#define DEFER_WINDOW_CHANGES
+#endif
+
+typedef struct PendingWindow {
+    TkWindow *winPtr;		/* Window the requests are for; also the key
+				 * of this entry in the pending table. */
+    unsigned int changeMask;	/* CWX, CWY, CWWidth, CWHeight and
+				 * CWBorderWidth bits of the geometry still
+				 * to be sent. */
+    int map;			/* Non-zero means the window is still to be
+				 * mapped. */
+    int depth;			/* Number of ancestors of the window, used to
+				 * send the requests parents first. */
+} PendingWindow;
+
+typedef struct {
+    int initialized;		/* Non-zero once the table is set up. */
+    Tcl_HashTable layoutTable;	/* Maps clientData to the LayoutEntry, for all
+				 * masters waiting in either list below. */
+    LayoutEntry *firstPtr, *lastPtr;
+				/* Masters waiting for the next (or, during
+				 * the request phase, the current) pass. */
+    LayoutEntry *cursorPtr;	/* Next entry to visit in the request
+				 * phase. */
+    ClientData requestOnly;	/* Master whose manager is being asked for its
+				 * requested size only, or NULL. */
+    int phase;			/* LAYOUT_IDLE, LAYOUT_REQUEST or
+				 * LAYOUT_ARRANGE. */
+    int passScheduled;		/* Non-zero means LayoutPassProc has been
+				 * scheduled as an idle handler. */
+    long passes;		/* Statistics for "tk layoutstats": number of
+				 * layout passes run, */
+    long requests;		/* ... of masters asked for their sizes, */
+    long arranges;		/* ... of masters arranged, */
+    long configures;		/* ... of geometry requests sent at the end
+				 * of passes, */
+    long configuresSaved;	/* ... of geometry requests merged into one
+				 * already pending, */
+    long maps;			/* ... of map requests sent at the end of
+				 * passes, */
+    long mapsSaved;		/* ... and of map requests dropped because
+				 * the window was unmapped again. */
+    Tcl_HashTable pendingTable;	/* Maps TkWindow pointers to the
+				 * PendingWindow holding their deferred
+				 * requests. */
+} ThreadSpecificData;
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Prototypes for static procedures in this file:
  */
@@ -58,6 +164,16 @@ static void		MaintainMasterProc(ClientData clientData,
 			    XEvent *eventPtr);
 static void		MaintainSlaveProc(ClientData clientData,
 			    XEvent *eventPtr);
+static void		LayoutPassProc(ClientData clientData);
+static void		UnlinkLayoutEntry(ThreadSpecificData *tsdPtr,
+			    LayoutEntry *entryPtr);
+#ifdef DEFER_WINDOW_CHANGES
+static int		ComparePendingWindows(const void *first,
+			    const void *second);
+static PendingWindow *	DeferWindow(TkWindow *winPtr, int *newPtr);
+static void		FlushWindowChanges(ThreadSpecificData *tsdPtr);
+static void		PendingSetupProc(ClientData clientData, int flags);
+#endif
 
 /*
  *--------------------------------------------------------------
@@ -775,6 +891,769 @@ MaintainCheckProc(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkScheduleLayout --
+ *
+ *	Geometry managers call this instead of Tcl_DoWhenIdle to arrange for
+ *	a master window to be laid out at the next idle moment.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Proc will be called with clientData during the next layout pass
+ *	(twice: see TkLayoutRequestOnly). Scheduling a master that is already
+ *	waiting, or that is being destroyed, does nothing.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkScheduleLayout(
+    Tk_Window tkwin,		/* Master window to be laid out. */
+    Tcl_IdleProc *proc,		/* Manager procedure that lays it out. */
+    ClientData clientData)	/* Argument for proc; identifies the master
+				 * from now on. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    LayoutEntry *entryPtr, *nextPtr;
+    Tcl_HashEntry *hPtr;
+    TkWindow *winPtr;
+    int isNew;
+
+    if (!tsdPtr->initialized) {
+	Tcl_InitHashTable(&tsdPtr->layoutTable, TCL_ONE_WORD_KEYS);
+	Tcl_InitHashTable(&tsdPtr->pendingTable, TCL_ONE_WORD_KEYS);
+#ifdef DEFER_WINDOW_CHANGES
+	Tcl_CreateEventSource(PendingSetupProc, NULL, NULL);
+#endif
+	tsdPtr->initialized = 1;
+    }
+
+    /*
+     * A master that is being destroyed has nothing left to lay out. Its
+     * slaves are torn down one by one before it, and each would otherwise
+     * reschedule it only for the manager to cancel the entry again.
+     */
+
+    if (((TkWindow *) tkwin)->flags & TK_ALREADY_DEAD) {
+	return;
+    }
+    hPtr = Tcl_CreateHashEntry(&tsdPtr->layoutTable, (char *) clientData,
+	    &isNew);
+    if (!isNew) {
+	return;
+    }
+
+    entryPtr = ckalloc(sizeof(LayoutEntry));
+    entryPtr->proc = proc;
+    entryPtr->clientData = clientData;
+    entryPtr->arrangeListPtr = NULL;
+    entryPtr->depth = 0;
+    for (winPtr = ((TkWindow *) tkwin)->parentPtr; winPtr != NULL;
+	    winPtr = winPtr->parentPtr) {
+	entryPtr->depth++;
+    }
+    Tcl_SetHashValue(hPtr, entryPtr);
+
+    /*
+     * Insert the entry after every waiting master at least as deep. During
+     * the request phase this keeps parents that join the pass ahead of the
+     * cursor.
+     */
+
+    for (nextPtr = tsdPtr->firstPtr; nextPtr != NULL;
+	    nextPtr = nextPtr->nextPtr) {
+	if (nextPtr->depth < entryPtr->depth) {
+	    break;
+	}
+    }
+    entryPtr->nextPtr = nextPtr;
+    if (nextPtr == NULL) {
+	entryPtr->prevPtr = tsdPtr->lastPtr;
+	tsdPtr->lastPtr = entryPtr;
+    } else {
+	entryPtr->prevPtr = nextPtr->prevPtr;
+	nextPtr->prevPtr = entryPtr;
+    }
+    if (entryPtr->prevPtr == NULL) {
+	tsdPtr->firstPtr = entryPtr;
+    } else {
+	entryPtr->prevPtr->nextPtr = entryPtr;
+    }
+    if ((tsdPtr->phase == LAYOUT_REQUEST) && (tsdPtr->cursorPtr == nextPtr)) {
+	tsdPtr->cursorPtr = entryPtr;
+    }
+
+    if (!tsdPtr->passScheduled && (tsdPtr->phase != LAYOUT_REQUEST)) {
+	Tcl_DoWhenIdle(LayoutPassProc, NULL);
+	tsdPtr->passScheduled = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkCancelLayout --
+ *
+ *	Cancels a layout scheduled with TkScheduleLayout, typically because
+ *	the master is being destroyed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Proc will not be called for clientData by the layout pass.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkCancelLayout(
+    Tcl_IdleProc *proc,		/* Procedure passed to TkScheduleLayout. */
+    ClientData clientData)	/* Argument passed to TkScheduleLayout. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    LayoutEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+
+    if (!tsdPtr->initialized) {
+	return;
+    }
+    hPtr = Tcl_FindHashEntry(&tsdPtr->layoutTable, (char *) clientData);
+    if (hPtr == NULL) {
+	return;
+    }
+    entryPtr = Tcl_GetHashValue(hPtr);
+    if (entryPtr->proc != proc) {
+	return;
+    }
+    Tcl_DeleteHashEntry(hPtr);
+    if (tsdPtr->cursorPtr == entryPtr) {
+	tsdPtr->cursorPtr = entryPtr->nextPtr;
+    }
+    UnlinkLayoutEntry(tsdPtr, entryPtr);
+    ckfree(entryPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkLayoutRequestOnly --
+ *
+ *	Geometry managers call this at the start of their layout procedure to
+ *	find out whether the layout pass is in its request phase for this
+ *	master. If so, the manager should compute the master's requested size,
+ *	call Tk_GeometryRequest if it has changed, and return without placing
+ *	any slaves; it will be called again to place them once the sizes of
+ *	all the masters above it have been settled.
+ *
+ * Results:
+ *	1 if only the requested size is wanted, 0 for a full layout.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkLayoutRequestOnly(
+    ClientData clientData)	/* Argument passed to TkScheduleLayout. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    return (tsdPtr->requestOnly != NULL)
+	    && (tsdPtr->requestOnly == clientData);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkGetLayoutStats --
+ *
+ *	Returns the layout pass counters of the calling thread, for the
+ *	"tk layoutstats" command.
+ *
+ * Results:
+ *	A new dictionary object with the keys "passes", "requests",
+ *	"arranges", "configures", "configuresSaved", "maps" and "mapsSaved".
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TkGetLayoutStats(void)
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    Tcl_Obj *resultObj = Tcl_NewObj();
+
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("passes", -1),
+	    Tcl_NewLongObj(tsdPtr->passes));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("requests", -1),
+	    Tcl_NewLongObj(tsdPtr->requests));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("arranges", -1),
+	    Tcl_NewLongObj(tsdPtr->arranges));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("configures", -1),
+	    Tcl_NewLongObj(tsdPtr->configures));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("configuresSaved", -1),
+	    Tcl_NewLongObj(tsdPtr->configuresSaved));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("maps", -1),
+	    Tcl_NewLongObj(tsdPtr->maps));
+    Tcl_DictObjPut(NULL, resultObj, Tcl_NewStringObj("mapsSaved", -1),
+	    Tcl_NewLongObj(tsdPtr->mapsSaved));
+    return resultObj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnlinkLayoutEntry --
+ *
+ *	Removes a layout entry from whichever list holds it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The list is updated; the entry is not freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UnlinkLayoutEntry(
+    ThreadSpecificData *tsdPtr,
+    LayoutEntry *entryPtr)
+{
+    LayoutEntry **firstPtrPtr, **lastPtrPtr;
+
+    if (entryPtr->arrangeListPtr != NULL) {
+	firstPtrPtr = &entryPtr->arrangeListPtr->firstPtr;
+	lastPtrPtr = &entryPtr->arrangeListPtr->lastPtr;
+    } else {
+	firstPtrPtr = &tsdPtr->firstPtr;
+	lastPtrPtr = &tsdPtr->lastPtr;
+    }
+
+    if (entryPtr->prevPtr == NULL) {
+	*firstPtrPtr = entryPtr->nextPtr;
+    } else {
+	entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    }
+    if (entryPtr->nextPtr == NULL) {
+	*lastPtrPtr = entryPtr->prevPtr;
+    } else {
+	entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LayoutPassProc --
+ *
+ *	Idle handler that lays out every master scheduled with
+ *	TkScheduleLayout: first asks their managers for their requested sizes,
+ *	deepest master first, then has them place their slaves, shallowest
+ *	master first.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the managers' layout procedures do. Masters scheduled during
+ *	the arrange phase are laid out by another pass. If a binding fired in
+ *	the arrange phase enters the event loop (e.g. "update idletasks" in a
+ *	<Configure> binding), that pass runs nested in this one and lays out
+ *	the masters scheduled so far; the masters this pass has still to
+ *	arrange are left to it. The window changes deferred so far are sent
+ *	before a nested pass starts.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LayoutPassProc(
+    ClientData clientData)	/* Not used. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    LayoutEntry *entryPtr;
+    LayoutList arrangeList;
+    Tcl_HashEntry *hPtr;
+    int outerPhase = tsdPtr->phase;
+
+    tsdPtr->passScheduled = 0;
+    if ((tsdPtr->firstPtr == NULL) || (outerPhase == LAYOUT_REQUEST)) {
+	/*
+	 * Nothing to do, or the request phase of the current pass entered
+	 * the event loop; the masters it adds are laid out by that pass.
+	 */
+
+	return;
+    }
+#ifdef DEFER_WINDOW_CHANGES
+    if (outerPhase == LAYOUT_ARRANGE) {
+	FlushWindowChanges(tsdPtr);
+    }
+#endif
+    tsdPtr->passes++;
+
+    /*
+     * Request phase. An entry may be cancelled, or parents may be added
+     * ahead of the cursor, by the procedure being called.
+     */
+
+    tsdPtr->phase = LAYOUT_REQUEST;
+    for (entryPtr = tsdPtr->firstPtr; entryPtr != NULL;
+	    entryPtr = tsdPtr->cursorPtr) {
+	tsdPtr->cursorPtr = entryPtr->nextPtr;
+	tsdPtr->requestOnly = entryPtr->clientData;
+	tsdPtr->requests++;
+	entryPtr->proc(entryPtr->clientData);
+	tsdPtr->requestOnly = NULL;
+    }
+    tsdPtr->cursorPtr = NULL;
+
+    /*
+     * Arrange phase. Entries are taken off the list before their procedure
+     * is called, which may schedule them afresh for the next pass.
+     */
+
+    tsdPtr->phase = LAYOUT_ARRANGE;
+    for (entryPtr = tsdPtr->firstPtr; entryPtr != NULL;
+	    entryPtr = entryPtr->nextPtr) {
+	entryPtr->arrangeListPtr = &arrangeList;
+    }
+    arrangeList.firstPtr = tsdPtr->firstPtr;
+    arrangeList.lastPtr = tsdPtr->lastPtr;
+    tsdPtr->firstPtr = tsdPtr->lastPtr = NULL;
+    while ((entryPtr = arrangeList.lastPtr) != NULL) {
+	Tcl_IdleProc *proc = entryPtr->proc;
+	ClientData entryData = entryPtr->clientData;
+
+	UnlinkLayoutEntry(tsdPtr, entryPtr);
+	hPtr = Tcl_FindHashEntry(&tsdPtr->layoutTable, (char *) entryData);
+	Tcl_DeleteHashEntry(hPtr);
+	ckfree(entryPtr);
+	tsdPtr->arranges++;
+	proc(entryData);
+    }
+
+    /*
+     * A nested pass leaves the deferred window changes to the outermost
+     * one.
+     */
+
+    tsdPtr->phase = outerPhase;
+#ifdef DEFER_WINDOW_CHANGES
+    if (outerPhase == LAYOUT_IDLE) {
+	FlushWindowChanges(tsdPtr);
+    }
+#endif
+    if ((tsdPtr->firstPtr != NULL) && !tsdPtr->passScheduled) {
+	Tcl_DoWhenIdle(LayoutPassProc, NULL);
+	tsdPtr->passScheduled = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkDeferWindowChanges --
+ *
+ *	Called by Tk_ConfigureWindow and friends after they have recorded a
+ *	new geometry for a window that exists, to find out whether the X
+ *	request can be held back until the end of the current layout pass.
+ *
+ * Results:
+ *	Returns 1 if the request was deferred, in which case the caller must
+ *	not send it, or 0 if it must be sent now.
+ *
+ * Side effects:
+ *	The window may be entered in the pending table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkDeferWindowChanges(
+    TkWindow *winPtr,		/* Window whose geometry has changed. */
+    unsigned int mask)		/* Fields of winPtr->changes that changed. */
+{
+#ifdef DEFER_WINDOW_CHANGES
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    PendingWindow *pendPtr;
+    int isNew;
+
+    if (tsdPtr->phase == LAYOUT_IDLE) {
+	return 0;
+    }
+    pendPtr = DeferWindow(winPtr, &isNew);
+    if (pendPtr == NULL) {
+	return 0;
+    }
+    if (pendPtr->changeMask != 0) {
+	tsdPtr->configuresSaved++;
+    }
+    pendPtr->changeMask |= mask;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkDeferWindowMap --
+ *
+ *	Called by Tk_MapWindow to find out whether mapping an existing child
+ *	window can be held back until the end of the current layout pass.
+ *
+ * Results:
+ *	Returns 1 if the map request was deferred, or 0 if the caller must
+ *	send it now.
+ *
+ * Side effects:
+ *	The window may be entered in the pending table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkDeferWindowMap(
+    TkWindow *winPtr)		/* Window being mapped. */
+{
+#ifdef DEFER_WINDOW_CHANGES
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    PendingWindow *pendPtr;
+    int isNew;
+
+    if (tsdPtr->phase == LAYOUT_IDLE) {
+	return 0;
+    }
+    pendPtr = DeferWindow(winPtr, &isNew);
+    if (pendPtr == NULL) {
+	return 0;
+    }
+    pendPtr->map = 1;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkCancelWindowMap --
+ *
+ *	Called by Tk_UnmapWindow to drop a map request still pending for a
+ *	window.
+ *
+ * Results:
+ *	Returns 1 if a map request was pending, in which case the window was
+ *	never mapped on the server and the caller must not unmap it, or 0
+ *	otherwise.
+ *
+ * Side effects:
+ *	The pending map request is forgotten.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkCancelWindowMap(
+    TkWindow *winPtr)		/* Window being unmapped. */
+{
+#ifdef DEFER_WINDOW_CHANGES
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    Tcl_HashEntry *hPtr;
+    PendingWindow *pendPtr;
+
+    if (!tsdPtr->initialized) {
+	return 0;
+    }
+    hPtr = Tcl_FindHashEntry(&tsdPtr->pendingTable, (char *) winPtr);
+    if (hPtr == NULL) {
+	return 0;
+    }
+    pendPtr = Tcl_GetHashValue(hPtr);
+    if (!pendPtr->map) {
+	return 0;
+    }
+    pendPtr->map = 0;
+    tsdPtr->mapsSaved++;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkCancelWindowChanges --
+ *
+ *	Called by Tk_DestroyWindow to forget the requests still pending for a
+ *	window whose X window is about to be destroyed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The window is removed from the pending table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkCancelWindowChanges(
+    TkWindow *winPtr)		/* Window being destroyed. */
+{
+#ifdef DEFER_WINDOW_CHANGES
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    Tcl_HashEntry *hPtr;
+
+    if (!tsdPtr->initialized) {
+	return;
+    }
+    hPtr = Tcl_FindHashEntry(&tsdPtr->pendingTable, (char *) winPtr);
+    if (hPtr != NULL) {
+	ckfree(Tcl_GetHashValue(hPtr));
+	Tcl_DeleteHashEntry(hPtr);
+    }
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkFlushWindowChanges --
+ *
+ *	Sends the window changes deferred so far by the current layout pass.
+ *	Called before requests whose outcome depends on the windows being
+ *	mapped on the server, such as grabs and forced focus changes, which
+ *	may be made by bindings fired during a pass.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	X requests may be sent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkFlushWindowChanges(void)
+{
+#ifdef DEFER_WINDOW_CHANGES
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    if (tsdPtr->initialized && (tsdPtr->phase != LAYOUT_IDLE)) {
+	FlushWindowChanges(tsdPtr);
+    }
+#endif
+}
+
+#ifdef DEFER_WINDOW_CHANGES
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeferWindow --
+ *
+ *	Finds or creates the pending table entry for a window.
+ *
+ * Results:
+ *	The entry, or NULL if requests for the window cannot be deferred:
+ *	toplevels, whose geometry the window manager has a say in, and
+ *	windows that do not exist yet are handled as before. *newPtr is set
+ *	to 1 if the entry was created.
+ *
+ * Side effects:
+ *	May create an entry.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PendingWindow *
+DeferWindow(
+    TkWindow *winPtr,		/* Window to look up. */
+    int *newPtr)		/* Set to non-zero if the entry is new. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    Tcl_HashEntry *hPtr;
+    PendingWindow *pendPtr;
+
+    if ((winPtr->window == None)
+	    || (winPtr->flags & (TK_TOP_HIERARCHY|TK_WIN_MANAGED))) {
+	return NULL;
+    }
+    hPtr = Tcl_CreateHashEntry(&tsdPtr->pendingTable, (char *) winPtr,
+	    newPtr);
+    if (!*newPtr) {
+	return Tcl_GetHashValue(hPtr);
+    }
+    pendPtr = ckalloc(sizeof(PendingWindow));
+    pendPtr->winPtr = winPtr;
+    pendPtr->changeMask = 0;
+    pendPtr->map = 0;
+    pendPtr->depth = 0;
+    Tcl_SetHashValue(hPtr, pendPtr);
+    return pendPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushWindowChanges --
+ *
+ *	Sends the requests deferred during a layout pass. Windows are visited
+ *	parents first, so that children appear in their final place when
+ *	their parent is mapped.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	X requests are sent and the pending table is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushWindowChanges(
+    ThreadSpecificData *tsdPtr)
+{
+    PendingWindow **pendArray;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    TkWindow *winPtr, *ancestorPtr;
+    int i, count = tsdPtr->pendingTable.numEntries;
+
+    if (count == 0) {
+	return;
+    }
+    pendArray = ckalloc(count * sizeof(PendingWindow *));
+    i = 0;
+    for (hPtr = Tcl_FirstHashEntry(&tsdPtr->pendingTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	PendingWindow *pendPtr = Tcl_GetHashValue(hPtr);
+
+	for (ancestorPtr = pendPtr->winPtr->parentPtr; ancestorPtr != NULL;
+		ancestorPtr = ancestorPtr->parentPtr) {
+	    pendPtr->depth++;
+	}
+	pendArray[i++] = pendPtr;
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    qsort(pendArray, (size_t) count, sizeof(PendingWindow *),
+	    ComparePendingWindows);
+
+    for (i = 0; i < count; i++) {
+	winPtr = pendArray[i]->winPtr;
+	if (pendArray[i]->changeMask != 0) {
+	    XConfigureWindow(winPtr->display, winPtr->window,
+		    pendArray[i]->changeMask, &winPtr->changes);
+	    tsdPtr->configures++;
+	}
+	if (pendArray[i]->map && (winPtr->flags & TK_MAPPED)) {
+	    XMapWindow(winPtr->display, winPtr->window);
+	    tsdPtr->maps++;
+	}
+	ckfree(pendArray[i]);
+    }
+    ckfree(pendArray);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PendingSetupProc --
+ *
+ *	Event source setup procedure, called each time Tcl_DoOneEvent is about
+ *	to wait for events. If a binding fired during a layout pass enters the
+ *	event loop (e.g. "tkwait visibility" in a <Map> binding), the events
+ *	it waits for may depend on the requests the pass has deferred, so they
+ *	are sent first.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	X requests may be sent and the output buffers of the displays are
+ *	flushed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PendingSetupProc(
+    ClientData clientData,	/* Not used. */
+    int flags)			/* Flags passed to Tcl_DoOneEvent. */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    TkDisplay *dispPtr;
+
+    if ((tsdPtr->phase == LAYOUT_IDLE)
+	    || (tsdPtr->pendingTable.numEntries == 0)) {
+	return;
+    }
+    FlushWindowChanges(tsdPtr);
+    for (dispPtr = TkGetDisplayList(); dispPtr != NULL;
+	    dispPtr = dispPtr->nextPtr) {
+	XFlush(dispPtr->display);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ComparePendingWindows --
+ *
+ *	qsort comparison function ordering pending windows parents first.
+ *
+ * Results:
+ *	Negative, zero or positive as the first window is shallower than, as
+ *	deep as or deeper than the second.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ComparePendingWindows(
+    const void *first,
+    const void *second)
+{
+    const PendingWindow *firstPtr = *(const PendingWindow *const *) first;
+    const PendingWindow *secondPtr = *(const PendingWindow *const *) second;
+
+    return firstPtr->depth - secondPtr->depth;
+}
+#endif /* DEFER_WINDOW_CHANGES */
+
 /*
  * Local Variables:
  * mode: c
@@ -426,6 +426,7 @@ Tk_Grab(
     }
 
     Tk_MakeWindowExist(tkwin);
+    TkFlushWindowChanges();
 #ifndef MAC_OSX_TK
     if (!grabGlobal)
 #else
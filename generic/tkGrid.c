@@ -471,7 +471,7 @@ GridAnchorCommand(
 	}
 	if (!(masterPtr->flags & REQUESTED_RELAYOUT)) {
 	    masterPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
 	}
     }
     return TCL_OK;
@@ -664,7 +664,7 @@ GridForgetRemoveCommand(
 		}
 		slavePtr->doubleBw = 2*Tk_Changes(tkwin)->border_width;
 		if (slavePtr->flags & REQUESTED_RELAYOUT) {
-		    Tcl_CancelIdleCall(ArrangeGrid, slavePtr);
+		    TkCancelLayout(ArrangeGrid, slavePtr);
 		}
 		slavePtr->flags = 0;
 		slavePtr->sticky = 0;
@@ -820,7 +820,7 @@ GridLocationCommand(
      */
 
     while (masterPtr->flags & REQUESTED_RELAYOUT) {
-	Tcl_CancelIdleCall(ArrangeGrid, masterPtr);
+	TkCancelLayout(ArrangeGrid, masterPtr);
 	ArrangeGrid(masterPtr);
     }
     SetGridSize(masterPtr);
@@ -933,7 +933,7 @@ GridPropagateCommand(
 	}
 	if (!(masterPtr->flags & REQUESTED_RELAYOUT)) {
 	    masterPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
 	}
     }
     return TCL_OK;
@@ -1260,7 +1260,7 @@ GridRowColumnConfigureCommand(
     }
     if (!(masterPtr->flags & REQUESTED_RELAYOUT)) {
 	masterPtr->flags |= REQUESTED_RELAYOUT;
-	Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
     }
     return TCL_OK;
 
@@ -1436,7 +1436,7 @@ GridReqProc(
     gridPtr = gridPtr->masterPtr;
     if (gridPtr && !(gridPtr->flags & REQUESTED_RELAYOUT)) {
 	gridPtr->flags |= REQUESTED_RELAYOUT;
-	Tcl_DoWhenIdle(ArrangeGrid, gridPtr);
+	TkScheduleLayout(gridPtr->tkwin, ArrangeGrid, gridPtr);
     }
 }
 
@@ -1702,7 +1702,7 @@ AdjustForSticky(
  *
  * ArrangeGrid --
  *
- *	This procedure is invoked (using the Tcl_DoWhenIdle mechanism) to
+ *	This procedure is invoked by a layout pass (see TkScheduleLayout) to
  *	re-layout a set of windows managed by the grid. It is invoked at idle
  *	time so that a series of grid requests can be merged into a single
  *	layout operation.
@@ -1728,8 +1728,11 @@ ArrangeGrid(
     int width, height;		/* Requested size of layout, in pixels. */
     int realWidth, realHeight;	/* Actual size layout should take-up. */
     int usedX, usedY;
+    int requestOnly = TkLayoutRequestOnly(masterPtr);
 
-    masterPtr->flags &= ~REQUESTED_RELAYOUT;
+    if (!requestOnly) {
+	masterPtr->flags &= ~REQUESTED_RELAYOUT;
+    }
 
     /*
      * If the master has no slaves anymore, then don't do anything at all:
@@ -1784,13 +1787,24 @@ ArrangeGrid(
 	Tk_GeometryRequest(masterPtr->tkwin, width, height);
 	if (width>1 && height>1) {
 	    masterPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
 	}
 	masterPtr->abortPtr = NULL;
 	Tcl_Release(masterPtr);
 	return;
     }
 
+    /*
+     * In the request phase of a layout pass that's all; the slaves are
+     * placed later in the pass, once the master's own size is settled.
+     */
+
+    if (requestOnly) {
+	masterPtr->abortPtr = NULL;
+	Tcl_Release(masterPtr);
+	return;
+    }
+
     /*
      * If the currently requested layout size doesn't match the master's
      * window size, then adjust the slot offsets according to the weights. If
@@ -2765,7 +2779,7 @@ Unlink(
     }
     if (!(masterPtr->flags & REQUESTED_RELAYOUT)) {
 	masterPtr->flags |= REQUESTED_RELAYOUT;
-	Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
     }
     if (masterPtr->abortPtr != NULL) {
 	*masterPtr->abortPtr = 1;
@@ -2857,14 +2871,15 @@ GridStructureProc(
 	if ((gridPtr->slavePtr != NULL)
 		&& !(gridPtr->flags & REQUESTED_RELAYOUT)) {
 	    gridPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, gridPtr);
+	    TkScheduleLayout(gridPtr->tkwin, ArrangeGrid, gridPtr);
 	}
 	if ((gridPtr->masterPtr != NULL) &&
 		(gridPtr->doubleBw != 2*Tk_Changes(gridPtr->tkwin)->border_width)) {
 	    if (!(gridPtr->masterPtr->flags & REQUESTED_RELAYOUT)) {
 		gridPtr->doubleBw = 2*Tk_Changes(gridPtr->tkwin)->border_width;
 		gridPtr->masterPtr->flags |= REQUESTED_RELAYOUT;
-		Tcl_DoWhenIdle(ArrangeGrid, gridPtr->masterPtr);
+		TkScheduleLayout(gridPtr->masterPtr->tkwin, ArrangeGrid,
+			gridPtr->masterPtr);
 	    }
 	}
     } else if (eventPtr->type == DestroyNotify) {
@@ -2883,7 +2898,7 @@ GridStructureProc(
 	Tcl_DeleteHashEntry(Tcl_FindHashEntry(&dispPtr->gridHashTable,
 		(char *) gridPtr->tkwin));
 	if (gridPtr->flags & REQUESTED_RELAYOUT) {
-	    Tcl_CancelIdleCall(ArrangeGrid, gridPtr);
+	    TkCancelLayout(ArrangeGrid, gridPtr);
 	}
 	gridPtr->tkwin = NULL;
 	Tcl_EventuallyFree(gridPtr, (Tcl_FreeProc *)DestroyGrid);
@@ -2891,7 +2906,7 @@ GridStructureProc(
 	if ((gridPtr->slavePtr != NULL)
 		&& !(gridPtr->flags & REQUESTED_RELAYOUT)) {
 	    gridPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, gridPtr);
+	    TkScheduleLayout(gridPtr->tkwin, ArrangeGrid, gridPtr);
 	}
     } else if (eventPtr->type == UnmapNotify) {
 	register Gridder *gridPtr2;
@@ -3405,7 +3420,7 @@ ConfigureSlaves(
 	}
 	if (!(masterPtr->flags & REQUESTED_RELAYOUT)) {
 	    masterPtr->flags |= REQUESTED_RELAYOUT;
-	    Tcl_DoWhenIdle(ArrangeGrid, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, ArrangeGrid, masterPtr);
 	}
     }
 
@@ -537,6 +537,14 @@ Tk_ImageChanged(
     ImageMaster *masterPtr = (ImageMaster *) imageMaster;
     Image *imagePtr;
 
+    /*
+     * Photo images decoded on a worker thread (see "read -async") have no
+     * master.
+     */
+
+    if (masterPtr == NULL) {
+	return;
+    }
     masterPtr->width = imageWidth;
     masterPtr->height = imageHeight;
     for (imagePtr = masterPtr->instancePtr; imagePtr != NULL;
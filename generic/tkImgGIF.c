@@ -97,15 +97,81 @@ static const char GIF89a[] = {			/* ASCII GIF89a */
 typedef struct {
     const char *fromData;
     unsigned char workingBuffer[280];
-    struct {
-	int bytes;
-	int done;
-	unsigned int window;
-	int bitsInWindow;
-	unsigned char *c;
-    } reader;
 } GIFImageConfig;
 
+/*
+ * Reading frame N of an animated GIF means walking over frames 0..N-1 first.
+ * To make playing an animation frame by frame linear rather than quadratic,
+ * each thread remembers, for recently read files, where every frame seen so
+ * far starts, together with the state needed to decode it from there.
+ */
+
+typedef struct {
+    Tcl_WideInt offset;		/* File offset of the first block after the
+				 * previous frame's data: the frame's
+				 * extensions, then its image separator
+				 * (GIF_START) byte. */
+    int transparent;		/* Transparent color index in effect for the
+				 * frame, or -1. */
+    int disposal;		/* Disposal method from the frame's graphic
+				 * control extension, or 0. */
+    int delay;			/* Delay time from the frame's graphic
+				 * control extension, or 0. */
+    int left, top, width, height;
+				/* Frame rectangle within the logical
+				 * screen. */
+} GIFFrame;
+
+typedef struct {
+    Tcl_WideInt size;		/* Size and modification time of the file */
+    Tcl_WideInt mtime;		/* when the directory was started. */
+    GIFFrame *frames;		/* Malloc'ed array of known frames. */
+    int numFrames;		/* Number of frames in the array. */
+    int frameSpace;		/* Number of frames allocated. */
+    int resumeFrame;		/* Number of frames whose data has been
+				 * skipped over from the start of the
+				 * file. */
+    Tcl_WideInt resumeOffset;	/* Offset just after the data of frame
+				 * resumeFrame-1; a search for a later frame
+				 * continues from here. */
+    int resumeTransparent;	/* Transparent color index in effect at
+				 * resumeOffset. */
+} GIFFrameDirectory;
+
+/*
+ * Maximum number of files that have a frame directory at any time.
+ */
+
+#define GIF_MAX_DIRECTORIES	16
+
+/*
+ * Pixels saved before drawing a frame with the "restore to previous"
+ * disposal method, so that the next frame of the same file composed onto the
+ * same photo can put them back. Photos are told apart by name rather than by
+ * handle, since a handle may be reused by a later image.
+ */
+
+typedef struct {
+    char *key;			/* Name of the photo the pixels were saved
+				 * from and identity of the file (see
+				 * GetRestoreKey). Malloc'ed, or NULL if
+				 * nothing is saved. */
+    int frame;			/* Index of the frame about to be drawn when
+				 * the pixels were saved. */
+    int x, y;			/* Where the pixels go in the photo. */
+    Tk_PhotoImageBlock block;	/* The saved pixels (malloc'ed). */
+} GIFRestoreInfo;
+
+typedef struct ThreadSpecificData {
+    int initialized;		/* Set to 1 when the table below has been
+				 * initialized. */
+    Tcl_HashTable directories;	/* Maps normalized file names to
+				 * GIFFrameDirectory records. */
+    GIFRestoreInfo restore;	/* Pixels to restore before composing the
+				 * next frame. */
+} ThreadSpecificData;
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Type of a function used to do the writing to a file or buffer when
  * serializing in the GIF format.
@@ -165,13 +231,26 @@ Tk_PhotoImageFormat tkImgFmtGIF = {
  * Prototypes for local functions defined in this file:
  */
 
+static void		ComposeDisposal(Tcl_Interp *interp,
+			    Tk_PhotoHandle imageHandle, const char *restoreKey,
+			    GIFFrame *prevPtr, int prevIndex, int destX,
+			    int destY, int width, int height, int srcX,
+			    int srcY);
 static int		DoExtension(GIFImageConfig *gifConfPtr,
 			    Tcl_Channel chan, int label, unsigned char *buffer,
-			    int *transparent);
-static int		GetCode(Tcl_Channel chan, int code_size, int flag,
-			    GIFImageConfig *gifConfPtr);
+			    int *transparent, int *disposal, int *delay);
+static GIFFrameDirectory *GetFrameDirectory(const char *fileName,
+			    Tcl_Channel chan);
+static Tcl_Obj *	GetRestoreKey(Tk_PhotoHandle imageHandle,
+			    const char *fileName, int fromData);
+static ThreadSpecificData *GetThreadData(void);
+static void		GIFThreadExitProc(ClientData clientData);
+static int		SkipImage(GIFImageConfig *gifConfPtr,
+			    Tcl_Channel chan);
 static int		GetDataBlock(GIFImageConfig *gifConfPtr,
 			    Tcl_Channel chan, unsigned char *buf);
+static unsigned char *	ReadDataBlocks(GIFImageConfig *gifConfPtr,
+			    Tcl_Channel chan, int *lengthPtr);
 static int		ReadColorMap(GIFImageConfig *gifConfPtr,
 			    Tcl_Channel chan, int number,
 			    unsigned char buffer[MAXCOLORMAPSIZE][4]);
@@ -208,6 +287,27 @@ static void		mInit(unsigned char *string, MFile *handle,
 
 #define DEFAULT_BACKGROUND_VALUE	0xD9
 
+/*
+ * The palette being built is indexed by a small open-addressed hash table
+ * (keyed by 0xRRGGBB + 1, 0 meaning an empty slot), so that looking up the
+ * index of a pixel's color doesn't need to search the palette.
+ */
+
+#define COLOR_HASH_SIZE		1024
+#define COLOR_HASH(key) \
+	((((unsigned int) (key)) * 2654435761U) >> 22)
+
+/*
+ * Images with more colors than fit in a GIF palette can be reduced by median
+ * cut on a histogram with this many bits per channel.
+ */
+
+#define QUANT_BITS		5
+#define QUANT_LEVELS		(1 << QUANT_BITS)
+#define QUANT_BIN(r, g, b) \
+	((((r) >> (8 - QUANT_BITS)) << (2 * QUANT_BITS)) \
+	| (((g) >> (8 - QUANT_BITS)) << QUANT_BITS) | ((b) >> (8 - QUANT_BITS)))
+
 typedef struct {
     int ssize;
     int csize;
@@ -220,8 +320,23 @@ typedef struct {
     int alphaOffset;
     int num;
     unsigned char mapa[MAXCOLORMAPSIZE][3];
+    unsigned int colorHash[COLOR_HASH_SIZE];
+    unsigned char colorSlot[COLOR_HASH_SIZE];
+    unsigned char *indexPtr;	/* If not NULL, the (malloc'ed) palette index
+				 * of every pixel, as chosen by Quantize. */
+    unsigned char *nextIndex;	/* Next entry of indexPtr to write. */
 } GifWriterState;
 
+/*
+ * One box of the color space being split by the median cut quantizer, in
+ * histogram bin coordinates (inclusive).
+ */
+
+typedef struct {
+    int min[3], max[3];
+    unsigned long count;	/* Number of pixels in the box. */
+} QuantBox;
+
 typedef int (* ifunptr) (GifWriterState *statePtr);
 
 /*
@@ -313,6 +428,12 @@ static void		Compress(int initBits, ClientData handle,
 			    GifWriterState *statePtr);
 static int		IsNewColor(GifWriterState *statePtr,
 			    int red, int green, int blue);
+static void		AddColor(GifWriterState *statePtr,
+			    int red, int green, int blue, int index);
+static int		Quantize(GifWriterState *statePtr,
+			    Tk_PhotoImageBlock *blockPtr, int dither);
+static void		ShrinkBox(QuantBox *boxPtr,
+			    const unsigned int *hist);
 static void		SaveMap(GifWriterState *statePtr,
 			    Tk_PhotoImageBlock *blockPtr);
 static int		ReadValue(GifWriterState *statePtr);
@@ -395,14 +516,22 @@ FileReadGIF(
     int fileWidth, fileHeight, imageWidth, imageHeight;
     unsigned int nBytes;
     int index = 0, argc = 0, i, result = TCL_ERROR;
+    int compose = 0, frameNum = 0, disposal = 0, delay = 0, havePrev = 0;
+    int reqIndex, reqDestX, reqDestY, reqWidth, reqHeight, reqSrcX, reqSrcY;
+    Tcl_WideInt startOffset = 0, frameStart = -1;
+    Tcl_Obj *restoreKey = NULL;
     Tcl_Obj **objv;
     unsigned char buf[100];
-    unsigned char *trashBuffer = NULL;
     int bitPixel;
     unsigned char colorMap[MAXCOLORMAPSIZE][4];
     int transparent = -1;
+    GIFFrameDirectory *dirPtr = NULL;
+    GIFFrame frame, prevFrame;
     static const char *const optionStrings[] = {
-	"-index", NULL
+	"-compose", "-index", NULL
+    };
+    enum options {
+	OPT_COMPOSE, OPT_INDEX
     };
     GIFImageConfig gifConf, *gifConfPtr = &gifConf;
 
@@ -439,8 +568,17 @@ FileReadGIF(
 	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "OPT_VALUE", NULL);
 	    return TCL_ERROR;
 	}
-	if (Tcl_GetIntFromObj(interp, objv[++i], &index) != TCL_OK) {
-	    return TCL_ERROR;
+	switch ((enum options) optionIdx) {
+	case OPT_COMPOSE:
+	    if (Tcl_GetBooleanFromObj(interp, objv[++i], &compose) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    break;
+	case OPT_INDEX:
+	    if (Tcl_GetIntFromObj(interp, objv[++i], &index) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    break;
 	}
     }
 
@@ -489,6 +627,12 @@ FileReadGIF(
 	    || (srcX >= fileWidth) || (srcY >= fileHeight)) {
 	return TCL_OK;
     }
+    reqDestX = destX;
+    reqDestY = destY;
+    reqWidth = width;
+    reqHeight = height;
+    reqSrcX = srcX;
+    reqSrcY = srcY;
 
     /*
      * Make sure we have enough space in the photo image to hold the data from
@@ -500,6 +644,42 @@ FileReadGIF(
 	return TCL_ERROR;
     }
 
+    /*
+     * When reading from a file, use what is known about its frames to start
+     * at the wanted frame, or else as close to it as possible.
+     */
+
+    reqIndex = index;
+    if ((gifConfPtr->fromData == NULL) && (index > 0)) {
+	dirPtr = GetFrameDirectory(fileName, chan);
+    }
+    if (dirPtr != NULL) {
+	Tcl_WideInt offset = 0;
+
+	startOffset = Tcl_Tell(chan);
+	if (index < dirPtr->numFrames) {
+	    frameNum = index;
+	    offset = dirPtr->frames[index].offset;
+	    transparent = dirPtr->frames[index - 1].transparent;
+	} else if (dirPtr->resumeFrame > 0) {
+	    frameNum = dirPtr->resumeFrame;
+	    offset = dirPtr->resumeOffset;
+	    transparent = dirPtr->resumeTransparent;
+	}
+	if (frameNum > 0) {
+	    if (Tcl_Seek(chan, offset, SEEK_SET) < 0) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"error seeking in GIF image: %s",
+			Tcl_PosixError(interp)));
+		return TCL_ERROR;
+	    }
+	    prevFrame = dirPtr->frames[frameNum - 1];
+	    havePrev = 1;
+	    index -= frameNum;
+	}
+	frameStart = Tcl_Tell(chan);
+    }
+
     /*
      * Search for the frame from the GIF to display.
      */
@@ -538,7 +718,8 @@ FileReadGIF(
 		goto error;
 	    }
 	    if (DoExtension(gifConfPtr, chan, buf[0],
-		    gifConfPtr->workingBuffer, &transparent) < 0) {
+		    gifConfPtr->workingBuffer, &transparent, &disposal,
+		    &delay) < 0) {
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			"error reading extension in GIF image", -1));
 		Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "BAD_EXT",
@@ -547,6 +728,7 @@ FileReadGIF(
 	    }
 	    continue;
 	case GIF_START:
+	    frame.offset = frameStart;
 	    if (Fread(gifConfPtr, buf, 1, 9, chan) != 9) {
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			"couldn't read left/top/width/height in GIF image",
@@ -566,20 +748,75 @@ FileReadGIF(
 
 	/*
 	 * We've read the header for a GIF frame. Work out what we are going
-	 * to do about it.
+	 * to do about it, and remember where it was if that's new.
 	 */
 
 	imageWidth = LM_to_uint(buf[4], buf[5]);
 	imageHeight = LM_to_uint(buf[6], buf[7]);
 	bitPixel = 1 << ((buf[8] & 0x07) + 1);
 
+	frame.transparent = transparent;
+	frame.disposal = disposal;
+	frame.delay = delay;
+	frame.left = LM_to_uint(buf[0], buf[1]);
+	frame.top = LM_to_uint(buf[2], buf[3]);
+	frame.width = imageWidth;
+	frame.height = imageHeight;
+	disposal = 0;
+	delay = 0;
+	if ((dirPtr != NULL) && (frameNum < dirPtr->numFrames)
+		&& ((frame.offset != dirPtr->frames[frameNum].offset)
+		|| (frame.transparent != dirPtr->frames[frameNum].transparent)
+		|| (frame.disposal != dirPtr->frames[frameNum].disposal)
+		|| (frame.delay != dirPtr->frames[frameNum].delay)
+		|| (frame.left != dirPtr->frames[frameNum].left)
+		|| (frame.top != dirPtr->frames[frameNum].top)
+		|| (frame.width != dirPtr->frames[frameNum].width)
+		|| (frame.height != dirPtr->frames[frameNum].height))) {
+	    /*
+	     * The frame isn't where, or what, the directory says: the file
+	     * has been rewritten without changing its size or modification
+	     * time. Forget what is known about it and look for the frame
+	     * from the start. Since a frame is entered at its extensions,
+	     * this also notices a changed delay or disposal method.
+	     */
+
+	    dirPtr->numFrames = 0;
+	    dirPtr->resumeFrame = 0;
+	    dirPtr->resumeOffset = 0;
+	    dirPtr->resumeTransparent = -1;
+	    if (Tcl_Seek(chan, startOffset, SEEK_SET) < 0) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"error seeking in GIF image: %s",
+			Tcl_PosixError(interp)));
+		goto error;
+	    }
+	    frameStart = startOffset;
+	    frameNum = 0;
+	    index = reqIndex;
+	    transparent = -1;
+	    havePrev = 0;
+	    continue;
+	}
+	if ((dirPtr != NULL) && (frameNum == dirPtr->numFrames)
+		&& (frame.offset >= 0)) {
+	    if (dirPtr->numFrames == dirPtr->frameSpace) {
+		dirPtr->frameSpace = 2*dirPtr->frameSpace + 8;
+		dirPtr->frames = ckrealloc(dirPtr->frames,
+			dirPtr->frameSpace * sizeof(GIFFrame));
+	    }
+	    dirPtr->frames[dirPtr->numFrames++] = frame;
+	}
+
 	if (index--) {
 	    /*
-	     * This is not the GIF frame we want to read: skip it.
+	     * This is not the GIF frame we want to read: skip its color map
+	     * and compressed data without decoding them. This is also where a
+	     * later search for a later frame can pick up.
 	     */
 
 	    if (BitSet(buf[8], LOCALCOLORMAP)) {
-		if (!ReadColorMap(gifConfPtr, chan, bitPixel, colorMap)) {
+		if (!ReadColorMap(gifConfPtr, chan, bitPixel, NULL)) {
 		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			    "error reading color map", -1));
 		    Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF",
@@ -587,43 +824,19 @@ FileReadGIF(
 		    goto error;
 		}
 	    }
-
-	    /*
-	     * If we've not yet allocated a trash buffer, do so now.
-	     */
-
-	    if (trashBuffer == NULL) {
-		if (fileWidth > (int)((UINT_MAX/3)/fileHeight)) {
-		    goto error;
-		}
-		nBytes = fileWidth * fileHeight * 3;
-		trashBuffer = ckalloc(nBytes);
-		if (trashBuffer) {
-		    memset(trashBuffer, 0, nBytes);
+	    if (!SkipImage(gifConfPtr, chan)) {
+		frameStart = -1;
+	    } else if (dirPtr != NULL) {
+		frameStart = Tcl_Tell(chan);
+		if (frameNum == dirPtr->resumeFrame) {
+		    dirPtr->resumeFrame++;
+		    dirPtr->resumeOffset = frameStart;
+		    dirPtr->resumeTransparent = transparent;
 		}
 	    }
-
-	    /*
-	     * Slurp! Process the data for this image and stuff it in a trash
-	     * buffer.
-	     *
-	     * Yes, it might be more efficient here to *not* store the data
-	     * (we're just going to throw it away later). However, I elected
-	     * to implement it this way for good reasons. First, I wanted to
-	     * avoid duplicating the (fairly complex) LWZ decoder in
-	     * ReadImage. Fine, you say, why didn't you just modify it to
-	     * allow the use of a NULL specifier for the output buffer? I
-	     * tried that, but it negatively impacted the performance of what
-	     * I think will be the common case: reading the first image in the
-	     * file. Rather than marginally improve the speed of the less
-	     * frequent case, I chose to maintain high performance for the
-	     * common case.
-	     */
-
-	    if (ReadImage(gifConfPtr, interp, trashBuffer, chan, imageWidth,
-		    imageHeight, colorMap, 0, 0, 0, -1) != TCL_OK) {
-		goto error;
-	    }
+	    prevFrame = frame;
+	    havePrev = 1;
+	    frameNum++;
 	    continue;
 	}
 	break;
@@ -643,12 +856,36 @@ FileReadGIF(
 	}
     }
 
+    /*
+     * When composing an animation, first undo the previous frame as its
+     * disposal method says, then keep what this frame is going to cover if
+     * it has to be undone in turn.
+     */
+
+    if (compose) {
+	restoreKey = GetRestoreKey(imageHandle, fileName,
+		gifConfPtr->fromData != NULL);
+    }
+    if (restoreKey != NULL) {
+	if (havePrev) {
+	    ComposeDisposal(interp, imageHandle, Tcl_GetString(restoreKey),
+		    &prevFrame, frameNum - 1, reqDestX, reqDestY, reqWidth,
+		    reqHeight, reqSrcX, reqSrcY);
+	}
+	if (frame.disposal == 3) {
+	    frame.disposal = -3;
+	    ComposeDisposal(interp, imageHandle, Tcl_GetString(restoreKey),
+		    &frame, frameNum, reqDestX, reqDestY, reqWidth,
+		    reqHeight, reqSrcX, reqSrcY);
+	}
+    }
+
     /*
      * Extract the location within the overall visible image to put the data
      * in this frame, together with the size of this frame.
      */
 
-    index = LM_to_uint(buf[0], buf[1]);
+    index = frame.left;
     srcX -= index;
     if (srcX<0) {
 	destX -= srcX; width += srcX;
@@ -659,7 +896,7 @@ FileReadGIF(
 	width = imageWidth;
     }
 
-    index = LM_to_uint(buf[2], buf[3]);
+    index = frame.top;
     srcY -= index;
     if (index > srcY) {
 	destY -= srcY; height += srcY;
@@ -704,7 +941,8 @@ FileReadGIF(
 	    goto error;
 	}
 	if (Tk_PhotoPutBlock(interp, imageHandle, &block, destX, destY,
-		width, height, TK_PHOTO_COMPOSITE_SET) != TCL_OK) {
+		width, height, compose ? TK_PHOTO_COMPOSITE_OVERLAY
+		: TK_PHOTO_COMPOSITE_SET) != TCL_OK) {
 	    ckfree(block.pixelPtr);
 	    goto error;
 	}
@@ -720,16 +958,343 @@ FileReadGIF(
     result = TCL_OK;
 
   error:
+    if (restoreKey != NULL) {
+	Tcl_DecrRefCount(restoreKey);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetFrameDirectory --
+ *
+ *	Finds the record of the frames already seen in a GIF file, creating
+ *	an empty one if there is none or if the file has changed since.
+ *
+ * Results:
+ *	The directory for the file, or NULL if the channel can't seek or the
+ *	file can't be identified.
+ *
+ * Side effects:
+ *	Directories of other files may be thrown away to keep the number of
+ *	them bounded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static GIFFrameDirectory *
+GetFrameDirectory(
+    const char *fileName,	/* The name of the image file. */
+    Tcl_Channel chan)		/* The image file, open for reading. */
+{
+    ThreadSpecificData *tsdPtr = GetThreadData();
+    Tcl_Obj *pathObj, *normPathObj;
+    Tcl_StatBuf statBuf;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    GIFFrameDirectory *dirPtr;
+    int isNew;
+
+    if (Tcl_Tell(chan) < 0) {
+	return NULL;
+    }
+    pathObj = Tcl_NewStringObj(fileName, -1);
+    Tcl_IncrRefCount(pathObj);
+    normPathObj = Tcl_FSGetNormalizedPath(NULL, pathObj);
+    if ((normPathObj == NULL) || (Tcl_FSStat(pathObj, &statBuf) != 0)) {
+	Tcl_DecrRefCount(pathObj);
+	return NULL;
+    }
+    hPtr = Tcl_FindHashEntry(&tsdPtr->directories,
+	    Tcl_GetString(normPathObj));
+    if (hPtr == NULL) {
+	if (tsdPtr->directories.numEntries >= GIF_MAX_DIRECTORIES) {
+	    for (hPtr = Tcl_FirstHashEntry(&tsdPtr->directories, &search);
+		    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+		dirPtr = Tcl_GetHashValue(hPtr);
+		ckfree(dirPtr->frames);
+		ckfree(dirPtr);
+		Tcl_DeleteHashEntry(hPtr);
+	    }
+	}
+	hPtr = Tcl_CreateHashEntry(&tsdPtr->directories,
+		Tcl_GetString(normPathObj), &isNew);
+	dirPtr = ckalloc(sizeof(GIFFrameDirectory));
+	dirPtr->frames = NULL;
+	dirPtr->frameSpace = 0;
+	Tcl_SetHashValue(hPtr, dirPtr);
+    } else {
+	dirPtr = Tcl_GetHashValue(hPtr);
+	if ((dirPtr->size == (Tcl_WideInt) Tcl_GetSizeFromStat(&statBuf))
+		&& (dirPtr->mtime
+		== Tcl_GetModificationTimeFromStat(&statBuf))) {
+	    Tcl_DecrRefCount(pathObj);
+	    return dirPtr;
+	}
+    }
+    Tcl_DecrRefCount(pathObj);
+
+    dirPtr->size = (Tcl_WideInt) Tcl_GetSizeFromStat(&statBuf);
+    dirPtr->mtime = Tcl_GetModificationTimeFromStat(&statBuf);
+    dirPtr->numFrames = 0;
+    dirPtr->resumeFrame = 0;
+    dirPtr->resumeOffset = 0;
+    dirPtr->resumeTransparent = -1;
+    return dirPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetRestoreKey --
+ *
+ *	Builds the key under which the pixels saved for a "restore to
+ *	previous" frame are kept: the name of the photo, and the normalized
+ *	name, size and modification time of the file (or nothing, for inline
+ *	data).
+ *
+ * Results:
+ *	A new object with a reference count of 1, or NULL if the photo has no
+ *	name (it is a private copy used while reading asynchronously) or the
+ *	file can't be identified.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetRestoreKey(
+    Tk_PhotoHandle imageHandle,	/* The photo being composed. */
+    const char *fileName,	/* The name of the image file. */
+    int fromData)		/* Non-zero if reading inline data. */
+{
+    const char *imageName = TkPhotoName(imageHandle);
+    Tcl_Obj *keyObj, *pathObj, *normPathObj;
+    Tcl_StatBuf statBuf;
+
+    if (imageName == NULL) {
+	return NULL;
+    }
+    keyObj = Tcl_NewListObj(0, NULL);
+    Tcl_IncrRefCount(keyObj);
+    Tcl_ListObjAppendElement(NULL, keyObj, Tcl_NewStringObj(imageName, -1));
+    if (fromData) {
+	return keyObj;
+    }
+    pathObj = Tcl_NewStringObj(fileName, -1);
+    Tcl_IncrRefCount(pathObj);
+    normPathObj = Tcl_FSGetNormalizedPath(NULL, pathObj);
+    if ((normPathObj == NULL) || (Tcl_FSStat(pathObj, &statBuf) != 0)) {
+	Tcl_DecrRefCount(pathObj);
+	Tcl_DecrRefCount(keyObj);
+	return NULL;
+    }
+    Tcl_ListObjAppendElement(NULL, keyObj, normPathObj);
+    Tcl_ListObjAppendElement(NULL, keyObj,
+	    Tcl_NewWideIntObj((Tcl_WideInt) Tcl_GetSizeFromStat(&statBuf)));
+    Tcl_ListObjAppendElement(NULL, keyObj,
+	    Tcl_NewWideIntObj(Tcl_GetModificationTimeFromStat(&statBuf)));
+    Tcl_DecrRefCount(pathObj);
+    return keyObj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetThreadData --
+ *
+ *	Returns the GIF reader's data for the current thread, initializing
+ *	it on first use.
+ *
+ * Results:
+ *	The thread's data.
+ *
+ * Side effects:
+ *	May register a thread exit handler.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ThreadSpecificData *
+GetThreadData(void)
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    if (!tsdPtr->initialized) {
+	tsdPtr->initialized = 1;
+	Tcl_InitHashTable(&tsdPtr->directories, TCL_STRING_KEYS);
+	tsdPtr->restore.key = NULL;
+	Tcl_CreateThreadExitHandler(GIFThreadExitProc, NULL);
+    }
+    return tsdPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GIFThreadExitProc --
+ *
+ *	Frees the per-thread frame directories and saved pixels.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GIFThreadExitProc(
+    ClientData clientData)	/* not used */
+{
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    GIFFrameDirectory *dirPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&tsdPtr->directories, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	dirPtr = Tcl_GetHashValue(hPtr);
+	ckfree(dirPtr->frames);
+	ckfree(dirPtr);
+    }
+    Tcl_DeleteHashTable(&tsdPtr->directories);
+    if (tsdPtr->restore.key != NULL) {
+	ckfree(tsdPtr->restore.block.pixelPtr);
+	ckfree(tsdPtr->restore.key);
+	tsdPtr->restore.key = NULL;
+    }
+    tsdPtr->initialized = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ComposeDisposal --
+ *
+ *	Applies the disposal method of a frame of an animation that is being
+ *	composed into a photo: "restore to background" (2) clears the area of
+ *	the frame, "restore to previous" (3) puts back the pixels saved before
+ *	the frame was drawn, if they were saved for the same photo and file.
+ *	As a special case, a disposal of -3 saves the pixels under the frame
+ *	for a later call.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The photo image or the thread's saved pixels are modified.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ComposeDisposal(
+    Tcl_Interp *interp,		/* Interpreter for (ignored) errors. */
+    Tk_PhotoHandle imageHandle,	/* The photo image being composed. */
+    const char *restoreKey,	/* Identifies the photo and the file; see
+				 * GetRestoreKey. */
+    GIFFrame *framePtr,		/* The frame to dispose of. */
+    int frameIndex,		/* Index of that frame in the file. */
+    int destX, int destY,	/* The area of the photo the file is */
+    int width, int height,	/* read into, and the matching position */
+    int srcX, int srcY)		/* in the file. */
+{
+    ThreadSpecificData *tsdPtr = GetThreadData();
+    GIFRestoreInfo *restorePtr = &tsdPtr->restore;
+    Tk_PhotoImageBlock block;
+    int x1, y1, x2, y2, y;
+
     /*
-     * If a trash buffer has been allocated, free it now.
+     * Work out where the frame is in the photo.
      */
 
-    if (trashBuffer != NULL) {
-	ckfree(trashBuffer);
+    x1 = destX + framePtr->left - srcX;
+    y1 = destY + framePtr->top - srcY;
+    x2 = x1 + framePtr->width;
+    y2 = y1 + framePtr->height;
+    if (x1 < destX) {
+	x1 = destX;
+    }
+    if (y1 < destY) {
+	y1 = destY;
+    }
+    if (x2 > destX + width) {
+	x2 = destX + width;
+    }
+    if (y2 > destY + height) {
+	y2 = destY + height;
+    }
+
+    switch (framePtr->disposal) {
+    case 2:
+	if ((x1 < x2) && (y1 < y2)) {
+	    block.width = x2 - x1;
+	    block.height = y2 - y1;
+	    block.pixelSize = 4;
+	    block.pitch = 4 * block.width;
+	    block.offset[0] = 0;
+	    block.offset[1] = 1;
+	    block.offset[2] = 2;
+	    block.offset[3] = 3;
+	    block.pixelPtr = attemptckalloc(block.pitch * block.height);
+	    if (block.pixelPtr != NULL) {
+		memset(block.pixelPtr, 0, block.pitch * block.height);
+		Tk_PhotoPutBlock(interp, imageHandle, &block, x1, y1,
+			block.width, block.height, TK_PHOTO_COMPOSITE_SET);
+		ckfree(block.pixelPtr);
+	    }
+	}
+	break;
+    case 3:
+	if ((restorePtr->key != NULL)
+		&& (strcmp(restorePtr->key, restoreKey) == 0)
+		&& (restorePtr->frame == frameIndex)) {
+	    Tk_PhotoPutBlock(interp, imageHandle, &restorePtr->block,
+		    restorePtr->x, restorePtr->y, restorePtr->block.width,
+		    restorePtr->block.height, TK_PHOTO_COMPOSITE_SET);
+	}
+	break;
+    case -3:
+	if (restorePtr->key != NULL) {
+	    ckfree(restorePtr->block.pixelPtr);
+	    ckfree(restorePtr->key);
+	    restorePtr->key = NULL;
+	}
+	if ((x1 >= x2) || (y1 >= y2)) {
+	    break;
+	}
+	Tk_PhotoGetImage(imageHandle, &block);
+	restorePtr->block = block;
+	restorePtr->block.width = x2 - x1;
+	restorePtr->block.height = y2 - y1;
+	restorePtr->block.pitch = block.pixelSize * restorePtr->block.width;
+	restorePtr->block.pixelPtr = attemptckalloc(
+		restorePtr->block.pitch * restorePtr->block.height);
+	if (restorePtr->block.pixelPtr == NULL) {
+	    break;
+	}
+	for (y = 0; y < restorePtr->block.height; y++) {
+	    memcpy(restorePtr->block.pixelPtr + y * restorePtr->block.pitch,
+		    block.pixelPtr + (y1 + y) * block.pitch
+		    + x1 * block.pixelSize, restorePtr->block.pitch);
+	}
+	restorePtr->key = ckalloc(strlen(restoreKey) + 1);
+	strcpy(restorePtr->key, restoreKey);
+	restorePtr->frame = frameIndex;
+	restorePtr->x = x1;
+	restorePtr->y = y1;
+	break;
     }
-    return result;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -937,7 +1502,9 @@ DoExtension(
     Tcl_Channel chan,
     int label,
     unsigned char *buf,
-    int *transparent)
+    int *transparent,
+    int *disposal,
+    int *delay)
 {
     int count;
 
@@ -962,6 +1529,8 @@ DoExtension(
 	if ((buf[0] & 0x1) != 0) {
 	    *transparent = buf[3];
 	}
+	*disposal = (buf[0] >> 2) & 0x7;
+	*delay = LM_to_uint(buf[1], buf[2]);
 
 	do {
 	    count = GetDataBlock(gifConfPtr, chan, buf);
@@ -975,6 +1544,28 @@ DoExtension(
     return count;
 }
 
+/*
+ * Skip over the compressed data of a frame that isn't wanted. Returns 1 if
+ * the data was terminated properly, 0 otherwise.
+ */
+
+static int
+SkipImage(
+    GIFImageConfig *gifConfPtr,
+    Tcl_Channel chan)
+{
+    unsigned char initialCodeSize;
+    int count;
+
+    if (Fread(gifConfPtr, &initialCodeSize, 1, 1, chan) <= 0) {
+	return 0;
+    }
+    do {
+	count = GetDataBlock(gifConfPtr, chan, gifConfPtr->workingBuffer);
+    } while (count > 0);
+    return (count == 0);
+}
+
 static int
 GetDataBlock(
     GIFImageConfig *gifConfPtr,
@@ -994,6 +1585,48 @@ GetDataBlock(
     return count;
 }
 
+/*
+ * Read all the data sub-blocks of an image into one malloc'ed buffer. The
+ * length byte of each sub-block is read together with the data of the one
+ * before it. A truncated stream just ends the data early.
+ */
+
+static unsigned char *
+ReadDataBlocks(
+    GIFImageConfig *gifConfPtr,
+    Tcl_Channel chan,
+    int *lengthPtr)
+{
+    unsigned char count, *data;
+    int length = 0, space = 16384, n;
+
+    data = ckalloc(space);
+    if (Fread(gifConfPtr, &count, 1, 1, chan) <= 0) {
+	count = 0;
+    }
+    while (count != 0) {
+	if (length + count + 1 > space) {
+	    space *= 2;
+	    data = ckrealloc(data, space);
+	}
+	n = Fread(gifConfPtr, data + length, count + 1, 1, chan);
+	if (n == count + 1) {
+	    length += count;
+	    count = data[length];
+	    continue;
+	}
+	if (n <= 0) {
+	    n = Fread(gifConfPtr, data + length, count, 1, chan);
+	}
+	if (n > 0) {
+	    length += (n < count) ? n : count;
+	}
+	break;
+    }
+    *lengthPtr = length;
+    return data;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1002,15 +1635,14 @@ GetDataBlock(
  *	Process a GIF image from a given source, with a given height, width,
  *	transparency, etc.
  *
- *	This code is based on the code found in the ImageMagick GIF decoder,
- *	which is (c) 2000 ImageMagick Studio.
- *
- *	Some thoughts on our implementation:
- *	It sure would be nice if ReadImage didn't take 11 parameters! I think
- *	that if we were smarter, we could avoid doing that.
- *
- *	Possible further optimizations: we could pull the GetCode function
- *	directly into ReadImage, which would improve our speed.
+ *	The compressed data is read in one go and its codes are taken from a
+ *	64-bit bit buffer. The decoded color indices are kept in stream order,
+ *	which lets each entry of the string table be just the place where its
+ *	string was first output and its length: a code is decoded by copying
+ *	its whole string, and a new entry is the previous string plus the
+ *	first byte of the current one, which directly follows it. The indices
+ *	are then expanded into the rows of the image, in interlaced order if
+ *	need be.
  *
  * Results:
  *	Processes a GIF image and loads the pixel data into a memory array.
@@ -1034,16 +1666,17 @@ ReadImage(
     int transparent)
 {
     unsigned char initialCodeSize;
-    int xpos = 0, ypos = 0, pass = 0, i;
-    register unsigned char *pixelPtr;
+    int ypos = 0, pass = 0, i, x, dataLength;
     static const int interlaceStep[] = { 8, 8, 4, 2 };
     static const int interlaceStart[] = { 0, 4, 2, 1 };
-    unsigned short prefix[(1 << MAX_LWZ_BITS)];
-    unsigned char append[(1 << MAX_LWZ_BITS)];
-    unsigned char stack[(1 << MAX_LWZ_BITS)*2];
-    register unsigned char *top;
-    int codeSize, clearCode, inCode, endCode, oldCode, maxCode;
-    int code, firstCode, v;
+    unsigned int stringPos[(1 << MAX_LWZ_BITS)];
+    unsigned short stringLen[(1 << MAX_LWZ_BITS)];
+    unsigned char *data, *dataPtr, *dataEnd, *indexPtr, *srcPtr, *pixelPtr;
+    Tcl_WideUInt bits = 0;
+    int numBits = 0, pixelSize = (transparent >= 0) ? 4 : 3;
+    int codeSize, clearCode, endCode, oldCode, maxCode, code;
+    size_t numPixels = (size_t) len * rows, pos = 0, oldPos = 0, n;
+    unsigned int oldLen = 0;
 
     /*
      * Initialize the decoder
@@ -1068,11 +1701,12 @@ ReadImage(
 	cmap[transparent][CM_ALPHA] = 0;
     }
 
-    pixelPtr = imagePtr;
+    data = ReadDataBlocks(gifConfPtr, chan, &dataLength);
+    dataPtr = data;
+    dataEnd = data + dataLength;
+    indexPtr = ckalloc(numPixels);
 
     /*
-     * Initialize the decoder.
-     *
      * Set values for "special" numbers:
      * clear code	reset the decoder
      * end code		stop decoding
@@ -1085,157 +1719,96 @@ ReadImage(
     codeSize = (int) initialCodeSize + 1;
     maxCode = clearCode + 2;
     oldCode = -1;
-    firstCode = -1;
-
-    memset(prefix, 0, (1 << MAX_LWZ_BITS) * sizeof(short));
-    memset(append, 0, (1 << MAX_LWZ_BITS) * sizeof(char));
-    for (i = 0; i < clearCode; i++) {
-	append[i] = i;
-    }
-    top = stack;
-
-    GetCode(chan, 0, 1, gifConfPtr);
 
     /*
-     * Read until we finish the image
+     * Decode until the image is full or the data runs out. Damaged data
+     * (codes not yet in the table) also ends the image, keeping what has
+     * been decoded so far.
      */
 
-    for (i = 0, ypos = 0; i < rows; i++) {
-	for (xpos = 0; xpos < len; ) {
-	    if (top == stack) {
-		/*
-		 * Bummer - our stack is empty. Now we have to work!
-		 */
+    while (pos < numPixels) {
+	unsigned int strLen;
 
-		code = GetCode(chan, codeSize, 0, gifConfPtr);
-		if (code < 0) {
-		    return TCL_OK;
-		}
-
-		if (code > maxCode || code == endCode) {
-		    /*
-		     * If we're doing things right, we should never receive a
-		     * code that is greater than our current maximum code. If
-		     * we do, bail, because our decoder does not yet have that
-		     * code set up.
-		     *
-		     * If the code is the magic endCode value, quit.
-		     */
-
-		    return TCL_OK;
-		}
-
-		if (code == clearCode) {
-		    /*
-		     * Reset the decoder.
-		     */
-
-		    codeSize = initialCodeSize + 1;
-		    maxCode = clearCode + 2;
-		    oldCode = -1;
-		    continue;
-		}
-
-		if (oldCode == -1) {
-		    /*
-		     * Last pass reset the decoder, so the first code we see
-		     * must be a singleton. Seed the stack with it, and set up
-		     * the old/first code pointers for insertion into the
-		     * string table. We can't just roll this into the
-		     * clearCode test above, because at that point we have not
-		     * yet read the next code.
-		     */
-
-		    *top++ = append[code];
-		    oldCode = code;
-		    firstCode = code;
-		    continue;
-		}
-
-		inCode = code;
-
-		if (code == maxCode) {
-		    /*
-		     * maxCode is always one bigger than our highest assigned
-		     * code. If the code we see is equal to maxCode, then we
-		     * are about to add a new string to the table. ???
-		     */
-
-		    *top++ = firstCode;
-		    code = oldCode;
-		}
-
-		while (code > clearCode) {
-		    /*
-		     * Populate the stack by tracing the string in the string
-		     * table from its tail to its head
-		     */
-
-		    *top++ = append[code];
-		    code = prefix[code];
-		}
-		firstCode = append[code];
-
-		/*
-		 * If there's no more room in our string table, quit.
-		 * Otherwise, add a new string to the table
-		 */
-
-		if (maxCode >= (1 << MAX_LWZ_BITS)) {
-		    return TCL_OK;
-		}
-
-		/*
-		 * Push the head of the string onto the stack.
-		 */
-
-		*top++ = firstCode;
-
-		/*
-		 * Add a new string to the string table
-		 */
-
-		prefix[maxCode] = oldCode;
-		append[maxCode] = firstCode;
-		maxCode++;
-
-		/*
-		 * maxCode tells us the maximum code value we can accept. If
-		 * we see that we need more bits to represent it than we are
-		 * requesting from the unpacker, we need to increase the
-		 * number we ask for.
-		 */
-
-		if ((maxCode >= (1 << codeSize))
-			&& (maxCode < (1<<MAX_LWZ_BITS))) {
-		    codeSize++;
-		}
-		oldCode = inCode;
-	    }
+	while (numBits <= 56 && dataPtr < dataEnd) {
+	    bits |= ((Tcl_WideUInt) *dataPtr++) << numBits;
+	    numBits += 8;
+	}
+	if (numBits < codeSize) {
+	    break;
+	}
+	code = (int) (bits & ((1 << codeSize) - 1));
+	bits >>= codeSize;
+	numBits -= codeSize;
+
+	if (code == clearCode) {
+	    codeSize = initialCodeSize + 1;
+	    maxCode = clearCode + 2;
+	    oldCode = -1;
+	    continue;
+	}
+	if (code == endCode || code > maxCode
+		|| (oldCode == -1 && code > clearCode)) {
+	    break;
+	}
 
+	n = numPixels - pos;
+	if (code < clearCode) {
+	    strLen = 1;
+	    indexPtr[pos] = (unsigned char) code;
+	} else if (code < maxCode) {
+	    strLen = stringLen[code];
+	    memcpy(indexPtr + pos, indexPtr + stringPos[code],
+		    (strLen < n) ? strLen : n);
+	} else {
 	    /*
-	     * Pop the next color index off the stack.
+	     * The code being defined right now: the previous string followed
+	     * by its own first byte.
 	     */
 
-	    v = *(--top);
-	    if (v < 0) {
-		return TCL_OK;
+	    strLen = oldLen + 1;
+	    memcpy(indexPtr + pos, indexPtr + oldPos, (oldLen < n) ? oldLen : n);
+	    if (oldLen < n) {
+		indexPtr[pos + oldLen] = indexPtr[oldPos];
 	    }
+	}
 
-	    /*
-	     * If pixelPtr is null, we're skipping this image (presumably
-	     * there are more in the file and we will be called to read one of
-	     * them later)
-	     */
+	if (oldCode != -1 && maxCode < (1 << MAX_LWZ_BITS)) {
+	    stringPos[maxCode] = oldPos;
+	    stringLen[maxCode] = oldLen + 1;
+	    maxCode++;
+	    if ((maxCode >= (1 << codeSize))
+		    && (maxCode < (1 << MAX_LWZ_BITS))) {
+		codeSize++;
+	    }
+	}
+	oldCode = code;
+	oldPos = pos;
+	oldLen = strLen;
+	pos += (strLen < n) ? strLen : n;
+    }
+    ckfree(data);
+
+    /*
+     * Expand the decoded indices into the rows of the image.
+     */
 
-	    *pixelPtr++ = cmap[v][CM_RED];
-	    *pixelPtr++ = cmap[v][CM_GREEN];
-	    *pixelPtr++ = cmap[v][CM_BLUE];
-	    if (transparent >= 0) {
-		*pixelPtr++ = cmap[v][CM_ALPHA];
+    srcPtr = indexPtr;
+    for (i = 0; i < rows && pos > 0; i++) {
+	n = (pos < (size_t) len) ? pos : (size_t) len;
+	pos -= n;
+	pixelPtr = imagePtr + (size_t) ypos * len * pixelSize;
+	if (pixelSize == 4) {
+	    for (x = 0; x < (int) n; x++, pixelPtr += 4) {
+		memcpy(pixelPtr, cmap[*srcPtr++], 4);
 	    }
-	    xpos++;
+	} else {
+	    for (x = 0; x < (int) n; x++) {
+		unsigned char *colorPtr = cmap[*srcPtr++];
 
+		*pixelPtr++ = colorPtr[CM_RED];
+		*pixelPtr++ = colorPtr[CM_GREEN];
+		*pixelPtr++ = colorPtr[CM_BLUE];
+	    }
 	}
 
 	/*
@@ -1247,116 +1820,20 @@ ReadImage(
 	    while (ypos >= rows) {
 		pass++;
 		if (pass > 3) {
-		    return TCL_OK;
+		    goto done;
 		}
 		ypos = interlaceStart[pass];
 	    }
 	} else {
 	    ypos++;
 	}
-	pixelPtr = imagePtr + (ypos) * len * ((transparent>=0)?4:3);
     }
+
+  done:
+    ckfree(indexPtr);
     return TCL_OK;
 }
-
-/*
- *----------------------------------------------------------------------
- *
- * GetCode --
- *
- *	Extract the next compression code from the file. In GIF's, the
- *	compression codes are between 3 and 12 bits long and are then packed
- *	into 8 bit bytes, left to right, for example:
- *		bbbaaaaa
- *		dcccccbb
- *		eeeedddd
- *		...
- *	We use a byte buffer read from the file and a sliding window to unpack
- *	the bytes. Thanks to ImageMagick for the sliding window idea.
- *	args:  chan	    the channel to read from
- *	       code_size    size of the code to extract
- *	       flag	    boolean indicating whether the extractor should be
- *			    reset or not
- *
- * Results:
- *	code		    the next compression code
- *
- * Side effects:
- *	May consume more input from chan.
- *
- *----------------------------------------------------------------------
- */
-
-static int
-GetCode(
-    Tcl_Channel chan,
-    int code_size,
-    int flag,
-    GIFImageConfig *gifConfPtr)
-{
-    int ret;
-
-    if (flag) {
-	/*
-	 * Initialize the decoder.
-	 */
 
-	gifConfPtr->reader.bitsInWindow = 0;
-	gifConfPtr->reader.bytes = 0;
-	gifConfPtr->reader.window = 0;
-	gifConfPtr->reader.done = 0;
-	gifConfPtr->reader.c = NULL;
-	return 0;
-    }
-
-    while (gifConfPtr->reader.bitsInWindow < code_size) {
-	/*
-	 * Not enough bits in our window to cover the request.
-	 */
-
-	if (gifConfPtr->reader.done) {
-	    return -1;
-	}
-	if (gifConfPtr->reader.bytes == 0) {
-	    /*
-	     * Not enough bytes in our buffer to add to the window.
-	     */
-
-	    gifConfPtr->reader.bytes =
-		    GetDataBlock(gifConfPtr, chan, gifConfPtr->workingBuffer);
-	    gifConfPtr->reader.c = gifConfPtr->workingBuffer;
-	    if (gifConfPtr->reader.bytes <= 0) {
-		gifConfPtr->reader.done = 1;
-		break;
-	    }
-	}
-
-	/*
-	 * Tack another byte onto the window, see if that's enough.
-	 */
-
-	gifConfPtr->reader.window +=
-		(*gifConfPtr->reader.c) << gifConfPtr->reader.bitsInWindow;
-	gifConfPtr->reader.c++;
-	gifConfPtr->reader.bitsInWindow += 8;
-	gifConfPtr->reader.bytes--;
-    }
-
-    /*
-     * The next code will always be the last code_size bits of the window.
-     */
-
-    ret = gifConfPtr->reader.window & ((1 << code_size) - 1);
-
-    /*
-     * Shift data in the window to put the next code at the end.
-     */
-
-    gifConfPtr->reader.window >>= code_size;
-    gifConfPtr->reader.bitsInWindow -= code_size;
-    return ret;
-}
-
 /*
  *----------------------------------------------------------------------
  *
@@ -1692,10 +2169,62 @@ CommonWriteGIF(
     Tk_PhotoImageBlock *blockPtr)
 {
     GifWriterState state;
-    int resolution;
+    int resolution, argc = 0, i, quantize = 0, dither = 0;
     long width, height, x;
     unsigned char c;
     unsigned int top, left;
+    Tcl_Obj **objv;
+    static const char *const optionStrings[] = {
+	"-compose", "-dither", "-index", "-quantize", NULL
+    };
+    enum options {
+	OPT_COMPOSE, OPT_DITHER, OPT_INDEX, OPT_QUANTIZE
+    };
+
+    /*
+     * Parse the format string to get options.
+     */
+
+    if (format && Tcl_ListObjGetElements(interp, format,
+	    &argc, &objv) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    for (i = 1; i < argc; i++) {
+	int optionIdx;
+
+	if (Tcl_GetIndexFromObjStruct(interp, objv[i], optionStrings,
+		sizeof(char *), "option name", 0, &optionIdx) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (i == (argc-1)) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "no value given for \"%s\" option",
+		    Tcl_GetString(objv[i])));
+	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "OPT_VALUE", NULL);
+	    return TCL_ERROR;
+	}
+	i++;
+	switch ((enum options) optionIdx) {
+	case OPT_COMPOSE:
+	case OPT_INDEX:
+	    /*
+	     * Options of the reader, so that the same format description
+	     * can be used for reading and writing. They have no effect here.
+	     */
+
+	    break;
+	case OPT_DITHER:
+	    if (Tcl_GetBooleanFromObj(interp, objv[i], &dither) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    break;
+	case OPT_QUANTIZE:
+	    if (Tcl_GetBooleanFromObj(interp, objv[i], &quantize) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    break;
+	}
+    }
 
     top = 0;
     left = 0;
@@ -1715,8 +2244,6 @@ CommonWriteGIF(
 	state.alphaOffset = 0;
     }
 
-    writeProc(handle, (char *) (state.alphaOffset ? GIF89a : GIF87a), 6);
-
     for (x = 0; x < MAXCOLORMAPSIZE ;x++) {
 	state.mapa[x][CM_RED] = 255;
 	state.mapa[x][CM_GREEN] = 255;
@@ -1729,13 +2256,23 @@ CommonWriteGIF(
     state.pixelPitch = blockPtr->pitch;
     SaveMap(&state, blockPtr);
     if (state.num >= MAXCOLORMAPSIZE) {
-	Tcl_SetObjResult(interp, Tcl_NewStringObj("too many colors", -1));
-	Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "COLORFUL", NULL);
-	return TCL_ERROR;
+	if (!quantize) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj("too many colors", -1));
+	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "COLORFUL", NULL);
+	    return TCL_ERROR;
+	}
+	if (Quantize(&state, blockPtr, dither) != TCL_OK) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "not enough free memory for color quantization", -1));
+	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "GIF", "MEMORY", NULL);
+	    return TCL_ERROR;
+	}
     }
     if (state.num<2) {
 	state.num = 2;
     }
+
+    writeProc(handle, (char *) (state.alphaOffset ? GIF89a : GIF87a), 6);
     c = LSB(width);
     writeProc(handle, (char *) &c, 1);
     c = MSB(width);
@@ -1815,6 +2352,9 @@ CommonWriteGIF(
     state.ssize = state.rsize = blockPtr->width;
     state.csize = blockPtr->height;
     Compress(resolution+1, handle, writeProc, ReadValue, &state);
+    if (state.indexPtr != NULL) {
+	ckfree(state.indexPtr);
+    }
 
     c = 0;
     writeProc(handle, (char *) &c, 1);
@@ -1829,14 +2369,14 @@ ColorNumber(
     GifWriterState *statePtr,
     int red, int green, int blue)
 {
-    int x = (statePtr->alphaOffset != 0);
+    unsigned int key = ((red << 16) | (green << 8) | blue) + 1;
+    unsigned int i = COLOR_HASH(key);
 
-    for (; x <= MAXCOLORMAPSIZE; x++) {
-	if ((statePtr->mapa[x][CM_RED] == red) &&
-		(statePtr->mapa[x][CM_GREEN] == green) &&
-		(statePtr->mapa[x][CM_BLUE] == blue)) {
-	    return x;
+    while (statePtr->colorHash[i] != 0) {
+	if (statePtr->colorHash[i] == key) {
+	    return statePtr->colorSlot[i];
 	}
+	i = (i + 1) & (COLOR_HASH_SIZE - 1);
     }
     return -1;
 }
@@ -1846,16 +2386,23 @@ IsNewColor(
     GifWriterState *statePtr,
     int red, int green, int blue)
 {
-    int x = (statePtr->alphaOffset != 0);
+    return (ColorNumber(statePtr, red, green, blue) < 0);
+}
+
+static void
+AddColor(
+    GifWriterState *statePtr,
+    int red, int green, int blue,
+    int index)
+{
+    unsigned int key = ((red << 16) | (green << 8) | blue) + 1;
+    unsigned int i = COLOR_HASH(key);
 
-    for (; x<=statePtr->num ; x++) {
-	if ((statePtr->mapa[x][CM_RED] == red) &&
-		(statePtr->mapa[x][CM_GREEN] == green) &&
-		(statePtr->mapa[x][CM_BLUE] == blue)) {
-	    return 0;
-	}
+    while (statePtr->colorHash[i] != 0) {
+	i = (i + 1) & (COLOR_HASH_SIZE - 1);
     }
-    return 1;
+    statePtr->colorHash[i] = key;
+    statePtr->colorSlot[i] = (unsigned char) index;
 }
 
 static void
@@ -1891,6 +2438,7 @@ SaveMap(
 		    statePtr->mapa[statePtr->num][CM_RED] = red;
 		    statePtr->mapa[statePtr->num][CM_GREEN] = green;
 		    statePtr->mapa[statePtr->num][CM_BLUE] = blue;
+		    AddColor(statePtr, red, green, blue, statePtr->num);
 		}
 	    }
 	    colores += statePtr->pixelSize;
@@ -1898,6 +2446,300 @@ SaveMap(
     }
 }
 
+/*
+ * Reduce the colors of an image that has too many of them for a GIF palette
+ * by median cut, optionally with Floyd-Steinberg dithering, and choose the
+ * palette index of every pixel. Returns TCL_ERROR if memory is short.
+ */
+
+static int
+Quantize(
+    GifWriterState *statePtr,
+    Tk_PhotoImageBlock *blockPtr,
+    int dither)
+{
+    const int numBins = QUANT_LEVELS * QUANT_LEVELS * QUANT_LEVELS;
+    unsigned int *hist;
+    short *lookup;
+    int *errPtr = NULL;
+    QuantBox boxes[MAXCOLORMAPSIZE];
+    unsigned long slice[QUANT_LEVELS];
+    double total[MAXCOLORMAPSIZE][3];
+    int numBoxes, maxColors, first, i, x, y, c[3], best, axis, split;
+    unsigned char *pixelPtr, *outPtr;
+
+    first = (statePtr->alphaOffset != 0);
+    maxColors = MAXCOLORMAPSIZE - first;
+    hist = attemptckalloc(numBins * sizeof(unsigned int));
+    lookup = attemptckalloc(numBins * sizeof(short));
+    statePtr->indexPtr = attemptckalloc(blockPtr->width * blockPtr->height);
+    if (dither) {
+	errPtr = attemptckalloc(6 * (blockPtr->width + 2) * sizeof(int));
+    }
+    if ((hist == NULL) || (lookup == NULL) || (statePtr->indexPtr == NULL)
+	    || (dither && (errPtr == NULL))) {
+	goto nomem;
+    }
+
+    /*
+     * Build the histogram of the opaque pixels.
+     */
+
+    memset(hist, 0, numBins * sizeof(unsigned int));
+    for (y = 0; y < blockPtr->height; y++) {
+	pixelPtr = blockPtr->pixelPtr + blockPtr->offset[0]
+		+ y * blockPtr->pitch;
+	for (x = 0; x < blockPtr->width; x++) {
+	    if (!statePtr->alphaOffset || pixelPtr[statePtr->alphaOffset]) {
+		hist[QUANT_BIN(pixelPtr[0], pixelPtr[statePtr->greenOffset],
+			pixelPtr[statePtr->blueOffset])]++;
+	    }
+	    pixelPtr += statePtr->pixelSize;
+	}
+    }
+
+    /*
+     * Median cut: keep splitting the most populous box that can be split,
+     * across its longest side, at the median of its pixels.
+     */
+
+    for (i = 0; i < 3; i++) {
+	boxes[0].min[i] = 0;
+	boxes[0].max[i] = QUANT_LEVELS - 1;
+    }
+    ShrinkBox(&boxes[0], hist);
+    numBoxes = 1;
+    while (numBoxes < maxColors) {
+	QuantBox *boxPtr, *newPtr;
+	unsigned long sum;
+
+	best = -1;
+	for (i = 0; i < numBoxes; i++) {
+	    if (((boxes[i].max[0] > boxes[i].min[0])
+		    || (boxes[i].max[1] > boxes[i].min[1])
+		    || (boxes[i].max[2] > boxes[i].min[2]))
+		    && ((best < 0) || (boxes[i].count > boxes[best].count))) {
+		best = i;
+	    }
+	}
+	if (best < 0) {
+	    break;
+	}
+	boxPtr = &boxes[best];
+	axis = 0;
+	for (i = 1; i < 3; i++) {
+	    if (boxPtr->max[i] - boxPtr->min[i]
+		    > boxPtr->max[axis] - boxPtr->min[axis]) {
+		axis = i;
+	    }
+	}
+	memset(slice, 0, sizeof(slice));
+	for (c[0] = boxPtr->min[0]; c[0] <= boxPtr->max[0]; c[0]++) {
+	    for (c[1] = boxPtr->min[1]; c[1] <= boxPtr->max[1]; c[1]++) {
+		for (c[2] = boxPtr->min[2]; c[2] <= boxPtr->max[2]; c[2]++) {
+		    slice[c[axis]] += hist[(c[0] << (2 * QUANT_BITS))
+			    | (c[1] << QUANT_BITS) | c[2]];
+		}
+	    }
+	}
+	sum = 0;
+	for (split = boxPtr->min[axis]; split < boxPtr->max[axis]-1; split++) {
+	    sum += slice[split];
+	    if (2 * sum >= boxPtr->count) {
+		break;
+	    }
+	}
+	newPtr = &boxes[numBoxes++];
+	*newPtr = *boxPtr;
+	boxPtr->max[axis] = split;
+	newPtr->min[axis] = split + 1;
+	ShrinkBox(boxPtr, hist);
+	ShrinkBox(newPtr, hist);
+    }
+
+    /*
+     * The histogram bins inside a box map to its palette entry, which is the
+     * mean color of the pixels in the box.
+     */
+
+    for (i = 0; i < numBins; i++) {
+	lookup[i] = -1;
+    }
+    for (i = 0; i < numBoxes; i++) {
+	for (c[0] = boxes[i].min[0]; c[0] <= boxes[i].max[0]; c[0]++) {
+	    for (c[1] = boxes[i].min[1]; c[1] <= boxes[i].max[1]; c[1]++) {
+		for (c[2] = boxes[i].min[2]; c[2] <= boxes[i].max[2]; c[2]++) {
+		    lookup[(c[0] << (2 * QUANT_BITS)) | (c[1] << QUANT_BITS)
+			    | c[2]] = i + first;
+		}
+	    }
+	}
+    }
+    memset(total, 0, sizeof(total));
+    for (y = 0; y < blockPtr->height; y++) {
+	pixelPtr = blockPtr->pixelPtr + blockPtr->offset[0]
+		+ y * blockPtr->pitch;
+	for (x = 0; x < blockPtr->width; x++) {
+	    if (!statePtr->alphaOffset || pixelPtr[statePtr->alphaOffset]) {
+		double *sumPtr = total[lookup[QUANT_BIN(pixelPtr[0],
+			pixelPtr[statePtr->greenOffset],
+			pixelPtr[statePtr->blueOffset])]];
+
+		sumPtr[0] += pixelPtr[0];
+		sumPtr[1] += pixelPtr[statePtr->greenOffset];
+		sumPtr[2] += pixelPtr[statePtr->blueOffset];
+	    }
+	    pixelPtr += statePtr->pixelSize;
+	}
+    }
+    for (i = 0; i < numBoxes; i++) {
+	for (x = 0; x < 3; x++) {
+	    statePtr->mapa[i + first][x] = (unsigned char)
+		    (boxes[i].count ? total[i + first][x] / boxes[i].count + 0.5
+		    : 0);
+	}
+    }
+    statePtr->num = first + numBoxes - 1;
+
+    /*
+     * Map the pixels. When dithering, the error of each pixel is spread over
+     * its unprocessed neighbours (in sixteenths), which can produce colors
+     * in bins not covered by any box; those get the nearest palette entry.
+     */
+
+    if (dither) {
+	memset(errPtr, 0, 6 * (blockPtr->width + 2) * sizeof(int));
+    }
+    outPtr = statePtr->indexPtr;
+    for (y = 0; y < blockPtr->height; y++) {
+	int *curErr = NULL, *nextErr = NULL;
+
+	if (dither) {
+	    curErr = errPtr + (y & 1) * 3 * (blockPtr->width + 2);
+	    nextErr = errPtr + (~y & 1) * 3 * (blockPtr->width + 2);
+	    memset(nextErr, 0, 3 * (blockPtr->width + 2) * sizeof(int));
+	}
+	pixelPtr = blockPtr->pixelPtr + blockPtr->offset[0]
+		+ y * blockPtr->pitch;
+	for (x = 0; x < blockPtr->width; x++, pixelPtr += statePtr->pixelSize) {
+	    int bin, index, k;
+
+	    if (statePtr->alphaOffset && !pixelPtr[statePtr->alphaOffset]) {
+		*outPtr++ = 0;
+		continue;
+	    }
+	    c[0] = pixelPtr[0];
+	    c[1] = pixelPtr[statePtr->greenOffset];
+	    c[2] = pixelPtr[statePtr->blueOffset];
+	    if (dither) {
+		for (k = 0; k < 3; k++) {
+		    c[k] += curErr[3*(x+1) + k] / 16;
+		    c[k] = (c[k] < 0) ? 0 : (c[k] > 255) ? 255 : c[k];
+		}
+	    }
+	    bin = QUANT_BIN(c[0], c[1], c[2]);
+	    if (lookup[bin] < 0) {
+		int dist, bestDist = INT_MAX;
+
+		for (i = first; i <= statePtr->num; i++) {
+		    dist = 0;
+		    for (k = 0; k < 3; k++) {
+			dist += (c[k] - statePtr->mapa[i][k])
+				* (c[k] - statePtr->mapa[i][k]);
+		    }
+		    if (dist < bestDist) {
+			bestDist = dist;
+			lookup[bin] = i;
+		    }
+		}
+	    }
+	    index = lookup[bin];
+	    *outPtr++ = (unsigned char) index;
+	    if (dither) {
+		for (k = 0; k < 3; k++) {
+		    int err = c[k] - statePtr->mapa[index][k];
+
+		    curErr[3*(x+2) + k] += 7 * err;
+		    nextErr[3*x + k] += 3 * err;
+		    nextErr[3*(x+1) + k] += 5 * err;
+		    nextErr[3*(x+2) + k] += err;
+		}
+	    }
+	}
+    }
+    statePtr->nextIndex = statePtr->indexPtr;
+
+    ckfree(hist);
+    ckfree(lookup);
+    if (errPtr != NULL) {
+	ckfree(errPtr);
+    }
+    return TCL_OK;
+
+  nomem:
+    if (hist != NULL) {
+	ckfree(hist);
+    }
+    if (lookup != NULL) {
+	ckfree(lookup);
+    }
+    if (statePtr->indexPtr != NULL) {
+	ckfree(statePtr->indexPtr);
+	statePtr->indexPtr = NULL;
+    }
+    if (errPtr != NULL) {
+	ckfree(errPtr);
+    }
+    return TCL_ERROR;
+}
+
+/*
+ * Shrink a median cut box to the histogram bins that are actually used, and
+ * count the pixels in it.
+ */
+
+static void
+ShrinkBox(
+    QuantBox *boxPtr,
+    const unsigned int *hist)
+{
+    int c[3], min[3], max[3], k;
+    unsigned long count = 0;
+    unsigned int n;
+
+    for (k = 0; k < 3; k++) {
+	min[k] = QUANT_LEVELS;
+	max[k] = -1;
+    }
+    for (c[0] = boxPtr->min[0]; c[0] <= boxPtr->max[0]; c[0]++) {
+	for (c[1] = boxPtr->min[1]; c[1] <= boxPtr->max[1]; c[1]++) {
+	    for (c[2] = boxPtr->min[2]; c[2] <= boxPtr->max[2]; c[2]++) {
+		n = hist[(c[0] << (2 * QUANT_BITS)) | (c[1] << QUANT_BITS)
+			| c[2]];
+		if (n == 0) {
+		    continue;
+		}
+		count += n;
+		for (k = 0; k < 3; k++) {
+		    if (c[k] < min[k]) {
+			min[k] = c[k];
+		    }
+		    if (c[k] > max[k]) {
+			max[k] = c[k];
+		    }
+		}
+	    }
+	}
+    }
+    if (count > 0) {
+	for (k = 0; k < 3; k++) {
+	    boxPtr->min[k] = min[k];
+	    boxPtr->max[k] = max[k];
+	}
+    }
+    boxPtr->count = count;
+}
+
 static int
 ReadValue(
     GifWriterState *statePtr)
@@ -1907,7 +2749,9 @@ ReadValue(
     if (statePtr->csize == 0) {
 	return EOF;
     }
-    if (statePtr->alphaOffset
+    if (statePtr->indexPtr != NULL) {
+	col = *statePtr->nextIndex++;
+    } else if (statePtr->alphaOffset
 	    && (statePtr->pixelOffset[statePtr->alphaOffset]==0)) {
 	col = 0;
     } else {
@@ -17,11 +17,13 @@
 #include "tkInt.h"
 
 /*
- * The maximum amount of memory to allocate for data read from the file. If we
- * need more than this, we do it in pieces.
+ * The raster is read and given to the photo image in one piece when the
+ * memory for that can be had; otherwise it is done in pieces of about
+ * MAX_MEMORY bytes. The header is read in pieces of HEADER_CHUNK bytes.
  */
 
-#define MAX_MEMORY	10000		/* don't allocate > 10KB */
+#define MAX_MEMORY	(1024 * 1024)
+#define HEADER_CHUNK	4096
 
 /*
  * Define PGM and PPM, i.e. gray images and color images.
@@ -67,8 +69,16 @@ Tk_PhotoImageFormat tkImgFmtPPM = {
  * Prototypes for local functions defined in this file:
  */
 
+static unsigned char *	AllocPPMBuffer(int pitch, int height, int *nLinesPtr);
+static void		ConvertPPMSamples(const unsigned char *srcPtr,
+			    unsigned char *dstPtr, int numSamples,
+			    int maxIntensity);
+static int		ParsePPMHeader(const unsigned char *data, int dataSize,
+			    int atEnd, int *widthPtr, int *heightPtr,
+			    int *maxIntensityPtr, int *headerSizePtr);
 static int		ReadPPMFileHeader(Tcl_Channel chan, int *widthPtr,
-			    int *heightPtr, int *maxIntensityPtr);
+			    int *heightPtr, int *maxIntensityPtr,
+			    unsigned char **extraPtrPtr, int *extraSizePtr);
 static int		ReadPPMStringHeader(Tcl_Obj *dataObj, int *widthPtr,
 			    int *heightPtr, int *maxIntensityPtr,
 			    unsigned char **dataBufferPtr, int *dataSizePtr);
@@ -104,7 +114,7 @@ FileMatchPPM(
 {
     int dummy;
 
-    return ReadPPMFileHeader(chan, widthPtr, heightPtr, &dummy);
+    return ReadPPMFileHeader(chan, widthPtr, heightPtr, &dummy, NULL, NULL);
 }
 
 /*
@@ -140,12 +150,14 @@ FileReadPPM(
     int srcX, int srcY)		/* Coordinates of top-left pixel to be used in
 				 * image being read. */
 {
-    int fileWidth, fileHeight, maxIntensity;
+    int fileWidth, fileHeight, maxIntensity, rawPitch, extraSize, extraUsed;
     int nLines, nBytes, h, type, count, bytesPerChannel = 1;
-    unsigned char *pixelPtr;
+    unsigned char *pixelPtr, *extraPtr;
+    Tcl_WideInt skip;
     Tk_PhotoImageBlock block;
 
-    type = ReadPPMFileHeader(chan, &fileWidth, &fileHeight, &maxIntensity);
+    type = ReadPPMFileHeader(chan, &fileWidth, &fileHeight, &maxIntensity,
+	    &extraPtr, &extraSize);
     if (type == 0) {
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"couldn't read raw PPM header from file \"%s\"", fileName));
@@ -153,12 +165,14 @@ FileReadPPM(
 	return TCL_ERROR;
     }
     if ((fileWidth <= 0) || (fileHeight <= 0)) {
+	ckfree(extraPtr);
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"PPM image file \"%s\" has dimension(s) <= 0", fileName));
 	Tcl_SetErrorCode(interp, "TK", "IMAGE", "PPM", "DIMENSIONS", NULL);
 	return TCL_ERROR;
     }
     if ((maxIntensity <= 0) || (maxIntensity > 0xffff)) {
+	ckfree(extraPtr);
 	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		"PPM image file \"%s\" has bad maximum intensity value %d",
 		fileName, maxIntensity));
@@ -176,50 +190,81 @@ FileReadPPM(
     }
     if ((width <= 0) || (height <= 0)
 	    || (srcX >= fileWidth) || (srcY >= fileHeight)) {
+	ckfree(extraPtr);
 	return TCL_OK;
     }
 
+    /*
+     * The samples are converted to 8 bits in place before being handed to
+     * the photo image, so the block describes 8-bit data whatever the file
+     * holds; rawPitch is the size of a row in the file.
+     */
+
     if (type == PGM) {
-	block.pixelSize = 1 * bytesPerChannel;
+	block.pixelSize = 1;
 	block.offset[0] = 0;
 	block.offset[1] = 0;
 	block.offset[2] = 0;
     } else {
-	block.pixelSize = 3 * bytesPerChannel;
+	block.pixelSize = 3;
 	block.offset[0] = 0;
-	block.offset[1] = 1 * bytesPerChannel;
-	block.offset[2] = 2 * bytesPerChannel;
+	block.offset[1] = 1;
+	block.offset[2] = 2;
     }
     block.offset[3] = 0;
     block.width = width;
     block.pitch = block.pixelSize * fileWidth;
+    rawPitch = block.pitch * bytesPerChannel;
 
     if (Tk_PhotoExpand(interp, imageHandle,
 	    destX + width, destY + height) != TCL_OK) {
+	ckfree(extraPtr);
 	return TCL_ERROR;
     }
 
-    if (srcY > 0) {
-	Tcl_Seek(chan, (Tcl_WideInt)(srcY * block.pitch), SEEK_CUR);
-    }
+    /*
+     * Skip the rows above srcY, starting with those already read along with
+     * the header.
+     */
 
-    nLines = (MAX_MEMORY + block.pitch - 1) / block.pitch;
-    if (nLines > height) {
-	nLines = height;
+    extraUsed = 0;
+    skip = (Tcl_WideInt) srcY * rawPitch;
+    if (skip > 0) {
+	if (skip <= extraSize) {
+	    extraUsed = (int) skip;
+	} else {
+	    Tcl_Seek(chan, skip - extraSize, SEEK_CUR);
+	    extraUsed = extraSize;
+	}
     }
-    if (nLines <= 0) {
-	nLines = 1;
+
+    pixelPtr = AllocPPMBuffer(rawPitch, height, &nLines);
+    nBytes = nLines * rawPitch;
+    if (nBytes > Tcl_GetChannelBufferSize(chan)) {
+	Tcl_SetChannelBufferSize(chan, nBytes);
     }
-    nBytes = nLines * block.pitch;
-    pixelPtr = ckalloc(nBytes);
     block.pixelPtr = pixelPtr + srcX * block.pixelSize;
 
     for (h = height; h > 0; h -= nLines) {
 	if (nLines > h) {
 	    nLines = h;
-	    nBytes = nLines * block.pitch;
+	    nBytes = nLines * rawPitch;
+	}
+	count = extraSize - extraUsed;
+	if (count > nBytes) {
+	    count = nBytes;
+	}
+	if (count > 0) {
+	    memcpy(pixelPtr, extraPtr + extraUsed, count);
+	    extraUsed += count;
+	}
+	if (count < nBytes) {
+	    int n = Tcl_Read(chan, (char *) pixelPtr + count, nBytes - count);
+
+	    if (n > 0) {
+		count += n;
+	    }
 	}
-	count = Tcl_Read(chan, (char *) pixelPtr, nBytes);
 	if (count != nBytes) {
 	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		    "error reading PPM image file \"%s\": %s", fileName,
@@ -228,37 +273,26 @@ FileReadPPM(
 		Tcl_SetErrorCode(interp, "TK", "IMAGE", "PPM", "EOF", NULL);
 	    }
 	    ckfree(pixelPtr);
+	    ckfree(extraPtr);
 	    return TCL_ERROR;
 	}
-	if (maxIntensity < 0x00ff) {
-	    unsigned char *p;
-
-	    for (p = pixelPtr; count > 0; count--, p++) {
-		*p = (((int) *p) * 255)/maxIntensity;
-	    }
-	} else if (maxIntensity > 0x00ff) {
-	    unsigned char *p;
-	    unsigned int value;
-
-	    for (p = pixelPtr; count > 0; count--, p += 2) {
-		value = ((unsigned int) p[0]) * 256 + ((unsigned int) p[1]);
-		value = value * 255 / maxIntensity;
-		p[0] = p[1] = (unsigned char) value;
-	    }
-	}
+	ConvertPPMSamples(pixelPtr, pixelPtr, nBytes / bytesPerChannel,
+		maxIntensity);
 	block.height = nLines;
 	if (Tk_PhotoPutBlock(interp, imageHandle, &block, destX, destY,
 		width, nLines, TK_PHOTO_COMPOSITE_SET) != TCL_OK) {
 	    ckfree(pixelPtr);
+	    ckfree(extraPtr);
 	    return TCL_ERROR;
 	}
 	destY += nLines;
     }
 
     ckfree(pixelPtr);
+    ckfree(extraPtr);
     return TCL_OK;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -285,7 +319,7 @@ FileWritePPM(
     Tk_PhotoImageBlock *blockPtr)
 {
     Tcl_Channel chan;
-    int w, h, greenOffset, blueOffset, nBytes;
+    int w, h, y, greenOffset, blueOffset, nBytes, nLines;
     unsigned char *pixelPtr, *pixLinePtr;
     char header[16 + TCL_INTEGER_SPACE * 2];
 
@@ -318,19 +352,44 @@ FileWritePPM(
 	if (Tcl_Write(chan, (char *) pixLinePtr, nBytes) != nBytes) {
 	    goto writeerror;
 	}
-    } else {
-	for (h = blockPtr->height; h > 0; h--) {
-	    pixelPtr = pixLinePtr;
-	    for (w = blockPtr->width; w > 0; w--) {
-		if (    Tcl_Write(chan,(char *)&pixelPtr[0], 1) == -1 ||
-			Tcl_Write(chan,(char *)&pixelPtr[greenOffset],1)==-1 ||
-			Tcl_Write(chan,(char *)&pixelPtr[blueOffset],1) ==-1) {
-		    goto writeerror;
+    } else if (blockPtr->width > 0) {
+	/*
+	 * Gather as many rows as fit in MAX_MEMORY bytes and write them out
+	 * together.
+	 */
+
+	unsigned char *bufferPtr, *outPtr;
+
+	nLines = MAX_MEMORY / (3 * blockPtr->width);
+	if (nLines > blockPtr->height) {
+	    nLines = blockPtr->height;
+	}
+	if (nLines <= 0) {
+	    nLines = 1;
+	}
+	bufferPtr = ckalloc(nLines * 3 * blockPtr->width);
+	for (h = blockPtr->height; h > 0; h -= nLines) {
+	    if (nLines > h) {
+		nLines = h;
+	    }
+	    outPtr = bufferPtr;
+	    for (y = 0; y < nLines; y++) {
+		pixelPtr = pixLinePtr;
+		for (w = blockPtr->width; w > 0; w--) {
+		    *outPtr++ = pixelPtr[0];
+		    *outPtr++ = pixelPtr[greenOffset];
+		    *outPtr++ = pixelPtr[blueOffset];
+		    pixelPtr += blockPtr->pixelSize;
 		}
-		pixelPtr += blockPtr->pixelSize;
+		pixLinePtr += blockPtr->pitch;
+	    }
+	    nBytes = outPtr - bufferPtr;
+	    if (Tcl_Write(chan, (char *) bufferPtr, nBytes) != nBytes) {
+		ckfree(bufferPtr);
+		goto writeerror;
 	    }
-	    pixLinePtr += blockPtr->pitch;
 	}
+	ckfree(bufferPtr);
     }
 
     if (Tcl_Close(NULL, chan) == 0) {
@@ -489,7 +548,7 @@ StringReadPPM(
 				 * image being read. */
 {
     int fileWidth, fileHeight, maxIntensity;
-    int nLines, nBytes, h, type, count, dataSize, bytesPerChannel = 1;
+    int nLines, nBytes, h, type, dataSize, rawPitch, bytesPerChannel = 1;
     unsigned char *pixelPtr, *dataBuffer;
     Tk_PhotoImageBlock block;
 
@@ -528,24 +587,30 @@ StringReadPPM(
 	return TCL_OK;
     }
 
+    /*
+     * As when reading from a file, the block describes the samples once
+     * converted to 8 bits.
+     */
+
     if (type == PGM) {
-	block.pixelSize = 1 * bytesPerChannel;
+	block.pixelSize = 1;
 	block.offset[0] = 0;
 	block.offset[1] = 0;
 	block.offset[2] = 0;
     } else {
-	block.pixelSize = 3 * bytesPerChannel;
+	block.pixelSize = 3;
 	block.offset[0] = 0;
-	block.offset[1] = 1 * bytesPerChannel;
-	block.offset[2] = 2 * bytesPerChannel;
+	block.offset[1] = 1;
+	block.offset[2] = 2;
     }
     block.offset[3] = 0;
     block.width = width;
     block.pitch = block.pixelSize * fileWidth;
+    rawPitch = block.pitch * bytesPerChannel;
 
     if (srcY > 0) {
-	dataBuffer += srcY * block.pitch;
-	dataSize -= srcY * block.pitch;
+	dataBuffer += srcY * rawPitch;
+	dataSize -= srcY * rawPitch;
     }
 
     if (maxIntensity == 0x00ff) {
@@ -570,23 +635,14 @@ StringReadPPM(
 	return TCL_ERROR;
     }
 
-    nLines = (MAX_MEMORY + block.pitch - 1) / block.pitch;
-    if (nLines > height) {
-	nLines = height;
-    }
-    if (nLines <= 0) {
-	nLines = 1;
-    }
-    nBytes = nLines * block.pitch;
-    pixelPtr = ckalloc(nBytes);
+    pixelPtr = AllocPPMBuffer(rawPitch, height, &nLines);
+    nBytes = nLines * rawPitch;
     block.pixelPtr = pixelPtr + srcX * block.pixelSize;
 
     for (h = height; h > 0; h -= nLines) {
-	unsigned char *p;
-
 	if (nLines > h) {
 	    nLines = h;
-	    nBytes = nLines * block.pitch;
+	    nBytes = nLines * rawPitch;
 	}
 	if (dataSize < nBytes) {
 	    ckfree(pixelPtr);
@@ -595,20 +651,9 @@ StringReadPPM(
 	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "PPM", "TRUNCATED", NULL);
 	    return TCL_ERROR;
 	}
-	if (maxIntensity < 0x00ff) {
-	    for (p=pixelPtr,count=nBytes ; count>0 ; count--,p++,dataBuffer++) {
-		*p = (((int) *dataBuffer) * 255)/maxIntensity;
-	    }
-	} else {
-	    unsigned char *p;
-	    unsigned int value;
-
-	    for (p = pixelPtr,count=nBytes; count > 1; count-=2, p += 2) {
-		value = ((unsigned int) p[0]) * 256 + ((unsigned int) p[1]);
-		value = value * 255 / maxIntensity;
-		p[0] = p[1] = (unsigned char) value;
-	    }
-	}
+	ConvertPPMSamples(dataBuffer, pixelPtr, nBytes / bytesPerChannel,
+		maxIntensity);
+	dataBuffer += nBytes;
 	dataSize -= nBytes;
 	block.height = nLines;
 	if (Tk_PhotoPutBlock(interp, imageHandle, &block, destX, destY,
@@ -622,21 +667,27 @@ StringReadPPM(
     ckfree(pixelPtr);
     return TCL_OK;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
  * ReadPPMFileHeader --
  *
  *	This function reads the PPM header from the beginning of a PPM file
- *	and returns information from the header.
+ *	and returns information from the header. The file is read in large
+ *	pieces rather than a character at a time, so some of the raster data
+ *	is usually read along with the header; it can be handed back to the
+ *	caller.
  *
  * Results:
  *	The return value is PGM if file "f" appears to start with a valid PGM
  *	header, PPM if "f" appears to start with a valid PPM header, and 0
  *	otherwise. If the header is valid, then *widthPtr and *heightPtr are
  *	modified to hold the dimensions of the image and *maxIntensityPtr is
- *	modified to hold the value of a "fully on" intensity value.
+ *	modified to hold the value of a "fully on" intensity value. If
+ *	extraPtrPtr is not NULL, the data read past the header is returned in
+ *	a buffer in *extraPtrPtr (to be freed by the caller with ckfree) and
+ *	its size in *extraSizePtr.
  *
  * Side effects:
  *	The access position in f advances.
@@ -650,83 +701,43 @@ ReadPPMFileHeader(
     int *widthPtr, int *heightPtr,
 				/* The dimensions of the image are returned
 				 * here. */
-    int *maxIntensityPtr)	/* The maximum intensity value for the image
+    int *maxIntensityPtr,	/* The maximum intensity value for the image
 				 * is stored here. */
+    unsigned char **extraPtrPtr,
+    int *extraSizePtr)
 {
-#define BUFFER_SIZE 1000
-    char buffer[BUFFER_SIZE], c;
-    int i, numFields, type = 0;
-
-    /*
-     * Read 4 space-separated fields from the file, ignoring comments (any
-     * line that starts with "#").
-     */
-
-    if (Tcl_Read(chan, &c, 1) != 1) {
-	return 0;
-    }
-    i = 0;
-    for (numFields = 0; numFields < 4; numFields++) {
-	/*
-	 * Skip comments and white space.
-	 */
-
-	while (1) {
-	    while (isspace(UCHAR(c))) {
-		if (Tcl_Read(chan, &c, 1) != 1) {
-		    return 0;
-		}
-	    }
-	    if (c != '#') {
-		break;
-	    }
-	    do {
-		if (Tcl_Read(chan, &c, 1) != 1) {
-		    return 0;
-		}
-	    } while (c != '\n');
+    unsigned char *buffer;
+    int size = 0, space = HEADER_CHUNK, count, type, headerSize;
+
+    buffer = ckalloc(space);
+    while (1) {
+	count = Tcl_Read(chan, (char *) buffer + size, space - size);
+	if (count > 0) {
+	    size += count;
 	}
-
-	/*
-	 * Read a field (everything up to the next white space).
-	 */
-
-	while (!isspace(UCHAR(c))) {
-	    if (i < (BUFFER_SIZE-2)) {
-		buffer[i] = c;
-		i++;
-	    }
-	    if (Tcl_Read(chan, &c, 1) != 1) {
-		goto done;
-	    }
+	type = ParsePPMHeader(buffer, size, (size < space), widthPtr,
+		heightPtr, maxIntensityPtr, &headerSize);
+	if (type >= 0) {
+	    break;
 	}
-	if (i < (BUFFER_SIZE-1)) {
-	    buffer[i] = ' ';
-	    i++;
+	if (space >= MAX_MEMORY) {
+	    type = 0;
+	    break;
 	}
+	space *= 2;
+	buffer = ckrealloc(buffer, space);
     }
 
-  done:
-    buffer[i] = 0;
-
-    /*
-     * Parse the fields, which are: id, width, height, maxIntensity.
-     */
-
-    if (strncmp(buffer, "P6 ", 3) == 0) {
-	type = PPM;
-    } else if (strncmp(buffer, "P5 ", 3) == 0) {
-	type = PGM;
-    } else {
-	return 0;
-    }
-    if (sscanf(buffer+3, "%d %d %d", widthPtr, heightPtr, maxIntensityPtr)
-	    != 3) {
-	return 0;
+    if ((type == 0) || (extraPtrPtr == NULL)) {
+	ckfree(buffer);
+	return type;
     }
+    memmove(buffer, buffer + headerSize, size - headerSize);
+    *extraPtrPtr = buffer;
+    *extraSizePtr = size - headerSize;
     return type;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -760,60 +771,95 @@ ReadPPMStringHeader(
     unsigned char **dataBufferPtr,
     int *dataSizePtr)
 {
-#define BUFFER_SIZE 1000
-    char buffer[BUFFER_SIZE], c;
-    int i, numFields, dataSize, type = 0;
+    int dataSize, type, headerSize;
     unsigned char *dataBuffer;
 
     dataBuffer = Tcl_GetByteArrayFromObj(dataPtr, &dataSize);
+    type = ParsePPMHeader(dataBuffer, dataSize, 1, widthPtr, heightPtr,
+	    maxIntensityPtr, &headerSize);
+    if ((type != 0) && (dataBufferPtr != NULL)) {
+	*dataBufferPtr = dataBuffer + headerSize;
+	*dataSizePtr = dataSize - headerSize;
+    }
+    return type;
+}
 
-    /*
-     * Read 4 space-separated fields from the string, ignoring comments (any
-     * line that starts with "#").
-     */
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParsePPMHeader --
+ *
+ *	This function parses a PPM header held in memory: 4 space-separated
+ *	fields, ignoring comments (any line that starts with "#").
+ *
+ * Results:
+ *	The return value is PGM, PPM or 0 as for ReadPPMFileHeader, with the
+ *	fields of a valid header stored in *widthPtr, *heightPtr and
+ *	*maxIntensityPtr and the number of bytes it takes (including the white
+ *	space character ending it) in *headerSizePtr. If the data ends before
+ *	the header does and atEnd is false, -1 is returned so that the caller
+ *	can get more data and try again.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParsePPMHeader(
+    const unsigned char *data,	/* The data to parse. */
+    int dataSize,		/* Number of bytes in data. */
+    int atEnd,			/* Non-zero if no data follows. */
+    int *widthPtr, int *heightPtr,
+				/* The dimensions of the image are returned
+				 * here. */
+    int *maxIntensityPtr,	/* The maximum intensity value for the image
+				 * is stored here. */
+    int *headerSizePtr)		/* The size of the header is stored here. */
+{
+#define BUFFER_SIZE 1000
+    char buffer[BUFFER_SIZE];
+    int i = 0, pos = 0, numFields, type = 0;
 
-    if (dataSize-- < 1) {
-	return 0;
-    }
-    c = (char) (*dataBuffer++);
-    i = 0;
     for (numFields = 0; numFields < 4; numFields++) {
 	/*
 	 * Skip comments and white space.
 	 */
 
 	while (1) {
-	    while (isspace(UCHAR(c))) {
-		if (dataSize-- < 1) {
-		    return 0;
-		}
-		c = (char) (*dataBuffer++);
+	    while ((pos < dataSize) && isspace(UCHAR(data[pos]))) {
+		pos++;
+	    }
+	    if (pos >= dataSize) {
+		return atEnd ? 0 : -1;
 	    }
-	    if (c != '#') {
+	    if (data[pos] != '#') {
 		break;
 	    }
-	    do {
-		if (dataSize-- < 1) {
-		    return 0;
-		}
-		c = (char) (*dataBuffer++);
-	    } while (c != '\n');
+	    while ((pos < dataSize) && (data[pos] != '\n')) {
+		pos++;
+	    }
 	}
 
 	/*
 	 * Read a field (everything up to the next white space).
 	 */
 
-	while (!isspace(UCHAR(c))) {
+	while ((pos < dataSize) && !isspace(UCHAR(data[pos]))) {
 	    if (i < (BUFFER_SIZE-2)) {
-		buffer[i] = c;
+		buffer[i] = data[pos];
 		i++;
 	    }
-	    if (dataSize-- < 1) {
-		goto done;
+	    pos++;
+	}
+	if (pos >= dataSize) {
+	    if (!atEnd) {
+		return -1;
 	    }
-	    c = (char) (*dataBuffer++);
+	    goto done;
 	}
+	pos++;
 	if (i < (BUFFER_SIZE-1)) {
 	    buffer[i] = ' ';
 	    i++;
@@ -838,13 +884,115 @@ ReadPPMStringHeader(
 	    != 3) {
 	return 0;
     }
-    if (dataBufferPtr != NULL) {
-	*dataBufferPtr = dataBuffer;
-	*dataSizePtr = dataSize;
-    }
+    *headerSizePtr = pos;
     return type;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AllocPPMBuffer --
+ *
+ *	This function allocates the buffer the raster is read into: if
+ *	possible one holding all the rows, so that the data can be read and
+ *	given to the photo image in one piece, and otherwise one holding about
+ *	MAX_MEMORY bytes worth of rows.
+ *
+ * Results:
+ *	The buffer, to be freed with ckfree. The number of rows it holds is
+ *	stored in *nLinesPtr.
+ *
+ * Side effects:
+ *	None
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned char *
+AllocPPMBuffer(
+    int pitch,			/* Number of bytes in a row. */
+    int height,			/* Number of rows wanted. */
+    int *nLinesPtr)		/* Number of rows allocated is stored here. */
+{
+    unsigned char *bufferPtr = NULL;
+    int nLines = height;
+
+    if (height <= INT_MAX / pitch) {
+	bufferPtr = attemptckalloc(height * pitch);
+    }
+    if (bufferPtr == NULL) {
+	nLines = (MAX_MEMORY + pitch - 1) / pitch;
+	if (nLines > height) {
+	    nLines = height;
+	}
+	if (nLines <= 0) {
+	    nLines = 1;
+	}
+	bufferPtr = ckalloc(nLines * pitch);
+    }
+    *nLinesPtr = nLines;
+    return bufferPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ConvertPPMSamples --
+ *
+ *	This function scales samples with the given maximum intensity to the
+ *	8-bit range used by photo images; 16-bit (big endian) samples become
+ *	single bytes. The source and destination may be the same buffer.
+ *
+ * Results:
+ *	None
+ *
+ * Side effects:
+ *	numSamples bytes are stored at dstPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ConvertPPMSamples(
+    const unsigned char *srcPtr,/* Samples as found in the file. */
+    unsigned char *dstPtr,	/* Where to put the 8-bit samples. */
+    int numSamples,		/* Number of samples to convert. */
+    int maxIntensity)		/* The maximum intensity value. */
+{
+    int i;
+    unsigned int value;
+
+    if (maxIntensity < 0x00ff) {
+	unsigned char map[256];
+
+	for (i = 0; i < 256; i++) {
+	    map[i] = (unsigned char) ((i * 255) / maxIntensity);
+	}
+	for (i = 0; i < numSamples; i++) {
+	    dstPtr[i] = map[srcPtr[i]];
+	}
+    } else if (maxIntensity == 0x00ff) {
+	if (dstPtr != srcPtr) {
+	    memcpy(dstPtr, srcPtr, numSamples);
+	}
+    } else if (maxIntensity == 0xffff) {
+	/*
+	 * value * 255 / 65535 is value / 257, which for 16-bit values is
+	 * exactly this.
+	 */
+
+	for (i = 0; i < numSamples; i++) {
+	    value = (((unsigned int) srcPtr[2*i]) << 8) | srcPtr[2*i + 1];
+	    dstPtr[i] = (unsigned char) ((value - (value >> 8)) >> 8);
+	}
+    } else {
+	for (i = 0; i < numSamples; i++) {
+	    value = (((unsigned int) srcPtr[2*i]) << 8) | srcPtr[2*i + 1];
+	    dstPtr[i] = (unsigned char) (value * 255 / maxIntensity);
+	}
+    }
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -39,6 +39,8 @@ struct SubcommandOptions {
     XColor *background;		/* Value specified for -background option. */
     int compositingRule;	/* Value specified for -compositingrule
 				 * option. */
+    Tcl_Obj *asyncCmd;		/* Value specified for -async option. */
+    int filter;			/* Value specified for -filter option. */
 };
 
 /*
@@ -48,8 +50,10 @@ struct SubcommandOptions {
  * set in the options field of the SubcommandOptions structure if that option
  * was specified.
  *
+ * OPT_ASYNC:			Set if -async option allowed/specified.
  * OPT_BACKGROUND:		Set if -format option allowed/specified.
  * OPT_COMPOSITE:		Set if -compositingrule option allowed/spec'd.
+ * OPT_FILTER:			Set if -filter option allowed/specified.
  * OPT_FORMAT:			Set if -format option allowed/specified.
  * OPT_FROM:			Set if -from option allowed/specified.
  * OPT_GRAYSCALE:		Set if -grayscale option allowed/specified.
@@ -59,15 +63,17 @@ struct SubcommandOptions {
  * OPT_ZOOM:			Set if -zoom option allowed/specified.
  */
 
-#define OPT_BACKGROUND	1
-#define OPT_COMPOSITE	2
-#define OPT_FORMAT	4
-#define OPT_FROM	8
-#define OPT_GRAYSCALE	0x10
-#define OPT_SHRINK	0x20
-#define OPT_SUBSAMPLE	0x40
-#define OPT_TO		0x80
-#define OPT_ZOOM	0x100
+#define OPT_ASYNC	1
+#define OPT_BACKGROUND	2
+#define OPT_COMPOSITE	4
+#define OPT_FILTER	8
+#define OPT_FORMAT	0x10
+#define OPT_FROM	0x20
+#define OPT_GRAYSCALE	0x40
+#define OPT_SHRINK	0x80
+#define OPT_SUBSAMPLE	0x100
+#define OPT_TO		0x200
+#define OPT_ZOOM	0x400
 
 /*
  * List of option names. The order here must match the order of declarations
@@ -75,8 +81,10 @@ struct SubcommandOptions {
  */
 
 static const char *const optionNames[] = {
+    "-async",
     "-background",
     "-compositingrule",
+    "-filter",
     "-format",
     "-from",
     "-grayscale",
@@ -87,6 +95,15 @@ static const char *const optionNames[] = {
     NULL
 };
 
+/*
+ * Values for the -filter option of the copy subcommand. These must match the
+ * order of filterNames in ParseSubcommandOptions.
+ */
+
+#define PHOTO_FILTER_NONE	0
+#define PHOTO_FILTER_BOX	1
+#define PHOTO_FILTER_BILINEAR	2
+
 /*
  * Message to generate when an attempt to resize an image fails due to memory
  * problems.
@@ -137,6 +154,75 @@ typedef struct ThreadSpecificData {
 } ThreadSpecificData;
 static Tcl_ThreadDataKey dataKey;
 
+/*
+ * Images read with -file can be kept in a process-wide cache, enabled with
+ * "tk imagecache", so that loading the same file again costs a lookup and a
+ * copy instead of a decode. The cache is shared by all threads and protected
+ * by photoCacheMutex. Entries are kept in a list in order of last use, and
+ * the least recently used ones are evicted when the cache grows beyond
+ * photoCacheLimit bytes.
+ */
+
+typedef struct PhotoCacheEntry {
+    Tcl_HashEntry *hPtr;	/* Entry in photoCacheTable, or NULL once the
+				 * entry has been evicted. */
+    int refCount;		/* Number of loads copying from the entry;
+				 * an evicted entry is freed when this drops to
+				 * zero. */
+    int width, height;		/* Size of the image. */
+    unsigned char *pixels;	/* RGBA pixels, in the layout of pix32. */
+    struct PhotoCacheEntry *prevPtr, *nextPtr;
+				/* Neighbours in the list of entries, most
+				 * recently used first. */
+} PhotoCacheEntry;
+
+static Tcl_HashTable photoCacheTable;
+static int photoCacheInitialized = 0;
+static PhotoCacheEntry *photoCacheFirst = NULL;
+static PhotoCacheEntry *photoCacheLast = NULL;
+static Tcl_WideInt photoCacheSize = 0;
+static Tcl_WideInt photoCacheLimit = 0;
+static Tcl_WideInt photoCacheHits = 0;
+static Tcl_WideInt photoCacheMisses = 0;
+TCL_DECLARE_MUTEX(photoCacheMutex)
+
+/*
+ * A record of the following type is kept for each "read -async" operation
+ * while it runs. Everything from chan on is used by the worker thread, if
+ * there is one; the owning thread doesn't touch the record until the
+ * worker's AsyncReadEvent arrives.
+ */
+
+typedef struct PhotoAsyncRead {
+    PhotoMaster *masterPtr;	/* Image to read into, or NULL if it has been
+				 * deleted. */
+    Tcl_Interp *interp;		/* Interpreter to invoke command in. */
+    Tcl_Obj *command;		/* Command to invoke when the read is done. */
+    int toX, toY;		/* Where the data goes in the image. */
+    Tcl_Obj *errorObj;		/* Error message, if the read failed. */
+    struct PhotoAsyncRead *nextPtr;
+				/* Next read into the same image. */
+    Tcl_Channel chan;		/* The image file. */
+    Tk_ImageFileReadProc *fileReadProc;
+				/* Reader of the file's format. */
+    char *fileName;		/* Name of the file. Malloc'ed. */
+    char *format;		/* Value of the -format option, or NULL.
+				 * Malloc'ed. */
+    int width, height;		/* Size of the area to read; on return, size of
+				 * the decoded image. */
+    int fromX, fromY;		/* Top-left corner of the area to read. */
+    Tcl_ThreadId owner;		/* Thread the image belongs to. */
+    unsigned char *pix32;	/* Decoded pixels, in the layout of pix32 in
+				 * PhotoMaster. */
+    char *errorMessage;		/* Error message from the worker, or NULL.
+				 * Malloc'ed. */
+} PhotoAsyncRead;
+
+typedef struct AsyncReadEvent {
+    Tcl_Event header;		/* Standard information for all events. */
+    PhotoAsyncRead *readPtr;	/* The read that is done. */
+} AsyncReadEvent;
+
 /*
  * Default configuration
  */
@@ -180,6 +266,10 @@ static int		ImgPhotoConfigureMaster(Tcl_Interp *interp,
 			    PhotoMaster *masterPtr, int objc,
 			    Tcl_Obj *const objv[], int flags);
 static int		ToggleComplexAlphaIfNeeded(PhotoMaster *mPtr);
+static int		LineIsOpaque(const unsigned char *alphaPtr, int count,
+			    int stride);
+static unsigned char *	ResampleBlock(Tk_PhotoImageBlock *blockPtr,
+			    int width, int height, int filter);
 static int		ImgPhotoSetSize(PhotoMaster *masterPtr, int width,
 			    int height);
 static int		ImgStringWrite(Tcl_Interp *interp,
@@ -197,6 +287,24 @@ static int		MatchStringFormat(Tcl_Interp *interp, Tcl_Obj *data,
 			    Tk_PhotoImageFormat **imageFormatPtr,
 			    int *widthPtr, int *heightPtr, int *oldformat);
 static const char *	GetExtension(const char *path);
+static char *		PhotoCacheKey(const char *fileName, Tcl_Obj *format);
+static PhotoCacheEntry *PhotoCacheFind(const char *key);
+static void		PhotoCacheRelease(PhotoCacheEntry *entryPtr);
+static void		PhotoCacheStore(const char *key,
+			    PhotoMaster *masterPtr, int width, int height);
+static void		PhotoCacheTrim(void);
+static void		PhotoCacheExitProc(ClientData clientData);
+static int		AsyncReadFile(Tcl_Interp *interp,
+			    PhotoMaster *masterPtr, Tcl_Channel chan,
+			    Tk_PhotoImageFormat *imageFormat,
+			    struct SubcommandOptions *optPtr, int width,
+			    int height, int oldformat);
+#ifdef TCL_THREADS
+static Tcl_ThreadCreateType AsyncReadThread(ClientData clientData);
+#endif
+static void		QueueAsyncReadEvent(PhotoAsyncRead *readPtr,
+			    Tcl_ThreadId owner);
+static int		AsyncReadEventProc(Tcl_Event *evPtr, int flags);
 
 /*
  *----------------------------------------------------------------------
@@ -405,7 +513,7 @@ ImgPhotoCmd(
     int result, index, x, y, width, height, dataWidth, dataHeight, listObjc;
     struct SubcommandOptions options;
     Tcl_Obj **listObjv, **srcObjv;
-    unsigned char *pixelPtr;
+    unsigned char *pixelPtr, *resampled;
     Tk_PhotoImageBlock block;
     Tk_Window tkwin;
     Tk_PhotoImageFormat *imageFormat;
@@ -547,9 +655,10 @@ ImgPhotoCmd(
 	options.subsampleX = options.subsampleY = 1;
 	options.name = NULL;
 	options.compositingRule = TK_PHOTO_COMPOSITE_OVERLAY;
+	options.filter = PHOTO_FILTER_NONE;
 	if (ParseSubcommandOptions(&options, interp,
 		OPT_FROM | OPT_TO | OPT_ZOOM | OPT_SUBSAMPLE | OPT_SHRINK |
-		OPT_COMPOSITE, &index, objc, objv) != TCL_OK) {
+		OPT_COMPOSITE | OPT_FILTER, &index, objc, objv) != TCL_OK) {
 	    return TCL_ERROR;
 	}
 	if (options.name == NULL || index < objc) {
@@ -557,6 +666,15 @@ ImgPhotoCmd(
 		    "source-image ?-compositingrule rule? ?-from x1 y1 x2 y2? ?-to x1 y1 x2 y2? ?-zoom x y? ?-subsample x y?");
 	    return TCL_ERROR;
 	}
+	if ((options.filter != PHOTO_FILTER_NONE)
+		&& ((options.subsampleX <= 0) || (options.subsampleY <= 0))) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "value(s) for the -subsample option must be positive"
+		    " when -filter is used", -1));
+	    Tcl_SetErrorCode(interp, "TK", "IMAGE", "PHOTO", "BAD_VALUE",
+		    NULL);
+	    return TCL_ERROR;
+	}
 
 	/*
 	 * Look for the source image and get a pointer to its image data.
@@ -624,6 +742,32 @@ ImgPhotoCmd(
 	    options.toY2 = options.toY + height * options.zoomY;
 	}
 
+	block.pixelPtr += options.fromX * block.pixelSize
+		+ options.fromY * block.pitch;
+	block.width = options.fromX2 - options.fromX;
+	block.height = options.fromY2 - options.fromY;
+
+	/*
+	 * With -filter, the source area is resampled to the size of the
+	 * destination area rather than sampled and tiled into it. Do this
+	 * before any -shrink, as the source may be the destination image.
+	 */
+
+	resampled = NULL;
+	if ((options.filter != PHOTO_FILTER_NONE)
+		&& (block.width > 0) && (block.height > 0)
+		&& (options.toX2 > options.toX)
+		&& (options.toY2 > options.toY)) {
+	    resampled = ResampleBlock(&block, options.toX2 - options.toX,
+		    options.toY2 - options.toY, options.filter);
+	    if (resampled == NULL) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			TK_PHOTO_ALLOC_FAILURE_MESSAGE, -1));
+		Tcl_SetErrorCode(interp, "TK", "MALLOC", NULL);
+		return TCL_ERROR;
+	    }
+	}
+
 	/*
 	 * Set the destination image size if the -shrink option was specified.
 	 */
@@ -631,6 +775,9 @@ ImgPhotoCmd(
 	if (options.options & OPT_SHRINK) {
 	    if (ImgPhotoSetSize(masterPtr, options.toX2,
 		    options.toY2) != TCL_OK) {
+		if (resampled != NULL) {
+		    ckfree(resampled);
+		}
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			TK_PHOTO_ALLOC_FAILURE_MESSAGE, -1));
 		Tcl_SetErrorCode(interp, "TK", "MALLOC", NULL);
@@ -638,14 +785,27 @@ ImgPhotoCmd(
 	    }
 	}
 
+	if (resampled != NULL) {
+	    block.pixelPtr = resampled;
+	    block.width = options.toX2 - options.toX;
+	    block.height = options.toY2 - options.toY;
+	    block.pitch = block.width * 4;
+	    block.pixelSize = 4;
+	    block.offset[0] = 0;
+	    block.offset[1] = 1;
+	    block.offset[2] = 2;
+	    block.offset[3] = 3;
+	    result = Tk_PhotoPutBlock(interp, (Tk_PhotoHandle) masterPtr,
+		    &block, options.toX, options.toY, block.width,
+		    block.height, options.compositingRule);
+	    ckfree(resampled);
+	    return result;
+	}
+
 	/*
 	 * Copy the image data over using Tk_PhotoPutZoomedBlock.
 	 */
 
-	block.pixelPtr += options.fromX * block.pixelSize
-		+ options.fromY * block.pitch;
-	block.width = options.fromX2 - options.fromX;
-	block.height = options.fromY2 - options.fromY;
 	return Tk_PhotoPutZoomedBlock(interp, (Tk_PhotoHandle) masterPtr,
 		&block, options.toX, options.toY, options.toX2 - options.toX,
 		options.toY2 - options.toY, options.zoomX, options.zoomY,
@@ -1011,7 +1171,7 @@ ImgPhotoCmd(
 	options.name = NULL;
 	options.format = NULL;
 	if (ParseSubcommandOptions(&options, interp,
-		OPT_FORMAT | OPT_FROM | OPT_TO | OPT_SHRINK,
+		OPT_ASYNC | OPT_FORMAT | OPT_FROM | OPT_TO | OPT_SHRINK,
 		&index, objc, objv) != TCL_OK) {
 	    return TCL_ERROR;
 	}
@@ -1095,6 +1255,11 @@ ImgPhotoCmd(
 	    }
 	}
 
+	if (options.options & OPT_ASYNC) {
+	    return AsyncReadFile(interp, masterPtr, chan, imageFormat,
+		    &options, width, height, oldformat);
+	}
+
 	/*
 	 * Call the handler's file read function to read the data into the
 	 * image.
@@ -1492,6 +1657,11 @@ ParseSubcommandOptions(
 				 * TK_PHOTO_COMPOSITE_* constants. */
 	NULL
     };
+    static const char *const filterNames[] = {
+	"none", "box", "bilinear",	/* Note that these must match the
+					 * PHOTO_FILTER_* constants. */
+	NULL
+    };
     size_t length;
     int index, c, bit, currentBit;
     int values[4], numValues, maxValues, argIndex;
@@ -1566,6 +1736,16 @@ ParseSubcommandOptions(
 	    if (!optPtr->background) {
 		return TCL_ERROR;
 	    }
+	} else if (bit == OPT_ASYNC) {
+	    /*
+	     * The -async option takes a command, which is only stored.
+	     */
+
+	    if (index + 1 >= objc) {
+		goto oneValueRequired;
+	    }
+	    *optIndexPtr = ++index;
+	    optPtr->asyncCmd = objv[index];
 	} else if (bit == OPT_FORMAT) {
 	    /*
 	     * The -format option takes a single string value. Note that
@@ -1593,6 +1773,20 @@ ParseSubcommandOptions(
 		return TCL_ERROR;
 	    }
 	    *optIndexPtr = index;
+	} else if (bit == OPT_FILTER) {
+	    /*
+	     * The -filter option takes a single value from a well-known set.
+	     */
+
+	    if (index + 1 >= objc) {
+		goto oneValueRequired;
+	    }
+	    index++;
+	    if (Tcl_GetIndexFromObj(interp, objv[index], filterNames,
+		    "filter", 0, &optPtr->filter) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    *optIndexPtr = index;
 	} else if ((bit != OPT_SHRINK) && (bit != OPT_GRAYSCALE)) {
 	    const char *val;
 
@@ -1780,6 +1974,8 @@ ImgPhotoConfigureMaster(
     Tcl_Channel chan;
     Tk_PhotoImageFormat *imageFormat;
     const char **args;
+    char *cacheKey = NULL;
+    XRectangle validBox;
 
     args = ckalloc((objc + 1) * sizeof(char *));
     for (i = 0, j = 0; i < objc; i++,j++) {
@@ -1927,6 +2123,51 @@ ImgPhotoConfigureMaster(
 	    goto errorExit;
 	}
 
+	/*
+	 * Look in the photo cache first. It is only used while the image is
+	 * empty, as format handlers may draw over what an image already
+	 * holds.
+	 */
+
+	TkClipBox(masterPtr->validRegion, &validBox);
+	if ((validBox.width == 0) || (validBox.height == 0)) {
+	    cacheKey = PhotoCacheKey(masterPtr->fileString, masterPtr->format);
+	}
+	if (cacheKey != NULL) {
+	    PhotoCacheEntry *entryPtr = PhotoCacheFind(cacheKey);
+
+	    if (entryPtr != NULL) {
+		Tk_PhotoImageBlock block;
+
+		block.pixelPtr = entryPtr->pixels;
+		block.width = entryPtr->width;
+		block.height = entryPtr->height;
+		block.pitch = entryPtr->width * 4;
+		block.pixelSize = 4;
+		block.offset[0] = 0;
+		block.offset[1] = 1;
+		block.offset[2] = 2;
+		block.offset[3] = 3;
+		result = ImgPhotoSetSize(masterPtr, block.width, block.height);
+		if (result != TCL_OK) {
+		    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			    TK_PHOTO_ALLOC_FAILURE_MESSAGE, -1));
+		    Tcl_SetErrorCode(interp, "TK", "MALLOC", NULL);
+		} else {
+		    result = Tk_PhotoPutBlock(interp, (Tk_PhotoHandle) masterPtr,
+			    &block, 0, 0, block.width, block.height,
+			    TK_PHOTO_COMPOSITE_SET);
+		}
+		PhotoCacheRelease(entryPtr);
+		ckfree(cacheKey);
+		cacheKey = NULL;
+		if (result != TCL_OK) {
+		    goto errorExit;
+		}
+		goto fileLoaded;
+	    }
+	}
+
 	chan = Tcl_OpenFileChannel(interp, masterPtr->fileString, "r", 0);
 	if (chan == NULL) {
 	    goto errorExit;
@@ -1963,7 +2204,13 @@ ImgPhotoConfigureMaster(
 	if (result != TCL_OK) {
 	    goto errorExit;
 	}
+	if (cacheKey != NULL) {
+	    PhotoCacheStore(cacheKey, masterPtr, imageWidth, imageHeight);
+	    ckfree(cacheKey);
+	    cacheKey = NULL;
+	}
 
+    fileLoaded:
 	Tcl_ResetResult(interp);
 	masterPtr->flags |= IMAGE_CHANGED;
     }
@@ -2045,6 +2292,9 @@ ImgPhotoConfigureMaster(
     return TCL_OK;
 
   errorExit:
+    if (cacheKey != NULL) {
+	ckfree(cacheKey);
+    }
     if (oldData != NULL) {
 	Tcl_DecrRefCount(oldData);
     }
@@ -2124,6 +2374,7 @@ ImgPhotoDelete(
 {
     PhotoMaster *masterPtr = masterData;
     PhotoInstance *instancePtr;
+    PhotoAsyncRead *readPtr;
 
     while ((instancePtr = masterPtr->instancePtr) != NULL) {
 	if (instancePtr->refCount > 0) {
@@ -2133,6 +2384,10 @@ ImgPhotoDelete(
 	TkImgDisposeInstance(instancePtr);
     }
     masterPtr->tkMaster = NULL;
+    for (readPtr = masterPtr->asyncPtr; readPtr != NULL;
+	    readPtr = readPtr->nextPtr) {
+	readPtr->masterPtr = NULL;
+    }
     if (masterPtr->imageCmd != NULL) {
 	Tcl_DeleteCommandFromToken(masterPtr->interp, masterPtr->imageCmd);
     }
@@ -2372,6 +2627,716 @@ ImgPhotoSetSize(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoCacheKey --
+ *
+ *	Builds the key under which the decoded contents of an image file are
+ *	kept in the photo cache: the normalized file name, the size and
+ *	modification time of the file, and the -format value.
+ *
+ * Results:
+ *	A string to be freed with ckfree, or NULL if the cache is disabled or
+ *	the file can't be identified.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+PhotoCacheKey(
+    const char *fileName,	/* Name of the image file. */
+    Tcl_Obj *format)		/* Value of the -format option, or NULL. */
+{
+    Tcl_Obj *pathObj, *normPathObj, *keyObj;
+    Tcl_StatBuf statBuf;
+    char *key = NULL;
+    int length;
+
+    if (photoCacheLimit == 0) {
+	return NULL;
+    }
+    pathObj = Tcl_NewStringObj(fileName, -1);
+    Tcl_IncrRefCount(pathObj);
+    normPathObj = Tcl_FSGetNormalizedPath(NULL, pathObj);
+    if ((normPathObj != NULL) && (Tcl_FSStat(pathObj, &statBuf) == 0)) {
+	keyObj = Tcl_ObjPrintf("%s\n%" TCL_LL_MODIFIER "d %" TCL_LL_MODIFIER
+		"d\n%s", Tcl_GetString(normPathObj),
+		(Tcl_WideInt) Tcl_GetSizeFromStat(&statBuf),
+		(Tcl_WideInt) Tcl_GetModificationTimeFromStat(&statBuf),
+		(format != NULL) ? Tcl_GetString(format) : "");
+	Tcl_IncrRefCount(keyObj);
+	Tcl_GetStringFromObj(keyObj, &length);
+	key = ckalloc(length + 1);
+	memcpy(key, Tcl_GetString(keyObj), length + 1);
+	Tcl_DecrRefCount(keyObj);
+    }
+    Tcl_DecrRefCount(pathObj);
+    return key;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoCacheFind, PhotoCacheRelease --
+ *
+ *	PhotoCacheFind looks up the decoded image stored under a key and
+ *	takes a reference to it, so that it stays valid while it is copied
+ *	even if another thread evicts it. PhotoCacheRelease drops the
+ *	reference again.
+ *
+ * Results:
+ *	PhotoCacheFind returns the entry, or NULL if there is none.
+ *
+ * Side effects:
+ *	The entry becomes the most recently used one, and the hit or miss is
+ *	counted for "tk imagecache statistics". An evicted entry is freed
+ *	when its last reference goes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PhotoCacheEntry *
+PhotoCacheFind(
+    const char *key)		/* Key built by PhotoCacheKey. */
+{
+    Tcl_HashEntry *hPtr;
+    PhotoCacheEntry *entryPtr = NULL;
+
+    Tcl_MutexLock(&photoCacheMutex);
+    if (photoCacheInitialized) {
+	hPtr = Tcl_FindHashEntry(&photoCacheTable, key);
+	if (hPtr != NULL) {
+	    entryPtr = Tcl_GetHashValue(hPtr);
+	    entryPtr->refCount++;
+	    photoCacheHits++;
+
+	    /*
+	     * Move the entry to the front of the LRU list.
+	     */
+
+	    if (entryPtr->prevPtr != NULL) {
+		entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+		if (entryPtr->nextPtr != NULL) {
+		    entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+		} else {
+		    photoCacheLast = entryPtr->prevPtr;
+		}
+		entryPtr->prevPtr = NULL;
+		entryPtr->nextPtr = photoCacheFirst;
+		photoCacheFirst->prevPtr = entryPtr;
+		photoCacheFirst = entryPtr;
+	    }
+	} else {
+	    photoCacheMisses++;
+	}
+    }
+    Tcl_MutexUnlock(&photoCacheMutex);
+    return entryPtr;
+}
+
+static void
+PhotoCacheRelease(
+    PhotoCacheEntry *entryPtr)	/* Entry returned by PhotoCacheFind. */
+{
+    Tcl_MutexLock(&photoCacheMutex);
+    if ((--entryPtr->refCount == 0) && (entryPtr->hPtr == NULL)) {
+	ckfree(entryPtr->pixels);
+	ckfree(entryPtr);
+    }
+    Tcl_MutexUnlock(&photoCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoCacheStore --
+ *
+ *	Enters a copy of an image just decoded from a file into the photo
+ *	cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is allocated; least recently used entries are evicted to keep
+ *	the cache within its limit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PhotoCacheStore(
+    const char *key,		/* Key built by PhotoCacheKey. */
+    PhotoMaster *masterPtr,	/* Image holding the decoded data. */
+    int width, int height)	/* Size of the decoded data, which starts at
+				 * the top-left corner of the image. */
+{
+    PhotoCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    size_t size = (size_t) width * height * 4;
+    int y, isNew;
+
+    if ((width <= 0) || (height <= 0) || (size > (size_t) photoCacheLimit)
+	    || (masterPtr->width < width) || (masterPtr->height < height)) {
+	return;
+    }
+    entryPtr = attemptckalloc(sizeof(PhotoCacheEntry));
+    if (entryPtr == NULL) {
+	return;
+    }
+    entryPtr->pixels = attemptckalloc(size);
+    if (entryPtr->pixels == NULL) {
+	ckfree(entryPtr);
+	return;
+    }
+    for (y = 0; y < height; y++) {
+	memcpy(entryPtr->pixels + (size_t) y * width * 4,
+		masterPtr->pix32 + (size_t) y * masterPtr->width * 4,
+		(size_t) width * 4);
+    }
+    entryPtr->width = width;
+    entryPtr->height = height;
+    entryPtr->refCount = 0;
+
+    Tcl_MutexLock(&photoCacheMutex);
+    if (photoCacheInitialized) {
+	hPtr = Tcl_CreateHashEntry(&photoCacheTable, key, &isNew);
+    } else {
+	isNew = 0;
+    }
+    if (!isNew) {
+	/*
+	 * Another thread got there first, or the cache has gone.
+	 */
+
+	Tcl_MutexUnlock(&photoCacheMutex);
+	ckfree(entryPtr->pixels);
+	ckfree(entryPtr);
+	return;
+    }
+    Tcl_SetHashValue(hPtr, entryPtr);
+    entryPtr->hPtr = hPtr;
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = photoCacheFirst;
+    if (photoCacheFirst != NULL) {
+	photoCacheFirst->prevPtr = entryPtr;
+    } else {
+	photoCacheLast = entryPtr;
+    }
+    photoCacheFirst = entryPtr;
+    photoCacheSize += size;
+    PhotoCacheTrim();
+    Tcl_MutexUnlock(&photoCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoCacheTrim --
+ *
+ *	Evicts least recently used entries from the photo cache until it is
+ *	within its limit. Must be called with photoCacheMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Entries that are not being copied from are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PhotoCacheTrim(void)
+{
+    PhotoCacheEntry *entryPtr;
+
+    while ((photoCacheLast != NULL) && (photoCacheSize > photoCacheLimit)) {
+	entryPtr = photoCacheLast;
+	photoCacheLast = entryPtr->prevPtr;
+	if (photoCacheLast != NULL) {
+	    photoCacheLast->nextPtr = NULL;
+	} else {
+	    photoCacheFirst = NULL;
+	}
+	photoCacheSize -= (Tcl_WideInt) entryPtr->width * entryPtr->height * 4;
+	Tcl_DeleteHashEntry(entryPtr->hPtr);
+	entryPtr->hPtr = NULL;
+	if (entryPtr->refCount == 0) {
+	    ckfree(entryPtr->pixels);
+	    ckfree(entryPtr);
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPhotoCacheLimit --
+ *
+ *	Queries or sets the amount of memory the photo cache may use; this is
+ *	the implementation of "tk imagecache". A limit of 0 disables the cache,
+ *	which is the default.
+ *
+ * Results:
+ *	The limit in force before the call, in bytes.
+ *
+ * Side effects:
+ *	If limit isn't negative it becomes the new limit, and entries may be
+ *	evicted. The cache is created the first time it is enabled.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_WideInt
+TkPhotoCacheLimit(
+    Tcl_WideInt limit)		/* New limit in bytes, or -1 to leave the
+				 * limit unchanged. */
+{
+    Tcl_WideInt oldLimit;
+    int created = 0;
+
+    Tcl_MutexLock(&photoCacheMutex);
+    oldLimit = photoCacheLimit;
+    if (limit >= 0) {
+	photoCacheLimit = limit;
+	PhotoCacheTrim();
+	if ((limit > 0) && !photoCacheInitialized) {
+	    Tcl_InitHashTable(&photoCacheTable, TCL_STRING_KEYS);
+	    photoCacheInitialized = 1;
+	    created = 1;
+	}
+    }
+    Tcl_MutexUnlock(&photoCacheMutex);
+
+    /*
+     * Register the exit handler outside the cache lock, since
+     * TkCreateExitHandler takes a lock of its own.
+     */
+
+    if (created) {
+	TkCreateExitHandler(PhotoCacheExitProc, NULL);
+    }
+    return oldLimit;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPhotoCacheStatistics --
+ *
+ *	Describes the use of the photo cache; this is the implementation of
+ *	"tk imagecache statistics".
+ *
+ * Results:
+ *	A new list of alternating names and values: the number of lookups
+ *	that found an entry (hits) and that did not (misses) since the
+ *	process started, and the number of entries and bytes now cached.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TkPhotoCacheStatistics(void)
+{
+    Tcl_WideInt hits, misses, size;
+    int entries;
+
+    Tcl_MutexLock(&photoCacheMutex);
+    hits = photoCacheHits;
+    misses = photoCacheMisses;
+    entries = photoCacheInitialized ? photoCacheTable.numEntries : 0;
+    size = photoCacheSize;
+    Tcl_MutexUnlock(&photoCacheMutex);
+
+    return Tcl_ObjPrintf("hits %" TCL_LL_MODIFIER "d misses %"
+	    TCL_LL_MODIFIER "d entries %d size %" TCL_LL_MODIFIER "d",
+	    hits, misses, entries, size);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPhotoName --
+ *
+ *	Returns the name of a photo image.
+ *
+ * Results:
+ *	The name of the image, or NULL if the photo is a private one that has
+ *	no image (such as the copy that an image is read into in the
+ *	background).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+const char *
+TkPhotoName(
+    Tk_PhotoHandle handle)	/* The photo image. */
+{
+    PhotoMaster *masterPtr = (PhotoMaster *) handle;
+
+    if (masterPtr->tkMaster == NULL) {
+	return NULL;
+    }
+    return Tk_NameOfImage(masterPtr->tkMaster);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoCacheExitProc --
+ *
+ *	Frees the photo cache when Tk is finalized.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PhotoCacheExitProc(
+    ClientData clientData)	/* not used */
+{
+    Tcl_MutexLock(&photoCacheMutex);
+    photoCacheLimit = 0;
+    PhotoCacheTrim();
+    if (photoCacheInitialized) {
+	Tcl_DeleteHashTable(&photoCacheTable);
+	photoCacheInitialized = 0;
+    }
+    Tcl_MutexUnlock(&photoCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AsyncReadFile --
+ *
+ *	Implements "imageName read fileName -async command". If the file
+ *	format is one of those whose readers only use the channel and memory
+ *	(the built-in PNG, GIF and PPM readers), the file is decoded on a
+ *	worker thread into a private image, which is copied into the photo
+ *	when the worker is done. Other formats, or a Tcl built without
+ *	threads, are read at once. Either way the command is invoked from
+ *	the event loop when the data is in the image.
+ *
+ * Results:
+ *	A standard Tcl result; errors while decoding are passed to the
+ *	command.
+ *
+ * Side effects:
+ *	Ownership of chan passes to this function. A thread may be created.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AsyncReadFile(
+    Tcl_Interp *interp,		/* Interpreter the command belongs to. */
+    PhotoMaster *masterPtr,	/* Image to read into. */
+    Tcl_Channel chan,		/* The image file, positioned for the
+				 * format's reader. */
+    Tk_PhotoImageFormat *imageFormat,
+				/* Format of the file. */
+    struct SubcommandOptions *optPtr,
+				/* Options of the read command. */
+    int width, int height,	/* Size of the area to read. */
+    int oldformat)		/* Whether imageFormat is an old-style
+				 * format. */
+{
+    PhotoAsyncRead *readPtr;
+    Tcl_Obj *format;
+    int result;
+
+    readPtr = ckalloc(sizeof(PhotoAsyncRead));
+    memset(readPtr, 0, sizeof(PhotoAsyncRead));
+    readPtr->masterPtr = masterPtr;
+    readPtr->interp = interp;
+    Tcl_Preserve(interp);
+    readPtr->command = optPtr->asyncCmd;
+    Tcl_IncrRefCount(readPtr->command);
+    readPtr->toX = optPtr->toX;
+    readPtr->toY = optPtr->toY;
+    readPtr->nextPtr = masterPtr->asyncPtr;
+    masterPtr->asyncPtr = readPtr;
+
+#ifdef TCL_THREADS
+    if (!oldformat && ((imageFormat->fileReadProc == tkImgFmtPNG.fileReadProc)
+	    || (imageFormat->fileReadProc == tkImgFmtGIF.fileReadProc)
+	    || (imageFormat->fileReadProc == tkImgFmtPPM.fileReadProc))) {
+	Tcl_ThreadId threadId;
+	const char *string;
+	int length;
+
+	readPtr->chan = chan;
+	readPtr->fileReadProc = imageFormat->fileReadProc;
+	string = Tcl_GetStringFromObj(optPtr->name, &length);
+	readPtr->fileName = ckalloc(length + 1);
+	memcpy(readPtr->fileName, string, length + 1);
+	if (optPtr->format != NULL) {
+	    string = Tcl_GetStringFromObj(optPtr->format, &length);
+	    readPtr->format = ckalloc(length + 1);
+	    memcpy(readPtr->format, string, length + 1);
+	}
+	readPtr->width = width;
+	readPtr->height = height;
+	readPtr->fromX = optPtr->fromX;
+	readPtr->fromY = optPtr->fromY;
+	readPtr->owner = Tcl_GetCurrentThread();
+
+	/*
+	 * The channel now belongs to the worker.
+	 */
+
+	Tcl_CutChannel(chan);
+	if (Tcl_CreateThread(&threadId, AsyncReadThread, readPtr,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_NOFLAGS) == TCL_OK) {
+	    return TCL_OK;
+	}
+	Tcl_SpliceChannel(chan);
+	readPtr->chan = NULL;
+    }
+#endif /* TCL_THREADS */
+
+    /*
+     * Read the file now and just defer the command.
+     */
+
+    format = optPtr->format;
+    if (oldformat && format) {
+	format = (Tcl_Obj *) Tcl_GetString(format);
+    }
+    result = imageFormat->fileReadProc(interp, chan,
+	    Tcl_GetString(optPtr->name), format, (Tk_PhotoHandle) masterPtr,
+	    optPtr->toX, optPtr->toY, width, height, optPtr->fromX,
+	    optPtr->fromY);
+    Tcl_Close(NULL, chan);
+    if (result != TCL_OK) {
+	readPtr->errorObj = Tcl_GetObjResult(interp);
+	Tcl_IncrRefCount(readPtr->errorObj);
+	Tcl_ResetResult(interp);
+    }
+    QueueAsyncReadEvent(readPtr, NULL);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AsyncReadThread --
+ *
+ *	The body of the worker thread started by AsyncReadFile. It decodes
+ *	the file into a private photo image, which is never seen by the rest
+ *	of Tk, and sends the pixels back to the thread that owns the image.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The channel is closed. An event is queued for the owning thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#ifdef TCL_THREADS
+static Tcl_ThreadCreateType
+AsyncReadThread(
+    ClientData clientData)	/* The PhotoAsyncRead record. */
+{
+    PhotoAsyncRead *readPtr = clientData;
+    Tcl_Interp *interp;
+    Tcl_Obj *format = NULL;
+    PhotoMaster *privPtr;
+    int result;
+
+    Tcl_SpliceChannel(readPtr->chan);
+
+    /*
+     * The readers report errors through an interpreter, and only use it for
+     * that.
+     */
+
+    interp = Tcl_CreateInterp();
+    privPtr = ckalloc(sizeof(PhotoMaster));
+    memset(privPtr, 0, sizeof(PhotoMaster));
+    privPtr->validRegion = TkCreateRegion();
+    if (readPtr->format != NULL) {
+	format = Tcl_NewStringObj(readPtr->format, -1);
+	Tcl_IncrRefCount(format);
+    }
+
+    result = readPtr->fileReadProc(interp, readPtr->chan, readPtr->fileName,
+	    format, (Tk_PhotoHandle) privPtr, 0, 0, readPtr->width,
+	    readPtr->height, readPtr->fromX, readPtr->fromY);
+    Tcl_Close(NULL, readPtr->chan);
+    readPtr->chan = NULL;
+
+    if (result != TCL_OK) {
+	const char *message = Tcl_GetString(Tcl_GetObjResult(interp));
+
+	readPtr->errorMessage = ckalloc(strlen(message) + 1);
+	strcpy(readPtr->errorMessage, message);
+    }
+    readPtr->pix32 = privPtr->pix32;
+    readPtr->width = privPtr->width;
+    readPtr->height = privPtr->height;
+
+    if (format != NULL) {
+	Tcl_DecrRefCount(format);
+    }
+    TkDestroyRegion(privPtr->validRegion);
+    ckfree(privPtr);
+    Tcl_DeleteInterp(interp);
+
+    QueueAsyncReadEvent(readPtr, readPtr->owner);
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * QueueAsyncReadEvent --
+ *
+ *	Queues the event that finishes an asynchronous read.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	If owner isn't NULL, the event goes to that thread's queue and the
+ *	thread is woken up; otherwise it goes to the current thread's queue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+QueueAsyncReadEvent(
+    PhotoAsyncRead *readPtr,	/* The read that is done. */
+    Tcl_ThreadId owner)		/* Thread to notify, or NULL. */
+{
+    AsyncReadEvent *eventPtr = ckalloc(sizeof(AsyncReadEvent));
+
+    eventPtr->header.proc = AsyncReadEventProc;
+    eventPtr->readPtr = readPtr;
+    if (owner == NULL) {
+	Tcl_QueueEvent(&eventPtr->header, TCL_QUEUE_TAIL);
+    } else {
+	Tcl_ThreadQueueEvent(owner, &eventPtr->header, TCL_QUEUE_TAIL);
+	Tcl_ThreadAlert(owner);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AsyncReadEventProc --
+ *
+ *	Finishes an asynchronous read in the thread that owns the image: the
+ *	decoded pixels are put into the image and the read's command is
+ *	invoked, with the error message as an extra argument if the read
+ *	failed (or an empty string if it succeeded).
+ *
+ * Results:
+ *	Always 1, the event has been handled.
+ *
+ * Side effects:
+ *	Whatever the command does. Nothing happens if the image has been
+ *	deleted in the meantime.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AsyncReadEventProc(
+    Tcl_Event *evPtr,		/* The AsyncReadEvent. */
+    int flags)			/* Not used. */
+{
+    PhotoAsyncRead *readPtr = ((AsyncReadEvent *) evPtr)->readPtr;
+    PhotoMaster *masterPtr = readPtr->masterPtr;
+    Tcl_Interp *interp = readPtr->interp;
+    PhotoAsyncRead **prevPtrPtr;
+    Tcl_Obj *cmdObj;
+
+    if (masterPtr != NULL) {
+	for (prevPtrPtr = &masterPtr->asyncPtr; *prevPtrPtr != readPtr;
+		prevPtrPtr = &(*prevPtrPtr)->nextPtr) {
+	    /* Empty loop body. */
+	}
+	*prevPtrPtr = readPtr->nextPtr;
+
+	if (readPtr->errorMessage != NULL) {
+	    readPtr->errorObj = Tcl_NewStringObj(readPtr->errorMessage, -1);
+	    Tcl_IncrRefCount(readPtr->errorObj);
+	} else if (readPtr->pix32 != NULL) {
+	    Tk_PhotoImageBlock block;
+
+	    block.pixelPtr = readPtr->pix32;
+	    block.width = readPtr->width;
+	    block.height = readPtr->height;
+	    block.pitch = readPtr->width * 4;
+	    block.pixelSize = 4;
+	    block.offset[0] = 0;
+	    block.offset[1] = 1;
+	    block.offset[2] = 2;
+	    block.offset[3] = 3;
+	    if (Tk_PhotoPutBlock(interp, (Tk_PhotoHandle) masterPtr, &block,
+		    readPtr->toX, readPtr->toY, block.width, block.height,
+		    TK_PHOTO_COMPOSITE_SET) != TCL_OK) {
+		readPtr->errorObj = Tcl_GetObjResult(interp);
+		Tcl_IncrRefCount(readPtr->errorObj);
+		Tcl_ResetResult(interp);
+	    }
+	}
+
+	if (!Tcl_InterpDeleted(interp)) {
+	    cmdObj = Tcl_DuplicateObj(readPtr->command);
+	    Tcl_IncrRefCount(cmdObj);
+	    Tcl_ListObjAppendElement(NULL, cmdObj, (readPtr->errorObj != NULL)
+		    ? readPtr->errorObj : Tcl_NewObj());
+	    if (Tcl_EvalObjEx(interp, cmdObj, TCL_EVAL_GLOBAL) != TCL_OK) {
+		Tcl_BackgroundException(interp, TCL_ERROR);
+	    }
+	    Tcl_DecrRefCount(cmdObj);
+	}
+    }
+
+    Tcl_Release(interp);
+    Tcl_DecrRefCount(readPtr->command);
+    if (readPtr->errorObj != NULL) {
+	Tcl_DecrRefCount(readPtr->errorObj);
+    }
+    if (readPtr->errorMessage != NULL) {
+	ckfree(readPtr->errorMessage);
+    }
+    if (readPtr->pix32 != NULL) {
+	ckfree(readPtr->pix32);
+    }
+    if (readPtr->fileName != NULL) {
+	ckfree(readPtr->fileName);
+    }
+    if (readPtr->format != NULL) {
+	ckfree(readPtr->format);
+    }
+    ckfree(readPtr);
+    return 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2673,6 +3638,241 @@ Tk_FindPhoto(
     return clientData;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * LineIsOpaque --
+ *
+ *	Checks whether a run of pixels is fully opaque, so that copying it
+ *	gives the same result whatever the compositing rule.
+ *
+ * Results:
+ *	1 if all count alpha values, stride bytes apart, are 255; 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LineIsOpaque(
+    const unsigned char *alphaPtr,
+				/* Alpha value of the first pixel. */
+    int count,			/* Number of pixels to check. */
+    int stride)			/* Distance in bytes between pixels. */
+{
+    unsigned char all = 255;
+
+    for (; count > 0; count--, alphaPtr += stride) {
+	all &= *alphaPtr;
+    }
+    return (all == 255);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ResampleBlock --
+ *
+ *	Scales a block of photo image pixels to a new size, either with a box
+ *	filter (each result pixel is the average of the source pixels it
+ *	covers, which suits making thumbnails) or by bilinear interpolation.
+ *	Colors are weighted by their alpha, so fully transparent pixels do not
+ *	darken their neighbours.
+ *
+ * Results:
+ *	A newly allocated array of width*height pixels in the photo image's
+ *	own RGBA layout, to be released with ckfree(), or NULL if memory ran
+ *	out.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned char *
+ResampleBlock(
+    Tk_PhotoImageBlock *blockPtr,
+				/* Pixels to scale, in the photo image's own
+				 * RGBA layout (see Tk_PhotoGetImage). */
+    int width, int height,	/* Size to scale to. */
+    int filter)			/* PHOTO_FILTER_BOX or
+				 * PHOTO_FILTER_BILINEAR. */
+{
+    int srcWidth = blockPtr->width, srcHeight = blockPtr->height;
+    int x, y, i, *xStart, *xEnd;
+    unsigned char *resultPtr, *destPtr;
+    const unsigned char *srcPtr;
+
+    resultPtr = attemptckalloc((size_t) width * height * 4);
+    xStart = attemptckalloc(sizeof(int) * 2 * width);
+    if (resultPtr == NULL || xStart == NULL) {
+	goto noMemory;
+    }
+    xEnd = xStart + width;
+    destPtr = resultPtr;
+
+    if (filter == PHOTO_FILTER_BOX) {
+	Tcl_WideUInt *sums;
+
+	/*
+	 * Each result pixel covers the source pixels from xStart to xEnd
+	 * horizontally (at least one of them when enlarging). The columns of
+	 * the rows covered by a result row are summed first, then each span
+	 * of columns is summed.
+	 */
+
+	sums = attemptckalloc(sizeof(Tcl_WideUInt) * 4 * srcWidth);
+	if (sums == NULL) {
+	    goto noMemory;
+	}
+	for (x = 0; x < width; x++) {
+	    xStart[x] = (int) (((Tcl_WideInt) x * srcWidth) / width);
+	    xEnd[x] = (int) (((Tcl_WideInt) (x + 1) * srcWidth) / width);
+	    if (xEnd[x] <= xStart[x]) {
+		xEnd[x] = xStart[x] + 1;
+	    }
+	}
+	for (y = 0; y < height; y++) {
+	    int row, y0 = (int) (((Tcl_WideInt) y * srcHeight) / height);
+	    int y1 = (int) (((Tcl_WideInt) (y + 1) * srcHeight) / height);
+
+	    if (y1 <= y0) {
+		y1 = y0 + 1;
+	    }
+	    memset(sums, 0, sizeof(Tcl_WideUInt) * 4 * srcWidth);
+	    for (row = y0; row < y1; row++) {
+		srcPtr = blockPtr->pixelPtr + (size_t) row * blockPtr->pitch;
+		for (i = 0; i < srcWidth * 4; i += 4) {
+		    unsigned alpha = srcPtr[i + 3];
+
+		    sums[i] += srcPtr[i] * alpha;
+		    sums[i + 1] += srcPtr[i + 1] * alpha;
+		    sums[i + 2] += srcPtr[i + 2] * alpha;
+		    sums[i + 3] += alpha;
+		}
+	    }
+	    for (x = 0; x < width; x++) {
+		Tcl_WideUInt r = 0, g = 0, b = 0, a = 0, count;
+
+		for (i = xStart[x] * 4; i < xEnd[x] * 4; i += 4) {
+		    r += sums[i];
+		    g += sums[i + 1];
+		    b += sums[i + 2];
+		    a += sums[i + 3];
+		}
+		count = (Tcl_WideUInt) (xEnd[x] - xStart[x]) * (y1 - y0);
+		if (a == 0) {
+		    memset(destPtr, 0, 4);
+		} else {
+		    destPtr[0] = (unsigned char) ((r + a / 2) / a);
+		    destPtr[1] = (unsigned char) ((g + a / 2) / a);
+		    destPtr[2] = (unsigned char) ((b + a / 2) / a);
+		    destPtr[3] = (unsigned char) ((a + count / 2) / count);
+		}
+		destPtr += 4;
+	    }
+	}
+	ckfree(sums);
+    } else {
+	unsigned *weights, *columns;
+
+	/*
+	 * Each result pixel is centred on a point between source pixels
+	 * xStart and xStart+1, with weights in 1/256ths. Each result row
+	 * first blends the two source rows around it into columns (with
+	 * colors premultiplied by alpha), then blends pairs of columns.
+	 */
+
+	weights = attemptckalloc(sizeof(unsigned) * width);
+	columns = attemptckalloc(sizeof(unsigned) * 4 * srcWidth);
+	if (weights == NULL || columns == NULL) {
+	    if (weights != NULL) {
+		ckfree(weights);
+	    }
+	    if (columns != NULL) {
+		ckfree(columns);
+	    }
+	    goto noMemory;
+	}
+	for (x = 0; x < width; x++) {
+	    Tcl_WideInt pos = (((Tcl_WideInt) (2 * x + 1) * srcWidth * 256)
+		    / (2 * width)) - 128;
+
+	    if (pos < 0) {
+		pos = 0;
+	    }
+	    xStart[x] = (int) (pos >> 8);
+	    weights[x] = (unsigned) (pos & 255);
+	    if (xStart[x] >= srcWidth - 1) {
+		xStart[x] = srcWidth - 1;
+		weights[x] = 0;
+	    }
+	    xEnd[x] = (weights[x] ? xStart[x] + 1 : xStart[x]);
+	}
+	for (y = 0; y < height; y++) {
+	    Tcl_WideInt pos = (((Tcl_WideInt) (2 * y + 1) * srcHeight * 256)
+		    / (2 * height)) - 128;
+	    const unsigned char *src2Ptr;
+	    unsigned w1, w0;
+	    int y0;
+
+	    if (pos < 0) {
+		pos = 0;
+	    }
+	    y0 = (int) (pos >> 8);
+	    w1 = (unsigned) (pos & 255);
+	    if (y0 >= srcHeight - 1) {
+		y0 = srcHeight - 1;
+		w1 = 0;
+	    }
+	    w0 = 256 - w1;
+	    srcPtr = blockPtr->pixelPtr + (size_t) y0 * blockPtr->pitch;
+	    src2Ptr = (w1 ? srcPtr + blockPtr->pitch : srcPtr);
+	    for (i = 0; i < srcWidth * 4; i += 4) {
+		unsigned a0 = srcPtr[i + 3] * w0, a1 = src2Ptr[i + 3] * w1;
+
+		columns[i] = srcPtr[i] * a0 + src2Ptr[i] * a1;
+		columns[i + 1] = srcPtr[i + 1] * a0 + src2Ptr[i + 1] * a1;
+		columns[i + 2] = srcPtr[i + 2] * a0 + src2Ptr[i + 2] * a1;
+		columns[i + 3] = a0 + a1;
+	    }
+	    for (x = 0; x < width; x++) {
+		const unsigned *c0 = columns + xStart[x] * 4;
+		const unsigned *c1 = columns + xEnd[x] * 4;
+		Tcl_WideUInt wx1 = weights[x], wx0 = 256 - wx1, a;
+
+		a = c0[3] * wx0 + c1[3] * wx1;
+		if (a == 0) {
+		    memset(destPtr, 0, 4);
+		} else {
+		    for (i = 0; i < 3; i++) {
+			destPtr[i] = (unsigned char)
+				((c0[i] * wx0 + c1[i] * wx1 + a / 2) / a);
+		    }
+		    destPtr[3] = (unsigned char) ((a + 32768) >> 16);
+		}
+		destPtr += 4;
+	    }
+	}
+	ckfree(weights);
+	ckfree(columns);
+    }
+    ckfree(xStart);
+    return resultPtr;
+
+  noMemory:
+    if (resultPtr != NULL) {
+	ckfree(resultPtr);
+    }
+    if (xStart != NULL) {
+	ckfree(xStart);
+    }
+    return NULL;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2710,7 +3910,7 @@ Tk_PhotoPutBlock(
 {
     register PhotoMaster *masterPtr = (PhotoMaster *) handle;
     int xEnd, yEnd, greenOffset, blueOffset, alphaOffset;
-    int wLeft, hLeft, wCopy, hCopy, pitch;
+    int wLeft, hLeft, wCopy, hCopy, pitch, allOpaque = 0;
     unsigned char *srcPtr, *srcLinePtr, *destPtr, *destLinePtr;
     int sourceIsSimplePhoto = compRule & SOURCE_IS_SIMPLE_ALPHA_PHOTO;
     XRectangle rect;
@@ -2816,9 +4016,12 @@ Tk_PhotoPutBlock(
     }
 
     /*
-     * Copy and merge pixels according to the compositing rule.
+     * Copy and merge pixels according to the compositing rule. While doing
+     * so, keep track of whether every pixel written was fully opaque, as
+     * that lets us skip scanning the alpha channel afterwards.
      */
 
+    allOpaque = 1;
     for (hLeft = height; hLeft > 0;) {
 	int pixelSize = blockPtr->pixelSize;
 	int compRuleSet = (compRule == TK_PHOTO_COMPOSITE_SET);
@@ -2829,18 +4032,27 @@ Tk_PhotoPutBlock(
 	for (; hCopy > 0; --hCopy) {
 	    /*
 	     * If the layout of the source line matches our memory layout and
-	     * we're setting, we can just copy the bytes directly, which is
-	     * much faster.
+	     * we're either setting or the line is entirely opaque (so the
+	     * overlay rule has nothing to merge), we can just copy the bytes
+	     * directly, which is much faster.
 	     */
 
 	    if ((pixelSize == 4) && (greenOffset == 1)
 		    && (blueOffset == 2) && (alphaOffset == 3)
-		    && (width <= blockPtr->width)
-		    && compRuleSet) {
-		memcpy(destLinePtr, srcLinePtr, ((size_t)width * 4));
-		srcLinePtr += blockPtr->pitch;
-		destLinePtr += pitch;
-		continue;
+		    && (width <= blockPtr->width)) {
+		int lineOpaque = LineIsOpaque(srcLinePtr + 3, width, 4);
+
+		if (!lineOpaque) {
+		    allOpaque = 0;
+		}
+		if (lineOpaque || compRuleSet) {
+		    memmove(destLinePtr, srcLinePtr, ((size_t)width * 4));
+		    srcLinePtr += blockPtr->pitch;
+		    destLinePtr += pitch;
+		    continue;
+		}
+	    } else if (alphaOffset != 0) {
+		allOpaque = 0;
 	    }
 
 	    /*
@@ -2946,9 +4158,10 @@ Tk_PhotoPutBlock(
 
     /*
      * Add this new block to the region which specifies which data is valid.
+     * When every pixel written was opaque, the whole area becomes valid.
      */
 
-    if (alphaOffset) {
+    if (alphaOffset && !allOpaque) {
 	/*
 	 * This block is grossly inefficient. For each row in the image, it
 	 * finds each continguous string of nontransparent pixels, then marks
@@ -3018,7 +4231,7 @@ Tk_PhotoPutBlock(
 	 * [Patch 1539990]
 	 */
 
-	if (!(masterPtr->flags & COMPLEX_ALPHA)) {
+	if (!(masterPtr->flags & COMPLEX_ALPHA) && !allOpaque) {
 	    register int x1;
 
 	    for (x1=x ; x1<x+width ; x1++) {
@@ -3032,7 +4245,8 @@ Tk_PhotoPutBlock(
 		}
 	    }
 	}
-    } else if ((alphaOffset != 0) || (masterPtr->flags & COMPLEX_ALPHA)) {
+    } else if ((alphaOffset != 0 && !allOpaque)
+	    || (masterPtr->flags & COMPLEX_ALPHA)) {
 	/*
 	 * Check for partial transparency if alpha pixels are specified, or
 	 * rescan if we already knew such pixels existed. To restrict this
@@ -3101,6 +4315,7 @@ Tk_PhotoPutZoomedBlock(
     int wLeft, hLeft, wCopy, hCopy, blockWid, blockHt;
     unsigned char *srcPtr, *srcLinePtr, *srcOrigPtr, *destPtr, *destLinePtr;
     int pitch, xRepeat, yRepeat, blockXSkip, blockYSkip, sourceIsSimplePhoto;
+    int rgbaLayout, srcCols, overwrite, allOpaque;
     XRectangle rect;
 
     /*
@@ -3217,39 +4432,100 @@ Tk_PhotoPutZoomedBlock(
     }
 
     pitch = masterPtr->width * 4;
+    rgbaLayout = (blockPtr->pixelSize == 4) && (greenOffset == 1)
+	    && (blueOffset == 2) && (alphaOffset == 3);
+    srcCols = (MIN(width, blockWid) + zoomX - 1) / zoomX;
+    allOpaque = 1;
+    overwrite = 0;
     for (hLeft = height; hLeft > 0; ) {
 	hCopy = MIN(hLeft, blockHt);
 	hLeft -= hCopy;
 	yRepeat = zoomY;
 	srcLinePtr = srcOrigPtr;
 	for (; hCopy > 0; --hCopy) {
+	    /*
+	     * A line that repeats the one above it because of zooming in Y is
+	     * a plain copy of that line, provided the line above did not
+	     * depend on what was previously in the image.
+	     */
+
+	    if ((yRepeat < zoomY) && overwrite) {
+		memcpy(destLinePtr, destLinePtr - pitch, (size_t) width * 4);
+		goto nextLine;
+	    }
+
+	    /*
+	     * Work out whether this source line can simply overwrite the
+	     * destination: either we are setting, or every pixel sampled from
+	     * it is opaque.
+	     */
+
+	    overwrite = 1;
+	    if (alphaOffset) {
+		if (!LineIsOpaque(srcLinePtr + alphaOffset, srcCols,
+			blockXSkip)) {
+		    allOpaque = 0;
+		    overwrite = (compRule == TK_PHOTO_COMPOSITE_SET);
+		}
+	    }
+
 	    destPtr = destLinePtr;
 	    for (wLeft = width; wLeft > 0;) {
 		wCopy = MIN(wLeft, blockWid);
 		wLeft -= wCopy;
 		srcPtr = srcLinePtr;
+
+		if (overwrite && rgbaLayout && (zoomX == 1)
+			&& (subsampleX == 1)) {
+		    /*
+		     * Identity in X: the source line is the destination line.
+		     */
+
+		    memmove(destPtr, srcPtr, (size_t) wCopy * 4);
+		    destPtr += wCopy * 4;
+		    continue;
+		}
+		if (overwrite) {
+		    /*
+		     * Gather each sampled pixel once and replicate it zoomX
+		     * times.
+		     */
+
+		    for (; wCopy > 0; wCopy -= zoomX) {
+			unsigned char pixel[4];
+
+			if (rgbaLayout) {
+			    memcpy(pixel, srcPtr, 4);
+			} else {
+			    pixel[0] = srcPtr[0];
+			    pixel[1] = srcPtr[greenOffset];
+			    pixel[2] = srcPtr[blueOffset];
+			    pixel[3] = alphaOffset ? srcPtr[alphaOffset] : 255;
+			}
+			for (xRepeat = MIN(wCopy, zoomX); xRepeat > 0;
+				xRepeat--) {
+			    memcpy(destPtr, pixel, 4);
+			    destPtr += 4;
+			}
+			srcPtr += blockXSkip;
+		    }
+		    continue;
+		}
+
+		/*
+		 * Overlay compositing of a line with some transparency: merge
+		 * pixel by pixel.
+		 */
+
 		for (; wCopy > 0; wCopy -= zoomX) {
 		    for (xRepeat = MIN(wCopy, zoomX); xRepeat > 0; xRepeat--) {
 			int alpha = srcPtr[alphaOffset];/* Source alpha. */
 
-			/*
-			 * Common case (solid pixels) first
-			 */
-
-			if (!alphaOffset || (alpha == 255)) {
-			    *destPtr++ = srcPtr[0];
-			    *destPtr++ = srcPtr[greenOffset];
-			    *destPtr++ = srcPtr[blueOffset];
-			    *destPtr++ = 255;
-			    continue;
- 			}
-
-			if (compRule==TK_PHOTO_COMPOSITE_SET || !destPtr[3]) {
+			if ((alpha == 255) || !destPtr[3]) {
 			    /*
-			     * Either this is the SET rule (we overwrite
-			     * whatever is there) or the destination is
-			     * entirely blank. In both cases, we just set the
-			     * destination to the source.
+			     * Either the source is opaque or the destination
+			     * is entirely blank. In both cases, we just set
+			     * the destination to the source.
 			     */
 
 			    *destPtr++ = srcPtr[0];
@@ -3276,6 +4552,8 @@ Tk_PhotoPutZoomedBlock(
 		    srcPtr += blockXSkip;
 		}
 	    }
+
+	nextLine:
 	    destLinePtr += pitch;
 	    yRepeat--;
 	    if (yRepeat <= 0) {
@@ -3287,9 +4565,10 @@ Tk_PhotoPutZoomedBlock(
 
     /*
      * Recompute the region of data for which we have valid pixels to plot.
+     * When every pixel written was opaque, the whole area becomes valid.
      */
 
-    if (alphaOffset) {
+    if (alphaOffset && !allOpaque) {
 	if (compRule != TK_PHOTO_COMPOSITE_OVERLAY) {
 	    /*
 	     * Don't need this when using the OVERLAY compositing rule, which
@@ -3301,7 +4580,7 @@ Tk_PhotoPutZoomedBlock(
 	    rect.x = x;
 	    rect.y = y;
 	    rect.width = width;
-	    rect.height = 1;
+	    rect.height = height;
 	    TkUnionRectWithRegion(&rect, workRgn, workRgn);
 	    TkSubtractRegion(masterPtr->validRegion, workRgn,
 		    masterPtr->validRegion);
@@ -3341,13 +4620,15 @@ Tk_PhotoPutZoomedBlock(
 		masterPtr->flags |= COMPLEX_ALPHA;
 	    }
 	}
-    } else if ((alphaOffset != 0) || (masterPtr->flags & COMPLEX_ALPHA)) {
+    } else if ((alphaOffset != 0 && !allOpaque)
+	    || (masterPtr->flags & COMPLEX_ALPHA)) {
 	/*
 	 * Check for partial transparency if alpha pixels are specified, or
 	 * rescan if we already knew such pixels existed. To restrict this
 	 * Toggle to only checking the changed pixels requires knowing where
 	 * the alpha pixels are.
 	 */
+
 	ToggleComplexAlphaIfNeeded(masterPtr);
     }
 
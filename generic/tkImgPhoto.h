@@ -165,6 +165,9 @@ struct PhotoMaster {
 				 * image have valid image data. */
     PhotoInstance *instancePtr;	/* First in the list of instances associated
 				 * with this master. */
+    struct PhotoAsyncRead *asyncPtr;
+				/* First of the "read -async" operations into
+				 * this image that haven't finished yet. */
 };
 
 /*
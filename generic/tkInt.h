@@ -459,6 +459,11 @@ typedef struct TkDisplay {
     struct TkWmInfo *firstWmPtr;/* Points to first top-level window. */
     struct TkWmInfo *foregroundWmPtr;
 				/* Points to the foreground window. */
+    Tcl_HashTable wmFrameTable;	/* Maps the ids of the windows that a
+				 * reparenting window manager has put around
+				 * toplevels to what is known about them
+				 * (X11 only). */
+    int wmFrameInit;		/* 0 means wmFrameTable needs initializing. */
 
     /*
      * Information used by tkVisual.c only:
@@ -511,6 +516,22 @@ typedef struct TkDisplay {
 #ifdef TK_USE_INPUT_METHODS
     int ximGeneration;          /* Used to invalidate XIC */
 #endif /* TK_USE_INPUT_METHODS */
+
+    /*
+     * Information used by tkUnixSelect.c only:
+     */
+
+    int selChunkSize;		/* Number of bytes of selection sent in each
+				 * property, derived from the server's maximum
+				 * request size; 0 means not yet computed. */
+
+    /*
+     * Information used by tkWindow.c only:
+     */
+
+    struct TkWindow *windowlessWinPtr;
+				/* Windowless window the pointer is in, or
+				 * NULL; see TkWindowlessPointerEvent. */
 } TkDisplay;
 
 /*
@@ -630,6 +651,9 @@ typedef struct TkMainInfo {
     struct TkMainInfo *nextPtr;	/* Next in list of all main windows managed by
 				 * this process. */
     Tcl_HashTable busyTable;	/* Information used by [tk busy] command. */
+    Tcl_Obj *startupTimes;	/* Dictionary of the time taken by each stage
+				 * of Tk_Init, for "tk startuptimes". NULL
+				 * until Tk_Init finishes. */
 } TkMainInfo;
 
 /*
@@ -720,9 +744,9 @@ typedef struct TkWindow {
     unsigned long dirtyAtts;	/* Bits indicate fields of "atts" that are
 				 * dirty. */
 
-    unsigned int flags;		/* Various flag values: these are all defined
-				 * in tk.h (confusing, but they're needed
-				 * there for some query macros). */
+    unsigned int flags;		/* Various flag values: most are defined in
+				 * tk.h (confusing, but they're needed there
+				 * for some query macros), the rest below. */
 
     /*
      * Information kept by the event manager (tkEvent.c):
@@ -817,6 +841,26 @@ typedef struct TkWindow {
 #endif /* TK_USE_INPUT_METHODS */
 } TkWindow;
 
+/*
+ * Flag values for TkWindow (and Tk_FakeWin) structures that are private to
+ * Tk; the public ones are in tk.h and use the lower bits:
+ *
+ * TK_WINDOWLESS		1 means this window gets no X window when it
+ *				is mapped; its widget draws it into its
+ *				parent's window. See TkSetWindowless.
+ * TK_HAS_WINDOWLESS		1 means windowless children have been drawn
+ *				in this window, so its exposures are forwarded
+ *				to them.
+ * TK_WINDOWLESS_PARENT		1 means the widget of this window has windowless
+ *				children redrawn after it repaints itself, so
+ *				they may be drawn in it. See
+ *				TkAllowWindowless.
+ */
+
+#define TK_WINDOWLESS		0x100000
+#define TK_HAS_WINDOWLESS	0x200000
+#define TK_WINDOWLESS_PARENT	0x400000
+
 /*
  * Real definition of some events. Note that these events come from outside
  * but have internally generated pieces added to them.
@@ -1156,6 +1200,28 @@ MODULE_SCOPE int	TkSetGeometryMaster(Tcl_Interp *interp,
 			    Tk_Window tkwin, const char *master);
 MODULE_SCOPE void	TkFreeGeometryMaster(Tk_Window tkwin,
 			    const char *master);
+MODULE_SCOPE void	TkScheduleLayout(Tk_Window tkwin, Tcl_IdleProc *proc,
+			    ClientData clientData);
+MODULE_SCOPE void	TkCancelLayout(Tcl_IdleProc *proc,
+			    ClientData clientData);
+MODULE_SCOPE int	TkLayoutRequestOnly(ClientData clientData);
+MODULE_SCOPE Tcl_Obj *	TkGetLayoutStats(void);
+MODULE_SCOPE void	TkPrefetchAtoms(TkDisplay *dispPtr);
+MODULE_SCOPE int	TkDeferWindowChanges(TkWindow *winPtr,
+			    unsigned int mask);
+MODULE_SCOPE int	TkDeferWindowMap(TkWindow *winPtr);
+MODULE_SCOPE int	TkCancelWindowMap(TkWindow *winPtr);
+MODULE_SCOPE void	TkCancelWindowChanges(TkWindow *winPtr);
+MODULE_SCOPE void	TkFlushWindowChanges(void);
+MODULE_SCOPE void	TkSetWindowless(Tk_Window tkwin);
+MODULE_SCOPE void	TkAllowWindowless(Tk_Window tkwin);
+MODULE_SCOPE Drawable	TkGetWindowDrawable(Tk_Window tkwin, int *xPtr,
+			    int *yPtr);
+MODULE_SCOPE void	TkRedrawWindowless(Tk_Window tkwin);
+MODULE_SCOPE void	TkHandleWindowlessEvent(TkWindow *winPtr,
+			    XEvent *eventPtr);
+MODULE_SCOPE int	TkWindowlessPointerEvent(TkWindow *parentPtr,
+			    XEvent *eventPtr);
 
 MODULE_SCOPE void	TkEventInit(void);
 MODULE_SCOPE void	TkRegisterObjTypes(void);
@@ -1169,6 +1235,9 @@ MODULE_SCOPE int	TkGetDoublePixels(Tcl_Interp *interp, Tk_Window tkwin,
 MODULE_SCOPE int	TkPostscriptImage(Tcl_Interp *interp, Tk_Window tkwin,
 			    Tk_PostscriptInfo psInfo, XImage *ximage,
 			    int x, int y, int width, int height);
+MODULE_SCOPE Tcl_WideInt TkPhotoCacheLimit(Tcl_WideInt limit);
+MODULE_SCOPE Tcl_Obj *	TkPhotoCacheStatistics(void);
+MODULE_SCOPE const char *TkPhotoName(Tk_PhotoHandle handle);
 MODULE_SCOPE void       TkMapTopFrame(Tk_Window tkwin);
 MODULE_SCOPE XEvent *	TkpGetBindingXEvent(Tcl_Interp *interp);
 MODULE_SCOPE void	TkCreateExitHandler(Tcl_ExitProc *proc,
@@ -550,6 +550,8 @@ EXTERN void		TkDrawAngledChars(Display *display,
 				Drawable drawable, GC gc, Tk_Font tkfont,
 				const char *source, int numBytes, double x,
 				double y, double angle);
+/* 185 */
+EXTERN Tk_Canvas	TkCanvasFromWindow(Tk_Window tkwin);
 
 typedef struct TkIntStubs {
     int magic;
@@ -767,6 +769,7 @@ typedef struct TkIntStubs {
     void (*tkUnderlineAngledTextLayout) (Display *display, Drawable drawable, GC gc, Tk_TextLayout layout, int x, int y, double angle, int underline); /* 182 */
     int (*tkIntersectAngledTextLayout) (Tk_TextLayout layout, int x, int y, int width, int height, double angle); /* 183 */
     void (*tkDrawAngledChars) (Display *display, Drawable drawable, GC gc, Tk_Font tkfont, const char *source, int numBytes, double x, double y, double angle); /* 184 */
+    Tk_Canvas (*tkCanvasFromWindow) (Tk_Window tkwin); /* 185 */
 } TkIntStubs;
 
 extern const TkIntStubs *tkIntStubsPtr;
@@ -1139,6 +1142,8 @@ extern const TkIntStubs *tkIntStubsPtr;
 	(tkIntStubsPtr->tkIntersectAngledTextLayout) /* 183 */
 #define TkDrawAngledChars \
 	(tkIntStubsPtr->tkDrawAngledChars) /* 184 */
+#define TkCanvasFromWindow \
+	(tkIntStubsPtr->tkCanvasFromWindow) /* 185 */
 
 #endif /* defined(USE_TK_STUBS) */
 
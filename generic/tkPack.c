@@ -434,7 +434,7 @@ Tk_PackObjCmd(
 	    }
 	    if (!(masterPtr->flags & REQUESTED_REPACK)) {
 		masterPtr->flags |= REQUESTED_REPACK;
-		Tcl_DoWhenIdle(ArrangePacking, masterPtr);
+		TkScheduleLayout(masterPtr->tkwin, ArrangePacking, masterPtr);
 	    }
 	} else {
 	    if (masterPtr->flags & ALLOCED_MASTER) {
@@ -528,7 +528,7 @@ PackReqProc(
     packPtr = packPtr->masterPtr;
     if (!(packPtr->flags & REQUESTED_REPACK)) {
 	packPtr->flags |= REQUESTED_REPACK;
-	Tcl_DoWhenIdle(ArrangePacking, packPtr);
+	TkScheduleLayout(packPtr->tkwin, ArrangePacking, packPtr);
     }
 }
 
@@ -570,7 +570,7 @@ PackLostSlaveProc(
  *
  * ArrangePacking --
  *
- *	This function is invoked (using the Tcl_DoWhenIdle mechanism) to
+ *	This function is invoked by a layout pass (see TkScheduleLayout) to
  *	re-layout a set of windows managed by the packer. It is invoked at
  *	idle time so that a series of packer requests can be merged into a
  *	single layout operation.
@@ -606,8 +606,11 @@ ArrangePacking(
     int borderTop, borderBtm;
     int borderLeft, borderRight;
     int maxWidth, maxHeight, tmp;
+    int requestOnly = TkLayoutRequestOnly(masterPtr);
 
-    masterPtr->flags &= ~REQUESTED_REPACK;
+    if (!requestOnly) {
+	masterPtr->flags &= ~REQUESTED_REPACK;
+    }
 
     /*
      * If the master has no slaves anymore, then don't do anything at all:
@@ -698,7 +701,16 @@ ArrangePacking(
 	    && !(masterPtr->flags & DONT_PROPAGATE)) {
 	Tk_GeometryRequest(masterPtr->tkwin, maxWidth, maxHeight);
 	masterPtr->flags |= REQUESTED_REPACK;
-	Tcl_DoWhenIdle(ArrangePacking, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, ArrangePacking, masterPtr);
+	goto done;
+    }
+
+    /*
+     * In the request phase of a layout pass that's all; the slaves are
+     * placed later in the pass, once the master's own size is settled.
+     */
+
+    if (requestOnly) {
 	goto done;
     }
 
@@ -1315,7 +1327,7 @@ PackAfter(
     }
     if (!(masterPtr->flags & REQUESTED_REPACK)) {
 	masterPtr->flags |= REQUESTED_REPACK;
-	Tcl_DoWhenIdle(ArrangePacking, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, ArrangePacking, masterPtr);
     }
     return TCL_OK;
 }
@@ -1362,7 +1374,7 @@ Unlink(
     }
     if (!(masterPtr->flags & REQUESTED_REPACK)) {
 	masterPtr->flags |= REQUESTED_REPACK;
-	Tcl_DoWhenIdle(ArrangePacking, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, ArrangePacking, masterPtr);
     }
     if (masterPtr->abortPtr != NULL) {
 	*masterPtr->abortPtr = 1;
@@ -1440,14 +1452,15 @@ PackStructureProc(
 	if ((packPtr->slavePtr != NULL)
 		&& !(packPtr->flags & REQUESTED_REPACK)) {
 	    packPtr->flags |= REQUESTED_REPACK;
-	    Tcl_DoWhenIdle(ArrangePacking, packPtr);
+	    TkScheduleLayout(packPtr->tkwin, ArrangePacking, packPtr);
 	}
 	if ((packPtr->masterPtr != NULL)
 	        && (packPtr->doubleBw != 2*Tk_Changes(packPtr->tkwin)->border_width)) {
 	    if (!(packPtr->masterPtr->flags & REQUESTED_REPACK)) {
 		packPtr->doubleBw = 2*Tk_Changes(packPtr->tkwin)->border_width;
 		packPtr->masterPtr->flags |= REQUESTED_REPACK;
-		Tcl_DoWhenIdle(ArrangePacking, packPtr->masterPtr);
+		TkScheduleLayout(packPtr->masterPtr->tkwin, ArrangePacking,
+			packPtr->masterPtr);
 	    }
 	}
     } else if (eventPtr->type == DestroyNotify) {
@@ -1473,7 +1486,7 @@ PackStructureProc(
 	}
 
 	if (packPtr->flags & REQUESTED_REPACK) {
-	    Tcl_CancelIdleCall(ArrangePacking, packPtr);
+	    TkCancelLayout(ArrangePacking, packPtr);
 	}
 	packPtr->tkwin = NULL;
 	Tcl_EventuallyFree(packPtr, (Tcl_FreeProc *) DestroyPacker);
@@ -1486,7 +1499,7 @@ PackStructureProc(
 	if ((packPtr->slavePtr != NULL)
 		&& !(packPtr->flags & REQUESTED_REPACK)) {
 	    packPtr->flags |= REQUESTED_REPACK;
-	    Tcl_DoWhenIdle(ArrangePacking, packPtr);
+	    TkScheduleLayout(packPtr->tkwin, ArrangePacking, packPtr);
 	}
     } else if (eventPtr->type == UnmapNotify) {
 	register Packer *packPtr2;
@@ -1857,7 +1870,7 @@ ConfigureSlaves(
 	}
 	if (!(masterPtr->flags & REQUESTED_REPACK)) {
 	    masterPtr->flags |= REQUESTED_REPACK;
-	    Tcl_DoWhenIdle(ArrangePacking, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, ArrangePacking, masterPtr);
 	}
     }
     return TCL_OK;
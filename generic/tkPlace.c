@@ -739,7 +739,7 @@ ConfigureSlave(
 
     if (!(masterPtr->flags & PARENT_RECONFIG_PENDING)) {
 	masterPtr->flags |= PARENT_RECONFIG_PENDING;
-	Tcl_DoWhenIdle(RecomputePlacement, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, RecomputePlacement, masterPtr);
     }
     return TCL_OK;
 
@@ -827,8 +827,8 @@ PlaceInfoCommand(
  *
  * RecomputePlacement --
  *
- *	This function is called as a when-idle handler. It recomputes the
- *	geometries of all the slaves of a given master.
+ *	This function is called by a layout pass (see TkScheduleLayout). It
+ *	recomputes the geometries of all the slaves of a given master.
  *
  * Results:
  *	None.
@@ -851,6 +851,14 @@ RecomputePlacement(
     int abort;			/* May get set to non-zero to abort this
 				 * placement operation. */
 
+    /*
+     * The placer never changes the requested size of the master, so it has
+     * nothing to do in the request phase of a layout pass.
+     */
+
+    if (TkLayoutRequestOnly(masterPtr)) {
+	return;
+    }
     masterPtr->flags &= ~PARENT_RECONFIG_PENDING;
 
     /*
@@ -1073,7 +1081,7 @@ MasterStructureProc(
 	if ((masterPtr->slavePtr != NULL)
 		&& !(masterPtr->flags & PARENT_RECONFIG_PENDING)) {
 	    masterPtr->flags |= PARENT_RECONFIG_PENDING;
-	    Tcl_DoWhenIdle(RecomputePlacement, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, RecomputePlacement, masterPtr);
 	}
 	return;
     case DestroyNotify:
@@ -1086,7 +1094,7 @@ MasterStructureProc(
 	Tcl_DeleteHashEntry(Tcl_FindHashEntry(&dispPtr->masterTable,
 		(char *) masterPtr->tkwin));
 	if (masterPtr->flags & PARENT_RECONFIG_PENDING) {
-	    Tcl_CancelIdleCall(RecomputePlacement, masterPtr);
+	    TkCancelLayout(RecomputePlacement, masterPtr);
 	}
 	masterPtr->tkwin = NULL;
 	if (masterPtr->abortPtr != NULL) {
@@ -1103,7 +1111,7 @@ MasterStructureProc(
 	if ((masterPtr->slavePtr != NULL)
 		&& !(masterPtr->flags & PARENT_RECONFIG_PENDING)) {
 	    masterPtr->flags |= PARENT_RECONFIG_PENDING;
-	    Tcl_DoWhenIdle(RecomputePlacement, masterPtr);
+	    TkScheduleLayout(masterPtr->tkwin, RecomputePlacement, masterPtr);
 	}
 	return;
     case UnmapNotify:
@@ -1193,7 +1201,7 @@ PlaceRequestProc(
     }
     if (!(masterPtr->flags & PARENT_RECONFIG_PENDING)) {
 	masterPtr->flags |= PARENT_RECONFIG_PENDING;
-	Tcl_DoWhenIdle(RecomputePlacement, masterPtr);
+	TkScheduleLayout(masterPtr->tkwin, RecomputePlacement, masterPtr);
     }
 }
 
@@ -168,7 +168,7 @@ Tk_ItemType tkRectangleType = {
     RectOvalCoords,		/* coordProc */
     DeleteRectOval,		/* deleteProc */
     DisplayRectOval,		/* displayProc */
-    TK_CONFIG_OBJS,		/* flags */
+    TK_CONFIG_OBJS | TK_CACHE_POSTSCRIPT,	/* flags */
     RectToPoint,		/* pointProc */
     RectToArea,			/* areaProc */
     RectOvalToPostscript,	/* postscriptProc */
@@ -192,7 +192,7 @@ Tk_ItemType tkOvalType = {
     RectOvalCoords,		/* coordProc */
     DeleteRectOval,		/* deleteProc */
     DisplayRectOval,		/* displayProc */
-    TK_CONFIG_OBJS,		/* flags */
+    TK_CONFIG_OBJS | TK_CACHE_POSTSCRIPT,	/* flags */
     OvalToPoint,		/* pointProc */
     OvalToArea,			/* areaProc */
     RectOvalToPostscript,	/* postscriptProc */
@@ -627,6 +627,11 @@ ComputeRectOvalBbox(
     double dtmp, width;
     Tk_State state = rectOvalPtr->header.state;
 
+    if (TkCanvDeferBbox(canvas, &rectOvalPtr->header,
+	    (TkCanvBboxProc *) ComputeRectOvalBbox)) {
+	return;
+    }
+
     if (state == TK_STATE_NULL) {
 	state = Canvas(canvas)->canvas_state;
     }
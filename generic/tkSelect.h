@@ -104,6 +104,8 @@ typedef struct TkSelRetrievalInfo {
 typedef struct TkClipboardBuffer {
     char *buffer;		/* Null terminated data buffer. */
     long length;		/* Length of string in buffer. */
+    long offset;		/* Offset of the first byte of buffer within
+				 * the data for its target. */
     struct TkClipboardBuffer *nextPtr;
 				/* Next in list of buffers. NULL means end of
 				 * list . */
@@ -117,6 +119,24 @@ typedef struct TkClipboardTarget {
     TkClipboardBuffer *lastBufferPtr;
 				/* Last in list of clipboard buffers. Used to
 				 * speed up appends. */
+    TkClipboardBuffer **bufferIndex;
+				/* Malloc-ed array holding the buffers in list
+				 * order, so that the buffer containing a
+				 * given offset can be found without walking
+				 * the list. */
+    int numBuffers;		/* Number of buffers in bufferIndex. */
+    int indexSpace;		/* Number of entries allocated for
+				 * bufferIndex. */
+    int lastIndex;		/* Index of the buffer in which the last
+				 * retrieval ended. Retrievals proceed in
+				 * order, so the next one normally starts
+				 * there. */
+    long length;		/* Total number of bytes in all buffers. */
+    Tcl_Encoding encoding;	/* Encoding of encodedObj, or NULL if there
+				 * is no cached conversion. */
+    Tcl_Obj *encodedObj;	/* Byte array holding the whole of the data
+				 * converted to encoding, or NULL. Discarded
+				 * whenever more data is appended. */
     struct TkClipboardTarget *nextPtr;
 				/* Next in list of targets on clipboard. NULL
 				 * means end of list. */
@@ -159,6 +179,8 @@ MODULE_SCOPE void	TkSelClearSelection(Tk_Window tkwin, XEvent *eventPtr);
 MODULE_SCOPE int	TkSelDefaultSelection(TkSelectionInfo *infoPtr,
 			    Atom target, char *buffer, int maxBytes,
 			    Atom *typePtr);
+MODULE_SCOPE Tcl_Obj *	TkClipboardGetEncoded(TkSelHandler *selPtr,
+			    const char *encodingName);
 #ifndef TkSelUpdateClipboard
 MODULE_SCOPE void	TkSelUpdateClipboard(TkWindow *winPtr,
 			    TkClipboardTarget *targetPtr);
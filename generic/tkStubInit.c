@@ -467,6 +467,7 @@ static const TkIntStubs tkIntStubs = {
     TkUnderlineAngledTextLayout, /* 182 */
     TkIntersectAngledTextLayout, /* 183 */
     TkDrawAngledChars, /* 184 */
+    TkCanvasFromWindow, /* 185 */
 };
 
 static const TkIntPlatStubs tkIntPlatStubs = {
@@ -1145,6 +1146,10 @@ const TkStubs tkStubs = {
     Tk_Interp, /* 271 */
     Tk_CreateOldImageType, /* 272 */
     Tk_CreateOldPhotoImageFormat, /* 273 */
+    Tk_InternAtoms, /* 274 */
+    Tk_CanvasDecimatePath, /* 275 */
+    Tk_CanvasBeginBatch, /* 276 */
+    Tk_CanvasEndBatch, /* 277 */
 };
 
 /* !END!: Do not edit above this line. */
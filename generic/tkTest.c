@@ -22,8 +22,18 @@
 #   define USE_TK_STUBS
 #endif
 #include "tkInt.h"
+#include "tkSelect.h"
 #include "tkText.h"
 
+/*
+ * The text and canvas widgets use some of the same names for their flags;
+ * this file uses neither.
+ */
+
+#undef GOT_FOCUS
+#undef UPDATE_SCROLLBARS
+#include "tkCanvas.h"
+
 #ifdef _WIN32
 #include "tkWinInt.h"
 #endif
@@ -148,18 +158,30 @@ static int		TestbitmapObjCmd(ClientData dummy,
 static int		TestborderObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj * const objv[]);
+static int		TestcanvasbatchObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj * const objv[]);
+static int		TestclipcacheObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
 static int		TestcolorObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj * const objv[]);
 static int		TestcursorObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj * const objv[]);
+static int		TestdecimateObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj * const objv[]);
 static int		TestdeleteappsObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj * const objv[]);
 static int		TestfontObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
+static int		TestinternatomsObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
 static int		TestmakeexistObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -189,9 +211,18 @@ static void		CustomOptionRestore(ClientData clientData,
 			    char *saveInternalPtr);
 static void		CustomOptionFree(ClientData clientData,
 			    Tk_Window tkwin, char *internalPtr);
+static int		TestpathcacheObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj * const objv[]);
+static int		TestpsitemObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj * const objv[]);
 static int		TestpropObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj * const objv[]);
+static int		TestwindowlessObjCmd(ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj * const objv[]);
 #if !(defined(_WIN32) || defined(MAC_OSX_TK) || defined(__CYGWIN__))
 static int		TestwrapperObjCmd(ClientData dummy,
 			    Tcl_Interp *interp, int objc,
@@ -247,10 +278,16 @@ Tktest_Init(
 	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testborder", TestborderObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testcanvasbatch", TestcanvasbatchObjCmd,
+	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testclipcache", TestclipcacheObjCmd,
+	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testcolor", TestcolorObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testcursor", TestcursorObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testdecimate", TestdecimateObjCmd,
+	    NULL, NULL);
     Tcl_CreateObjCommand(interp, "testdeleteapps", TestdeleteappsObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testembed", TkpTestembedCmd,
@@ -259,12 +296,19 @@ Tktest_Init(
 	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testfont", TestfontObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testinternatoms", TestinternatomsObjCmd,
+	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testmakeexist", TestmakeexistObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testpathcache", TestpathcacheObjCmd,
+	    (ClientData) Tk_MainWindow(interp), NULL);
     Tcl_CreateObjCommand(interp, "testprop", TestpropObjCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testpsitem", TestpsitemObjCmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, "testtext", TkpTesttextCmd,
 	    (ClientData) Tk_MainWindow(interp), NULL);
+    Tcl_CreateObjCommand(interp, "testwindowless", TestwindowlessObjCmd,
+	    (ClientData) Tk_MainWindow(interp), NULL);
 
 #if defined(_WIN32) || defined(MAC_OSX_TK)
     Tcl_CreateObjCommand(interp, "testmetrics", TestmetricsObjCmd,
@@ -372,6 +416,56 @@ TestborderObjCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestclipcacheObjCmd --
+ *
+ *	This function implements the "testclipcache" command. It reports the
+ *	encoded copy of a clipboard target that TkClipboardGetEncoded keeps
+ *	for serving large transfers.
+ *
+ * Results:
+ *	A standard Tcl result. The interp's result is a list holding the name
+ *	of the encoding and the number of encoded bytes, or an empty list if
+ *	there is no encoded copy.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestclipcacheObjCmd(
+    ClientData clientData,	/* Main window for application. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    TkWindow *winPtr = clientData;
+    TkClipboardTarget *targetPtr;
+    Atom type;
+    int length;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "type");
+	return TCL_ERROR;
+    }
+    type = Tk_InternAtom((Tk_Window) winPtr, Tcl_GetString(objv[1]));
+    for (targetPtr = winPtr->dispPtr->clipTargetPtr; targetPtr != NULL;
+	    targetPtr = targetPtr->nextPtr) {
+	if ((targetPtr->type == type) && (targetPtr->encodedObj != NULL)) {
+	    Tcl_GetByteArrayFromObj(targetPtr->encodedObj, &length);
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s %d",
+		    Tcl_GetEncodingName(targetPtr->encoding), length));
+	    break;
+	}
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1639,6 +1733,224 @@ ImageDelete(
     ckfree(timPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestcanvasbatchObjCmd --
+ *
+ *	This function implements the "testcanvasbatch" command. It starts or
+ *	ends a batch of changes to a canvas with Tk_CanvasBeginBatch and
+ *	Tk_CanvasEndBatch, or returns the bounding box stored in an item
+ *	without bringing it up to date first.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestcanvasbatchObjCmd(
+    ClientData clientData,	/* Main window for application. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    static const char *const options[] = {
+	"begin", "end", "itembbox", NULL
+    };
+    enum option {BATCH_BEGIN, BATCH_END, BATCH_ITEMBBOX};
+    Tk_Window tkwin;
+    TkCanvas *canvasPtr;
+    Tk_Item *itemPtr;
+    int index, id;
+
+    if (objc < 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "pathName option ?id?");
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, Tcl_GetString(objv[1]), clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[2], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    canvasPtr = (TkCanvas *) TkCanvasFromWindow(tkwin);
+    if (canvasPtr == NULL) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("window \"%s\" isn't a canvas",
+		Tk_PathName(tkwin)));
+	return TCL_ERROR;
+    }
+    switch ((enum option) index) {
+    case BATCH_BEGIN:
+	Tk_CanvasBeginBatch(interp, tkwin);
+	break;
+    case BATCH_END:
+	if (canvasPtr->batchDepth < 1) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj("no batch to end", -1));
+	    return TCL_ERROR;
+	}
+	Tk_CanvasEndBatch((Tk_Canvas) canvasPtr);
+	break;
+    case BATCH_ITEMBBOX:
+	if (objc != 4) {
+	    Tcl_WrongNumArgs(interp, 3, objv, "id");
+	    return TCL_ERROR;
+	}
+	if (Tcl_GetIntFromObj(interp, objv[3], &id) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	for (itemPtr = canvasPtr->firstItemPtr; itemPtr != NULL;
+		itemPtr = itemPtr->nextPtr) {
+	    if (itemPtr->id == id) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d %d %d %d",
+			itemPtr->x1, itemPtr->y1, itemPtr->x2, itemPtr->y2));
+		break;
+	    }
+	}
+	break;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestdecimateObjCmd --
+ *
+ *	This function implements the "testdecimate" command. It passes a list
+ *	of canvas coordinates through Tk_CanvasDecimatePath.
+ *
+ * Results:
+ *	A standard Tcl result. The interpreter result is a list holding
+ *	whether the decimated path is sorted by x and the decimated
+ *	coordinates.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestdecimateObjCmd(
+    ClientData clientData,	/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tcl_Obj **coordObjs, *resultObj;
+    double *coordArr, *outArr;
+    int i, numCoords, numOutput, monotonic;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "coordList");
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[1], &numCoords,
+	    &coordObjs) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (numCoords & 1) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"odd number of coordinates", -1));
+	return TCL_ERROR;
+    }
+    coordArr = ckalloc((numCoords + 1) * sizeof(double));
+    outArr = ckalloc((numCoords + 1) * sizeof(double));
+    for (i = 0; i < numCoords; i++) {
+	if (Tcl_GetDoubleFromObj(interp, coordObjs[i],
+		&coordArr[i]) != TCL_OK) {
+	    ckfree(coordArr);
+	    ckfree(outArr);
+	    return TCL_ERROR;
+	}
+    }
+    numOutput = Tk_CanvasDecimatePath(numCoords / 2, coordArr, outArr,
+	    &monotonic);
+    resultObj = Tcl_NewListObj(0, NULL);
+    for (i = 0; i < 2 * numOutput; i++) {
+	Tcl_ListObjAppendElement(NULL, resultObj,
+		Tcl_NewDoubleObj(outArr[i]));
+    }
+    ckfree(coordArr);
+    ckfree(outArr);
+    Tcl_SetObjResult(interp, Tcl_NewListObj(0, NULL));
+    Tcl_ListObjAppendElement(NULL, Tcl_GetObjResult(interp),
+	    Tcl_NewIntObj(monotonic));
+    Tcl_ListObjAppendElement(NULL, Tcl_GetObjResult(interp), resultObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestinternatomsObjCmd --
+ *
+ *	This function implements the "testinternatoms" command. It interns all
+ *	its arguments with a single call to Tk_InternAtoms and checks each
+ *	atom against the one Tk_InternAtom gives for the same name.
+ *
+ * Results:
+ *	A standard Tcl result. On success, the interp's result is the list of
+ *	atoms, in the order of the names.
+ *
+ * Side effects:
+ *	The names are added to the local atom cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestinternatomsObjCmd(
+    ClientData clientData,	/* Main window for application. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tk_Window mainWin = (Tk_Window) clientData;
+    const char **names;
+    Atom *atoms, atom;
+    Tcl_Obj *resultObj;
+    int i, code = TCL_OK;
+
+    names = ckalloc(objc * sizeof(char *));
+    atoms = ckalloc(objc * sizeof(Atom));
+    for (i = 1; i < objc; i++) {
+	names[i - 1] = Tcl_GetString(objv[i]);
+    }
+    Tk_InternAtoms(mainWin, objc - 1, names, atoms);
+
+    resultObj = Tcl_NewObj();
+    for (i = 0; i < objc - 1; i++) {
+	atom = Tk_InternAtom(mainWin, names[i]);
+	if (atom != atoms[i]) {
+	    Tcl_DecrRefCount(resultObj);
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "Tk_InternAtoms gave %lu for \"%s\", Tk_InternAtom gave %lu",
+		    (unsigned long) atoms[i], names[i], (unsigned long) atom));
+	    code = TCL_ERROR;
+	    break;
+	}
+	Tcl_ListObjAppendElement(NULL, resultObj,
+		Tcl_NewLongObj((long) atoms[i]));
+    }
+    if (code == TCL_OK) {
+	Tcl_SetObjResult(interp, resultObj);
+    }
+    ckfree(names);
+    ckfree(atoms);
+    return code;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1819,6 +2131,57 @@ TestmetricsObjCmd(
 }
 #endif
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestpathcacheObjCmd --
+ *
+ *	This function implements the "testpathcache" command. It returns how
+ *	often a canvas has filled the screen coordinate caches of its line and
+ *	polygon items, how often it has redrawn them from those caches, how
+ *	many line segments it has drawn in batches, and how many
+ *	XDrawSegments calls those took.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestpathcacheObjCmd(
+    ClientData clientData,	/* Main window for application. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tk_Window tkwin;
+    TkCanvas *canvasPtr;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "pathName");
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, Tcl_GetString(objv[1]), clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    canvasPtr = (TkCanvas *) TkCanvasFromWindow(tkwin);
+    if (canvasPtr == NULL) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("window \"%s\" isn't a canvas",
+		Tk_PathName(tkwin)));
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d %d %d %d",
+	    canvasPtr->pathCacheFills, canvasPtr->pathCacheHits,
+	    canvasPtr->segmentsDrawn, canvasPtr->segmentBatches));
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1895,7 +2258,124 @@ TestpropObjCmd(
     }
     return TCL_OK;
 }
+
+/*
+ * The "psrect" canvas item type is a copy of the rectangle type that counts
+ * how often its Postscript is generated, so the tests can tell whether the
+ * canvas reused Postscript it generated earlier.
+ */
+
+static Tk_ItemType psRectType;
+static Tk_ItemPostscriptProc *rectPostscriptProc;
+static int psRectCalls = 0;
+
+static int
+PsRectPostscript(
+    Tcl_Interp *interp,
+    Tk_Canvas canvas,
+    Tk_Item *itemPtr,
+    int prepass)
+{
+    psRectCalls++;
+    return rectPostscriptProc(interp, canvas, itemPtr, prepass);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestpsitemObjCmd --
+ *
+ *	This function implements the "testpsitem" command. It creates the
+ *	"psrect" canvas item type the first time it is called.
+ *
+ * Results:
+ *	A standard Tcl result. The interpreter result is the number of times
+ *	Postscript has been generated for psrect items so far.
+ *
+ * Side effects:
+ *	May create a canvas item type.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestpsitemObjCmd(
+    ClientData clientData,	/* Not used. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tk_ItemType *typePtr;
+
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, "");
+	return TCL_ERROR;
+    }
+    if (psRectType.name == NULL) {
+	for (typePtr = Tk_GetItemTypes(); typePtr != NULL;
+		typePtr = typePtr->nextPtr) {
+	    if (strcmp(typePtr->name, "rectangle") == 0) {
+		break;
+	    }
+	}
+	if (typePtr == NULL) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "no rectangle item type", -1));
+	    return TCL_ERROR;
+	}
+	psRectType = *typePtr;
+	psRectType.name = "psrect";
+	rectPostscriptProc = typePtr->postscriptProc;
+	psRectType.postscriptProc = PsRectPostscript;
+	Tk_CreateItemType(&psRectType);
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(psRectCalls));
+    return TCL_OK;
+}
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestwindowlessObjCmd --
+ *
+ *	This function implements the "testwindowless" command. It returns
+ *	whether a window is still windowless and whether it has an X window,
+ *	without making the window exist as "winfo id" would.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static int
+TestwindowlessObjCmd(
+    ClientData clientData,	/* Main window for application. */
+    Tcl_Interp *interp,		/* Current interpreter. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const objv[])	/* Argument objects. */
+{
+    Tk_Window tkwin;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "pathName");
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, Tcl_GetString(objv[1]), clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf("%d %d",
+	    (((TkWindow *) tkwin)->flags & TK_WINDOWLESS) != 0,
+	    Tk_WindowId(tkwin) != None));
+    return TCL_OK;
+}
+
 #if !(defined(_WIN32) || defined(MAC_OSX_TK) || defined(__CYGWIN__))
 /*
  *----------------------------------------------------------------------
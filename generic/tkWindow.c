@@ -53,6 +53,15 @@ typedef struct ThreadSpecificData {
 } ThreadSpecificData;
 static Tcl_ThreadDataKey dataKey;
 
+/*
+ * A windowless window (see TkSetWindowless) has no X window of its own while
+ * it is mapped; its widget draws it into its parent's window.
+ */
+
+#define DRAWN_IN_PARENT(winPtr) \
+    (((winPtr)->window == None) && (((winPtr)->flags \
+	    & (TK_WINDOWLESS|TK_MAPPED)) == (TK_WINDOWLESS|TK_MAPPED)))
+
 /*
  * Default values for "changes" and "atts" fields of TkWindows. Note that Tk
  * always requests all events for all windows, except StructureNotify events
@@ -210,9 +219,18 @@ static void		DeleteWindowsExitProc(ClientData clientData);
 static TkDisplay *	GetScreen(Tcl_Interp *interp, const char *screenName,
 			    int *screenPtr);
 static int		Initialize(Tcl_Interp *interp);
+static void		AddStartupTime(Tcl_Obj *timesObj, const char *stage,
+			    Tcl_Time *lastPtr);
 static int		NameWindow(Tcl_Interp *interp, TkWindow *winPtr,
 			    TkWindow *parentPtr, const char *name);
 static void		UnlinkWindow(TkWindow *winPtr);
+static int		CanDrawInParent(TkWindow *winPtr);
+static void		ExposeWindowless(TkWindow *winPtr);
+static void		HandleWindowEvent(TkWindow *winPtr, XEvent *eventPtr);
+static void		WindowlessParentProc(ClientData clientData,
+			    XEvent *eventPtr);
+static void		WindowlessCrossing(TkWindow *winPtr, int type,
+			    XEvent *eventPtr, int x, int y);
 
 /*
  *----------------------------------------------------------------------
@@ -896,6 +914,7 @@ TkCreateMainWindow(
     Tcl_SetHashValue(hPtr, winPtr);
     winPtr->pathName = Tcl_GetHashKey(&mainPtr->nameTable, hPtr);
     Tcl_InitHashTable(&mainPtr->busyTable, TCL_ONE_WORD_KEYS);
+    mainPtr->startupTimes = NULL;
 
     /*
      * We have just created another Tk application; increment the refcount on
@@ -1362,10 +1381,11 @@ Tk_DestroyWindow(
     }
 
     /*
-     * Generate a DestroyNotify event. In order for the DestroyNotify event to
-     * be processed correctly, need to make sure the window exists. This is a
-     * bit of a kludge, and may be unnecessarily expensive, but without it no
-     * event handlers will get called for windows that don't exist yet.
+     * Generate a DestroyNotify event. A window that was never made to exist
+     * gets it dispatched directly rather than through its (None) X window,
+     * so tearing down a subtree that was never displayed costs no server
+     * round trips. Top-level windows are still made to exist, since the
+     * window manager code expects them to have a window.
      *
      * Note: if the window's pathName is NULL and the window is not an
      * anonymous window, it means that the window was not successfully
@@ -1377,7 +1397,7 @@ Tk_DestroyWindow(
 	    winPtr->pathName != NULL &&
 	    !(winPtr->flags & TK_ANONYMOUS_WINDOW)) {
 	halfdeadPtr->flags |= HD_DESTROY_EVENT;
-	if (winPtr->window == None) {
+	if ((winPtr->window == None) && (winPtr->flags & TK_TOP_HIERARCHY)) {
 	    Tk_MakeWindowExist(tkwin);
 	}
 	event.type = DestroyNotify;
@@ -1387,7 +1407,7 @@ Tk_DestroyWindow(
 	event.xdestroywindow.display = winPtr->display;
 	event.xdestroywindow.event = winPtr->window;
 	event.xdestroywindow.window = winPtr->window;
-	Tk_HandleEvent(&event);
+	HandleWindowEvent(winPtr, &event);
     }
 
     /*
@@ -1424,6 +1444,7 @@ Tk_DestroyWindow(
 	TkWmRemoveFromColormapWindows(winPtr);
     }
     if (winPtr->window != None) {
+	TkCancelWindowChanges(winPtr);
 #if defined(MAC_OSX_TK) || defined(_WIN32)
 	XDestroyWindow(winPtr->display, winPtr->window);
 #else
@@ -1442,6 +1463,15 @@ Tk_DestroyWindow(
 	Tcl_DeleteHashEntry(Tcl_FindHashEntry(&dispPtr->winTable,
 		(char *) winPtr->window));
 	winPtr->window = None;
+    } else if (winPtr->flags & TK_MAPPED) {
+	/*
+	 * A windowless window: have its parent repaint the area.
+	 */
+
+	ExposeWindowless(winPtr);
+    }
+    if (dispPtr->windowlessWinPtr == winPtr) {
+	dispPtr->windowlessWinPtr = NULL;
     }
     UnlinkWindow(winPtr);
     TkEventDeadWindow(winPtr);
@@ -1464,6 +1494,17 @@ Tk_DestroyWindow(
     }
     if (winPtr->mainPtr != NULL) {
 	if (winPtr->pathName != NULL) {
+	    /*
+	     * The bindings and the name of each window are removed as the
+	     * window goes, rather than in one sweep per destroyed subtree.
+	     * Both lookups are direct hash probes, under a microsecond per
+	     * window, while a sweep would have to scan every bound object of
+	     * the application. Deferring them is also unsafe: bindings are
+	     * keyed by the name table's copy of the path name, which is
+	     * freed with the name table entry and may be reused by a window
+	     * created from a Destroy binding.
+	     */
+
 	    Tk_DeleteAllBindings(winPtr->mainPtr->bindingTable,
 		    winPtr->pathName);
 	    Tcl_DeleteHashEntry(Tcl_FindHashEntry(&winPtr->mainPtr->nameTable,
@@ -1512,6 +1553,9 @@ Tk_DestroyWindow(
 	    }
 
 	    Tcl_DeleteHashTable(&winPtr->mainPtr->busyTable);
+	    if (winPtr->mainPtr->startupTimes != NULL) {
+		Tcl_DecrRefCount(winPtr->mainPtr->startupTimes);
+	    }
 	    Tcl_DeleteHashTable(&winPtr->mainPtr->nameTable);
 	    TkBindFree(winPtr->mainPtr);
 	    TkDeleteAllImages(winPtr->mainPtr);
@@ -1617,7 +1661,8 @@ Tk_MapWindow(
     if (winPtr->flags & TK_MAPPED) {
 	return;
     }
-    if (winPtr->window == None) {
+    if ((winPtr->window == None) && !((winPtr->flags & TK_WINDOWLESS)
+	    && CanDrawInParent(winPtr))) {
 	Tk_MakeWindowExist(tkwin);
     }
     /*
@@ -1637,7 +1682,11 @@ Tk_MapWindow(
 	return;
     }
     winPtr->flags |= TK_MAPPED;
-    XMapWindow(winPtr->display, winPtr->window);
+    if (winPtr->window == None) {
+	ExposeWindowless(winPtr);
+    } else if (!TkDeferWindowMap(winPtr)) {
+	XMapWindow(winPtr->display, winPtr->window);
+    }
     event.type = MapNotify;
     event.xmap.serial = LastKnownRequestProcessed(winPtr->display);
     event.xmap.send_event = False;
@@ -1645,7 +1694,7 @@ Tk_MapWindow(
     event.xmap.event = winPtr->window;
     event.xmap.window = winPtr->window;
     event.xmap.override_redirect = winPtr->atts.override_redirect;
-    Tk_HandleEvent(&event);
+    HandleWindowEvent(winPtr, &event);
 }
 
 /*
@@ -1755,6 +1804,24 @@ Tk_MakeWindowExist(
 	winPtr->flags &= ~TK_NEED_CONFIG_NOTIFY;
 	TkDoConfigureNotify(winPtr);
     }
+
+    /*
+     * A windowless window that needs an X window after all becomes an
+     * ordinary window, mapped if it was drawn in its parent.
+     */
+
+    if (winPtr->flags & TK_WINDOWLESS) {
+	winPtr->flags &= ~TK_WINDOWLESS;
+	if (winPtr->dispPtr->windowlessWinPtr == winPtr) {
+	    winPtr->dispPtr->windowlessWinPtr = NULL;
+	    XDefineCursor(winPtr->display, winPtr->parentPtr->window,
+		    winPtr->parentPtr->atts.cursor);
+	}
+	if ((winPtr->flags & TK_MAPPED)
+		&& !(winPtr->flags & TK_ALREADY_DEAD)) {
+	    XMapWindow(winPtr->display, winPtr->window);
+	}
+    }
 }
 
 /*
@@ -1796,7 +1863,11 @@ Tk_UnmapWindow(
 	return;
     }
     winPtr->flags &= ~TK_MAPPED;
-    XUnmapWindow(winPtr->display, winPtr->window);
+    if (winPtr->window == None) {
+	ExposeWindowless(winPtr);
+    } else if (!TkCancelWindowMap(winPtr)) {
+	XUnmapWindow(winPtr->display, winPtr->window);
+    }
     if (!(winPtr->flags & TK_TOP_HIERARCHY)) {
 	XEvent event;
 
@@ -1807,7 +1878,7 @@ Tk_UnmapWindow(
 	event.xunmap.event = winPtr->window;
 	event.xunmap.window = winPtr->window;
 	event.xunmap.from_configure = False;
-	Tk_HandleEvent(&event);
+	HandleWindowEvent(winPtr, &event);
     }
 }
 
@@ -1820,6 +1891,9 @@ Tk_ConfigureWindow(
 {
     register TkWindow *winPtr = (TkWindow *) tkwin;
 
+    if (DRAWN_IN_PARENT(winPtr)) {
+	ExposeWindowless(winPtr);
+    }
     if (valueMask & CWX) {
 	winPtr->changes.x = valuePtr->x;
     }
@@ -1840,12 +1914,18 @@ Tk_ConfigureWindow(
     }
 
     if (winPtr->window != None) {
-	XConfigureWindow(winPtr->display, winPtr->window,
-		valueMask, valuePtr);
+	if (!TkDeferWindowChanges(winPtr, valueMask)) {
+	    XConfigureWindow(winPtr->display, winPtr->window,
+		    valueMask, valuePtr);
+	}
 	TkDoConfigureNotify(winPtr);
     } else {
 	winPtr->dirtyChanges |= valueMask;
 	winPtr->flags |= TK_NEED_CONFIG_NOTIFY;
+	if (DRAWN_IN_PARENT(winPtr)) {
+	    ExposeWindowless(winPtr);
+	    TkDoConfigureNotify(winPtr);
+	}
     }
 }
 
@@ -1856,14 +1936,23 @@ Tk_MoveWindow(
 {
     register TkWindow *winPtr = (TkWindow *) tkwin;
 
+    if (DRAWN_IN_PARENT(winPtr)) {
+	ExposeWindowless(winPtr);
+    }
     winPtr->changes.x = x;
     winPtr->changes.y = y;
     if (winPtr->window != None) {
-	XMoveWindow(winPtr->display, winPtr->window, x, y);
+	if (!TkDeferWindowChanges(winPtr, CWX|CWY)) {
+	    XMoveWindow(winPtr->display, winPtr->window, x, y);
+	}
 	TkDoConfigureNotify(winPtr);
     } else {
 	winPtr->dirtyChanges |= CWX|CWY;
 	winPtr->flags |= TK_NEED_CONFIG_NOTIFY;
+	if (DRAWN_IN_PARENT(winPtr)) {
+	    ExposeWindowless(winPtr);
+	    TkDoConfigureNotify(winPtr);
+	}
     }
 }
 
@@ -1874,15 +1963,24 @@ Tk_ResizeWindow(
 {
     register TkWindow *winPtr = (TkWindow *) tkwin;
 
+    if (DRAWN_IN_PARENT(winPtr)) {
+	ExposeWindowless(winPtr);
+    }
     winPtr->changes.width = (unsigned) width;
     winPtr->changes.height = (unsigned) height;
     if (winPtr->window != None) {
-	XResizeWindow(winPtr->display, winPtr->window, (unsigned) width,
-		(unsigned) height);
+	if (!TkDeferWindowChanges(winPtr, CWWidth|CWHeight)) {
+	    XResizeWindow(winPtr->display, winPtr->window, (unsigned) width,
+		    (unsigned) height);
+	}
 	TkDoConfigureNotify(winPtr);
     } else {
 	winPtr->dirtyChanges |= CWWidth|CWHeight;
 	winPtr->flags |= TK_NEED_CONFIG_NOTIFY;
+	if (DRAWN_IN_PARENT(winPtr)) {
+	    ExposeWindowless(winPtr);
+	    TkDoConfigureNotify(winPtr);
+	}
     }
 }
 
@@ -1894,17 +1992,26 @@ Tk_MoveResizeWindow(
 {
     register TkWindow *winPtr = (TkWindow *) tkwin;
 
+    if (DRAWN_IN_PARENT(winPtr)) {
+	ExposeWindowless(winPtr);
+    }
     winPtr->changes.x = x;
     winPtr->changes.y = y;
     winPtr->changes.width = (unsigned) width;
     winPtr->changes.height = (unsigned) height;
     if (winPtr->window != None) {
-	XMoveResizeWindow(winPtr->display, winPtr->window, x, y,
-		(unsigned) width, (unsigned) height);
+	if (!TkDeferWindowChanges(winPtr, CWX|CWY|CWWidth|CWHeight)) {
+	    XMoveResizeWindow(winPtr->display, winPtr->window, x, y,
+		    (unsigned) width, (unsigned) height);
+	}
 	TkDoConfigureNotify(winPtr);
     } else {
 	winPtr->dirtyChanges |= CWX|CWY|CWWidth|CWHeight;
 	winPtr->flags |= TK_NEED_CONFIG_NOTIFY;
+	if (DRAWN_IN_PARENT(winPtr)) {
+	    ExposeWindowless(winPtr);
+	    TkDoConfigureNotify(winPtr);
+	}
     }
 }
 
@@ -1915,14 +2022,23 @@ Tk_SetWindowBorderWidth(
 {
     register TkWindow *winPtr = (TkWindow *) tkwin;
 
+    if (DRAWN_IN_PARENT(winPtr)) {
+	ExposeWindowless(winPtr);
+    }
     winPtr->changes.border_width = width;
     if (winPtr->window != None) {
-	XSetWindowBorderWidth(winPtr->display, winPtr->window,
-		(unsigned) width);
+	if (!TkDeferWindowChanges(winPtr, CWBorderWidth)) {
+	    XSetWindowBorderWidth(winPtr->display, winPtr->window,
+		    (unsigned) width);
+	}
 	TkDoConfigureNotify(winPtr);
     } else {
 	winPtr->dirtyChanges |= CWBorderWidth;
 	winPtr->flags |= TK_NEED_CONFIG_NOTIFY;
+	if (DRAWN_IN_PARENT(winPtr)) {
+	    ExposeWindowless(winPtr);
+	    TkDoConfigureNotify(winPtr);
+	}
     }
 }
 
@@ -2079,6 +2195,11 @@ Tk_DefineCursor(
 	XDefineCursor(winPtr->display, winPtr->window, winPtr->atts.cursor);
     } else {
 	winPtr->dirtyAtts = winPtr->dirtyAtts | CWCursor;
+	if (winPtr->dispPtr->windowlessWinPtr == winPtr) {
+	    XDefineCursor(winPtr->display, winPtr->parentPtr->window,
+		    (winPtr->atts.cursor != None) ? winPtr->atts.cursor
+		    : winPtr->parentPtr->atts.cursor);
+	}
     }
 }
 
@@ -2201,9 +2322,524 @@ TkDoConfigureNotify(
 	event.xconfigure.above = None;
     }
     event.xconfigure.override_redirect = winPtr->atts.override_redirect;
-    Tk_HandleEvent(&event);
+    HandleWindowEvent(winPtr, &event);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkSetWindowless --
+ *
+ *	Marks a window that has not been made to exist yet as windowless.
+ *	Such a window gets no X window when it is mapped: its widget draws it
+ *	into its parent's window (see TkGetWindowDrawable), Tk synthesizes its
+ *	structure events and its parent's exposures are forwarded to it. It
+ *	does not receive input events, which go to the parent instead. The
+ *	window becomes an ordinary one as soon as something needs its X
+ *	window, for instance "winfo id", a child window or a grab. Only the
+ *	X11 port supports windowless windows; elsewhere this does nothing.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the TK_WINDOWLESS flag.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkSetWindowless(
+    Tk_Window tkwin)		/* Window that has no X window yet. */
+{
+#if !defined(_WIN32) && !defined(MAC_OSX_TK)
+    TkWindow *winPtr = (TkWindow *) tkwin;
+
+    if ((winPtr->window == None) && !(winPtr->flags & TK_TOP_HIERARCHY)) {
+	winPtr->flags |= TK_WINDOWLESS;
+    }
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkAllowWindowless --
+ *
+ *	Called by widgets that call TkRedrawWindowless whenever they have
+ *	repainted their window, such as frames and ttk widgets, to let the
+ *	windowless children of their window be drawn in it. The children of
+ *	other widgets get X windows of their own, since nothing would draw
+ *	them again after their parent repaints.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the TK_WINDOWLESS_PARENT flag.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkAllowWindowless(
+    Tk_Window tkwin)		/* Window of the widget. */
+{
+    ((TkWindow *) tkwin)->flags |= TK_WINDOWLESS_PARENT;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkGetWindowDrawable --
+ *
+ *	Returns where a widget must draw the contents of its window.
+ *
+ * Results:
+ *	The window's own X window, with *xPtr and *yPtr set to 0, or, for a
+ *	windowless window drawn in its parent, the parent's X window, with
+ *	*xPtr and *yPtr set to the position of the window's inside in it.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Drawable
+TkGetWindowDrawable(
+    Tk_Window tkwin,		/* Window to draw. */
+    int *xPtr, int *yPtr)	/* Returns the offset to draw at. */
+{
+    TkWindow *winPtr = (TkWindow *) tkwin;
+
+    if (DRAWN_IN_PARENT(winPtr)) {
+	*xPtr = winPtr->changes.x + winPtr->changes.border_width;
+	*yPtr = winPtr->changes.y + winPtr->changes.border_width;
+	return winPtr->parentPtr->window;
+    }
+    *xPtr = *yPtr = 0;
+    return winPtr->window;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkRedrawWindowless --
+ *
+ *	Called by widgets after they have repainted their whole window, which
+ *	may have painted over windowless children.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Every windowless child drawn in the window is sent an Expose event.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkRedrawWindowless(
+    Tk_Window tkwin)		/* Window that was repainted. */
+{
+    TkWindow *winPtr = (TkWindow *) tkwin;
+    XEvent event;
+
+    if (!(winPtr->flags & TK_HAS_WINDOWLESS) || (winPtr->window == None)) {
+	return;
+    }
+    memset(&event, 0, sizeof(event));
+    event.type = Expose;
+    event.xexpose.serial = LastKnownRequestProcessed(winPtr->display);
+    event.xexpose.display = winPtr->display;
+    event.xexpose.window = winPtr->window;
+    event.xexpose.width = winPtr->changes.width;
+    event.xexpose.height = winPtr->changes.height;
+    WindowlessParentProc(winPtr, &event);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CanDrawInParent --
+ *
+ *	Called when a windowless window is about to be mapped, to check that
+ *	it can be drawn into its parent's window.
+ *
+ * Results:
+ *	1 if the parent's widget redraws windowless children (see
+ *	TkAllowWindowless) and the parent's X window exists and has the
+ *	window's visual and depth, 0 otherwise.
+ *
+ * Side effects:
+ *	The first time, arranges for the parent's exposures to be forwarded
+ *	to its windowless children.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CanDrawInParent(
+    TkWindow *winPtr)		/* Windowless window. */
+{
+    TkWindow *parentPtr = winPtr->parentPtr;
+
+    if ((parentPtr == NULL) || (parentPtr->window == None)
+	    || !(parentPtr->flags & TK_WINDOWLESS_PARENT)
+	    || (winPtr->flags & TK_TOP_HIERARCHY)
+	    || (winPtr->depth != parentPtr->depth)
+	    || (winPtr->visual != parentPtr->visual)) {
+	return 0;
+    }
+    if (!(parentPtr->flags & TK_HAS_WINDOWLESS)) {
+	parentPtr->flags |= TK_HAS_WINDOWLESS;
+	Tk_CreateEventHandler((Tk_Window) parentPtr, ExposureMask,
+		WindowlessParentProc, parentPtr);
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExposeWindowless --
+ *
+ *	Called when a windowless window drawn in its parent is mapped,
+ *	unmapped, moved, resized or destroyed, to have the parent repaint the
+ *	area the window covers (before the change, or after it).
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The area is cleared and the server sends Expose events for it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ExposeWindowless(
+    TkWindow *winPtr)		/* Windowless window. */
+{
+    TkWindow *parentPtr = winPtr->parentPtr;
+
+    if ((parentPtr == NULL) || (parentPtr->window == None)
+	    || (parentPtr->flags & TK_ALREADY_DEAD)) {
+	return;
+    }
+    XClearArea(winPtr->display, parentPtr->window, winPtr->changes.x,
+	    winPtr->changes.y,
+	    winPtr->changes.width + 2 * winPtr->changes.border_width,
+	    winPtr->changes.height + 2 * winPtr->changes.border_width, True);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WindowlessParentProc --
+ *
+ *	Event handler for the parents of windowless windows, which forwards
+ *	Expose events to the windowless children they intersect.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Expose events, in the children's coordinates, are dispatched to the
+ *	children.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WindowlessParentProc(
+    ClientData clientData,	/* Parent window. */
+    XEvent *eventPtr)		/* Expose event for the parent. */
+{
+    TkWindow *parentPtr = clientData, *childPtr, *nextPtr;
+    XEvent event;
+    int x1, y1, x2, y2, bw;
+
+    if (eventPtr->type != Expose) {
+	return;
+    }
+    for (childPtr = parentPtr->childList; childPtr != NULL;
+	    childPtr = nextPtr) {
+	nextPtr = childPtr->nextPtr;
+	if (!DRAWN_IN_PARENT(childPtr)
+		|| (childPtr->flags & TK_ALREADY_DEAD)) {
+	    continue;
+	}
+	bw = childPtr->changes.border_width;
+	x1 = childPtr->changes.x + bw;
+	y1 = childPtr->changes.y + bw;
+	x2 = x1 + childPtr->changes.width;
+	y2 = y1 + childPtr->changes.height;
+	if (x1 < eventPtr->xexpose.x) {
+	    x1 = eventPtr->xexpose.x;
+	}
+	if (y1 < eventPtr->xexpose.y) {
+	    y1 = eventPtr->xexpose.y;
+	}
+	if (x2 > eventPtr->xexpose.x + eventPtr->xexpose.width) {
+	    x2 = eventPtr->xexpose.x + eventPtr->xexpose.width;
+	}
+	if (y2 > eventPtr->xexpose.y + eventPtr->xexpose.height) {
+	    y2 = eventPtr->xexpose.y + eventPtr->xexpose.height;
+	}
+	if ((x1 >= x2) || (y1 >= y2)) {
+	    continue;
+	}
+	event = *eventPtr;
+	event.xexpose.window = None;
+	event.xexpose.x = x1 - childPtr->changes.x - bw;
+	event.xexpose.y = y1 - childPtr->changes.y - bw;
+	event.xexpose.width = x2 - x1;
+	event.xexpose.height = y2 - y1;
+	event.xexpose.count = 0;
+	Tcl_Preserve(childPtr);
+	TkHandleWindowlessEvent(childPtr, &event);
+	nextPtr = childPtr->nextPtr;
+	Tcl_Release(childPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkWindowlessPointerEvent --
+ *
+ *	Called by Tk_HandleEvent for the pointer events of a window that has
+ *	windowless children, once grabs have been taken into account, to find
+ *	out whether the event belongs to one of the children. A button press,
+ *	release or motion over a child goes to the child instead; while a
+ *	button is down, events keep going to the child it was pressed in, as
+ *	the server would do for a window of its own. Enter and Leave events
+ *	are synthesized for the children as the pointer moves in and out of
+ *	them, and the parent shows the cursor of the child the pointer is in.
+ *
+ * Results:
+ *	1 if the event was dispatched to a windowless child, in which case
+ *	the parent must not process it, or 0 otherwise.
+ *
+ * Side effects:
+ *	Events, with coordinates relative to the child, are dispatched to
+ *	windowless children, and the parent's cursor may change.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkWindowlessPointerEvent(
+    TkWindow *parentPtr,	/* Window the event was reported to. */
+    XEvent *eventPtr)		/* Pointer event. */
+{
+    TkDisplay *dispPtr = parentPtr->dispPtr;
+    TkWindow *childPtr, *hitPtr, *curPtr = dispPtr->windowlessWinPtr;
+    XEvent event;
+    int x, y, bw;
+    unsigned int state;
+
+    switch (eventPtr->type) {
+    case ButtonPress:
+    case ButtonRelease:
+	x = eventPtr->xbutton.x;
+	y = eventPtr->xbutton.y;
+	state = eventPtr->xbutton.state;
+	break;
+    case MotionNotify:
+	x = eventPtr->xmotion.x;
+	y = eventPtr->xmotion.y;
+	state = eventPtr->xmotion.state;
+	break;
+    case EnterNotify:
+    case LeaveNotify:
+	x = eventPtr->xcrossing.x;
+	y = eventPtr->xcrossing.y;
+	state = eventPtr->xcrossing.state;
+	break;
+    default:
+	return 0;
+    }
+    if ((curPtr != NULL) && (curPtr->parentPtr != parentPtr)) {
+	curPtr = NULL;
+    }
+
+    /*
+     * Find the child the event is for: the topmost one under the pointer
+     * (the last in the list), or the one a button was pressed in.
+     */
+
+    hitPtr = NULL;
+    if (eventPtr->type == LeaveNotify) {
+	/*
+	 * The pointer left the parent, or went into one of its real
+	 * children.
+	 */
+    } else if ((curPtr != NULL) && (state & (Button1Mask|Button2Mask
+	    |Button3Mask|Button4Mask|Button5Mask))
+	    && (eventPtr->type != ButtonPress)) {
+	hitPtr = curPtr;
+    } else {
+	for (childPtr = parentPtr->childList; childPtr != NULL;
+		childPtr = childPtr->nextPtr) {
+	    if (!DRAWN_IN_PARENT(childPtr)
+		    || (childPtr->flags & TK_ALREADY_DEAD)) {
+		continue;
+	    }
+	    bw = childPtr->changes.border_width;
+	    if ((x >= childPtr->changes.x) && (y >= childPtr->changes.y)
+		    && (x < childPtr->changes.x + childPtr->changes.width
+			+ 2*bw)
+		    && (y < childPtr->changes.y + childPtr->changes.height
+			+ 2*bw)) {
+		hitPtr = childPtr;
+	    }
+	}
+    }
+
+    if (hitPtr != curPtr) {
+	if (curPtr != NULL) {
+	    WindowlessCrossing(curPtr, LeaveNotify, eventPtr, x, y);
+	}
+	dispPtr->windowlessWinPtr = hitPtr;
+	if ((hitPtr != NULL) && !(hitPtr->flags & TK_ALREADY_DEAD)) {
+	    WindowlessCrossing(hitPtr, EnterNotify, eventPtr, x, y);
+	}
+	if ((dispPtr->windowlessWinPtr != NULL)
+		&& (dispPtr->windowlessWinPtr->atts.cursor != None)) {
+	    XDefineCursor(parentPtr->display, parentPtr->window,
+		    dispPtr->windowlessWinPtr->atts.cursor);
+	} else {
+	    XDefineCursor(parentPtr->display, parentPtr->window,
+		    parentPtr->atts.cursor);
+	}
+    }
+    hitPtr = dispPtr->windowlessWinPtr;
+    if ((hitPtr == NULL) || (eventPtr->type == EnterNotify)
+	    || (eventPtr->type == LeaveNotify)) {
+	return 0;
+    }
+
+    bw = hitPtr->changes.border_width;
+    event = *eventPtr;
+    if (event.type == MotionNotify) {
+	event.xmotion.window = None;
+	event.xmotion.subwindow = None;
+	event.xmotion.x = x - hitPtr->changes.x - bw;
+	event.xmotion.y = y - hitPtr->changes.y - bw;
+    } else {
+	event.xbutton.window = None;
+	event.xbutton.subwindow = None;
+	event.xbutton.x = x - hitPtr->changes.x - bw;
+	event.xbutton.y = y - hitPtr->changes.y - bw;
+    }
+    Tcl_Preserve(hitPtr);
+    TkHandleWindowlessEvent(hitPtr, &event);
+    Tcl_Release(hitPtr);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WindowlessCrossing --
+ *
+ *	Synthesizes an Enter or Leave event for a windowless window as the
+ *	pointer moves in or out of it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The event is dispatched to the window.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WindowlessCrossing(
+    TkWindow *winPtr,		/* Windowless window. */
+    int type,			/* EnterNotify or LeaveNotify. */
+    XEvent *eventPtr,		/* Pointer event for its parent. */
+    int x, int y)		/* Pointer position in the parent. */
+{
+    XEvent event;
+    int bw = winPtr->changes.border_width;
+
+    memset(&event, 0, sizeof(XEvent));
+    event.xcrossing.type = type;
+    event.xcrossing.serial = eventPtr->xany.serial;
+    event.xcrossing.send_event = eventPtr->xany.send_event;
+    event.xcrossing.display = winPtr->display;
+    event.xcrossing.window = None;
+    event.xcrossing.subwindow = None;
+    event.xcrossing.x = x - winPtr->changes.x - bw;
+    event.xcrossing.y = y - winPtr->changes.y - bw;
+    event.xcrossing.mode = NotifyNormal;
+    event.xcrossing.detail = NotifyAncestor;
+    event.xcrossing.same_screen = True;
+    switch (eventPtr->type) {
+    case ButtonPress:
+    case ButtonRelease:
+	event.xcrossing.root = eventPtr->xbutton.root;
+	event.xcrossing.time = eventPtr->xbutton.time;
+	event.xcrossing.x_root = eventPtr->xbutton.x_root;
+	event.xcrossing.y_root = eventPtr->xbutton.y_root;
+	event.xcrossing.state = eventPtr->xbutton.state;
+	break;
+    case MotionNotify:
+	event.xcrossing.root = eventPtr->xmotion.root;
+	event.xcrossing.time = eventPtr->xmotion.time;
+	event.xcrossing.x_root = eventPtr->xmotion.x_root;
+	event.xcrossing.y_root = eventPtr->xmotion.y_root;
+	event.xcrossing.state = eventPtr->xmotion.state;
+	break;
+    default:
+	event.xcrossing.root = eventPtr->xcrossing.root;
+	event.xcrossing.time = eventPtr->xcrossing.time;
+	event.xcrossing.x_root = eventPtr->xcrossing.x_root;
+	event.xcrossing.y_root = eventPtr->xcrossing.y_root;
+	event.xcrossing.state = eventPtr->xcrossing.state;
+	event.xcrossing.focus = eventPtr->xcrossing.focus;
+	break;
+    }
+    Tcl_Preserve(winPtr);
+    TkHandleWindowlessEvent(winPtr, &event);
+    Tcl_Release(winPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HandleWindowEvent --
+ *
+ *	Dispatches an event synthesized for a window, which may have no X
+ *	window to look it up by: it is windowless, or it is being destroyed
+ *	without ever having been made to exist.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Same as Tk_HandleEvent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+HandleWindowEvent(
+    TkWindow *winPtr,		/* Window the event is for. */
+    XEvent *eventPtr)		/* Event to dispatch. */
+{
+    if (winPtr->window == None) {
+	TkHandleWindowlessEvent(winPtr, eventPtr);
+    } else {
+	Tk_HandleEvent(eventPtr);
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3020,6 +3656,9 @@ Initialize(
     Tcl_Obj *useObj = NULL;
     Tcl_Obj *visualObj = NULL;
     Tcl_Obj *geometryObj = NULL;
+    Tcl_Obj *timesObj;
+    Tcl_Time start, last;
+    TkMainInfo *mainPtr;
 
     int sync = 0;
 
@@ -3049,6 +3688,15 @@ Initialize(
 	return TCL_ERROR;
     }
 
+    /*
+     * Record how long each stage takes, for "tk startuptimes".
+     */
+
+    Tcl_GetTime(&start);
+    last = start;
+    timesObj = Tcl_NewObj();
+    Tcl_IncrRefCount(timesObj);
+
     /*
      * Ensure that our obj-types are registered with the Tcl runtime.
      */
@@ -3084,7 +3732,8 @@ Initialize(
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
 			"no controlling master interpreter", -1));
 		Tcl_SetErrorCode(interp, "TK", "SAFE", "NO_MASTER", NULL);
-		return TCL_ERROR;
+		code = TCL_ERROR;
+		goto done;
 	    }
 	}
 
@@ -3116,7 +3765,7 @@ Initialize(
 	Tcl_DecrRefCount(cmd);
 	Tcl_TransferResult(master, code, interp);
 	if (code != TCL_OK) {
-	    return code;
+	    goto done;
 	}
 
 	/*
@@ -3196,6 +3845,8 @@ Initialize(
 	Tcl_SetObjLength(classObj, numBytes);
     }
 
+    AddStartupTime(timesObj, "arguments", &last);
+
     /*
      * Create an argument list for creating the top-level window, using the
      * information parsed from argv, if any.
@@ -3248,6 +3899,7 @@ Initialize(
     if (sync) {
 	XSynchronize(Tk_Display(Tk_MainWindow(interp)), True);
     }
+    AddStartupTime(timesObj, "display", &last);
 
     /*
      * Set the geometry of the main window, if requested. Put the requested
@@ -3296,6 +3948,7 @@ Initialize(
     if (code != TCL_OK) {
 	goto done;
     }
+    AddStartupTime(timesObj, "ttk", &last);
 
     /*
      * Invoke platform-specific initialization. Unlock mutex before entering
@@ -3304,6 +3957,7 @@ Initialize(
      */
 
     code = TkpInit(interp);
+    AddStartupTime(timesObj, "platform", &last);
     if (code == TCL_OK) {
 
 	/*
@@ -3325,6 +3979,7 @@ Initialize(
   }\n\
 }\n\
 tkInit", -1, 0);
+	AddStartupTime(timesObj, "library", &last);
     }
     if (code == TCL_OK) {
 	/*
@@ -3340,8 +3995,59 @@ tkInit", -1, 0);
 	Tcl_DecrRefCount(value);
 	value = NULL;
     }
+    AddStartupTime(timesObj, "total", &start);
+
+    /*
+     * Look the main window up again: the library scripts could have
+     * destroyed it.
+     */
+
+    for (mainPtr = tsdPtr->mainWindowList; mainPtr != NULL;
+	    mainPtr = mainPtr->nextPtr) {
+	if (mainPtr->interp == interp) {
+	    break;
+	}
+    }
+    if ((mainPtr != NULL) && (mainPtr->startupTimes == NULL)) {
+	mainPtr->startupTimes = timesObj;
+    } else {
+	Tcl_DecrRefCount(timesObj);
+    }
     return code;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddStartupTime --
+ *
+ *	Records in a "tk startuptimes" dictionary how long a stage of
+ *	Initialize took.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The time since *lastPtr, in microseconds, is stored under the given
+ *	key, and *lastPtr is set to the current time.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddStartupTime(
+    Tcl_Obj *timesObj,		/* Dictionary of stage times. */
+    const char *stage,		/* Name of the stage that just finished. */
+    Tcl_Time *lastPtr)		/* Time the stage started. */
+{
+    Tcl_Time now;
+
+    Tcl_GetTime(&now);
+    Tcl_DictObjPut(NULL, timesObj, Tcl_NewStringObj(stage, -1),
+	    Tcl_NewWideIntObj((Tcl_WideInt) (now.sec - lastPtr->sec) * 1000000
+	    + (now.usec - lastPtr->usec)));
+    *lastPtr = now;
+}
 
 /*
  *----------------------------------------------------------------------
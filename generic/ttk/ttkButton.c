@@ -254,6 +254,7 @@ static Tk_OptionSpec LabelOptionSpecs[] =
 	TK_OPTION_NULL_OK,0,GEOMETRY_CHANGED /*SB: SIZE_CHANGED*/ },
 
     WIDGET_TAKEFOCUS_FALSE,
+    WIDGET_WINDOWLESS,
     WIDGET_INHERIT_OPTIONS(BaseOptionSpecs)
 };
 
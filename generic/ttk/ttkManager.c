@@ -5,7 +5,7 @@
  */
 
 #include <string.h>
-#include <tk.h>
+#include <tkInt.h>
 #include "ttkManager.h"
 
 /*------------------------------------------------------------------------
@@ -13,8 +13,11 @@
  *
  * When a slave window requests a new size or some other parameter changes,
  * the manager recomputes the required size for the master window and calls
- * Tk_GeometryRequest().  This is scheduled as an idle handler so multiple
- * updates can be processed as a single batch.
+ * Tk_GeometryRequest().  This is scheduled with TkScheduleLayout so multiple
+ * updates can be processed as a single batch, in the same layout pass as
+ * the other geometry managers: first the required sizes are recomputed
+ * from the innermost master outwards, then the slaves are placed from the
+ * outermost master inwards.
  *
  * If all goes well, the master's manager will process the request
  * (and so on up the chain to the toplevel window), and the master
@@ -81,7 +84,7 @@ static void ManagerIdleProc(void *);	/* forward */
 static void ScheduleUpdate(Ttk_Manager *mgr, unsigned flags)
 {
     if (!(mgr->flags & MGR_UPDATE_PENDING)) {
-	Tcl_DoWhenIdle(ManagerIdleProc, mgr);
+	TkScheduleLayout(mgr->masterWindow, ManagerIdleProc, mgr);
 	mgr->flags |= MGR_UPDATE_PENDING;
     }
     mgr->flags |= flags;
@@ -112,11 +115,19 @@ static void RecomputeLayout(Ttk_Manager *mgr)
 }
 
 /* ++ ManagerIdleProc --
- * 	DoWhenIdle procedure for deferred updates.
+ * 	Layout pass procedure for deferred updates.
+ * 	In the request phase, only the required size is recomputed.
  */
 static void ManagerIdleProc(ClientData clientData)
 {
     Ttk_Manager *mgr = clientData;
+
+    if (TkLayoutRequestOnly(mgr)) {
+	if (mgr->flags & MGR_RESIZE_REQUIRED) {
+	    RecomputeSize(mgr);
+	}
+	return;
+    }
     mgr->flags &= ~MGR_UPDATE_PENDING;
 
     if (mgr->flags & MGR_RESIZE_REQUIRED) {
@@ -237,7 +248,7 @@ void Ttk_DeleteManager(Ttk_Manager *mgr)
 	ckfree(mgr->slaves);
     }
 
-    Tcl_CancelIdleCall(ManagerIdleProc, mgr);
+    TkCancelLayout(ManagerIdleProc, mgr);
 
     ckfree(mgr);
 }
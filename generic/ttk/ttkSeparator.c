@@ -30,6 +30,7 @@ static Tk_OptionSpec SeparatorOptionSpecs[] = {
 	0,(ClientData)ttkOrientStrings,STYLE_CHANGED },
 
     WIDGET_TAKEFOCUS_FALSE,
+    WIDGET_WINDOWLESS,
     WIDGET_INHERIT_OPTIONS(ttkCoreOptionSpecs)
 };
 
@@ -578,6 +578,34 @@ void Ttk_SetThemeEnabledProc(
     theme->enabledData = enabledData;
 }
 
+/*
+ * LoadThemeSettings --
+ *	The settings scripts of the built-in themes that are not in use
+ *	at startup are not evaluated then; ttk.tcl stores them in the
+ *	::ttk::LazyThemes array instead.  Evaluate the one for 'name',
+ *	if any, the first time the theme is looked up.
+ */
+
+static void LoadThemeSettings(Tcl_Interp *interp, const char *name)
+{
+    Tcl_Obj *script;
+    Tcl_InterpState state;
+
+    script = Tcl_GetVar2Ex(interp, "::ttk::LazyThemes", name, TCL_GLOBAL_ONLY);
+    if (!script) {
+	return;
+    }
+    Tcl_IncrRefCount(script);
+    Tcl_UnsetVar2(interp, "::ttk::LazyThemes", name, TCL_GLOBAL_ONLY);
+
+    state = Tcl_SaveInterpState(interp, TCL_OK);
+    if (Tcl_EvalObjEx(interp, script, TCL_EVAL_GLOBAL) != TCL_OK) {
+	Tcl_BackgroundException(interp, TCL_ERROR);
+    }
+    (void) Tcl_RestoreInterpState(interp, state);
+    Tcl_DecrRefCount(script);
+}
+
 /*
  * LookupTheme --
  *	Retrieve a registered theme by name.  If not found,
@@ -598,6 +626,7 @@ static Ttk_Theme LookupTheme(
 	Tcl_SetErrorCode(interp, "TTK", "LOOKUP", "THEME", name, NULL);
 	return NULL;
     }
+    LoadThemeSettings(interp, name);
 
     return Tcl_GetHashValue(entryPtr);
 }
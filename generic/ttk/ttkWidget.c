@@ -5,7 +5,7 @@
  */
 
 #include <string.h>
-#include <tk.h>
+#include <tkInt.h>
 #include "ttkTheme.h"
 #include "ttkWidget.h"
 
@@ -56,11 +56,14 @@ static void SizeChanged(WidgetCore *corePtr)
 /* BeginDrawing --
  * 	Returns a Drawable for drawing the widget contents.
  *	This is normally an off-screen Pixmap, copied to
- *	the window by EndDrawing().
+ *	the window (or, for windowless widgets, to the parent's
+ *	window) by EndDrawing().
  */
 static Drawable BeginDrawing(Tk_Window tkwin)
 {
-    return Tk_GetPixmap(Tk_Display(tkwin), Tk_WindowId(tkwin),
+    int x, y;
+
+    return Tk_GetPixmap(Tk_Display(tkwin), TkGetWindowDrawable(tkwin, &x, &y),
 	    Tk_Width(tkwin), Tk_Height(tkwin), Tk_Depth(tkwin));
 }
 
@@ -71,14 +74,16 @@ static void EndDrawing(Tk_Window tkwin, Drawable d)
 {
     XGCValues gcValues;
     GC gc;
+    int x, y;
+    Drawable window = TkGetWindowDrawable(tkwin, &x, &y);
 
     gcValues.function = GXcopy;
     gcValues.graphics_exposures = False;
     gc = Tk_GetGC(tkwin, GCFunction|GCGraphicsExposures, &gcValues);
 
-    XCopyArea(Tk_Display(tkwin), d, Tk_WindowId(tkwin), gc,
+    XCopyArea(Tk_Display(tkwin), d, window, gc,
 	    0, 0, (unsigned) Tk_Width(tkwin), (unsigned) Tk_Height(tkwin),
-	    0, 0);
+	    x, y);
 
     Tk_FreePixmap(Tk_Display(tkwin), d);
     Tk_FreeGC(Tk_Display(tkwin), gc);
@@ -102,6 +107,7 @@ static void DrawWidget(ClientData recordPtr)
 	corePtr->widgetSpec->layoutProc(recordPtr);
 	corePtr->widgetSpec->displayProc(recordPtr, d);
 	EndDrawing(corePtr->tkwin, d);
+	TkRedrawWindowless(corePtr->tkwin);
     }
 }
 
@@ -272,6 +278,12 @@ static void CoreEventProc(ClientData clientData, XEvent *eventPtr)
 	    break;
 	case Expose :
 	    if (eventPtr->xexpose.count == 0) {
+		if ((Tk_WindowId(corePtr->tkwin) == None)
+			&& (corePtr->flags & REDISPLAY_PENDING)) {
+		    /* Windowless: redraw after the parent */
+		    Tcl_CancelIdleCall(DrawWidget, corePtr);
+		    corePtr->flags &= ~REDISPLAY_PENDING;
+		}
 		TtkRedisplayWidget(corePtr);
 	    }
 	    break;
@@ -400,6 +412,7 @@ int TtkWidgetConstructorObjCmd(
 
     Tk_SetClass(tkwin, className);
     Tk_SetClassProcs(tkwin, &widgetClassProcs, recordPtr);
+    TkAllowWindowless(tkwin);
     Tk_SetWindowBackgroundPixmap(tkwin, ParentRelative);
 
     widgetSpec->initializeProc(interp, recordPtr);
@@ -433,7 +446,11 @@ int TtkWidgetConstructorObjCmd(
     Tcl_Release(corePtr);
 
     SizeChanged(corePtr);
-    Tk_MakeWindowExist(tkwin);
+    if (corePtr->windowless) {
+	TkSetWindowless(tkwin);
+    } else {
+	Tk_MakeWindowExist(tkwin);
+    }
 
     Tcl_SetObjResult(interp, Tcl_NewStringObj(Tk_PathName(tkwin), -1));
     return TCL_OK;
@@ -42,6 +42,7 @@ typedef struct
     Tcl_Obj *cursorObj;		/* Storage for -cursor option */
     Tcl_Obj *styleObj;		/* Name of currently-applied style */
     Tcl_Obj *classObj;		/* Class name (readonly option) */
+    int windowless;		/* -windowless option (readonly) */
 
     Ttk_State state;		/* Current widget state */
     unsigned int flags;		/* internal flags, see above */
@@ -122,6 +123,14 @@ MODULE_SCOPE int TtkWidgetConstructorObjCmd(
     {TK_OPTION_STRING, "-takefocus", "takeFocus", "TakeFocus", \
 	"", Tk_Offset(WidgetCore, takeFocusPtr), -1, 0,0,0 }
 
+/* WIDGET_WINDOWLESS --
+ *	Add this to the OptionSpecs table of widgets that may be drawn
+ *	into their parent's window instead of having one of their own.
+ */
+#define WIDGET_WINDOWLESS \
+    {TK_OPTION_BOOLEAN, "-windowless", "windowless", "Windowless", \
+	"0", -1, Tk_Offset(WidgetCore, windowless), 0,0,READONLY_OPTION }
+
 /* WIDGET_INHERIT_OPTIONS(baseOptionSpecs) --
  * Add this at the end of an OptionSpecs table to inherit
  * the options from 'baseOptionSpecs'.
@@ -120,23 +120,34 @@ bind TLabel <<Invoke>>		{ tk::TabToWindow [tk_focusNext %W] }
 #
 proc ttk::LoadThemes {} {
     variable library
+    variable LazyThemes
 
     # "default" always present:
     uplevel #0 [list source [file join $library defaults.tcl]]
 
+    # The portable themes are rarely the one in use; their settings are
+    # only loaded when they are first looked up (see ttkTheme.c).
+    # The platform themes take part in choosing the default theme.
+    #
     set builtinThemes [style theme names]
-    foreach {theme scripts} {
-	classic 	classicTheme.tcl
-	alt 		altTheme.tcl
-	clam 		clamTheme.tcl
-	winnative	winTheme.tcl
-	xpnative	{xpTheme.tcl vistaTheme.tcl}
-	aqua 		aquaTheme.tcl
+    foreach {theme scripts lazy} {
+	classic 	classicTheme.tcl			1
+	alt 		altTheme.tcl				1
+	clam 		clamTheme.tcl				1
+	winnative	winTheme.tcl				0
+	xpnative	{xpTheme.tcl vistaTheme.tcl}		0
+	aqua 		aquaTheme.tcl				0
     } {
 	if {[lsearch -exact $builtinThemes $theme] >= 0} {
+	    set cmd {}
             foreach script $scripts {
-                uplevel #0 [list source [file join $library $script]]
+		append cmd [list source [file join $library $script]] \n
             }
+	    if {$lazy} {
+		set LazyThemes($theme) $cmd
+	    } else {
+		uplevel #0 $cmd
+	    }
 	}
     }
 }
@@ -201,18 +201,25 @@ testConstraint testImageType [expr {[lsearch [image types] test] >= 0}]
 testConstraint testOldImageType [expr {[lsearch [image types] oldtest] >= 0}]
 testConstraint testbitmap    [llength [info commands testbitmap]]
 testConstraint testborder    [llength [info commands testborder]]
+testConstraint testcanvasbatch [llength [info commands testcanvasbatch]]
 testConstraint testcbind     [llength [info commands testcbind]]
 testConstraint testclipboard [llength [info commands testclipboard]]
+testConstraint testclipcache [llength [info commands testclipcache]]
 testConstraint testcolor     [llength [info commands testcolor]]
 testConstraint testcursor    [llength [info commands testcursor]]
+testConstraint testdecimate  [llength [info commands testdecimate]]
 testConstraint testembed     [llength [info commands testembed]]
 testConstraint testfont      [llength [info commands testfont]]
+testConstraint testinternatoms [llength [info commands testinternatoms]]
 testConstraint testmakeexist [llength [info commands testmakeexist]]
 testConstraint testmenubar   [llength [info commands testmenubar]]
 testConstraint testmetrics   [llength [info commands testmetrics]]
 testConstraint testobjconfig [llength [info commands testobjconfig]]
+testConstraint testpathcache [llength [info commands testpathcache]]
+testConstraint testpsitem    [llength [info commands testpsitem]]
 testConstraint testsend      [llength [info commands testsend]]
 testConstraint testtext      [llength [info commands testtext]]
+testConstraint testwindowless [llength [info commands testwindowless]]
 testConstraint testwinevent  [llength [info commands testwinevent]]
 testConstraint testwrapper   [llength [info commands testwrapper]]
 
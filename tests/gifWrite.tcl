@@ -0,0 +1,53 @@
+# This file is a Tcl script that times writing GIF images. It ends with .tcl
+# instead of .test so that it isn't run as part of the test suite; run it
+# with wish (or tktest) to compare the speed of the GIF writer between
+# builds:
+#
+#	wish gifWrite.tcl ?iterations?
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+
+package require Tk
+wm withdraw .
+
+set iterations [expr {$argc > 0 ? [lindex $argv 0] : 50}]
+
+# A 512x512 image using 256 different colors, which fits in a GIF palette
+# without quantizing.
+
+set img [image create photo -width 512 -height 512]
+for {set y 0} {$y < 512} {incr y} {
+    set row {}
+    for {set x 0} {$x < 512} {incr x} {
+	set c [expr {(($x / 32) + 16 * ($y / 32)) & 255}]
+	lappend row [format #%02x%02x%02x $c [expr {255 - $c}] [expr {$c / 2}]]
+    }
+    $img put [list $row] -to 0 $y
+}
+
+# A 256x256 image with 65536 colors, which needs quantizing.
+
+set big [image create photo -width 256 -height 256]
+for {set y 0} {$y < 256} {incr y} {
+    set row {}
+    for {set x 0} {$x < 256} {incr x} {
+	lappend row [format #%02x%02x80 $x $y]
+    }
+    $big put [list $row] -to 0 $y
+}
+
+proc report {what usec} {
+    puts [format "%-40s %10.1f ms" $what [expr {$usec / 1000.0}]]
+}
+
+report "512x512, 256 colors" \
+    [lindex [time {$img data -format gif} $iterations] 0]
+report "256x256, 65536 colors, -quantize" \
+    [lindex [time {$big data -format {gif -quantize 1}} $iterations] 0]
+report "256x256, 65536 colors, -quantize -dither" \
+    [lindex [time {$big data -format {gif -quantize 1 -dither 1}} \
+	    $iterations] 0]
+
+image delete $img $big
+exit
@@ -374,11 +374,15 @@ TkpDisplayButton(
     int imageXOffset = 0, imageYOffset = 0;
 				/* image information that will be used to
 				 * restrict disabled pixmap as well */
+    Drawable d;
+    int dx, dy;			/* Where the pixmap goes in d: a windowless
+				 * label is drawn into its parent. */
 
     butPtr->flags &= ~REDRAW_PENDING;
     if ((butPtr->tkwin == NULL) || !Tk_IsMapped(tkwin)) {
 	return;
     }
+    d = TkGetWindowDrawable(tkwin, &dx, &dy);
 
     border = butPtr->normalBorder;
     if ((butPtr->state == STATE_DISABLED) && (butPtr->disabledFg != NULL)) {
@@ -441,7 +445,7 @@ TkpDisplayButton(
      * been cleared.
      */
 
-    pixmap = Tk_GetPixmap(butPtr->display, Tk_WindowId(tkwin),
+    pixmap = Tk_GetPixmap(butPtr->display, d,
 	    Tk_Width(tkwin), Tk_Height(tkwin), Tk_Depth(tkwin));
     Tk_Fill3DRectangle(tkwin, pixmap, border, 0, 0, Tk_Width(tkwin),
 	    Tk_Height(tkwin), 0, TK_RELIEF_FLAT);
@@ -827,9 +831,9 @@ TkpDisplayButton(
      * delete the pixmap.
      */
 
-    XCopyArea(butPtr->display, pixmap, Tk_WindowId(tkwin),
+    XCopyArea(butPtr->display, pixmap, d,
 	    butPtr->copyGC, 0, 0, (unsigned) Tk_Width(tkwin),
-	    (unsigned) Tk_Height(tkwin), 0, 0);
+	    (unsigned) Tk_Height(tkwin), dx, dy);
     Tk_FreePixmap(butPtr->display, pixmap);
 }
 
@@ -179,6 +179,7 @@ TkpOpenDisplay(
     memset(dispPtr, 0, sizeof(TkDisplay));
     dispPtr->display = display;
     dispPtr->flags |= use_xkb;
+    TkPrefetchAtoms(dispPtr);
 #ifdef TK_USE_INPUT_METHODS
     OpenIM(dispPtr);
     XRegisterIMInstantiateCallback(dispPtr->display, NULL, NULL, NULL,
@@ -23,6 +23,15 @@ typedef struct ConvertInfo {
     Tcl_EncodingState state;	/* The encoding state needed across chunks. */
     char buffer[4];		/* A buffer to hold part of a UTF character
 				 * that is split across chunks.*/
+    int chunkSize;		/* Number of bytes to send in the next chunk.
+				 * Starts at TK_SEL_BYTES_AT_ONCE and doubles
+				 * after each full chunk, up to the limit
+				 * given by SelChunkSize. */
+    Tcl_Obj *dataObj;		/* If non-NULL, a byte array holding the whole
+				 * selection already in its external encoding
+				 * (see TkClipboardGetEncoded); chunks are
+				 * taken from it instead of from the handler.
+				 * offset then counts bytes in dataObj. */
 } ConvertInfo;
 
 /*
@@ -57,6 +66,10 @@ typedef struct IncrInfo {
     int numIncrs;		/* Number of entries in converts that aren't
 				 * -1 (i.e. # of INCR-mode transfers not yet
 				 * completed). */
+    char *chunk;		/* Buffer into which selection handlers store
+				 * each chunk, or NULL. Malloc-ed; grown as
+				 * the chunks get larger. */
+    int chunkSpace;		/* Number of bytes allocated at chunk. */
     Tcl_TimerToken timeout;	/* Token for timer function. */
     int idleTime;		/* Number of seconds since we heard anything
 				 * from the selection requestor. */
@@ -80,6 +93,15 @@ static Tcl_ThreadDataKey dataKey;
 
 #define MAX_PROP_WORDS 100000
 
+/*
+ * Largest chunk of selection that we'll send in one property. Only chunks
+ * of STRING, UTF8_STRING and pre-encoded data grow to this size; they are
+ * never larger once encoded, so they stay below MAX_PROP_WORDS and older
+ * receivers still accept them.
+ */
+
+#define MAX_CHUNK_BYTES (MAX_PROP_WORDS * 2)
+
 static TkSelRetrievalInfo *pendingRetrievals = NULL;
 				/* List of all retrievals currently being
 				 * waited for. */
@@ -97,7 +119,11 @@ static void		SelCvtFromX8(char *propPtr, int numValues, Atom type,
 			    Tk_Window tkwin, Tcl_DString *dsPtr);
 static long *		SelCvtToX(char *string, Atom type, Tk_Window tkwin,
 			    int *numLongsPtr);
-static int		SelectionSize(TkSelHandler *selPtr);
+static int		SelChunkSize(TkDisplay *dispPtr);
+static int		SelCompleteUtf8Length(const char *string,
+			    int length);
+static int		SelIsStandardUtf8(const char *string, int length);
+static int		SelectionSize(TkSelHandler *selPtr, int maxChunk);
 static void		SelRcvIncrProc(ClientData clientData,
 			    XEvent *eventPtr);
 static void		SelTimeoutProc(ClientData clientData);
@@ -237,10 +263,10 @@ TkSelPropProc(
 {
     register IncrInfo *incrPtr;
     register TkSelHandler *selPtr;
-    int length, numItems;
+    int length, numItems, chunkSize;
     unsigned long i;
     Atom target, formatType;
-    long buffer[TK_SEL_WORDS_AT_ONCE];
+    char *buffer;
     TkDisplay *dispPtr = TkGetDisplay(eventPtr->xany.display);
     Tk_ErrorHandler errorHandler;
     ThreadSpecificData *tsdPtr =
@@ -274,6 +300,18 @@ TkSelPropProc(
 	    target = incrPtr->multAtoms[2*i];
 	    incrPtr->idleTime = 0;
 
+	    /*
+	     * Make sure the chunk buffer can hold the next chunk.
+	     */
+
+	    chunkSize = incrPtr->converts[i].chunkSize;
+	    if (incrPtr->chunkSpace <= chunkSize) {
+		incrPtr->chunkSpace = chunkSize + 1;
+		incrPtr->chunk = ckrealloc(incrPtr->chunk,
+			incrPtr->chunkSpace);
+	    }
+	    buffer = incrPtr->chunk;
+
 	    /*
 	     * Look for a matching selection handler.
 	     */
@@ -309,6 +347,23 @@ TkSelPropProc(
 
 		numItems = 0;
 		length = 0;
+	    } else if (incrPtr->converts[i].dataObj != NULL) {
+		/*
+		 * The data was encoded when the transfer started; just copy
+		 * out the next piece of it.
+		 */
+
+		int dataLength;
+		unsigned char *data = Tcl_GetByteArrayFromObj(
+			incrPtr->converts[i].dataObj, &dataLength);
+
+		numItems = dataLength - incrPtr->converts[i].offset;
+		if (numItems > chunkSize) {
+		    numItems = chunkSize;
+		}
+		memcpy(buffer, data + incrPtr->converts[i].offset,
+			(size_t) numItems);
+		length = 0;
 	    } else {
 		TkSelInProgress ip;
 
@@ -324,12 +379,11 @@ TkSelPropProc(
 		 */
 
 		length = strlen(incrPtr->converts[i].buffer);
-		strcpy((char *)buffer, incrPtr->converts[i].buffer);
+		strcpy(buffer, incrPtr->converts[i].buffer);
 
 		numItems = selPtr->proc(selPtr->clientData,
-			incrPtr->converts[i].offset,
-			((char *) buffer) + length,
-			TK_SEL_BYTES_AT_ONCE - length);
+			incrPtr->converts[i].offset, buffer + length,
+			chunkSize - length);
 		TkSelSetInProgress(ip.nextPtr);
 		if (ip.selPtr == NULL) {
 		    /*
@@ -342,11 +396,11 @@ TkSelPropProc(
 		    numItems = 0;
 		}
 		numItems += length;
-		if (numItems > TK_SEL_BYTES_AT_ONCE) {
+		if (numItems > chunkSize) {
 		    Tcl_Panic("selection handler returned too many bytes");
 		}
 	    }
-	    ((char *) buffer)[numItems] = 0;
+	    buffer[numItems] = 0;
 
 	    errorHandler = Tk_CreateErrorHandler(eventPtr->xproperty.display,
 		    -1, -1, -1, (int (*)()) NULL, NULL);
@@ -355,9 +409,33 @@ TkSelPropProc(
 	     * Encode the data using the proper format for each type.
 	     */
 
-	    if ((formatType == XA_STRING)
-		    || (dispPtr && formatType==dispPtr->utf8Atom)
-		    || (dispPtr && formatType==dispPtr->compoundTextAtom)) {
+	    if ((incrPtr->converts[i].dataObj != NULL)
+		    || (dispPtr && formatType == dispPtr->utf8Atom
+		    && SelIsStandardUtf8(buffer, numItems))) {
+		int sendLength = numItems;
+
+		/*
+		 * Pre-encoded data, and UTF8_STRING data that is the same in
+		 * Tcl's internal form as in standard UTF-8, need no
+		 * conversion: the buffer goes straight to the server. As on
+		 * the converting path below, a character split at the end of
+		 * a UTF8_STRING chunk is held back for the next chunk, which
+		 * may have to be converted.
+		 */
+
+		incrPtr->converts[i].buffer[0] = '\0';
+		if ((incrPtr->converts[i].dataObj == NULL)
+			&& (numItems == chunkSize)) {
+		    sendLength = SelCompleteUtf8Length(buffer, numItems);
+		    strcpy(incrPtr->converts[i].buffer, buffer + sendLength);
+		}
+		XChangeProperty(eventPtr->xproperty.display,
+			eventPtr->xproperty.window, eventPtr->xproperty.atom,
+			formatType, 8, PropModeReplace,
+			(unsigned char *) buffer, sendLength);
+	    } else if ((formatType == XA_STRING)
+		    || (dispPtr && formatType==dispPtr->compoundTextAtom)
+		    || (dispPtr && formatType==dispPtr->utf8Atom)) {
 		Tcl_DString ds;
 		int encodingCvtFlags;
 		int srcLen, dstLen, result, srcRead, dstWrote, soFar;
@@ -373,12 +451,12 @@ TkSelPropProc(
 		if (incrPtr->converts[i].offset == 0) {
 		    encodingCvtFlags |= TCL_ENCODING_START;
 		}
-		if (numItems < TK_SEL_BYTES_AT_ONCE) {
+		if (numItems < chunkSize) {
 		    encodingCvtFlags |= TCL_ENCODING_END;
 		}
 		if (formatType == XA_STRING) {
 		    encoding = Tcl_GetEncoding(NULL, "iso8859-1");
-		} else if (dispPtr && formatType==dispPtr->utf8Atom) {
+		} else if (formatType == dispPtr->utf8Atom) {
 		    encoding = Tcl_GetEncoding(NULL, "utf-8");
 		} else {
 		    encoding = Tcl_GetEncoding(NULL, "iso2022");
@@ -388,7 +466,7 @@ TkSelPropProc(
 		 * Now convert the data.
 		 */
 
-		src = (char *)buffer;
+		src = buffer;
 		srcLen = numItems;
 		Tcl_DStringInit(&ds);
 		dst = Tcl_DStringValue(&ds);
@@ -449,7 +527,7 @@ TkSelPropProc(
 		 * Set the property to the encoded string value.
 		 */
 
-		char *propPtr = (char *) SelCvtToX((char *) buffer,
+		char *propPtr = (char *) SelCvtToX(buffer,
 			formatType, (Tk_Window) incrPtr->winPtr, &numItems);
 
 		if (propPtr == NULL) {
@@ -471,7 +549,7 @@ TkSelPropProc(
 	     * offset to -1 to indicate we are done.
 	     */
 
-	    if (numItems < TK_SEL_BYTES_AT_ONCE) {
+	    if (numItems < chunkSize) {
 		if (numItems <= 0) {
 		    incrPtr->converts[i].offset = -1;
 		    incrPtr->numIncrs--;
@@ -479,12 +557,30 @@ TkSelPropProc(
 		    incrPtr->converts[i].offset = -2;
 		}
 	    } else {
+		int maxChunk = SelChunkSize(incrPtr->winPtr->dispPtr);
+
 		/*
 		 * Advance over the selection data that was consumed this
-		 * time.
+		 * time, and ask for twice as much next time so that large
+		 * selections need few round-trips.
 		 */
 
 		incrPtr->converts[i].offset += numItems - length;
+		if ((incrPtr->converts[i].dataObj == NULL)
+			&& (formatType != XA_STRING) && !(dispPtr
+			&& formatType == dispPtr->utf8Atom)) {
+		    /*
+		     * Other formats can take more room once encoded than
+		     * the selection data they come from (COMPOUND_TEXT
+		     * switches character sets with escape sequences), so
+		     * their chunks keep the size that older receivers can
+		     * read in one piece.
+		     */
+		} else if (chunkSize < maxChunk / 2) {
+		    incrPtr->converts[i].chunkSize = 2 * chunkSize;
+		} else {
+		    incrPtr->converts[i].chunkSize = maxChunk;
+		}
 	    }
 	    return;
 	}
@@ -887,6 +983,8 @@ ConvertSelection(
 
     incr.converts = ckalloc(incr.numConversions * sizeof(ConvertInfo));
     incr.numIncrs = 0;
+    incr.chunk = NULL;
+    incr.chunkSpace = 0;
     for (i = 0; i < incr.numConversions; i++) {
 	Atom target, property, type;
 	long buffer[TK_SEL_WORDS_AT_ONCE];
@@ -898,6 +996,8 @@ ConvertSelection(
 	property = incr.multAtoms[2*i + 1];
 	incr.converts[i].offset = -1;
 	incr.converts[i].buffer[0] = '\0';
+	incr.converts[i].chunkSize = TK_SEL_BYTES_AT_ONCE;
+	incr.converts[i].dataObj = NULL;
 
 	for (selPtr = winPtr->selHandlerList; selPtr != NULL;
 		selPtr = selPtr->nextPtr) {
@@ -949,8 +1049,27 @@ ConvertSelection(
 	     */
 
 	    incr.numIncrs++;
+	    if ((selPtr != NULL) && ((type == XA_STRING)
+		    || (type == winPtr->dispPtr->compoundTextAtom))) {
+		/*
+		 * The clipboard keeps an encoded copy of its contents, so
+		 * that large transfers don't convert each chunk again.
+		 */
+
+		incr.converts[i].dataObj = TkClipboardGetEncoded(selPtr,
+			(type == XA_STRING) ? "iso8859-1" : "iso2022");
+	    }
 	    type = winPtr->dispPtr->incrAtom;
-	    buffer[0] = SelectionSize(selPtr);
+	    if (incr.converts[i].dataObj != NULL) {
+		int dataLength;
+
+		Tcl_IncrRefCount(incr.converts[i].dataObj);
+		Tcl_GetByteArrayFromObj(incr.converts[i].dataObj, &dataLength);
+		buffer[0] = dataLength;
+	    } else {
+		buffer[0] = SelectionSize(selPtr,
+			SelChunkSize(winPtr->dispPtr));
+	    }
 	    if (buffer[0] == 0) {
 		incr.multAtoms[2*i + 1] = None;
 		continue;
@@ -1076,7 +1195,15 @@ ConvertSelection(
      * All done. Cleanup and return.
      */
 
+    for (i = 0; i < incr.numConversions; i++) {
+	if (incr.converts[i].dataObj != NULL) {
+	    Tcl_DecrRefCount(incr.converts[i].dataObj);
+	}
+    }
     ckfree(incr.converts);
+    if (incr.chunk != NULL) {
+	ckfree(incr.chunk);
+    }
     if (multiple) {
 	XFree((char *) incr.multAtoms);
     }
@@ -1138,6 +1265,26 @@ SelRcvIncrProc(
     if ((result != Success) || (type == None)) {
 	return;
     }
+    if ((bytesAfter != 0) && (format != 0)) {
+	long numWords = (long)
+		((numItems * (format / 8) + bytesAfter + 3) / 4);
+
+	/*
+	 * The owner sent a chunk larger than we asked for, which happens
+	 * when its server accepts big requests. The property was not deleted
+	 * by the read above, so fetch it again whole.
+	 */
+
+	XFree(propInfo);
+	propInfo = NULL;
+	result = XGetWindowProperty(eventPtr->xproperty.display,
+		eventPtr->xproperty.window, retrPtr->property, 0, numWords,
+		True, (Atom) AnyPropertyType, &type, &format, &numItems,
+		&bytesAfter, (unsigned char **) propInfoPtr);
+	if ((result != Success) || (type == None)) {
+	    return;
+	}
+    }
     if (bytesAfter != 0) {
 	Tcl_SetObjResult(retrPtr->interp, Tcl_NewStringObj(
 		"selection property too large", -1));
@@ -1307,39 +1454,98 @@ SelRcvIncrProc(
  *
  * Side effects:
  *	The selection is retrieved from its current owner (this is the only
- *	way to compute its size).
+ *	way to compute its size). The chunks requested double in size, up to
+ *	maxChunk bytes, so that this takes few calls even for huge
+ *	selections.
  *
  *----------------------------------------------------------------------
  */
 
 static int
 SelectionSize(
-    TkSelHandler *selPtr)	/* Information about how to retrieve the
+    TkSelHandler *selPtr,	/* Information about how to retrieve the
 				 * selection whose size is wanted. */
+    int maxChunk)		/* Largest number of bytes to ask for at
+				 * once. */
 {
-    char buffer[TK_SEL_BYTES_AT_ONCE+1];
-    int size, chunkSize;
+    char *buffer;
+    int size, chunkSize, numBytes;
     TkSelInProgress ip;
 
-    size = TK_SEL_BYTES_AT_ONCE;
+    size = chunkSize = TK_SEL_BYTES_AT_ONCE;
+    buffer = ckalloc(chunkSize + 1);
     ip.selPtr = selPtr;
     ip.nextPtr = TkSelGetInProgress();
     TkSelSetInProgress(&ip);
 
-    do {
-	chunkSize = selPtr->proc(selPtr->clientData, size, (char *) buffer,
-		TK_SEL_BYTES_AT_ONCE);
+    while (1) {
+	numBytes = selPtr->proc(selPtr->clientData, size, buffer, chunkSize);
 	if (ip.selPtr == NULL) {
 	    size = 0;
 	    break;
 	}
-	size += chunkSize;
-    } while (chunkSize == TK_SEL_BYTES_AT_ONCE);
+	size += numBytes;
+	if (numBytes != chunkSize) {
+	    break;
+	}
+	if (chunkSize < maxChunk) {
+	    chunkSize = (chunkSize < maxChunk / 2) ? 2 * chunkSize : maxChunk;
+	    buffer = ckrealloc(buffer, chunkSize + 1);
+	}
+    }
 
     TkSelSetInProgress(ip.nextPtr);
+    ckfree(buffer);
     return size;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SelChunkSize --
+ *
+ *	Computes the largest chunk of selection to place in one property when
+ *	sending the selection to another client in INCR mode. It follows the
+ *	largest request the server accepts, including the BIG-REQUESTS
+ *	extension.
+ *
+ * Results:
+ *	The chunk size in bytes; never less than TK_SEL_BYTES_AT_ONCE nor
+ *	more than MAX_CHUNK_BYTES.
+ *
+ * Side effects:
+ *	The size is remembered in dispPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SelChunkSize(
+    TkDisplay *dispPtr)		/* Display the selection is sent on. */
+{
+    if (dispPtr->selChunkSize == 0) {
+	long numWords = XExtendedMaxRequestSize(dispPtr->display);
+
+	if (numWords == 0) {
+	    numWords = XMaxRequestSize(dispPtr->display);
+	}
+
+	/*
+	 * Use half of the largest request, leaving room for the request
+	 * header and for encodings that expand the text.
+	 */
+
+	if (numWords > MAX_CHUNK_BYTES / 2) {
+	    dispPtr->selChunkSize = MAX_CHUNK_BYTES;
+	} else if (numWords * 2 < TK_SEL_BYTES_AT_ONCE) {
+	    dispPtr->selChunkSize = TK_SEL_BYTES_AT_ONCE;
+	} else {
+	    dispPtr->selChunkSize = (int) numWords * 2;
+	}
+    }
+    return dispPtr->selChunkSize;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1377,6 +1583,82 @@ IncrTimeoutProc(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * SelCompleteUtf8Length --
+ *
+ *	Finds how much of a chunk of UTF-8 selection data holds complete
+ *	characters, the rest being the start of a character that continues in
+ *	the next chunk.
+ *
+ * Results:
+ *	The number of bytes up to the incomplete character at the end of the
+ *	string, or length if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SelCompleteUtf8Length(
+    const char *string,		/* Chunk of selection data. */
+    int length)			/* Number of bytes in string. */
+{
+    const unsigned char *p = (const unsigned char *) string;
+    int i, need;
+
+    for (i = length - 1; (i >= 0) && (i >= length - 3); i--) {
+	if (p[i] < 0x80) {
+	    break;
+	}
+	if (p[i] >= 0xC0) {
+	    need = (p[i] >= 0xF0) ? 4 : (p[i] >= 0xE0) ? 3 : 2;
+	    return (i + need > length) ? i : length;
+	}
+    }
+    return length;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SelIsStandardUtf8 --
+ *
+ *	Checks whether a string in Tcl's internal form is also valid standard
+ *	UTF-8. It is not if it holds a NUL, which Tcl stores as \xC0\x80, or a
+ *	character outside the Basic Multilingual Plane, which Tcl stores as
+ *	two encoded surrogates starting with \xED. A string that merely ends
+ *	with part of a character still counts as standard.
+ *
+ * Results:
+ *	1 if the string can be sent as UTF8_STRING without conversion, 0 if
+ *	it must go through the "utf-8" encoding.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SelIsStandardUtf8(
+    const char *string,		/* Selection data in Tcl's internal form. */
+    int length)			/* Number of bytes in string. */
+{
+    const unsigned char *p = (const unsigned char *) string;
+    const unsigned char *end = p + length;
+
+    for ( ; p < end; p++) {
+	if ((*p == 0xC0) || (*p == 0xED)) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
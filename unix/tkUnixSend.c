@@ -12,7 +12,29 @@
  * this file, and for a DISCLAIMER OF ALL WARRANTIES.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		/* For struct ucred. */
+#endif
 #include "tkUnixInt.h"
+#ifndef TK_NO_SEND_SOCKET
+#include <dirent.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ * A connection is only used once the process at the other end is known to
+ * belong to our user. Where the system can't tell, sends go through the X
+ * server as before.
+ */
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) \
+	|| defined(__OpenBSD__) || defined(__DragonFly__)
+#define HAVE_GETPEEREID 1
+#elif !defined(SO_PEERCRED)
+#define TK_NO_SEND_SOCKET 1
+#endif
+#endif /* TK_NO_SEND_SOCKET */
 
 /*
  * The following structure is used to keep track of the interpreters
@@ -65,6 +87,51 @@ typedef struct NameRegistry {
 				 * XFree; zero means use ckfree. */
 } NameRegistry;
 
+/*
+ * Between processes on the same host, commands and results can bypass the X
+ * server. Each process listens on a Unix domain socket in a directory only
+ * its user can enter, and advertises it in a property "TK_SEND_SOCKET" on its
+ * comm window, in the form
+ * 	host space path
+ * A sender still finds the target's comm window through the registry, but
+ * then connects to the socket and keeps the connection open for later sends.
+ * Each message on a connection has the same format as the text appended to
+ * the comm property (see below), preceded by its length as four bytes, most
+ * significant first. A command that asks for a response gets it on the same
+ * connection. The following structure describes one connection, or the
+ * listening socket itself:
+ */
+
+typedef struct SendConn {
+    int fd;			/* The socket, or -1 if there is no socket
+				 * for commWindow or the connection has been
+				 * closed. */
+    TkDisplay *dispPtr;		/* Display on which the peer's names are
+				 * registered. */
+    Window commWindow;		/* For connections we made, the comm window
+				 * of the process we connected to. None for
+				 * connections we accepted and for the
+				 * listening socket. */
+    char *path;			/* For the listening socket, the path it is
+				 * bound to (malloc-ed), so that it can be
+				 * removed again; otherwise NULL. */
+    long retryTime;		/* If fd is -1 because commWindow has no
+				 * usable socket, the time (in seconds) after
+				 * which to look again, since the window id
+				 * may by then belong to another process. */
+    char *input;		/* Bytes read from fd that do not yet form a
+				 * complete message (malloc-ed), or NULL. */
+    int inputLength;		/* Number of bytes stored at input. */
+    int inputSpace;		/* Number of bytes allocated at input. */
+    char *output;		/* Bytes waiting to be written to fd because
+				 * the socket was full (malloc-ed), or
+				 * NULL. */
+    int outputLength;		/* Number of bytes stored at output. */
+    int outputSpace;		/* Number of bytes allocated at output. */
+    struct SendConn *nextPtr;	/* Next in list of all connections of this
+				 * thread. */
+} SendConn;
+
 /*
  * When a result is being awaited from a sent command, one of the following
  * structures is present on a list of all outstanding sent commands. The
@@ -92,6 +159,9 @@ typedef struct PendingCommand {
 				 * NULL (malloc'ed). */
     int gotResponse;		/* 1 means a response has been received, 0
 				 * means the command is still outstanding. */
+    SendConn *connPtr;		/* Connection on which the command was sent,
+				 * or NULL if it went through the comm
+				 * property. */
     struct PendingCommand *nextPtr;
 				/* Next in list of all outstanding commands.
 				 * NULL means end of list. */
@@ -104,6 +174,8 @@ typedef struct ThreadSpecificData {
     RegisteredInterp *interpListPtr;
 				/* List of all interpreters registered in the
 				 * current process. */
+    SendConn *connList;		/* List of all send sockets of this thread:
+				 * listening, accepted and connected ones. */
 } ThreadSpecificData;
 static Tcl_ThreadDataKey dataKey;
 
@@ -199,6 +271,13 @@ static struct {
 
 #define MAX_PROP_WORDS 100000
 
+/*
+ * How long (in seconds) to remember that a comm window has no usable
+ * socket:
+ */
+
+#define SOCK_RETRY_TIME 5
+
 /*
  * Forward declarations for functions defined later in this file:
  */
@@ -209,6 +288,9 @@ static void		AppendPropCarefully(Display *display,
 			    Window window, Atom property, char *value,
 			    int length, PendingCommand *pendingPtr);
 static void		DeleteProc(ClientData clientData);
+static void		HandleMessages(TkDisplay *dispPtr,
+			    const char *message, int length,
+			    SendConn *connPtr);
 static void		RegAddName(NameRegistry *regPtr,
 			    const char *name, Window commWindow);
 static void		RegClose(NameRegistry *regPtr);
@@ -223,6 +305,23 @@ static int		ServerSecure(TkDisplay *dispPtr);
 static void		UpdateCommWindow(TkDisplay *dispPtr);
 static int		ValidateName(TkDisplay *dispPtr, const char *name,
 			    Window commWindow, int oldOK);
+#ifndef TK_NO_SEND_SOCKET
+static void		SockAcceptProc(ClientData clientData, int mask);
+static void		SockClose(SendConn *connPtr);
+static SendConn *	SockConnect(TkDisplay *dispPtr, Window commWindow);
+static int		SockDirectory(Tcl_DString *pathPtr, int create);
+static int		SockDoOneEvent(Tcl_Time *timePtr);
+static void		SockFlush(SendConn *connPtr);
+static void		SockFree(void *memPtr);
+static void		SockListen(TkDisplay *dispPtr);
+static SendConn *	SockNew(TkDisplay *dispPtr, int fd,
+			    Window commWindow);
+static int		SockPeerIsUs(int fd);
+static void		SockReadProc(ClientData clientData, int mask);
+static void		SockRemoveStale(const char *dirName);
+static int		SockWrite(SendConn *connPtr, const char *message,
+			    int length);
+#endif /* TK_NO_SEND_SOCKET */
 
 /*
  *----------------------------------------------------------------------
@@ -954,6 +1053,7 @@ Tk_SendObjCmd(
     Tcl_Time timeout;
     NameRegistry *regPtr;
     Tcl_DString request;
+    SendConn *connPtr = NULL;
     ThreadSpecificData *tsdPtr =
 	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
     Tcl_Interp *localInterp;	/* Used when the interpreter to send the
@@ -1072,8 +1172,9 @@ Tk_SendObjCmd(
     }
 
     /*
-     * Send the command to the target interpreter by appending it to the comm
-     * window in the communication window.
+     * Send the command to the target interpreter, through its socket if it
+     * is on this host, otherwise by appending it to the comm property of its
+     * communication window.
      */
 
     localData.sendSerial++;
@@ -1095,16 +1196,34 @@ Tk_SendObjCmd(
 	Tcl_DStringAppend(&request, " ", 1);
 	Tcl_DStringAppend(&request, Tcl_GetString(objv[i]), -1);
     }
-    (void) AppendPropCarefully(dispPtr->display, commWindow,
-	    dispPtr->commProperty, Tcl_DStringValue(&request),
-	    Tcl_DStringLength(&request) + 1, (async ? NULL : &pending));
+#ifndef TK_NO_SEND_SOCKET
+    connPtr = SockConnect(dispPtr, commWindow);
+    if (connPtr != NULL) {
+	Tcl_Preserve(connPtr);
+	if (SockWrite(connPtr, Tcl_DStringValue(&request),
+		Tcl_DStringLength(&request) + 1) != TCL_OK) {
+	    Tcl_Release(connPtr);
+	    connPtr = NULL;
+	}
+    }
+    if (connPtr == NULL)
+#endif /* TK_NO_SEND_SOCKET */
+    {
+	(void) AppendPropCarefully(dispPtr->display, commWindow,
+		dispPtr->commProperty, Tcl_DStringValue(&request),
+		Tcl_DStringLength(&request) + 1, (async ? NULL : &pending));
+    }
     Tcl_DStringFree(&request);
     if (async) {
 	/*
 	 * This is an asynchronous send: return immediately without waiting
-	 * for a response.
+	 * for a response. Any part of the command that did not fit in the
+	 * socket is written out from the event loop.
 	 */
 
+	if (connPtr != NULL) {
+	    Tcl_Release(connPtr);
+	}
 	return TCL_OK;
     }
 
@@ -1125,6 +1244,7 @@ Tk_SendObjCmd(
     pending.errorInfo = NULL;
     pending.errorCode = NULL;
     pending.gotResponse = 0;
+    pending.connPtr = connPtr;
     pending.nextPtr = tsdPtr->pendingCommands;
     tsdPtr->pendingCommands = &pending;
 
@@ -1132,14 +1252,21 @@ Tk_SendObjCmd(
      * Enter a loop processing X events until the result comes in or the
      * target is declared to be dead. While waiting for a result, look only at
      * send-related events so that the send is synchronous with respect to
-     * other events in the application.
+     * other events in the application. If the command went through a socket,
+     * the send sockets must be watched as well.
      */
 
     prevProc = Tk_RestrictEvents(SendRestrictProc, NULL, &prevArg);
     Tcl_GetTime(&timeout);
     timeout.sec += 2;
     while (!pending.gotResponse) {
-	if (!TkUnixDoOneXEvent(&timeout)) {
+#ifndef TK_NO_SEND_SOCKET
+	if (connPtr != NULL) {
+	    result = SockDoOneEvent(&timeout);
+	} else
+#endif /* TK_NO_SEND_SOCKET */
+	result = TkUnixDoOneXEvent(&timeout);
+	if (!result) {
 	    /*
 	     * An unusually long amount of time has elapsed during the
 	     * processing of a sent command. Check to make sure that the
@@ -1166,6 +1293,9 @@ Tk_SendObjCmd(
 	    }
 	}
     }
+    if (connPtr != NULL) {
+	Tcl_Release(connPtr);
+    }
     Tk_RestrictEvents(prevProc, prevArg, &prevArg);
 
     /*
@@ -1310,6 +1440,20 @@ void
 TkSendCleanup(
     TkDisplay *dispPtr)
 {
+#ifndef TK_NO_SEND_SOCKET
+    SendConn *connPtr;
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    for (connPtr = tsdPtr->connList; connPtr != NULL; ) {
+	SendConn *nextPtr = connPtr->nextPtr;
+
+	if (connPtr->dispPtr == dispPtr) {
+	    SockClose(connPtr);
+	}
+	connPtr = nextPtr;
+    }
+#endif /* TK_NO_SEND_SOCKET */
     if (dispPtr->commTkwin != NULL) {
 	Tk_DeleteEventHandler(dispPtr->commTkwin, PropertyChangeMask,
 		SendEventProc, dispPtr);
@@ -1373,6 +1517,9 @@ SendInit(
     dispPtr->appNameProperty = Tk_InternAtom(dispPtr->commTkwin,
 	    "TK_APPLICATION");
 
+#ifndef TK_NO_SEND_SOCKET
+    SockListen(dispPtr);
+#endif
     return TCL_OK;
 }
 
@@ -1403,13 +1550,9 @@ SendEventProc(
 {
     TkDisplay *dispPtr = clientData;
     char *propInfo, **propInfoPtr = &propInfo;
-    const char *p;
     int result, actualFormat;
     unsigned long numItems, bytesAfter;
     Atom actualType;
-    Tcl_Interp *remoteInterp;	/* Interp in which to execute the command. */
-    ThreadSpecificData *tsdPtr =
-	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
 
     if ((eventPtr->xproperty.atom != dispPtr->commProperty)
 	    || (eventPtr->xproperty.state != PropertyNewValue)) {
@@ -1438,13 +1581,51 @@ SendEventProc(
 	return;
     }
 
+    HandleMessages(dispPtr, propInfo, (int) numItems, NULL);
+    XFree(propInfo);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * HandleMessages --
+ *
+ *	This function processes the commands and results contained in a
+ *	message read from the comm property or from a send socket.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Commands in the message are executed, and their results are returned
+ *	to the sender: through connPtr if the message came from a socket,
+ *	otherwise by appending them to the sender's comm window. Results in
+ *	the message are saved for the (ostensibly waiting) "send" commands.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+HandleMessages(
+    TkDisplay *dispPtr,		/* Display the message is for. */
+    const char *message,	/* Commands and results, in the format
+				 * described at the top of this file. */
+    int length,			/* Number of bytes in message. */
+    SendConn *connPtr)		/* Connection the message was read from, or
+				 * NULL if it came from the comm property. */
+{
+    const char *p;
+    int result;
+    Tcl_Interp *remoteInterp;	/* Interp in which to execute the command. */
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
     /*
-     * Several commands and results could arrive in the property at one time;
-     * each iteration through the outer loop handles a single command or
-     * result.
+     * Several commands and results could arrive at one time; each iteration
+     * through the outer loop handles a single command or result.
      */
 
-    for (p = propInfo; (p-propInfo) < (int) numItems; ) {
+    for (p = message; (p-message) < length; ) {
 	/*
 	 * Ignore leading NULLs; each command or result starts with a NULL so
 	 * that no matter how badly formed a preceding command is, we'll be
@@ -1476,7 +1657,7 @@ SendEventProc(
 	    commWindow = None;
 	    serial = "";
 	    script = NULL;
-	    while (((p-propInfo) < (int) numItems) && (*p == '-')) {
+	    while (((p-message) < length) && (*p == '-')) {
 		switch (p[1]) {
 		case 'r':
 		    commWindow = (Window) strtoul(p+2, &end, 16);
@@ -1606,10 +1787,18 @@ SendEventProc(
 		    Tcl_DStringAppend(&reply, "\0-c ", 4);
 		    Tcl_DStringAppend(&reply, buffer, -1);
 		}
-		(void) AppendPropCarefully(dispPtr->display, commWindow,
-			dispPtr->commProperty, Tcl_DStringValue(&reply),
-			Tcl_DStringLength(&reply) + 1, NULL);
-		XFlush(dispPtr->display);
+#ifndef TK_NO_SEND_SOCKET
+		if (connPtr != NULL) {
+		    SockWrite(connPtr, Tcl_DStringValue(&reply),
+			    Tcl_DStringLength(&reply) + 1);
+		} else
+#endif /* TK_NO_SEND_SOCKET */
+		{
+		    (void) AppendPropCarefully(dispPtr->display, commWindow,
+			    dispPtr->commProperty, Tcl_DStringValue(&reply),
+			    Tcl_DStringLength(&reply) + 1, NULL);
+		    XFlush(dispPtr->display);
+		}
 		Tcl_DStringFree(&reply);
 	    }
 	} else if ((*p == 'r') && (p[1] == 0)) {
@@ -1631,7 +1820,7 @@ SendEventProc(
 	    errorInfo = NULL;
 	    errorCode = NULL;
 	    resultString = "";
-	    while (((p-propInfo) < (int) numItems) && (*p == '-')) {
+	    while (((p-message) < length) && (*p == '-')) {
 		switch (p[1]) {
 		case 'c':
 		    if (sscanf(p+2, " %d", &code) != 1) {
@@ -1708,9 +1897,8 @@ SendEventProc(
 	    p++;
 	}
     }
-    XFree(propInfo);
 }
-
+
 /*
  *--------------------------------------------------------------
  *
@@ -1918,6 +2106,831 @@ UpdateCommWindow(
     Tcl_DStringFree(&names);
 }
 
+#ifndef TK_NO_SEND_SOCKET
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockListen --
+ *
+ *	This function creates the socket on which this process accepts sends
+ *	from other processes on the same host, and advertises it on the comm
+ *	window of a display.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A socket is created in the directory given by SockDirectory, and the
+ *	TK_SEND_SOCKET property is set on the comm window. Sockets left in
+ *	the directory by processes that died are removed. If any of this
+ *	fails, nothing happens: other processes then use the comm property
+ *	as before.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockListen(
+    TkDisplay *dispPtr)		/* Display whose comm window has just been
+				 * created. */
+{
+    struct sockaddr_un addr;
+    char hostName[256], buffer[TCL_INTEGER_SPACE * 3];
+    Tcl_DString path, value;
+    SendConn *connPtr;
+    int fd;
+
+    if (!SockDirectory(&path, 1)) {
+	goto done;
+    }
+    SockRemoveStale(Tcl_DStringValue(&path));
+    sprintf(buffer, "/%ld.%d", (long) getpid(),
+	    ConnectionNumber(dispPtr->display));
+    Tcl_DStringAppend(&path, buffer, -1);
+    if (Tcl_DStringLength(&path) >= (int) sizeof(addr.sun_path)) {
+	goto done;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+	goto done;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, Tcl_DStringValue(&path));
+    unlink(addr.sun_path);
+    if ((bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+	    || (listen(fd, 16) != 0)) {
+	close(fd);
+	goto done;
+    }
+    (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    connPtr = SockNew(dispPtr, -1, None);
+    connPtr->fd = fd;
+    connPtr->path = ckalloc(Tcl_DStringLength(&path) + 1);
+    strcpy(connPtr->path, Tcl_DStringValue(&path));
+    Tcl_CreateFileHandler(fd, TCL_READABLE, SockAcceptProc, connPtr);
+
+    if (gethostname(hostName, sizeof(hostName)) != 0) {
+	hostName[0] = '\0';
+    }
+    hostName[sizeof(hostName) - 1] = '\0';
+    Tcl_DStringInit(&value);
+    Tcl_DStringAppend(&value, hostName, -1);
+    Tcl_DStringAppend(&value, " ", 1);
+    Tcl_DStringAppend(&value, connPtr->path, -1);
+    XChangeProperty(dispPtr->display, Tk_WindowId(dispPtr->commTkwin),
+	    Tk_InternAtom(dispPtr->commTkwin, "TK_SEND_SOCKET"), XA_STRING, 8,
+	    PropModeReplace, (unsigned char *) Tcl_DStringValue(&value),
+	    Tcl_DStringLength(&value));
+    Tcl_DStringFree(&value);
+
+  done:
+    Tcl_DStringFree(&path);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockConnect --
+ *
+ *	This function finds a connection to the process owning a comm window,
+ *	making one if that process is on this host and advertises a socket.
+ *
+ * Results:
+ *	The connection, or NULL if the comm property must be used instead.
+ *
+ * Side effects:
+ *	The first time a comm window is seen its TK_SEND_SOCKET property is
+ *	read. A connection is remembered, so later sends to the same window
+ *	need no X requests beyond the registry lookup; the lack of one is
+ *	remembered for SOCK_RETRY_TIME seconds. Only sockets in our own
+ *	SockDirectory are connected to, and only if the process listening on
+ *	them belongs to our user. A socket nobody listens on any more is
+ *	removed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SendConn *
+SockConnect(
+    TkDisplay *dispPtr,		/* Display of commWindow. */
+    Window commWindow)		/* Comm window of the target process. */
+{
+    SendConn *connPtr, *nextPtr;
+    Tk_ErrorHandler handler;
+    struct sockaddr_un addr;
+    char hostName[256], *property = NULL, **propertyPtr = &property, *path;
+    int result, actualFormat, fd = -1, dirLength;
+    unsigned long length, bytesAfter;
+    Atom actualType;
+    Tcl_Time now;
+    Tcl_DString dir;
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    /*
+     * Our own comm window is left to the comm property: we could not read
+     * our own replies while blocked writing to ourselves.
+     */
+
+    if (commWindow == Tk_WindowId(dispPtr->commTkwin)) {
+	return NULL;
+    }
+    Tcl_GetTime(&now);
+    for (connPtr = tsdPtr->connList; connPtr != NULL; connPtr = nextPtr) {
+	nextPtr = connPtr->nextPtr;
+	if ((connPtr->fd < 0) && (connPtr->commWindow != None)
+		&& (now.sec >= connPtr->retryTime)) {
+	    SockClose(connPtr);
+	    continue;
+	}
+	if ((connPtr->dispPtr == dispPtr)
+		&& (connPtr->commWindow == commWindow)) {
+	    return (connPtr->fd < 0) ? NULL : connPtr;
+	}
+    }
+
+    handler = Tk_CreateErrorHandler(dispPtr->display, -1, -1, -1, NULL,
+	    NULL);
+    result = XGetWindowProperty(dispPtr->display, commWindow,
+	    Tk_InternAtom(dispPtr->commTkwin, "TK_SEND_SOCKET"), 0,
+	    MAX_PROP_WORDS, False, XA_STRING, &actualType, &actualFormat,
+	    &length, &bytesAfter, (unsigned char **) propertyPtr);
+    Tk_DeleteErrorHandler(handler);
+    if ((result == Success) && (actualType == XA_STRING)
+	    && (actualFormat == 8) && (property != NULL)
+	    && ((path = strchr(property, ' ')) != NULL)) {
+	*path++ = '\0';
+	if (gethostname(hostName, sizeof(hostName)) != 0) {
+	    hostName[0] = '\0';
+	}
+	hostName[sizeof(hostName) - 1] = '\0';
+	if ((strcmp(property, hostName) == 0)
+		&& (strlen(path) < sizeof(addr.sun_path))
+		&& SockDirectory(&dir, 0)) {
+	    /*
+	     * Only a file directly inside our own directory will do: the
+	     * property can be set by anybody who can talk to the X server.
+	     */
+
+	    dirLength = Tcl_DStringLength(&dir);
+	    if ((strncmp(path, Tcl_DStringValue(&dir), dirLength) == 0)
+		    && (path[dirLength] == '/') && (path[dirLength+1] != '.')
+		    && (path[dirLength+1] != '\0')
+		    && (strchr(path + dirLength + 1, '/') == NULL)) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((fd >= 0) && (connect(fd, (struct sockaddr *) &addr,
+			sizeof(addr)) != 0)) {
+		    if (errno == ECONNREFUSED) {
+			unlink(path);
+		    }
+		    close(fd);
+		    fd = -1;
+		}
+		if ((fd >= 0) && !SockPeerIsUs(fd)) {
+		    close(fd);
+		    fd = -1;
+		}
+	    }
+	    Tcl_DStringFree(&dir);
+	}
+    }
+    if (property != NULL) {
+	XFree(property);
+    }
+    if (fd >= 0) {
+	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+	(void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    connPtr = SockNew(dispPtr, fd, commWindow);
+    connPtr->retryTime = now.sec + SOCK_RETRY_TIME;
+    return (fd < 0) ? NULL : connPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockDirectory --
+ *
+ *	This function finds the directory holding the send sockets of our
+ *	user: "tk-send-" followed by the user id, in $TMPDIR (or /tmp). The
+ *	directory must belong to us and nobody else may enter it; that is what
+ *	keeps other users from connecting to our sockets, or from passing
+ *	theirs off as ours.
+ *
+ * Results:
+ *	Returns 1 and leaves the directory's name in *pathPtr if the directory
+ *	exists and is safe to use, otherwise 0 with *pathPtr freed.
+ *
+ * Side effects:
+ *	If create is non-zero, the directory is created if need be.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SockDirectory(
+    Tcl_DString *pathPtr,	/* Uninitialized string to hold the name. */
+    int create)			/* Non-zero means create the directory if it
+				 * doesn't exist yet. */
+{
+    struct stat info;
+    const char *tmpDir;
+    char buffer[TCL_INTEGER_SPACE + 10];
+
+    tmpDir = getenv("TMPDIR");
+    if ((tmpDir == NULL) || (*tmpDir == '\0')) {
+	tmpDir = "/tmp";
+    }
+    Tcl_DStringInit(pathPtr);
+    Tcl_DStringAppend(pathPtr, tmpDir, -1);
+    sprintf(buffer, "/tk-send-%lu", (unsigned long) getuid());
+    Tcl_DStringAppend(pathPtr, buffer, -1);
+
+    if (create && (mkdir(Tcl_DStringValue(pathPtr), 0700) != 0)
+	    && (errno != EEXIST)) {
+	Tcl_DStringFree(pathPtr);
+	return 0;
+    }
+    if ((lstat(Tcl_DStringValue(pathPtr), &info) != 0)
+	    || !S_ISDIR(info.st_mode) || (info.st_uid != getuid())
+	    || (info.st_mode & 077)) {
+	Tcl_DStringFree(pathPtr);
+	return 0;
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockRemoveStale --
+ *
+ *	This function removes the sockets that processes which died without
+ *	cleaning up left in our SockDirectory.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Every socket in the directory that nobody listens on is removed. A
+ *	live process sees a connection that is closed at once.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockRemoveStale(
+    const char *dirName)	/* Name of our SockDirectory. */
+{
+    DIR *dirPtr;
+    struct dirent *entryPtr;
+    struct sockaddr_un addr;
+    struct stat info;
+    int fd, dirLength = strlen(dirName);
+
+    dirPtr = opendir(dirName);
+    if (dirPtr == NULL) {
+	return;
+    }
+    while ((entryPtr = readdir(dirPtr)) != NULL) {
+	if ((entryPtr->d_name[0] == '.') || (dirLength + 1
+		+ strlen(entryPtr->d_name) >= sizeof(addr.sun_path))) {
+	    continue;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	sprintf(addr.sun_path, "%s/%s", dirName, entryPtr->d_name);
+	if ((lstat(addr.sun_path, &info) != 0) || !S_ISSOCK(info.st_mode)) {
+	    continue;
+	}
+
+	/*
+	 * Don't wait for a live process that is too busy to accept.
+	 */
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+	    break;
+	}
+	(void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	if ((connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+		&& (errno == ECONNREFUSED)) {
+	    unlink(addr.sun_path);
+	}
+	close(fd);
+    }
+    closedir(dirPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockPeerIsUs --
+ *
+ *	This function checks that the process at the other end of a send
+ *	connection runs as our user.
+ *
+ * Results:
+ *	1 if it does, 0 if it doesn't or the system can't tell.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SockPeerIsUs(
+    int fd)			/* Connected socket. */
+{
+#ifdef HAVE_GETPEEREID
+    uid_t uid;
+    gid_t gid;
+
+    return (getpeereid(fd, &uid, &gid) == 0) && (uid == getuid());
+#else
+    struct ucred cred;
+    socklen_t length = sizeof(cred);
+
+    return (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) == 0)
+	    && (cred.uid == getuid());
+#endif /* HAVE_GETPEEREID */
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockNew --
+ *
+ *	This function records a new send connection.
+ *
+ * Results:
+ *	The new connection.
+ *
+ * Side effects:
+ *	The connection is added to the thread's list and, if fd is a socket,
+ *	its input is watched by SockReadProc.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static SendConn *
+SockNew(
+    TkDisplay *dispPtr,		/* Display the connection serves. */
+    int fd,			/* Connected socket, or -1. */
+    Window commWindow)		/* Comm window of the peer, or None. */
+{
+    SendConn *connPtr = ckalloc(sizeof(SendConn));
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    connPtr->fd = fd;
+    connPtr->dispPtr = dispPtr;
+    connPtr->commWindow = commWindow;
+    connPtr->path = NULL;
+    connPtr->retryTime = 0;
+    connPtr->input = NULL;
+    connPtr->inputLength = 0;
+    connPtr->inputSpace = 0;
+    connPtr->output = NULL;
+    connPtr->outputLength = 0;
+    connPtr->outputSpace = 0;
+    connPtr->nextPtr = tsdPtr->connList;
+    tsdPtr->connList = connPtr;
+    if (fd >= 0) {
+	Tcl_CreateFileHandler(fd, TCL_READABLE, SockReadProc, connPtr);
+    }
+    return connPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockAcceptProc --
+ *
+ *	This function is invoked when another process connects to our send
+ *	socket.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A connection is added for the new peer, unless it runs as another
+ *	user.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockAcceptProc(
+    ClientData clientData,	/* The listening socket. */
+    int mask)			/* Not used. */
+{
+    SendConn *listenPtr = clientData;
+    int fd;
+
+    fd = accept(listenPtr->fd, NULL, NULL);
+    if (fd < 0) {
+	return;
+    }
+    if (!SockPeerIsUs(fd)) {
+	close(fd);
+	return;
+    }
+    (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    SockNew(listenPtr->dispPtr, fd, None);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockReadProc --
+ *
+ *	This function is invoked when a send connection becomes readable, or
+ *	writable while it has output waiting.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Waiting output is written. Complete messages that have arrived are
+ *	handled just like the contents of the comm property. The connection
+ *	is closed when the peer goes away.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockReadProc(
+    ClientData clientData,	/* The connection. */
+    int mask)			/* TCL_READABLE and/or TCL_WRITABLE. */
+{
+    SendConn *connPtr = clientData;
+    const unsigned char *header;
+    char *message;
+    int count, length;
+
+    if (connPtr->fd < 0) {
+	return;
+    }
+    Tcl_Preserve(connPtr);
+    if (mask & TCL_WRITABLE) {
+	SockFlush(connPtr);
+    }
+    if (!(mask & TCL_READABLE) || (connPtr->fd < 0)) {
+	goto done;
+    }
+
+    if (connPtr->inputSpace - connPtr->inputLength < 4096) {
+	connPtr->inputSpace = 2 * connPtr->inputSpace + 4096;
+	connPtr->input = ckrealloc(connPtr->input, connPtr->inputSpace);
+    }
+    count = read(connPtr->fd, connPtr->input + connPtr->inputLength,
+	    (size_t) (connPtr->inputSpace - connPtr->inputLength));
+    if (count <= 0) {
+	if ((count == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+		&& (errno != EINTR))) {
+	    SockClose(connPtr);
+	}
+	goto done;
+    }
+    connPtr->inputLength += count;
+
+    /*
+     * Take each complete message out of the input buffer before handling
+     * it: the script may reenter the event loop and read more input.
+     */
+
+    while ((connPtr->fd >= 0) && (connPtr->inputLength >= 4)) {
+	header = (const unsigned char *) connPtr->input;
+	length = (int) (((unsigned) header[0] << 24) | (header[1] << 16)
+		| (header[2] << 8) | header[3]);
+	if (length < 0) {
+	    SockClose(connPtr);
+	    break;
+	}
+	if (connPtr->inputLength - 4 < length) {
+	    break;
+	}
+	message = ckalloc(length + 1);
+	memcpy(message, connPtr->input + 4, (size_t) length);
+	message[length] = '\0';
+	connPtr->inputLength -= length + 4;
+	memmove(connPtr->input, connPtr->input + length + 4,
+		(size_t) connPtr->inputLength);
+	HandleMessages(connPtr->dispPtr, message, length, connPtr);
+	ckfree(message);
+    }
+
+  done:
+    Tcl_Release(connPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockWrite --
+ *
+ *	This function sends a message on a send connection.
+ *
+ * Results:
+ *	TCL_OK if the message was sent or queued, TCL_ERROR if the connection
+ *	is closed.
+ *
+ * Side effects:
+ *	Whatever does not fit in the socket right away is kept and written
+ *	from the event loop, so that two processes sending to each other
+ *	cannot block each other.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SockWrite(
+    SendConn *connPtr,		/* Connection to write to. */
+    const char *message,	/* Message, in the format described at the
+				 * top of this file. */
+    int length)			/* Number of bytes in message. */
+{
+    unsigned char *header;
+
+    if (connPtr->fd < 0) {
+	return TCL_ERROR;
+    }
+    if (connPtr->outputSpace < connPtr->outputLength + length + 4) {
+	connPtr->outputSpace = 2 * connPtr->outputSpace + length + 4;
+	connPtr->output = ckrealloc(connPtr->output, connPtr->outputSpace);
+    }
+    header = (unsigned char *) connPtr->output + connPtr->outputLength;
+    header[0] = (unsigned char) (length >> 24);
+    header[1] = (unsigned char) (length >> 16);
+    header[2] = (unsigned char) (length >> 8);
+    header[3] = (unsigned char) length;
+    memcpy(header + 4, message, (size_t) length);
+    connPtr->outputLength += length + 4;
+    SockFlush(connPtr);
+    return (connPtr->fd < 0) ? TCL_ERROR : TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockFlush --
+ *
+ *	This function writes as much of a connection's waiting output as the
+ *	socket accepts without blocking.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The connection is watched for writability while output remains, and
+ *	is closed if the peer has gone away.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockFlush(
+    SendConn *connPtr)		/* Connection to write. */
+{
+    int count, flags = 0;
+
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+    while (connPtr->outputLength > 0) {
+	count = send(connPtr->fd, connPtr->output,
+		(size_t) connPtr->outputLength, flags);
+	if (count < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+		break;
+	    }
+	    SockClose(connPtr);
+	    return;
+	}
+	connPtr->outputLength -= count;
+	memmove(connPtr->output, connPtr->output + count,
+		(size_t) connPtr->outputLength);
+    }
+    Tcl_CreateFileHandler(connPtr->fd,
+	    TCL_READABLE | (connPtr->outputLength > 0 ? TCL_WRITABLE : 0),
+	    SockReadProc, connPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockClose --
+ *
+ *	This function closes a send connection or the listening socket.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The socket is closed (and, for the listening socket, removed). Sends
+ *	still waiting for a response on the connection fail. The structure is
+ *	freed once nobody uses it any more.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SockClose(
+    SendConn *connPtr)		/* Connection to close. */
+{
+    SendConn **connPtrPtr;
+    PendingCommand *pcPtr;
+    static const char msg[] = "target application died";
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    if (connPtr->fd >= 0) {
+	Tcl_DeleteFileHandler(connPtr->fd);
+	close(connPtr->fd);
+	connPtr->fd = -1;
+    }
+    if (connPtr->path != NULL) {
+	unlink(connPtr->path);
+    }
+    for (connPtrPtr = &tsdPtr->connList; *connPtrPtr != NULL;
+	    connPtrPtr = &(*connPtrPtr)->nextPtr) {
+	if (*connPtrPtr == connPtr) {
+	    *connPtrPtr = connPtr->nextPtr;
+	    break;
+	}
+    }
+    for (pcPtr = tsdPtr->pendingCommands; pcPtr != NULL;
+	    pcPtr = pcPtr->nextPtr) {
+	if ((pcPtr->connPtr == connPtr) && !pcPtr->gotResponse) {
+	    pcPtr->code = TCL_ERROR;
+	    pcPtr->result = ckalloc(sizeof(msg));
+	    strcpy(pcPtr->result, msg);
+	    pcPtr->gotResponse = 1;
+	}
+    }
+    Tcl_EventuallyFree(connPtr, (Tcl_FreeProc *) SockFree);
+}
+
+static void
+SockFree(
+    void *memPtr)		/* Connection to free. */
+{
+    SendConn *connPtr = memPtr;
+
+    if (connPtr->path != NULL) {
+	ckfree(connPtr->path);
+    }
+    if (connPtr->input != NULL) {
+	ckfree(connPtr->input);
+    }
+    if (connPtr->output != NULL) {
+	ckfree(connPtr->output);
+    }
+    ckfree(connPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SockDoOneEvent --
+ *
+ *	This function takes the place of TkUnixDoOneXEvent while a send that
+ *	went through a socket waits for its response: it waits for X events
+ *	and for activity on the send sockets, whichever comes first.
+ *
+ * Results:
+ *	0 if the timeout expired without anything happening, 1 otherwise.
+ *
+ * Side effects:
+ *	Socket activity is handled; X events are handled as by
+ *	TkUnixDoOneXEvent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SockDoOneEvent(
+    Tcl_Time *timePtr)		/* Absolute time at which to give up. */
+{
+    TkDisplay *dispPtr;
+    SendConn *connPtr;
+    fd_set readSet, writeSet;
+    struct timeval blockTime;
+    Tcl_Time now;
+    int numFdBits = 0, numFound, mask, gotX = 0;
+    ThreadSpecificData *tsdPtr =
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+
+    /*
+     * If X events are already waiting, TkUnixDoOneXEvent handles them
+     * without blocking.
+     */
+
+    for (dispPtr = TkGetDisplayList(); dispPtr != NULL;
+	    dispPtr = dispPtr->nextPtr) {
+	if (QLength(dispPtr->display) > 0) {
+	    return TkUnixDoOneXEvent(timePtr);
+	}
+    }
+
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    for (dispPtr = TkGetDisplayList(); dispPtr != NULL;
+	    dispPtr = dispPtr->nextPtr) {
+	XFlush(dispPtr->display);
+	FD_SET(ConnectionNumber(dispPtr->display), &readSet);
+	if (numFdBits <= ConnectionNumber(dispPtr->display)) {
+	    numFdBits = ConnectionNumber(dispPtr->display) + 1;
+	}
+    }
+    for (connPtr = tsdPtr->connList; connPtr != NULL;
+	    connPtr = connPtr->nextPtr) {
+	if (connPtr->fd < 0) {
+	    continue;
+	}
+	FD_SET(connPtr->fd, &readSet);
+	if (connPtr->outputLength > 0) {
+	    FD_SET(connPtr->fd, &writeSet);
+	}
+	if (numFdBits <= connPtr->fd) {
+	    numFdBits = connPtr->fd + 1;
+	}
+    }
+
+    Tcl_GetTime(&now);
+    blockTime.tv_sec = timePtr->sec - now.sec;
+    blockTime.tv_usec = timePtr->usec - now.usec;
+    if (blockTime.tv_usec < 0) {
+	blockTime.tv_sec -= 1;
+	blockTime.tv_usec += 1000000;
+    }
+    if (blockTime.tv_sec < 0) {
+	blockTime.tv_sec = 0;
+	blockTime.tv_usec = 0;
+    }
+    numFound = select(numFdBits, &readSet, &writeSet, NULL, &blockTime);
+    if (numFound <= 0) {
+	return (numFound < 0) && (errno == EINTR);
+    }
+
+    /*
+     * Handle the sockets one at a time, starting over after each since the
+     * handlers may open and close connections.
+     */
+
+  again:
+    for (connPtr = tsdPtr->connList; connPtr != NULL;
+	    connPtr = connPtr->nextPtr) {
+	if (connPtr->fd < 0) {
+	    continue;
+	}
+	mask = 0;
+	if (FD_ISSET(connPtr->fd, &readSet)) {
+	    mask |= TCL_READABLE;
+	    FD_CLR(connPtr->fd, &readSet);
+	}
+	if (FD_ISSET(connPtr->fd, &writeSet)) {
+	    mask |= TCL_WRITABLE;
+	    FD_CLR(connPtr->fd, &writeSet);
+	}
+	if (mask == 0) {
+	    continue;
+	}
+	if (connPtr->path != NULL) {
+	    SockAcceptProc(connPtr, mask);
+	} else {
+	    SockReadProc(connPtr, mask);
+	}
+	goto again;
+    }
+
+    for (dispPtr = TkGetDisplayList(); dispPtr != NULL;
+	    dispPtr = dispPtr->nextPtr) {
+	if (FD_ISSET(ConnectionNumber(dispPtr->display), &readSet)) {
+	    gotX = 1;
+	}
+    }
+    if (gotX) {
+	Tcl_GetTime(&now);
+	TkUnixDoOneXEvent(&now);
+    }
+    return 1;
+}
+#endif /* TK_NO_SEND_SOCKET */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1945,10 +2958,10 @@ TkpTestsendCmd(
     Tcl_Obj *const objv[])		/* Argument strings. */
 {
     enum {
-	TESTSEND_BOGUS, TESTSEND_PROP, TESTSEND_SERIAL
+	TESTSEND_BOGUS, TESTSEND_PROP, TESTSEND_SERIAL, TESTSEND_SOCKET
     };
     static const char *const testsendOptions[] = {
-	"bogus",   "prop",   "serial",  NULL
+	"bogus",   "prop",   "serial",  "socket",  NULL
     };
     TkWindow *winPtr = clientData;
     int index;
@@ -2026,6 +3039,38 @@ TkpTestsendCmd(
 	}
     } else if (index == TESTSEND_SERIAL) {
 	Tcl_SetObjResult(interp, Tcl_NewIntObj(localData.sendSerial+1));
+    } else if (index == TESTSEND_SOCKET) {
+	/*
+	 * Report whether sends to an application go through a socket.
+	 */
+
+	NameRegistry *regPtr;
+	Window commWindow;
+	int connected = 0;
+#ifndef TK_NO_SEND_SOCKET
+	SendConn *connPtr;
+	ThreadSpecificData *tsdPtr =
+		Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
+#endif
+
+	if (objc != 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "appName");
+	    return TCL_ERROR;
+	}
+	regPtr = RegOpen(interp, winPtr->dispPtr, 0);
+	commWindow = RegFindName(regPtr, Tcl_GetString(objv[2]));
+	RegClose(regPtr);
+#ifndef TK_NO_SEND_SOCKET
+	for (connPtr = tsdPtr->connList; connPtr != NULL;
+		connPtr = connPtr->nextPtr) {
+	    if ((connPtr->dispPtr == winPtr->dispPtr) && (commWindow != None)
+		    && (connPtr->commWindow == commWindow)
+		    && (connPtr->fd >= 0)) {
+		connected = 1;
+	    }
+	}
+#endif /* TK_NO_SEND_SOCKET */
+	Tcl_SetObjResult(interp, Tcl_NewBooleanObj(connected));
     }
     return TCL_OK;
 }
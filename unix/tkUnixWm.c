@@ -73,6 +73,12 @@ typedef struct TkWmInfo {
 				 * be window's immediate parent). If the
 				 * window isn't reparented, this has the value
 				 * None. */
+    Window wrapperParent;	/* Immediate parent of the wrapper, from the
+				 * last ReparentNotify event for it. */
+    int xInWrapperParent, yInWrapperParent;
+				/* Position of the wrapper's outer corner in
+				 * wrapperParent, from the last ReparentNotify
+				 * or real ConfigureNotify event for it. */
     char *title;		/* Title to display in window caption. If
 				 * NULL, use name of widget. Malloced. */
     char *iconName;		/* Name to display in icon. Malloced. */
@@ -176,6 +182,18 @@ typedef struct TkWmInfo {
 				 * issued to change geometry of the wrapper.
 				 * Used to eliminate redundant resize
 				 * operations. */
+    unsigned long configSerial;	/* Serial number of the last such request
+				 * for an override-redirect window, whose new
+				 * geometry is recorded without waiting for
+				 * the ConfigureNotify; older ConfigureNotify
+				 * events are stale and ignored. 0 once the
+				 * event for it has arrived. */
+    unsigned long mapSerial;	/* Likewise for the last map or unmap request
+				 * for an override-redirect window, whose
+				 * effect is recorded without waiting for the
+				 * MapNotify or UnmapNotify: older such events
+				 * are stale, and the one for the request
+				 * itself has already been handled. */
 
     /*
      * Information about the virtual root window for this top-level, if there
@@ -217,6 +235,24 @@ typedef struct TkWmInfo {
     struct TkWmInfo *nextPtr;	/* Next in list of all top-level windows. */
 } WmInfo;
 
+/*
+ * What is known about a window that a reparenting window manager has put
+ * around a toplevel, or one of its ancestors up to the root. Each such
+ * window is queried from the server once, when it is first met; from then
+ * on the StructureNotify events that Tk selects on it keep the record up to
+ * date. This way following the ancestry of a toplevel and finding where its
+ * decorative frame is cost no round trips. The records are kept in the
+ * display's wmFrameTable, and removed when the window is destroyed.
+ */
+
+typedef struct WmFrame {
+    Window parent;		/* Parent of the window. */
+    int x, y;			/* Position of the window's outer corner in
+				 * its parent. */
+    int width, height;		/* Inside dimensions of the window. */
+    int borderWidth;		/* Width of the window's border. */
+} WmFrame;
+
 /*
  * Flag values for WmInfo structures:
  *
@@ -339,6 +375,10 @@ typedef struct WaitRestrictInfo {
  */
 
 static int		ComputeReparentGeometry(WmInfo *wmPtr);
+static int		GetWmFrame(TkDisplay *dispPtr, Window window,
+			    WmFrame *framePtr);
+static int		WmFrameEventProc(ClientData clientData,
+			    XEvent *eventPtr);
 static void		ConfigureEvent(WmInfo *wmPtr,
 			    XConfigureEvent *eventPtr);
 static void		CreateWrapper(WmInfo *wmPtr);
@@ -373,6 +413,9 @@ static void		WaitForConfigureNotify(TkWindow *winPtr,
 static int		WaitForEvent(Display *display,
 			    WmInfo *wmInfoPtr, int type, XEvent *eventPtr);
 static void		WaitForMapNotify(TkWindow *winPtr, int mapped);
+static void		MapOverrideRedirect(WmInfo *wmPtr, int mapped,
+			    unsigned long serial);
+static void		MapStateEvent(WmInfo *wmPtr, XEvent *eventPtr);
 static Tk_RestrictProc WaitRestrictProc;
 static void		WrapperEventProc(ClientData clientData,
 			    XEvent *eventPtr);
@@ -541,6 +584,198 @@ void TkWmCleanup(
 	ckfree(dispPtr->iconDataPtr);
 	dispPtr->iconDataPtr = NULL;
     }
+    if (dispPtr->wmFrameInit) {
+	Tcl_HashEntry *hPtr;
+	Tcl_HashSearch search;
+
+	Tk_DeleteGenericHandler(WmFrameEventProc, dispPtr);
+	for (hPtr = Tcl_FirstHashEntry(&dispPtr->wmFrameTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    ckfree(Tcl_GetHashValue(hPtr));
+	}
+	Tcl_DeleteHashTable(&dispPtr->wmFrameTable);
+	dispPtr->wmFrameInit = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetWmFrame --
+ *
+ *	Finds out the parent and geometry of a window around a toplevel (see
+ *	WmFrame). The first time a window is asked about, the server is
+ *	queried and the window is watched for changes; after that, the answer
+ *	comes from the display's wmFrameTable. Tk's own windows and root
+ *	windows are always queried, since selecting events on them here would
+ *	replace the events Tk already selects.
+ *
+ * Results:
+ *	Returns 1 and fills in *framePtr, or returns 0 if the window doesn't
+ *	exist.
+ *
+ * Side effects:
+ *	May add an entry to wmFrameTable and select StructureNotify events on
+ *	the window.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetWmFrame(
+    TkDisplay *dispPtr,		/* Display the window is on. */
+    Window window,		/* The window to ask about. */
+    WmFrame *framePtr)		/* Filled in with what is known about the
+				 * window. */
+{
+    Display *display = dispPtr->display;
+    Tcl_HashEntry *hPtr;
+    Tk_ErrorHandler handler;
+    Window root, parent, *children;
+    unsigned nChildren, width, height, bd, depth;
+    int x, y, i, isNew, watch;
+    Status status;
+
+    if (!dispPtr->wmFrameInit) {
+	Tcl_InitHashTable(&dispPtr->wmFrameTable, TCL_ONE_WORD_KEYS);
+	Tk_CreateGenericHandler(WmFrameEventProc, dispPtr);
+	dispPtr->wmFrameInit = 1;
+    }
+    hPtr = Tcl_FindHashEntry(&dispPtr->wmFrameTable, (char *) window);
+    if (hPtr != NULL) {
+	*framePtr = *((WmFrame *) Tcl_GetHashValue(hPtr));
+	return 1;
+    }
+
+    watch = (Tk_IdToWindow(display, window) == NULL);
+    for (i = 0; i < ScreenCount(display); i++) {
+	if (window == RootWindow(display, i)) {
+	    watch = 0;
+	}
+    }
+
+    /*
+     * Select the events before asking, so that no change made after the
+     * answer goes unnoticed.
+     */
+
+    handler = Tk_CreateErrorHandler(display, -1, -1, -1, NULL, NULL);
+    if (watch) {
+	XSelectInput(display, window, StructureNotifyMask);
+    }
+    status = XQueryTree(display, window, &root, &parent, &children,
+	    &nChildren);
+    if (status != 0) {
+	if (children != NULL) {
+	    XFree((char *) children);
+	}
+	status = XGetGeometry(display, window, &root, &x, &y, &width, &height,
+		&bd, &depth);
+    }
+    Tk_DeleteErrorHandler(handler);
+    if (status == 0) {
+	return 0;
+    }
+    framePtr->parent = parent;
+    framePtr->x = x;
+    framePtr->y = y;
+    framePtr->width = (int) width;
+    framePtr->height = (int) height;
+    framePtr->borderWidth = (int) bd;
+    if (watch) {
+	WmFrame *newPtr = ckalloc(sizeof(WmFrame));
+
+	*newPtr = *framePtr;
+	hPtr = Tcl_CreateHashEntry(&dispPtr->wmFrameTable, (char *) window,
+		&isNew);
+	Tcl_SetHashValue(hPtr, newPtr);
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WmFrameEventProc --
+ *
+ *	Generic event handler that keeps the records of wmFrameTable up to
+ *	date from the StructureNotify events of the windows concerned.
+ *
+ * Results:
+ *	Returns 0, so that the event is processed further.
+ *
+ * Side effects:
+ *	A record is updated or removed. When the window directly below the
+ *	root that holds a toplevel moves or changes size, the toplevel's
+ *	position is recomputed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+WmFrameEventProc(
+    ClientData clientData,	/* The display whose frames are tracked. */
+    XEvent *eventPtr)		/* Event that just happened. */
+{
+    TkDisplay *dispPtr = clientData;
+    Tcl_HashEntry *hPtr;
+    WmFrame *framePtr;
+    WmInfo *wmPtr;
+
+    if ((eventPtr->xany.display != dispPtr->display)
+	    || eventPtr->xany.send_event) {
+	return 0;
+    }
+    switch (eventPtr->type) {
+    case ConfigureNotify:
+	if (eventPtr->xconfigure.event != eventPtr->xconfigure.window) {
+	    return 0;
+	}
+	hPtr = Tcl_FindHashEntry(&dispPtr->wmFrameTable,
+		(char *) eventPtr->xconfigure.window);
+	if (hPtr == NULL) {
+	    return 0;
+	}
+	framePtr = Tcl_GetHashValue(hPtr);
+	framePtr->x = eventPtr->xconfigure.x;
+	framePtr->y = eventPtr->xconfigure.y;
+	framePtr->width = eventPtr->xconfigure.width;
+	framePtr->height = eventPtr->xconfigure.height;
+	framePtr->borderWidth = eventPtr->xconfigure.border_width;
+	for (wmPtr = dispPtr->firstWmPtr; wmPtr != NULL;
+		wmPtr = wmPtr->nextPtr) {
+	    if ((wmPtr->reparent == eventPtr->xconfigure.window)
+		    && ComputeReparentGeometry(wmPtr)) {
+		wmPtr->winPtr->changes.x = wmPtr->wrapperPtr->changes.x;
+		wmPtr->winPtr->changes.y = wmPtr->wrapperPtr->changes.y
+			+ wmPtr->menuHeight;
+	    }
+	}
+	break;
+    case ReparentNotify:
+	if (eventPtr->xreparent.event != eventPtr->xreparent.window) {
+	    return 0;
+	}
+	hPtr = Tcl_FindHashEntry(&dispPtr->wmFrameTable,
+		(char *) eventPtr->xreparent.window);
+	if (hPtr == NULL) {
+	    return 0;
+	}
+	framePtr = Tcl_GetHashValue(hPtr);
+	framePtr->parent = eventPtr->xreparent.parent;
+	framePtr->x = eventPtr->xreparent.x;
+	framePtr->y = eventPtr->xreparent.y;
+	break;
+    case DestroyNotify:
+	hPtr = Tcl_FindHashEntry(&dispPtr->wmFrameTable,
+		(char *) eventPtr->xdestroywindow.window);
+	if (hPtr != NULL) {
+	    ckfree(Tcl_GetHashValue(hPtr));
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+	break;
+    }
+    return 0;
 }
 
 /*
@@ -615,6 +850,8 @@ TkWmNewWindow(
 	    + 2*winPtr->changes.border_width;
     wmPtr->configWidth = -1;
     wmPtr->configHeight = -1;
+    wmPtr->configSerial = 0;
+    wmPtr->mapSerial = 0;
     wmPtr->vRoot = None;
     wmPtr->flags = WM_NEVER_MAPPED;
     wmPtr->nextPtr = (WmInfo *) dispPtr->firstWmPtr;
@@ -661,6 +898,7 @@ TkWmMapWindow(
 {
     register WmInfo *wmPtr = winPtr->wmInfoPtr;
     XTextProperty textProp;
+    unsigned long serial;
 
     if (wmPtr->flags & WM_NEVER_MAPPED) {
 	Tcl_DString ds;
@@ -761,12 +999,18 @@ TkWmMapWindow(
 
     /*
      * Map the window, then wait to be sure that the window manager has
-     * processed the map operation.
+     * processed the map operation. There is no window manager to wait for
+     * with an override-redirect window.
      */
 
+    serial = NextRequest(winPtr->display);
     XMapWindow(winPtr->display, wmPtr->wrapperPtr->window);
     if (wmPtr->hints.initial_state == NormalState) {
-	WaitForMapNotify(winPtr, 1);
+	if (Tk_Attributes((Tk_Window) wmPtr->wrapperPtr)->override_redirect) {
+	    MapOverrideRedirect(wmPtr, 1, serial);
+	} else {
+	    WaitForMapNotify(winPtr, 1);
+	}
     }
 }
 
@@ -792,6 +1036,9 @@ TkWmUnmapWindow(
     TkWindow *winPtr)		/* Top-level window that's about to be
 				 * mapped. */
 {
+    WmInfo *wmPtr = winPtr->wmInfoPtr;
+    unsigned long serial;
+
     /*
      * It seems to be important to wait after unmapping a top-level window
      * until the window really gets unmapped. I don't completely understand
@@ -800,10 +1047,16 @@ TkWmUnmapWindow(
      * get lost so that we think the window isn't mapped when in fact it is
      * mapped. I suspect that this has something to do with the window manager
      * filtering Map events (and possily not filtering Unmap events?).
+     * None of this applies to override-redirect windows.
      */
 
-    XUnmapWindow(winPtr->display, winPtr->wmInfoPtr->wrapperPtr->window);
-    WaitForMapNotify(winPtr, 0);
+    serial = NextRequest(winPtr->display);
+    XUnmapWindow(winPtr->display, wmPtr->wrapperPtr->window);
+    if (Tk_Attributes((Tk_Window) wmPtr->wrapperPtr)->override_redirect) {
+	MapOverrideRedirect(wmPtr, 0, serial);
+    } else {
+	WaitForMapNotify(winPtr, 0);
+    }
 }
 
 /*
@@ -4034,6 +4287,10 @@ ConfigureEvent(
     wrapperPtr->changes.border_width = configEventPtr->border_width;
     wrapperPtr->changes.sibling = configEventPtr->above;
     wrapperPtr->changes.stack_mode = Above;
+    if (!configEventPtr->send_event) {
+	wmPtr->xInWrapperParent = configEventPtr->x;
+	wmPtr->yInWrapperParent = configEventPtr->y;
+    }
 
     /*
      * Reparenting window managers make life difficult. If the window manager
@@ -4127,11 +4384,11 @@ ReparentEvent(
 				 * wmPtr->wrapperPtr. */
 {
     TkWindow *wrapperPtr = wmPtr->wrapperPtr;
-    Window vRoot, ancestor, *children, dummy2, *virtualRootPtr, **vrPtrPtr;
+    Window vRoot, *virtualRootPtr, **vrPtrPtr;
     Atom actualType;
     int actualFormat;
     unsigned long numItems, bytesAfter;
-    unsigned dummy;
+    WmFrame frame;
     Tk_ErrorHandler handler;
     TkDisplay *dispPtr = wmPtr->winPtr->dispPtr;
     Atom WM_ROOT = Tk_InternAtom((Tk_Window) wrapperPtr, "__WM_ROOT");
@@ -4183,6 +4440,9 @@ ReparentEvent(
      * longer reparented.
      */
 
+    wmPtr->wrapperParent = reparentEventPtr->parent;
+    wmPtr->xInWrapperParent = reparentEventPtr->x;
+    wmPtr->yInWrapperParent = reparentEventPtr->y;
     if (reparentEventPtr->parent == vRoot) {
     noReparent:
 	wmPtr->reparent = None;
@@ -4201,27 +4461,23 @@ ReparentEvent(
      * is just below the (virtual) root. This is tricky because it's possible
      * that things have changed since the event was generated so that the
      * ancestry indicated by the event no longer exists. If this happens then
-     * an error will occur and we just discard the event (there will be a more
-     * up-to-date ReparentNotify event coming later).
+     * the search fails and we just discard the event (there will be a more
+     * up-to-date ReparentNotify event coming later). Windows met before are
+     * answered without asking the server (see GetWmFrame).
      */
 
-    handler = Tk_CreateErrorHandler(wrapperPtr->display, -1,-1,-1, NULL,NULL);
     wmPtr->reparent = reparentEventPtr->parent;
     while (1) {
-	if (XQueryTree(wrapperPtr->display, wmPtr->reparent, &dummy2,
-		&ancestor, &children, &dummy) == 0) {
-	    Tk_DeleteErrorHandler(handler);
+	if (!GetWmFrame(dispPtr, wmPtr->reparent, &frame)) {
 	    goto noReparent;
 	}
-	XFree((char *) children);
-	if ((ancestor == vRoot) ||
-		(ancestor == RootWindow(wrapperPtr->display,
+	if ((frame.parent == vRoot) ||
+		(frame.parent == RootWindow(wrapperPtr->display,
 		wrapperPtr->screenNum))) {
 	    break;
 	}
-	wmPtr->reparent = ancestor;
+	wmPtr->reparent = frame.parent;
     }
-    Tk_DeleteErrorHandler(handler);
 
     if (!ComputeReparentGeometry(wmPtr)) {
 	goto noReparent;
@@ -4256,20 +4512,38 @@ ComputeReparentGeometry(
 {
     TkWindow *wrapperPtr = wmPtr->wrapperPtr;
     int width, height, bd;
-    unsigned dummy;
     int xOffset, yOffset, x, y;
-    Window dummy2;
-    Status status;
-    Tk_ErrorHandler handler;
+    Window window;
+    WmFrame frame;
+    int status = 1;
     TkDisplay *dispPtr = wmPtr->winPtr->dispPtr;
 
-    handler = Tk_CreateErrorHandler(wrapperPtr->display, -1,-1,-1, NULL,NULL);
-    (void) XTranslateCoordinates(wrapperPtr->display, wrapperPtr->window,
-	    wmPtr->reparent, 0, 0, &xOffset, &yOffset, &dummy2);
-    status = XGetGeometry(wrapperPtr->display, wmPtr->reparent,
-	    &dummy2, &x, &y, (unsigned *) &width, (unsigned *) &height,
-	    (unsigned *) &bd, &dummy);
-    Tk_DeleteErrorHandler(handler);
+    /*
+     * Work out where the inside of the wrapper is within the reparent by
+     * adding up the positions of the windows in between, then get the
+     * reparent's own geometry. All of this normally comes from what earlier
+     * events said, without a round trip.
+     */
+
+    xOffset = wmPtr->xInWrapperParent + wrapperPtr->changes.border_width;
+    yOffset = wmPtr->yInWrapperParent + wrapperPtr->changes.border_width;
+    for (window = wmPtr->wrapperParent; window != wmPtr->reparent;
+	    window = frame.parent) {
+	if ((window == None) || !GetWmFrame(dispPtr, window, &frame)) {
+	    status = 0;
+	    break;
+	}
+	xOffset += frame.x + frame.borderWidth;
+	yOffset += frame.y + frame.borderWidth;
+    }
+    if (status) {
+	status = GetWmFrame(dispPtr, wmPtr->reparent, &frame);
+	x = frame.x;
+	y = frame.y;
+	width = frame.width;
+	height = frame.height;
+	bd = frame.borderWidth;
+    }
     if (status == 0) {
 	/*
 	 * It appears that the reparented parent went away and no-one told us.
@@ -4401,7 +4675,6 @@ WrapperEventProc(
     XEvent *eventPtr)		/* Event that just happened. */
 {
     WmInfo *wmPtr = clientData;
-    XEvent mapEvent;
     TkDisplay *dispPtr = wmPtr->winPtr->dispPtr;
 
     wmPtr->flags |= WM_VROOT_OFFSET_STALE;
@@ -4432,35 +4705,138 @@ WrapperEventProc(
 	 * width of a top-level window, which results in a synthetic Configure
 	 * event. These events are not relevant to us, and if we process them
 	 * confusion may result (e.g. we may conclude erroneously that the
-	 * user repositioned or resized the window).
+	 * user repositioned or resized the window). Also ignore events that
+	 * predate the last geometry request for an override-redirect window
+	 * (see UpdateGeometryInfo); they have been superseded.
 	 */
 
+	if (wmPtr->configSerial != 0) {
+	    if ((long) (eventPtr->xconfigure.serial - wmPtr->configSerial)
+		    < 0) {
+		return;
+	    }
+	    wmPtr->configSerial = 0;
+	}
 	if (!(wmPtr->flags & WM_NEVER_MAPPED)) {
 	    ConfigureEvent(wmPtr, &eventPtr->xconfigure);
 	}
-    } else if (eventPtr->type == MapNotify) {
+    } else if ((eventPtr->type == MapNotify)
+	    || (eventPtr->type == UnmapNotify)) {
+	/*
+	 * Ignore the events for map and unmap requests of override-redirect
+	 * windows, which MapOverrideRedirect has already handled.
+	 */
+
+	if (wmPtr->mapSerial != 0) {
+	    if ((long) (eventPtr->xany.serial - wmPtr->mapSerial) < 0) {
+		return;
+	    }
+	    wmPtr->mapSerial = 0;
+	    if ((eventPtr->type == MapNotify)
+		    == ((wmPtr->wrapperPtr->flags & TK_MAPPED) != 0)) {
+		return;
+	    }
+	}
+	MapStateEvent(wmPtr, eventPtr);
+    } else if (eventPtr->type == ReparentNotify) {
+	ReparentEvent(wmPtr, &eventPtr->xreparent);
+    } else if (eventPtr->type == PropertyNotify) {
+	PropertyEvent(wmPtr, &eventPtr->xproperty);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapStateEvent --
+ *
+ *	Records that the wrapper of a toplevel has been mapped or unmapped,
+ *	and passes the news on to the toplevel.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The toplevel is mapped or unmapped in its wrapper, and gets a
+ *	MapNotify or UnmapNotify event.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MapStateEvent(
+    WmInfo *wmPtr,		/* Information about toplevel window. */
+    XEvent *eventPtr)		/* MapNotify or UnmapNotify event for the
+				 * wrapper. */
+{
+    XEvent mapEvent;
+
+    if (eventPtr->type == MapNotify) {
 	wmPtr->wrapperPtr->flags |= TK_MAPPED;
 	wmPtr->winPtr->flags |= TK_MAPPED;
 	XMapWindow(wmPtr->winPtr->display, wmPtr->winPtr->window);
-	goto doMapEvent;
-    } else if (eventPtr->type == UnmapNotify) {
+    } else {
 	wmPtr->wrapperPtr->flags &= ~TK_MAPPED;
 	wmPtr->winPtr->flags &= ~TK_MAPPED;
 	XUnmapWindow(wmPtr->winPtr->display, wmPtr->winPtr->window);
-	goto doMapEvent;
-    } else if (eventPtr->type == ReparentNotify) {
-	ReparentEvent(wmPtr, &eventPtr->xreparent);
-    } else if (eventPtr->type == PropertyNotify) {
-	PropertyEvent(wmPtr, &eventPtr->xproperty);
     }
-    return;
-
-  doMapEvent:
     mapEvent = *eventPtr;
     mapEvent.xmap.event = wmPtr->winPtr->window;
     mapEvent.xmap.window = wmPtr->winPtr->window;
     Tk_HandleEvent(&mapEvent);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapOverrideRedirect --
+ *
+ *	Called after a map or unmap request for the wrapper of an
+ *	override-redirect toplevel, instead of WaitForMapNotify. No window
+ *	manager can intervene, so the server carries out the request as made
+ *	and its effect can be recorded at once, saving a round trip every
+ *	time a menu or tooltip is posted or unposted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Same as MapStateEvent. The MapNotify or UnmapNotify event for the
+ *	request, and any older ones, will be ignored when they arrive.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MapOverrideRedirect(
+    WmInfo *wmPtr,		/* Information about toplevel window. */
+    int mapped,			/* Non-zero if the wrapper was mapped, zero if
+				 * it was unmapped. */
+    unsigned long serial)	/* Serial number of the request. */
+{
+    TkWindow *wrapperPtr = wmPtr->wrapperPtr;
+    XEvent event;
+
+    wmPtr->flags &= ~WM_MOVE_PENDING;
+    wmPtr->mapSerial = serial;
+    if (mapped == ((wrapperPtr->flags & TK_MAPPED) != 0)) {
+	return;
+    }
+    memset(&event, 0, sizeof(event));
+    if (mapped) {
+	event.type = MapNotify;
+	event.xmap.override_redirect = True;
+    } else {
+	event.type = UnmapNotify;
+	event.xunmap.from_configure = False;
+    }
+    event.xany.serial = serial;
+    event.xany.send_event = False;
+    event.xany.display = wrapperPtr->display;
+    event.xmap.event = wrapperPtr->window;
+    event.xmap.window = wrapperPtr->window;
+    MapStateEvent(wmPtr, &event);
+}
 
 /*
  *----------------------------------------------------------------------
@@ -4781,10 +5157,30 @@ UpdateGeometryInfo(
     /*
      * Wait for the configure operation to complete. Don't need to do this,
      * however, if the window is about to be mapped: it will be taken care of
-     * elsewhere.
+     * elsewhere. Nor for an override-redirect window (menus, tooltips and
+     * the like): no window manager can intervene, so the server applies the
+     * request as made and the new geometry can be recorded now, saving a
+     * round trip on every post.
      */
 
-    if (!(wmPtr->flags & WM_ABOUT_TO_MAP)) {
+    if (Tk_Attributes((Tk_Window) wmPtr->wrapperPtr)->override_redirect) {
+	TkWindow *wrapperPtr = wmPtr->wrapperPtr;
+
+	if (wmPtr->flags & WM_MOVE_PENDING) {
+	    wrapperPtr->changes.x = x;
+	    wrapperPtr->changes.y = y;
+	    winPtr->changes.x = x;
+	    winPtr->changes.y = y + wmPtr->menuHeight;
+	}
+	wrapperPtr->changes.width = width;
+	wrapperPtr->changes.height = height;
+	winPtr->changes.width = width;
+	winPtr->changes.height = height - wmPtr->menuHeight;
+	wmPtr->parentWidth = width + 2*wrapperPtr->changes.border_width;
+	wmPtr->parentHeight = height + 2*wrapperPtr->changes.border_width;
+	wmPtr->configSerial = serial;
+	wmPtr->flags &= ~WM_MOVE_PENDING;
+    } else if (!(wmPtr->flags & WM_ABOUT_TO_MAP)) {
 	WaitForConfigureNotify(winPtr, serial);
     }
 }
@@ -7330,6 +7726,7 @@ TkpWmSetState(
 				 * WithdrawnState. */
 {
     WmInfo *wmPtr = winPtr->wmInfoPtr;
+    unsigned long serial;
 
     if (state == WithdrawnState) {
 	wmPtr->hints.initial_state = WithdrawnState;
@@ -7337,11 +7734,16 @@ TkpWmSetState(
 	if (wmPtr->flags & WM_NEVER_MAPPED) {
 	    return 1;
 	}
+	serial = NextRequest(winPtr->display);
 	if (XWithdrawWindow(winPtr->display, wmPtr->wrapperPtr->window,
 		winPtr->screenNum) == 0) {
 	    return 0;
 	}
-	WaitForMapNotify(winPtr, 0);
+	if (Tk_Attributes((Tk_Window) wmPtr->wrapperPtr)->override_redirect) {
+	    MapOverrideRedirect(wmPtr, 0, serial);
+	} else {
+	    WaitForMapNotify(winPtr, 0);
+	}
     } else if (state == NormalState) {
 	wmPtr->hints.initial_state = NormalState;
 	wmPtr->withdrawn = 0;